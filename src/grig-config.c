@@ -42,6 +42,7 @@
 #endif
 #include "grig-debug.h"
 #include "grig-config.h"
+#include "rig-mem.h"
 
 
 
@@ -221,6 +222,59 @@ static gint
 check_mem_files ()
 {
 	gint status = 0;
+	GDir  *dir = NULL;
+	gchar *dirname;
+	const gchar *fname;
+	gchar *fpath;
+	gint   version;
+	GError *err = NULL;
+
+
+	grig_debug_local (RIG_DEBUG_VERBOSE,
+					  _("..Memory files:"));
+
+	/* scan .grig directory for .mem files */
+	dirname = g_strconcat (g_get_home_dir (), G_DIR_SEPARATOR_S, ".grig", NULL);
+	dir = g_dir_open (dirname, 0, &err);
+
+	if (err != NULL) {
+		grig_debug_local (RIG_DEBUG_ERR,
+						  _("%s: %s"),
+						  __FUNCTION__, err->message);
+		g_clear_error (&err);
+		g_free (dirname);
+
+		return -1;
+	}
+
+	while ((fname = g_dir_read_name (dir)) != NULL) {
+
+		fpath = g_strconcat (dirname, G_DIR_SEPARATOR_S, fname, NULL);
+		if ((!g_file_test (fpath, G_FILE_TEST_IS_DIR)) &&
+			g_str_has_suffix (fname, ".mem")) {
+
+			/* there is no older format to update from yet */
+			version = rig_mem_file_version (fpath);
+
+			if (version > GRIG_MEM_CFG_VER) {
+				grig_debug_local (RIG_DEBUG_ERR,
+								  _("....%s has version %d; this grig reads version %d"),
+								  fname, version, GRIG_MEM_CFG_VER);
+				status = -1;
+			}
+			else {
+				grig_debug_local (RIG_DEBUG_VERBOSE,
+								  (version == GRIG_MEM_CFG_VER) ?
+								  _("....%s OK") : _("....%s is not a memory file"),
+								  fname);
+			}
+		}
+		g_free (fpath);
+
+	}
+
+	g_dir_close (dir);
+	g_free (dirname);
 
 	return status;
 }
@@ -36,16 +36,58 @@
  * hamlib and grig itself. The debug messages are printed on stderr and
  * saved into a file, if the debug handler has been initialised with a file
  * name.
+ *
+ * Debug messages are often generated by the daemon thread in the middle of
+ * a serial transaction. To keep logging from stretching the daemon cycle,
+ * the message is only formatted into a slot of a lock-free ring buffer
+ * together with its time stamp; splitting, time formatting and writing is
+ * done by a separate writer thread. The ring buffer is a bounded
+ * multi-producer single-consumer queue where each slot carries a sequence
+ * number telling whether it is free or holds a message. If the buffer is
+ * full the message is dropped and counted. Before the writer thread has
+ * been started and after it has been stopped, messages are written
+ * synchronously.
+ *
+ * Errors and warnings are filtered before they are written, so that a
+ * failing rig cannot flood the log. Repeated messages are collapsed: a
+ * message identical to one written
+ * less than DEBUG_DEDUP_WINDOW seconds ago (same source, level and text)
+ * is only counted. When the window of the original message expires, a
+ * single record telling how many times it was repeated and when the first
+ * and the last repetition occurred is written instead. Messages that get
+ * through are subject to a token-bucket rate limit per source, so that a
+ * failure storm of varying messages cannot flood the log either; messages
+ * exceeding the rate are counted and reported when the rate is back to
+ * normal. Both happen before the message is split and formatted for output.
+ * Verbose and trace messages have been asked for explicitly and are always
+ * written.
+ *
+ * The log file is size-bounded: when it reaches the maximum size it is
+ * closed and renamed to filename.1, the older segments are shifted to
+ * filename.2 ... filename.N and the oldest one is deleted. Optionally, the
+ * closed segment is compressed by running gzip in the background; the
+ * next rotation waits for it to finish, so that a segment is never renamed
+ * while it is being compressed. The active segment always has the original
+ * file name.
  */
 #include <glib.h>
 #include <glib/gi18n.h>
 #include <glib/gprintf.h>
+#include <glib/gstdio.h>
+#include <stdio.h>
+#include <string.h>
 #include <time.h>
 #include <sys/time.h>
 #include <hamlib/rig.h>
 #ifdef HAVE_CONFIG_H
 #  include <config.h>
 #endif
+#ifdef G_OS_WIN32
+#  include <windows.h>
+#else
+#  include <sys/types.h>
+#  include <sys/wait.h>
+#endif
 #include "grig-debug.h"
 
 
@@ -54,7 +96,109 @@
 static enum rig_debug_level_e dbglvl = RIG_DEBUG_NONE;
 
 static gchar      *logfname = NULL;
-/*static GIOChannel *logfile  = NULL;*/
+static FILE       *logfile  = NULL;
+
+static gulong      logsize     = 0;                         /*!< Size of active segment. */
+static gulong      logmaxsize  = GRIG_DEBUG_DEF_LOG_SIZE;   /*!< Max size of a segment. */
+static guint       logcount    = GRIG_DEBUG_DEF_LOG_COUNT;  /*!< Number of old segments. */
+static gboolean    logcompress = FALSE;                     /*!< Compress old segments. */
+static GPid        gzpid;                                   /*!< The running gzip process. */
+static gboolean    gzrunning   = FALSE;                     /*!< Whether gzpid is valid. */
+
+#if GLIB_CHECK_VERSION(2,32,0)
+static GMutex      logmutex;
+#  define LOG_LOCK()   g_mutex_lock (&logmutex)
+#  define LOG_UNLOCK() g_mutex_unlock (&logmutex)
+#else
+static GStaticMutex logmutex = G_STATIC_MUTEX_INIT;
+#  define LOG_LOCK()   g_static_mutex_lock (&logmutex)
+#  define LOG_UNLOCK() g_static_mutex_unlock (&logmutex)
+#endif
+
+
+/** \brief Number of slots in the message queue; must be a power of 2. */
+#define DEBUG_QUEUE_SIZE   1024
+
+/** \brief Max size of a formatted message incl. terminating NUL. */
+#define DEBUG_MSG_SIZE     512
+
+/** \brief Writer thread sleep time when queue is empty [msec]. */
+#define DEBUG_WRITER_SLEEP 10
+
+
+/** \brief Number of distinct recent messages remembered for deduplication. */
+#define DEBUG_DEDUP_SIZE   16
+
+/** \brief Time window within which identical messages are collapsed [sec]. */
+#define DEBUG_DEDUP_WINDOW 10
+
+/** \brief Sustained number of messages per second and source. */
+#define DEBUG_RATE         20
+
+/** \brief Max number of messages per source in a burst. */
+#define DEBUG_BURST        100
+
+
+/** \brief One slot of the message queue. */
+typedef struct {
+	volatile gint            seq;          /*!< Sequence number of slot. */
+	GTimeVal                 time;         /*!< Time when message was generated. */
+	debug_msg_src_t          source;       /*!< Message source. */
+	enum rig_debug_level_e   level;        /*!< Debug level. */
+	gchar                    msg[DEBUG_MSG_SIZE];  /*!< The formatted message. */
+} debug_slot_t;
+
+
+static debug_slot_t   queue[DEBUG_QUEUE_SIZE];  /*!< The message queue. */
+static volatile gint  qhead = 0;                /*!< Next slot to write (producers). */
+static gint           qtail = 0;                /*!< Next slot to read (writer thread). */
+static volatile gint  dropped = 0;              /*!< Number of dropped messages. */
+
+static GThread       *writer = NULL;            /*!< The writer thread. */
+static volatile gint  writer_run = 0;           /*!< Flag indicating whether the writer should run. */
+static volatile gint  accepting = 0;            /*!< Flag indicating whether messages may be queued. */
+static volatile gint  producers = 0;            /*!< Number of threads currently queueing a message. */
+
+
+/** \brief A recently written message. */
+typedef struct {
+	gboolean                 used;         /*!< Whether the entry is in use. */
+	guint                    hash;         /*!< Hash value of the message text. */
+	debug_msg_src_t          source;       /*!< Message source. */
+	enum rig_debug_level_e   level;        /*!< Debug level. */
+	GTimeVal                 first;        /*!< Time when the message was written. */
+	GTimeVal                 last;         /*!< Time of the last repetition. */
+	guint                    count;        /*!< Number of repetitions. */
+	gchar                    msg[DEBUG_MSG_SIZE];  /*!< The message. */
+} debug_dedup_t;
+
+/** \brief Token bucket limiting the message rate of a source. */
+typedef struct {
+	gdouble                  tokens;       /*!< Available tokens. */
+	GTimeVal                 stamp;        /*!< Time of last refill. */
+	guint                    suppressed;   /*!< Number of suppressed messages. */
+} debug_bucket_t;
+
+/** \brief A report on repeated or suppressed messages waiting to be written. */
+typedef struct {
+	debug_msg_src_t          source;       /*!< Message source. */
+	enum rig_debug_level_e   level;        /*!< Debug level. */
+	GTimeVal                 time;         /*!< Time stamp of the report. */
+	gchar                   *msg;          /*!< The report. */
+} debug_report_t;
+
+static debug_dedup_t  dedup[DEBUG_DEDUP_SIZE];  /*!< Recently written messages. */
+static debug_bucket_t bucket[MSG_SRC_GRIG + 1]; /*!< Rate limit per source. */
+
+#if GLIB_CHECK_VERSION(2,32,0)
+static GMutex      dedupmutex;
+#  define DEDUP_LOCK()   g_mutex_lock (&dedupmutex)
+#  define DEDUP_UNLOCK() g_mutex_unlock (&dedupmutex)
+#else
+static GStaticMutex dedupmutex = G_STATIC_MUTEX_INIT;
+#  define DEDUP_LOCK()   g_static_mutex_lock (&dedupmutex)
+#  define DEDUP_UNLOCK() g_static_mutex_unlock (&dedupmutex)
+#endif
 
 
 const gchar *SRC_TO_STR[] = {N_("NONE"), N_("HAMLIB"), N_("GRIG")};
@@ -62,7 +206,37 @@ const gchar *SRC_TO_STR[] = {N_("NONE"), N_("HAMLIB"), N_("GRIG")};
 
 static void manage_debug_message (debug_msg_src_t source,
 				  enum rig_debug_level_e debug_level,
+				  const GTimeVal *tval,
 				  const gchar *message);
+static void     debug_queue_init  (void);
+static gboolean debug_enqueue     (debug_msg_src_t source,
+				   enum rig_debug_level_e debug_level,
+				   const char *fmt,
+				   va_list ap);
+static gboolean debug_dequeue     (void);
+static gpointer debug_writer      (gpointer data);
+static void     debug_write_lines (debug_msg_src_t source,
+				   enum rig_debug_level_e debug_level,
+				   const GTimeVal *tval,
+				   gchar *msg);
+static void     debug_filter      (debug_msg_src_t source,
+				   enum rig_debug_level_e debug_level,
+				   const GTimeVal *tval,
+				   gchar *msg);
+static void     debug_expire      (const GTimeVal *tval, gboolean all,
+				   GSList **reports);
+static void     debug_dedup_flush (debug_dedup_t *entry, GSList **reports);
+static GSList  *debug_report      (GSList *reports,
+				   debug_msg_src_t source,
+				   enum rig_debug_level_e debug_level,
+				   const GTimeVal *tval,
+				   gchar *msg);
+static void     debug_write_reports (GSList *reports);
+static gboolean debug_rate_check  (debug_msg_src_t source, const GTimeVal *tval);
+static gdouble  debug_time_diff   (const GTimeVal *t1, const GTimeVal *t0);
+static void     debug_log_rotate  (void);
+static void     debug_log_wait    (void);
+static gchar   *debug_log_segment (guint index, gboolean gz);
 
 
 
@@ -77,12 +251,55 @@ void
 grig_debug_init  (gchar *filename)
 {
 
-        if (filename != NULL) {
-                /*** FIXME: open file for write/append ***/
+        GError *err = NULL;
+
+
+        if ((filename != NULL) && (logfile == NULL)) {
+
+                logfile = g_fopen (filename, "a");
+
+                if (logfile != NULL) {
+                        logfname = g_strdup (filename);
+                        setvbuf (logfile, NULL, _IOLBF, BUFSIZ);
+
+                        /* continue with existing file */
+                        fseek (logfile, 0, SEEK_END);
+                        logsize = (gulong) ftell (logfile);
+                }
+                else {
+                        g_fprintf (stderr, _("%s: Could not open %s\n"),
+                                   __FUNCTION__, filename);
+                }
+        }
+
+        /* start writer thread; messages are written synchronously
+           if this fails */
+        if (writer == NULL) {
+                debug_queue_init ();
+                g_atomic_int_set (&writer_run, 1);
+
+#if !GLIB_CHECK_VERSION(2,32,0)
+                writer = g_thread_create (debug_writer, NULL, TRUE, &err);
+#else
+                writer = g_thread_try_new ("debug writer", debug_writer, NULL, &err);
+#endif
+                if (writer == NULL) {
+                        g_atomic_int_set (&writer_run, 0);
+                }
+                else {
+                        g_atomic_int_set (&accepting, 1);
+                }
         }
 
         /* set debug handler */
         rig_set_debug_callback (grig_debug_hamlib_cb, NULL);
+
+        if (err != NULL) {
+                grig_debug_local (RIG_DEBUG_ERR,
+                                  _("%s: Failed to start writer thread: %s"),
+                                  __FUNCTION__, err->message);
+                g_clear_error (&err);
+        }
         
         /* send debug message to indicate readiness of debug handler */
         grig_debug_local (RIG_DEBUG_VERBOSE,
@@ -100,6 +317,7 @@ grig_debug_init  (gchar *filename)
 void
 grig_debug_close ()
 {
+        GSList *reports = NULL;
 
         /* send a final debug message */
         grig_debug_local (RIG_DEBUG_VERBOSE,
@@ -109,7 +327,43 @@ grig_debug_close ()
         /* remove debug handler */
         rig_set_debug_callback (NULL, NULL);
 
+        /* stop accepting messages and wait for the threads which
+           are putting a message into the queue right now; later
+           messages are written synchronously */
+        g_atomic_int_set (&accepting, 0);
+        while (g_atomic_int_get (&producers) > 0) {
+                g_usleep (1000);
+        }
+
+        /* stop writer thread; it will write the remaining
+           messages before it exits */
+        if (writer != NULL) {
+                g_atomic_int_set (&writer_run, 0);
+                g_thread_join (writer);
+                writer = NULL;
+        }
+
+        /* report pending repetitions and suppressed messages */
+        DEDUP_LOCK ();
+        debug_expire (NULL, TRUE, &reports);
+        DEDUP_UNLOCK ();
+
+        debug_write_reports (reports);
+
         /* close log file if open */
+        LOG_LOCK ();
+
+        if (logfile != NULL) {
+                fclose (logfile);
+                logfile = NULL;
+        }
+
+        debug_log_wait ();
+
+        g_free (logfname);
+        logfname = NULL;
+
+        LOG_UNLOCK ();
 }
 
 
@@ -123,38 +377,23 @@ grig_debug_hamlib_cb    (enum rig_debug_level_e debug_level,
 {
 
 	gchar          *msg;       /* formatted debug message */
-	gchar         **msgv;      /* debug message line by line */
-	guint           numlines;  /* the number of lines in the message */
-	guint           i;
+	GTimeVal        tval;      /* time stamp */
 
 
 	if (debug_level > dbglvl)
 		return RIG_OK;
 
+	/* hand the message over to the writer thread */
+	if (debug_enqueue (MSG_SRC_HAMLIB, debug_level, fmt, ap)) {
 
-	/* create character string and split it in case
-	   it is a multi-line message */
-	msg = g_strdup_vprintf (fmt, ap);
-
-	/* remove trailing \n */
-	g_strchomp (msg);
-
-	/* split the message in case it is a multiline message */
-	msgv = g_strsplit_set (msg, "\n", 0);
-	numlines = g_strv_length (msgv);
-
-	g_free (msg);
-
-	/* for each line in msgv, call the real debug handler
-	   which will print the debug message and save it to
-	   a logfile
-	*/
-	for (i = 0; i < numlines; i++) {
-		manage_debug_message (MSG_SRC_HAMLIB, debug_level, msgv[i]);
+		return RIG_OK;
 	}
 
-
-	g_strfreev (msgv);
+	/* create character string and write it */
+	msg = g_strdup_vprintf (fmt, ap);
+	g_get_current_time (&tval);
+	debug_filter (MSG_SRC_HAMLIB, debug_level, &tval, msg);
+	g_free (msg);
 	
 	return RIG_OK;
 
@@ -169,9 +408,7 @@ grig_debug_local    (enum rig_debug_level_e debug_level,
 {
 
 	gchar      *msg;       /* formatted debug message */
-	gchar     **msgv;      /* debug message line by line */
-	guint       numlines;  /* the number of lines in the message */
-	guint       i;
+	GTimeVal    tval;      /* time stamp */
 	va_list     ap;
 
 
@@ -181,30 +418,21 @@ grig_debug_local    (enum rig_debug_level_e debug_level,
 
 	va_start (ap, fmt);
 
-	/* create character string and split it in case
-	   it is a multi-line message */
-	msg = g_strdup_vprintf (fmt, ap);
+	/* hand the message over to the writer thread */
+	if (debug_enqueue (MSG_SRC_GRIG, debug_level, fmt, ap)) {
 
-	/* remove trailing \n */
-	g_strchomp (msg);
+		va_end (ap);
 
-	/* split the message in case it is a multiline message */
-	msgv = g_strsplit_set (msg, "\n", 0);
-	numlines = g_strv_length (msgv);
+		return RIG_OK;
+	}
 
+	/* create character string and write it */
+	msg = g_strdup_vprintf (fmt, ap);
+	g_get_current_time (&tval);
+	debug_filter (MSG_SRC_GRIG, debug_level, &tval, msg);
 	g_free (msg);
 
-	/* for each line in msgv, call the real debug handler
-	   which will print the debug message and save it to
-	   a logfile
-	*/
-	for (i = 0; i < numlines; i++) {
-		manage_debug_message (MSG_SRC_GRIG, debug_level, msgv[i]);
-	}
-
 	va_end(ap);
-
-	g_strfreev (msgv);
 	
 	return RIG_OK;
 
@@ -216,7 +444,8 @@ grig_debug_local    (enum rig_debug_level_e debug_level,
  *  \return The name of the current log file or NULL.
  *
  * The function returns the name of the currently use log file or NULL
- * if the debug messages are not saved to file. In case of non NULL return
+ * if the debug messages are not saved to file. This is always the active
+ * segment, i.e. the file the messages are currently written to. In case of non NULL return
  * value, the function returns a newly allocated string that should be freed
  * by the caller when no longer needed.
  */
@@ -235,24 +464,18 @@ grig_debug_get_log_file ()
 
 
 /***** FIXME: portability issues because of time? */
-/***** FIXME: size management sucks */
 static void
 manage_debug_message (debug_msg_src_t source,
 		      enum rig_debug_level_e debug_level,
+		      const GTimeVal *tval,
 		      const gchar *message)
 {
 	gchar msg_time[50];
 	guint size;
-	//struct timeval tval;
-	//struct timezone tzone;
 	time_t t;
-	//gint x;
-	GTimeVal tval;
 
-	/* get the time */
-	//x = gettimeofday (&tval, &tzone);
-	g_get_current_time (&tval);
-	t = (time_t ) tval.tv_sec;
+	/* format the time */
+	t = (time_t ) tval->tv_sec;
 	size = strftime (msg_time, 48, "%Y/%m/%d %H:%M:%S", localtime (&t));
 	if (size < 49) {
 		msg_time[size] = '\0';
@@ -271,6 +494,49 @@ manage_debug_message (debug_msg_src_t source,
 		   GRIG_DEBUG_SEPARATOR,
 		   message);
 
+	LOG_LOCK ();
+
+	if (logfile != NULL) {
+		size = g_fprintf (logfile,
+				  "%s%s%s%s%d%s%s\n",
+				  msg_time,
+				  GRIG_DEBUG_SEPARATOR,
+				  SRC_TO_STR[source],
+				  GRIG_DEBUG_SEPARATOR,
+				  debug_level,
+				  GRIG_DEBUG_SEPARATOR,
+				  message);
+
+		if ((gint) size > 0) {
+			logsize += size;
+		}
+
+		if (logsize >= logmaxsize) {
+			debug_log_rotate ();
+		}
+	}
+
+	LOG_UNLOCK ();
+}
+
+
+/** \brief Set log file rotation parameters.
+ *  \param maxsize The maximum size of a segment in bytes (0 means default).
+ *  \param count The number of old segments to keep (0 means default).
+ *  \param compress Flag indicating whether old segments should be compressed.
+ *
+ * This function should be called before grig_debug_init().
+ */
+void
+grig_debug_set_log_rotation (gulong maxsize, guint count, gboolean compress)
+{
+	LOG_LOCK ();
+
+	logmaxsize  = (maxsize > 0) ? maxsize : GRIG_DEBUG_DEF_LOG_SIZE;
+	logcount    = (count > 0) ? count : GRIG_DEBUG_DEF_LOG_COUNT;
+	logcompress = compress;
+
+	LOG_UNLOCK ();
 }
 
 
@@ -290,3 +556,614 @@ grig_debug_get_level ()
 	return (int) (dbglvl);
 }
 
+
+/** \brief Reset the message queue.
+ *
+ * This function marks all slots of the message queue as free. It must not
+ * be called while the writer thread is running.
+ */
+static void
+debug_queue_init ()
+{
+	gint i;
+
+	for (i = 0; i < DEBUG_QUEUE_SIZE; i++) {
+		g_atomic_int_set (&queue[i].seq, i);
+	}
+
+	g_atomic_int_set (&qhead, 0);
+	qtail = 0;
+	g_atomic_int_set (&dropped, 0);
+}
+
+
+/** \brief Put a message into the queue.
+ *  \param source The message source.
+ *  \param debug_level The debug level.
+ *  \param fmt The format string.
+ *  \param ap The arguments.
+ *  \return TRUE if the message has been taken care of, FALSE if the queue
+ *          does not accept messages.
+ *
+ * This function may be called from any thread. A free slot is claimed by
+ * advancing the head index with compare-and-exchange, whereafter the message
+ * is formatted directly into the slot and the slot is published by updating
+ * its sequence number. No memory is allocated and no locks are taken.
+ * Messages longer than DEBUG_MSG_SIZE are truncated. If the queue is full,
+ * the message is dropped and counted; the writer thread will report the
+ * number of dropped messages.
+ *
+ * The producer count is raised before the accepting flag is checked, so
+ * that grig_debug_close() can wait for every message that got past the
+ * check to be published before the writer thread does its final flush.
+ */
+static gboolean
+debug_enqueue     (debug_msg_src_t source,
+		   enum rig_debug_level_e debug_level,
+		   const char *fmt,
+		   va_list ap)
+{
+	debug_slot_t *slot;
+	gint          pos;
+	gint          dif;
+
+	g_atomic_int_inc (&producers);
+
+	if (!g_atomic_int_get (&accepting)) {
+		g_atomic_int_add (&producers, -1);
+
+		return FALSE;
+	}
+
+	pos = g_atomic_int_get (&qhead);
+
+	for (;;) {
+		slot = &queue[pos & (DEBUG_QUEUE_SIZE - 1)];
+		dif = (gint) ((guint) g_atomic_int_get (&slot->seq) - (guint) pos);
+
+		if (dif == 0) {
+			/* slot is free; try to claim it */
+			if (g_atomic_int_compare_and_exchange (&qhead, pos, (gint) ((guint) pos + 1)))
+				break;
+
+			pos = g_atomic_int_get (&qhead);
+		}
+		else if (dif < 0) {
+			/* queue is full */
+			g_atomic_int_inc (&dropped);
+			g_atomic_int_add (&producers, -1);
+
+			return TRUE;
+		}
+		else {
+			/* somebody else got the slot */
+			pos = g_atomic_int_get (&qhead);
+		}
+	}
+
+	g_get_current_time (&slot->time);
+	slot->source = source;
+	slot->level = debug_level;
+	g_vsnprintf (slot->msg, DEBUG_MSG_SIZE, fmt, ap);
+
+	/* publish */
+	g_atomic_int_set (&slot->seq, (gint) ((guint) pos + 1));
+	g_atomic_int_add (&producers, -1);
+
+	return TRUE;
+}
+
+
+/** \brief Write the oldest message in the queue.
+ *  \return TRUE if a message has been written, FALSE if the queue was empty.
+ *
+ * This function may only be called by the writer thread.
+ */
+static gboolean
+debug_dequeue ()
+{
+	debug_slot_t *slot;
+	gint          dif;
+
+	slot = &queue[qtail & (DEBUG_QUEUE_SIZE - 1)];
+	dif = (gint) ((guint) g_atomic_int_get (&slot->seq) - ((guint) qtail + 1));
+
+	if (dif < 0) {
+		/* empty (or the message is still being written) */
+		return FALSE;
+	}
+
+	debug_filter (slot->source, slot->level, &slot->time, slot->msg);
+
+	/* release slot for the next round */
+	g_atomic_int_set (&slot->seq, (gint) ((guint) qtail + DEBUG_QUEUE_SIZE));
+	qtail = (gint) ((guint) qtail + 1);
+
+	return TRUE;
+}
+
+
+/** \brief Debug message writer thread.
+ *  \param data Unused.
+ *  \return Always NULL.
+ *
+ * The writer thread writes queued messages until it is told to stop,
+ * whereafter it writes the remaining messages and exits.
+ */
+static gpointer
+debug_writer (gpointer data)
+{
+	GTimeVal tval;
+	GSList  *reports;
+	gint     lost;
+	gchar   *msg;
+
+	while (g_atomic_int_get (&writer_run)) {
+
+		if (!debug_dequeue ()) {
+			/* report repetitions whose window has expired */
+			g_get_current_time (&tval);
+			reports = NULL;
+			DEDUP_LOCK ();
+			debug_expire (&tval, FALSE, &reports);
+			DEDUP_UNLOCK ();
+
+			debug_write_reports (reports);
+
+			g_usleep (1000 * DEBUG_WRITER_SLEEP);
+		}
+
+		/* report dropped messages */
+		lost = g_atomic_int_get (&dropped);
+		if ((lost > 0) && g_atomic_int_compare_and_exchange (&dropped, lost, 0)) {
+			msg = g_strdup_printf (_("%s: %d debug messages dropped"),
+					       __FUNCTION__, lost);
+			g_get_current_time (&tval);
+			debug_write_lines (MSG_SRC_GRIG, RIG_DEBUG_WARN, &tval, msg);
+			g_free (msg);
+		}
+	}
+
+	/* flush */
+	while (debug_dequeue ())
+		;
+
+	return NULL;
+}
+
+
+/** \brief Write a possibly multi-line debug message.
+ *  \param source The message source.
+ *  \param debug_level The debug level.
+ *  \param tval The time when the message was generated.
+ *  \param msg The message; trailing newlines are removed in place.
+ */
+static void
+debug_write_lines (debug_msg_src_t source,
+		   enum rig_debug_level_e debug_level,
+		   const GTimeVal *tval,
+		   gchar *msg)
+{
+	gchar     **msgv;      /* debug message line by line */
+	guint       numlines;  /* the number of lines in the message */
+	guint       i;
+
+	/* remove trailing \n */
+	g_strchomp (msg);
+
+	/* split the message in case it is a multiline message */
+	msgv = g_strsplit_set (msg, "\n", 0);
+	numlines = g_strv_length (msgv);
+
+	/* for each line in msgv, call the real debug handler
+	   which will print the debug message and save it to
+	   a logfile
+	*/
+	for (i = 0; i < numlines; i++) {
+		manage_debug_message (source, debug_level, tval, msgv[i]);
+	}
+
+	g_strfreev (msgv);
+}
+
+
+/** \brief Deduplicate and rate limit a debug message.
+ *  \param source The message source.
+ *  \param debug_level The debug level.
+ *  \param tval The time when the message was generated.
+ *  \param msg The message; it may be modified in place.
+ *
+ * Verbose and trace messages are written as they are. For errors and
+ * warnings: if the same message has been written within the last
+ * DEBUG_DEDUP_WINDOW seconds, it is only counted. Otherwise it is written,
+ * provided the source has not exceeded its rate, and remembered. When all
+ * entries are in use, the oldest one is reported and replaced.
+ *
+ * Reports are collected while the dedup mutex is held and written after it
+ * has been released.
+ */
+static void
+debug_filter      (debug_msg_src_t source,
+		   enum rig_debug_level_e debug_level,
+		   const GTimeVal *tval,
+		   gchar *msg)
+{
+	debug_dedup_t *entry;
+	debug_dedup_t *oldest = NULL;
+	GSList        *reports = NULL;
+	guint          hash;
+	guint          i;
+
+	if (debug_level > RIG_DEBUG_WARN) {
+		debug_write_lines (source, debug_level, tval, msg);
+
+		return;
+	}
+
+	hash = g_str_hash (msg);
+
+	DEDUP_LOCK ();
+
+	debug_expire (tval, FALSE, &reports);
+
+	for (i = 0; i < DEBUG_DEDUP_SIZE; i++) {
+		entry = &dedup[i];
+
+		if (!entry->used) {
+			if ((oldest == NULL) || oldest->used)
+				oldest = entry;
+			continue;
+		}
+
+		if ((entry->hash == hash) && (entry->source == source) &&
+		    (entry->level == debug_level) && !strcmp (entry->msg, msg)) {
+
+			/* repetition */
+			entry->count++;
+			entry->last = *tval;
+
+			DEDUP_UNLOCK ();
+
+			debug_write_reports (reports);
+
+			return;
+		}
+
+		if ((oldest == NULL) ||
+		    (oldest->used && (debug_time_diff (&entry->first, &oldest->first) < 0.0))) {
+			oldest = entry;
+		}
+	}
+
+	if (!debug_rate_check (source, tval)) {
+		DEDUP_UNLOCK ();
+
+		debug_write_reports (reports);
+
+		return;
+	}
+
+	/* remember message */
+	if (oldest->used)
+		debug_dedup_flush (oldest, &reports);
+
+	oldest->used = TRUE;
+	oldest->hash = hash;
+	oldest->source = source;
+	oldest->level = debug_level;
+	oldest->first = *tval;
+	oldest->last = *tval;
+	oldest->count = 0;
+	g_strlcpy (oldest->msg, msg, DEBUG_MSG_SIZE);
+
+	DEDUP_UNLOCK ();
+
+	debug_write_reports (reports);
+	debug_write_lines (source, debug_level, tval, msg);
+}
+
+
+/** \brief Report expired repetitions and suppressed messages.
+ *  \param tval The current time (ignored if all is TRUE).
+ *  \param all Flag indicating whether all entries should be reported.
+ *  \param reports Location of the list the reports are added to.
+ *
+ * \note Must be called with the dedup mutex held. The reports must be
+ *       written with debug_write_reports() after the mutex has been released.
+ */
+static void
+debug_expire (const GTimeVal *tval, gboolean all, GSList **reports)
+{
+	gchar *msg;
+	GTimeVal now;
+	guint  i;
+
+	for (i = 0; i < DEBUG_DEDUP_SIZE; i++) {
+		if (dedup[i].used &&
+		    (all || (debug_time_diff (tval, &dedup[i].first) >= DEBUG_DEDUP_WINDOW))) {
+
+			debug_dedup_flush (&dedup[i], reports);
+		}
+	}
+
+	for (i = MSG_SRC_NONE; i <= MSG_SRC_GRIG; i++) {
+		if (bucket[i].suppressed == 0)
+			continue;
+
+		/* wait until the source is below its rate again */
+		if (!all && (bucket[i].tokens + debug_time_diff (tval, &bucket[i].stamp) * DEBUG_RATE < 1.0))
+			continue;
+
+		msg = g_strdup_printf (_("%s: %d messages from %s suppressed (more than %d/sec)"),
+				       __FUNCTION__, bucket[i].suppressed,
+				       SRC_TO_STR[i], DEBUG_RATE);
+		g_get_current_time (&now);
+		*reports = debug_report (*reports, MSG_SRC_GRIG, RIG_DEBUG_WARN, &now, msg);
+
+		bucket[i].suppressed = 0;
+	}
+}
+
+
+/** \brief Release a dedup entry, reporting its repetitions if any.
+ *
+ * The report carries the source and level of the original message and the
+ * time stamp of the last repetition, so that it shows up next to the
+ * original in the message window. The report is added to reports.
+ *
+ * \note Must be called with the dedup mutex held.
+ */
+static void
+debug_dedup_flush (debug_dedup_t *entry, GSList **reports)
+{
+	gchar    first[16];
+	gchar    last[16];
+	gchar   *msg;
+	gchar   *eol;
+	time_t   t;
+
+	entry->used = FALSE;
+
+	if (entry->count == 0)
+		return;
+
+	/* only the first line of multi-line messages */
+	eol = strchr (entry->msg, '\n');
+	if (eol != NULL)
+		*eol = '\0';
+
+	t = (time_t) entry->first.tv_sec;
+	strftime (first, sizeof (first), "%H:%M:%S", localtime (&t));
+	t = (time_t) entry->last.tv_sec;
+	strftime (last, sizeof (last), "%H:%M:%S", localtime (&t));
+
+	msg = g_strdup_printf (_("%s (repeated %d times between %s and %s)"),
+			       entry->msg, entry->count, first, last);
+	*reports = debug_report (*reports, entry->source, entry->level,
+				 &entry->last, msg);
+}
+
+
+/** \brief Add a report to a list of reports.
+ *  \param reports The list of reports.
+ *  \param source The message source.
+ *  \param debug_level The debug level.
+ *  \param tval The time stamp of the report.
+ *  \param msg The report; the list takes ownership of it.
+ *  \return The new start of the list.
+ */
+static GSList *
+debug_report      (GSList *reports,
+		   debug_msg_src_t source,
+		   enum rig_debug_level_e debug_level,
+		   const GTimeVal *tval,
+		   gchar *msg)
+{
+	debug_report_t *report;
+
+	report = g_new (debug_report_t, 1);
+	report->source = source;
+	report->level = debug_level;
+	report->time = *tval;
+	report->msg = msg;
+
+	return g_slist_prepend (reports, report);
+}
+
+
+/** \brief Write and free a list of reports.
+ *  \param reports The list of reports, most recent first.
+ *
+ * \note Must be called without the dedup mutex held.
+ */
+static void
+debug_write_reports (GSList *reports)
+{
+	debug_report_t *report;
+	GSList         *node;
+
+	reports = g_slist_reverse (reports);
+
+	for (node = reports; node != NULL; node = node->next) {
+		report = (debug_report_t *) node->data;
+
+		debug_write_lines (report->source, report->level,
+				   &report->time, report->msg);
+		g_free (report->msg);
+		g_free (report);
+	}
+
+	g_slist_free (reports);
+}
+
+
+/** \brief Take a token from the bucket of a source.
+ *  \param source The message source.
+ *  \param tval The time when the message was generated.
+ *  \return TRUE if the message may be written, FALSE if it has to be suppressed.
+ *
+ * The bucket is refilled with DEBUG_RATE tokens per second up to
+ * DEBUG_BURST tokens.
+ *
+ * \note Must be called with the dedup mutex held.
+ */
+static gboolean
+debug_rate_check  (debug_msg_src_t source, const GTimeVal *tval)
+{
+	debug_bucket_t *b = &bucket[source];
+	gdouble         dt;
+
+	if (b->stamp.tv_sec == 0) {
+		/* first message from this source */
+		b->tokens = DEBUG_BURST;
+	}
+	else {
+		dt = debug_time_diff (tval, &b->stamp);
+		if (dt > 0.0)
+			b->tokens = MIN (b->tokens + dt * DEBUG_RATE, DEBUG_BURST);
+	}
+
+	b->stamp = *tval;
+
+	if (b->tokens < 1.0) {
+		b->suppressed++;
+
+		return FALSE;
+	}
+
+	b->tokens -= 1.0;
+
+	return TRUE;
+}
+
+
+/** \brief Difference t1 - t0 in seconds. */
+static gdouble
+debug_time_diff   (const GTimeVal *t1, const GTimeVal *t0)
+{
+	return (gdouble) (t1->tv_sec - t0->tv_sec) +
+		(gdouble) (t1->tv_usec - t0->tv_usec) / G_USEC_PER_SEC;
+}
+
+
+/** \brief Get the file name of an old log file segment.
+ *  \param index The index of the segment (1 is the most recent).
+ *  \param gz Flag indicating whether to return the name of the compressed file.
+ *  \return A newly allocated string that should be freed when no longer needed.
+ */
+static gchar *
+debug_log_segment (guint index, gboolean gz)
+{
+	return g_strdup_printf ("%s.%d%s", logfname, index, gz ? ".gz" : "");
+}
+
+
+/** \brief Rotate log file.
+ *
+ * This function closes the active segment, shifts the old segments and
+ * opens a new, empty active segment. If compression is enabled, gzip is
+ * started in the background to compress the segment which has just been
+ * closed. A gzip started by the previous rotation is waited for before any
+ * segment is renamed. Both compressed and uncompressed old segments are
+ * shifted, since gzip may not be available.
+ *
+ * \note Must be called with the log mutex held.
+ */
+static void
+debug_log_rotate ()
+{
+	gchar   *from;
+	gchar   *to;
+	gchar   *argv[4];
+	guint    i;
+	gint     gz;
+
+
+	fclose (logfile);
+	logfile = NULL;
+
+	/* the previous segment must be completely compressed
+	   before it is shifted */
+	debug_log_wait ();
+
+	/* delete the oldest segment */
+	for (gz = 0; gz < 2; gz++) {
+		to = debug_log_segment (logcount, gz);
+		g_remove (to);
+		g_free (to);
+	}
+
+	/* shift the others */
+	for (i = logcount - 1; i > 0; i--) {
+		for (gz = 0; gz < 2; gz++) {
+			from = debug_log_segment (i, gz);
+			to = debug_log_segment (i + 1, gz);
+
+			if (g_file_test (from, G_FILE_TEST_EXISTS)) {
+				g_rename (from, to);
+			}
+
+			g_free (from);
+			g_free (to);
+		}
+	}
+
+	/* the active segment becomes the first old segment */
+	to = debug_log_segment (1, FALSE);
+	g_rename (logfname, to);
+
+	if (logcompress) {
+		argv[0] = "gzip";
+		argv[1] = "-f";
+		argv[2] = to;
+		argv[3] = NULL;
+
+		if (g_spawn_async (NULL, argv, NULL,
+				   G_SPAWN_SEARCH_PATH |
+				   G_SPAWN_DO_NOT_REAP_CHILD |
+				   G_SPAWN_STDOUT_TO_DEV_NULL |
+				   G_SPAWN_STDERR_TO_DEV_NULL,
+				   NULL, NULL, &gzpid, NULL)) {
+
+			gzrunning = TRUE;
+		}
+		else {
+			g_fprintf (stderr, _("%s: Could not compress %s\n"),
+				   __FUNCTION__, to);
+		}
+	}
+
+	g_free (to);
+
+	/* open new active segment */
+	logfile = g_fopen (logfname, "w");
+	logsize = 0;
+
+	if (logfile != NULL) {
+		setvbuf (logfile, NULL, _IOLBF, BUFSIZ);
+	}
+	else {
+		g_fprintf (stderr, _("%s: Could not open %s\n"),
+			   __FUNCTION__, logfname);
+	}
+}
+
+
+/** \brief Wait for the gzip started by the last rotation to finish.
+ *
+ * \note Must be called with the log mutex held.
+ */
+static void
+debug_log_wait ()
+{
+	if (!gzrunning)
+		return;
+
+#ifdef G_OS_WIN32
+	WaitForSingleObject (gzpid, INFINITE);
+#else
+	waitpid (gzpid, NULL, 0);
+#endif
+	g_spawn_close_pid (gzpid);
+	gzrunning = FALSE;
+}
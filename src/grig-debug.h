@@ -38,6 +38,12 @@
 
 #define GRIG_DEBUG_SEPARATOR ";;"
 
+/** \brief Default max size of a log file segment in bytes. */
+#define GRIG_DEBUG_DEF_LOG_SIZE  (1024*1024)
+
+/** \brief Default number of old log file segments to keep. */
+#define GRIG_DEBUG_DEF_LOG_COUNT 5
+
 /** \brief Debug message sources. */
 typedef enum {
 	MSG_SRC_NONE   = 0,     /*!< No source, unknown source. */
@@ -59,6 +65,7 @@ int  grig_debug_local      (enum rig_debug_level_e debug_level,
                             ...);
 
 gchar *grig_debug_get_log_file (void);
+void   grig_debug_set_log_rotation (gulong maxsize, guint count, gboolean compress);
 
 
 void grig_debug_set_level (enum rig_debug_level_e level);
@@ -0,0 +1,171 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+    Grig:  Gtk+ user interface for the Hamradio Control Libraries.
+
+    Copyright (C)  2001-2007  Alexandru Csete.
+
+    Authors: Alexandru Csete <oz9aec@gmail.com>
+
+    Comments, questions and bugreports should be submitted via
+    http://sourceforge.net/projects/groundstation/
+    More details can be found at the project home page:
+
+            http://groundstation.sourceforge.net/
+ 
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+  
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+  
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, visit http://www.fsf.org/
+ 
+ 
+ 
+/** \file grig-gui-latency.c
+ *  \ingroup latency
+ *  \brief Gdk event latency monitor.
+ *
+ * A Gdk event handler wrapping gtk_main_do_event measures the processing
+ * of each event using the statistics records of grig-latency.c. The record
+ * of a widget and event class is cached on the widget using object data,
+ * so that the lookup costs a pointer fetch per event.
+ *
+ * All functions must be called from the main loop thread.
+ */
+#include <gtk/gtk.h>
+#include "grig-latency.h"
+#include "grig-gui-latency.h"
+
+
+/** \brief Event classes; the names are used as prefix of the record name. */
+typedef enum {
+	LATENCY_EV_EXPOSE = 0,
+	LATENCY_EV_BUTTON,
+	LATENCY_EV_MOTION,
+	LATENCY_EV_KEY,
+	LATENCY_EV_SCROLL,
+	LATENCY_EV_OTHER,
+	LATENCY_EV_NUMBER
+} latency_ev_t;
+
+static const gchar *EV_NAME[LATENCY_EV_NUMBER] = {
+	"expose",
+	"button",
+	"motion",
+	"key",
+	"scroll",
+	"event"
+};
+
+
+static GQuark      evquark[LATENCY_EV_NUMBER];  /*!< Object data keys caching records on widgets. */
+static gboolean    evmonitor = FALSE;     /*!< Whether events are monitored. */
+
+
+static void latency_event (GdkEvent *event, gpointer data);
+
+
+
+/** \brief Start monitoring Gdk events.
+ *
+ * This function must be called after gtk_init().
+ */
+void
+grig_gui_latency_init ()
+{
+	guint i;
+
+	if (evmonitor)
+		return;
+
+	for (i = 0; i < LATENCY_EV_NUMBER; i++) {
+		evquark[i] = g_quark_from_static_string (EV_NAME[i]);
+	}
+
+	gdk_event_handler_set (latency_event, NULL, NULL);
+	evmonitor = TRUE;
+}
+
+
+/** \brief Stop monitoring Gdk events. */
+void
+grig_gui_latency_close ()
+{
+	if (evmonitor) {
+		gdk_event_handler_set ((GdkEventFunc) gtk_main_do_event, NULL, NULL);
+		evmonitor = FALSE;
+	}
+}
+
+
+/** \brief Gdk event handler measuring Gtk+ event processing. */
+static void
+latency_event        (GdkEvent *event, gpointer data)
+{
+	GtkWidget       *widget;
+	grig_latency_stat_t *stat;
+	latency_ev_t     ev;
+	gchar           *name;
+	gint64           start;
+	guint64          seq;
+
+	switch (event->type) {
+
+	case GDK_EXPOSE:
+		ev = LATENCY_EV_EXPOSE;
+		break;
+
+	case GDK_BUTTON_PRESS:
+	case GDK_2BUTTON_PRESS:
+	case GDK_3BUTTON_PRESS:
+	case GDK_BUTTON_RELEASE:
+		ev = LATENCY_EV_BUTTON;
+		break;
+
+	case GDK_MOTION_NOTIFY:
+		ev = LATENCY_EV_MOTION;
+		break;
+
+	case GDK_KEY_PRESS:
+	case GDK_KEY_RELEASE:
+		ev = LATENCY_EV_KEY;
+		break;
+
+	case GDK_SCROLL:
+		ev = LATENCY_EV_SCROLL;
+		break;
+
+	default:
+		ev = LATENCY_EV_OTHER;
+		break;
+	}
+
+	widget = gtk_get_event_widget (event);
+
+	if (widget != NULL) {
+		stat = (grig_latency_stat_t *) g_object_get_qdata (G_OBJECT (widget), evquark[ev]);
+
+		if (stat == NULL) {
+			name = g_strconcat (EV_NAME[ev], ":", gtk_widget_get_name (widget), NULL);
+			stat = grig_latency_get_stat (name);
+			g_free (name);
+
+			g_object_set_qdata (G_OBJECT (widget), evquark[ev], stat);
+		}
+	}
+	else {
+		stat = grig_latency_get_stat (EV_NAME[ev]);
+	}
+
+	seq = grig_latency_begin (&start);
+
+	gtk_main_do_event (event);
+
+	grig_latency_end (stat, start, seq);
+}
@@ -0,0 +1,47 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+    Grig:  Gtk+ user interface for the Hamradio Control Libraries.
+
+    Copyright (C)  2001-2007  Alexandru Csete.
+
+    Authors: Alexandru Csete <oz9aec@gmail.com>
+
+    Comments, questions and bugreports should be submitted via
+    http://sourceforge.net/projects/groundstation/
+    More details can be found at the project home page:
+
+            http://groundstation.sourceforge.net/
+ 
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+  
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+  
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, visit http://www.fsf.org/
+ 
+ 
+ 
+/** \file grig-gui-latency.h
+ *  \ingroup latency
+ *  \brief Gdk event latency monitor.
+ *
+ * Once grig_gui_latency_init has been called, Gdk events are measured per
+ * event class and widget name, e.g. "expose:grig-smeter" or
+ * "button:GtkToggleButton"; this covers expose handlers as well as button
+ * and other signal handlers which run while an event is processed. The
+ * results are part of the statistics of grig-latency.h.
+ */
+#ifndef GRIG_GUI_LATENCY_H
+#define GRIG_GUI_LATENCY_H 1
+
+
+void grig_gui_latency_init  (void);
+void grig_gui_latency_close (void);
+
+#endif
@@ -0,0 +1,448 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+    Grig:  Gtk+ user interface for the Hamradio Control Libraries.
+
+    Copyright (C)  2001-2007  Alexandru Csete.
+
+    Authors: Alexandru Csete <oz9aec@gmail.com>
+
+    Comments, questions and bugreports should be submitted via
+    http://sourceforge.net/projects/groundstation/
+    More details can be found at the project home page:
+
+            http://groundstation.sourceforge.net/
+ 
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+  
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+  
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, visit http://www.fsf.org/
+ 
+ 
+ 
+*/
+/** \file grig-latency.c
+ *  \ingroup latency
+ *  \brief Main loop latency monitor.
+ *
+ * Every measured callback source has a statistics record holding a
+ * histogram of the execution time and, for timeouts, of the dispatch lag,
+ * i.e. how much later than scheduled the callback was run. Records are
+ * looked up by name.
+ *
+ * This file only depends on GLib, so that the daemon can use the monitored
+ * timeouts as well. Gdk events are measured by grig-gui-latency.c using
+ * grig_latency_get_stat, grig_latency_begin and grig_latency_end.
+ *
+ * Modal dialogs run a nested main loop inside a callback. A callback
+ * during which other callbacks have been dispatched is therefore not
+ * measured, only counted as nested.
+ *
+ * All functions must be called from the main loop thread.
+ */
+#include <glib.h>
+#include <glib/gi18n.h>
+#include <string.h>
+#include <hamlib/rig.h>
+#include "grig-debug.h"
+#include "grig-latency.h"
+
+
+/** \brief Number of histogram buckets, excluding +Inf. */
+#define LATENCY_NUM_BUCKETS 11
+
+/** \brief Interval of the main loop probe [msec]. */
+#define LATENCY_PROBE_TVAL  100
+
+/** \brief Min time between two warnings about the same callback [sec]. */
+#define LATENCY_WARN_PERIOD 5
+
+/** \brief Histogram bucket upper bounds [msec]. */
+static const guint LATENCY_BUCKETS[LATENCY_NUM_BUCKETS] = {
+	1, 2, 4, 8, 16, 32, 64, 128, 256, 512, 1024
+};
+
+
+/** \brief Histogram with execution time or lag. */
+typedef struct {
+	guint64   bucket[LATENCY_NUM_BUCKETS + 1];   /*!< Non-cumulative counts; last is +Inf. */
+	guint64   count;                             /*!< Number of observations. */
+	gint64    sum;                               /*!< Sum of observations [usec]. */
+	gint64    max;                               /*!< Largest observation [usec]. */
+} latency_hist_t;
+
+
+/** \brief Statistics of a callback source. */
+struct _grig_latency_stat {
+	gchar          *name;       /*!< Name of the source. */
+	latency_hist_t  exec;       /*!< Execution time. */
+	latency_hist_t  lag;        /*!< Dispatch lag (timeouts only). */
+	guint64         over;       /*!< Number of executions over budget. */
+	guint64         nested;     /*!< Number of executions running a nested main loop. */
+	gint64          lastwarn;   /*!< Time of last warning [usec]. */
+};
+
+
+/** \brief Data of a monitored timeout. */
+typedef struct {
+	GSourceFunc          func;      /*!< The real callback. */
+	gpointer             data;      /*!< User data of the real callback. */
+	GDestroyNotify       notify;    /*!< Destroy notifier for data or NULL. */
+	guint                interval;  /*!< Timeout interval [msec]. */
+	gint64               expected;  /*!< Time when the callback is due [usec]. */
+	grig_latency_stat_t *stat;      /*!< Statistics record. */
+} latency_timeout_t;
+
+
+static GHashTable *stats = NULL;          /*!< Statistics records by name. */
+static GPtrArray  *statlist = NULL;       /*!< Statistics records in order of creation. */
+static guint       probeid = 0;           /*!< ID of the main loop probe. */
+static guint64     dispatches = 0;        /*!< Number of callbacks started. */
+
+
+static void            latency_hist_add     (latency_hist_t *hist, gint64 usec);
+static gboolean        latency_timeout_exec (gpointer data);
+static void            latency_timeout_free (gpointer data);
+static gboolean        latency_probe        (gpointer data);
+static gint64          latency_time         (void);
+static void            latency_format_hist  (GString *str, const gchar *name,
+					     const gchar *source,
+					     const latency_hist_t *hist);
+static void            latency_report       (gpointer value, gpointer data);
+
+
+
+/** \brief Start monitoring the main loop lag. */
+void
+grig_latency_init ()
+{
+	if (probeid != 0)
+		return;
+
+	probeid = grig_latency_timeout_add (LATENCY_PROBE_TVAL, latency_probe,
+					    NULL, "main-loop");
+}
+
+
+/** \brief Stop monitoring and log a summary. */
+void
+grig_latency_close ()
+{
+	if (probeid != 0) {
+		g_source_remove (probeid);
+		probeid = 0;
+	}
+
+	if (statlist != NULL) {
+		g_ptr_array_foreach (statlist, latency_report, NULL);
+	}
+}
+
+
+/** \brief Add a monitored timeout.
+ *  \param interval The timeout interval in milliseconds.
+ *  \param func The callback function.
+ *  \param data User data passed to func.
+ *  \param name Name of the callback used in reports.
+ *  \return The ID of the event source.
+ *
+ * This function can be used instead of g_timeout_add. The returned ID can
+ * be passed to g_source_remove as usual.
+ */
+guint
+grig_latency_timeout_add      (guint interval, GSourceFunc func,
+			       gpointer data, const gchar *name)
+{
+	return grig_latency_timeout_add_full (interval, func, data, NULL, name);
+}
+
+
+/** \brief Add a monitored timeout.
+ *  \param interval The timeout interval in milliseconds.
+ *  \param func The callback function.
+ *  \param data User data passed to func.
+ *  \param notify Function called with data when the timeout is removed, or NULL.
+ *  \param name Name of the callback used in reports.
+ *  \return The ID of the event source.
+ */
+guint
+grig_latency_timeout_add_full (guint interval, GSourceFunc func,
+			       gpointer data, GDestroyNotify notify,
+			       const gchar *name)
+{
+	latency_timeout_t *tmo;
+
+	tmo = g_new (latency_timeout_t, 1);
+	tmo->func     = func;
+	tmo->data     = data;
+	tmo->notify   = notify;
+	tmo->interval = interval;
+	tmo->expected = latency_time () + 1000 * (gint64) interval;
+	tmo->stat     = grig_latency_get_stat (name);
+
+	return g_timeout_add_full (G_PRIORITY_DEFAULT, interval,
+				   latency_timeout_exec, tmo,
+				   latency_timeout_free);
+}
+
+
+/** \brief Append the histograms in Prometheus text format.
+ *  \param str The string to append to.
+ */
+void
+grig_latency_format_metrics (GString *str)
+{
+	grig_latency_stat_t *stat;
+	guint           i;
+
+	if (statlist == NULL)
+		return;
+
+	g_string_append (str,
+			 "# HELP grig_gui_callback_duration_seconds Execution time of main loop callbacks.\n"
+			 "# TYPE grig_gui_callback_duration_seconds histogram\n");
+	for (i = 0; i < statlist->len; i++) {
+		stat = (grig_latency_stat_t *) g_ptr_array_index (statlist, i);
+		latency_format_hist (str, "grig_gui_callback_duration_seconds",
+				     stat->name, &stat->exec);
+	}
+
+	g_string_append (str,
+			 "# HELP grig_gui_dispatch_lag_seconds Delay between due time and dispatch of timeouts.\n"
+			 "# TYPE grig_gui_dispatch_lag_seconds histogram\n");
+	for (i = 0; i < statlist->len; i++) {
+		stat = (grig_latency_stat_t *) g_ptr_array_index (statlist, i);
+		if (stat->lag.count > 0)
+			latency_format_hist (str, "grig_gui_dispatch_lag_seconds",
+					     stat->name, &stat->lag);
+	}
+
+	g_string_append (str,
+			 "# HELP grig_gui_over_budget_total Callbacks exceeding the frame budget.\n"
+			 "# TYPE grig_gui_over_budget_total counter\n");
+	for (i = 0; i < statlist->len; i++) {
+		stat = (grig_latency_stat_t *) g_ptr_array_index (statlist, i);
+		g_string_append_printf (str, "grig_gui_over_budget_total{callback=\"%s\"} %"
+					G_GUINT64_FORMAT "\n", stat->name, stat->over);
+	}
+}
+
+
+/** \brief Get statistics record, creating it if necessary.
+ *  \param name The name of the callback source.
+ *  \return The statistics record; it stays valid for the lifetime of the
+ *          program and may be cached by the caller.
+ */
+grig_latency_stat_t *
+grig_latency_get_stat         (const gchar *name)
+{
+	grig_latency_stat_t *stat;
+
+	if (stats == NULL) {
+		stats = g_hash_table_new (g_str_hash, g_str_equal);
+		statlist = g_ptr_array_new ();
+	}
+
+	stat = (grig_latency_stat_t *) g_hash_table_lookup (stats, name);
+
+	if (stat == NULL) {
+		stat = g_new0 (grig_latency_stat_t, 1);
+		stat->name = g_strdup (name);
+		g_hash_table_insert (stats, stat->name, stat);
+		g_ptr_array_add (statlist, stat);
+	}
+
+	return stat;
+}
+
+
+/** \brief Add an observation to a histogram. */
+static void
+latency_hist_add     (latency_hist_t *hist, gint64 usec)
+{
+	guint i;
+
+	for (i = 0; i < LATENCY_NUM_BUCKETS; i++) {
+		if (usec <= 1000 * (gint64) LATENCY_BUCKETS[i])
+			break;
+	}
+
+	hist->bucket[i]++;
+	hist->count++;
+	hist->sum += usec;
+
+	if (usec > hist->max)
+		hist->max = usec;
+}
+
+
+/** \brief Start measuring a callback.
+ *  \param start Location where the start time is stored [usec].
+ *  \return The sequence number to pass to grig_latency_end.
+ */
+guint64
+grig_latency_begin            (gint64 *start)
+{
+	*start = latency_time ();
+
+	return ++dispatches;
+}
+
+
+/** \brief Record execution time of a callback.
+ *  \param stat The statistics record.
+ *  \param start Time when the callback started [usec].
+ *  \param seq Value of the dispatch counter when the callback started.
+ *
+ * Executions over budget are reported, but at most once every
+ * LATENCY_WARN_PERIOD seconds per callback.
+ */
+void
+grig_latency_end              (grig_latency_stat_t *stat, gint64 start, guint64 seq)
+{
+	gint64 now;
+	gint64 usec;
+
+	/* other callbacks have run meanwhile; this one ran a nested main loop */
+	if (dispatches != seq) {
+		stat->nested++;
+		return;
+	}
+
+	now = latency_time ();
+	usec = now - start;
+
+	latency_hist_add (&stat->exec, usec);
+
+	if (usec <= 1000 * GRIG_LATENCY_BUDGET)
+		return;
+
+	stat->over++;
+
+	if ((stat->lastwarn == 0) ||
+	    (now - stat->lastwarn >= LATENCY_WARN_PERIOD * G_USEC_PER_SEC)) {
+
+		grig_debug_local (RIG_DEBUG_WARN,
+				  _("%s: %s took %d ms, frame budget is %d ms (%d times so far)"),
+				  __FUNCTION__, stat->name, (gint) (usec / 1000),
+				  GRIG_LATENCY_BUDGET, (gint) stat->over);
+
+		stat->lastwarn = now;
+	}
+}
+
+
+/** \brief Execute monitored timeout. */
+static gboolean
+latency_timeout_exec (gpointer data)
+{
+	latency_timeout_t *tmo = (latency_timeout_t *) data;
+	gboolean           retval;
+	gint64             start;
+	guint64            seq;
+
+	seq = grig_latency_begin (&start);
+	latency_hist_add (&tmo->stat->lag, MAX (start - tmo->expected, 0));
+
+	retval = tmo->func (tmo->data);
+
+	grig_latency_end (tmo->stat, start, seq);
+
+	/* Glib schedules the next call relative to the dispatch time */
+	tmo->expected = start + 1000 * (gint64) tmo->interval;
+
+	return retval;
+}
+
+
+/** \brief Free monitored timeout data. */
+static void
+latency_timeout_free (gpointer data)
+{
+	latency_timeout_t *tmo = (latency_timeout_t *) data;
+
+	if (tmo->notify != NULL)
+		tmo->notify (tmo->data);
+
+	g_free (tmo);
+}
+
+
+/** \brief Main loop probe; only its dispatch lag is of interest. */
+static gboolean
+latency_probe        (gpointer data)
+{
+	return TRUE;
+}
+
+
+/** \brief Get current time in microseconds. */
+static gint64
+latency_time         ()
+{
+#if GLIB_CHECK_VERSION(2,28,0)
+	return g_get_monotonic_time ();
+#else
+	GTimeVal tval;
+
+	g_get_current_time (&tval);
+
+	return ((gint64) tval.tv_sec * G_USEC_PER_SEC) + tval.tv_usec;
+#endif
+}
+
+
+/** \brief Format a histogram in Prometheus text format. */
+static void
+latency_format_hist  (GString *str, const gchar *name,
+		      const gchar *source, const latency_hist_t *hist)
+{
+	gchar    buf[G_ASCII_DTOSTR_BUF_SIZE];
+	guint64  cumulative = 0;
+	guint    i;
+
+	for (i = 0; i < LATENCY_NUM_BUCKETS; i++) {
+		cumulative += hist->bucket[i];
+
+		g_string_append_printf (str, "%s_bucket{callback=\"%s\",le=\"%s\"} %"
+					G_GUINT64_FORMAT "\n", name, source,
+					g_ascii_formatd (buf, sizeof (buf), "%g",
+							 LATENCY_BUCKETS[i] / 1000.0),
+					cumulative);
+	}
+
+	g_string_append_printf (str, "%s_bucket{callback=\"%s\",le=\"+Inf\"} %"
+				G_GUINT64_FORMAT "\n", name, source, hist->count);
+	g_string_append_printf (str, "%s_sum{callback=\"%s\"} %s\n", name, source,
+				g_ascii_formatd (buf, sizeof (buf), "%.6f",
+						 (gdouble) hist->sum / G_USEC_PER_SEC));
+	g_string_append_printf (str, "%s_count{callback=\"%s\"} %" G_GUINT64_FORMAT "\n",
+				name, source, hist->count);
+}
+
+
+/** \brief Log summary of a statistics record. */
+static void
+latency_report       (gpointer value, gpointer data)
+{
+	grig_latency_stat_t *stat = (grig_latency_stat_t *) value;
+
+	if (stat->exec.count == 0)
+		return;
+
+	grig_debug_local (RIG_DEBUG_VERBOSE,
+			  _("%s: %s: %d calls, avg %.2f ms, max %.2f ms, "\
+			    "%d over budget, avg lag %.2f ms"),
+			  __FUNCTION__, stat->name, (gint) stat->exec.count,
+			  stat->exec.sum / 1000.0 / stat->exec.count,
+			  stat->exec.max / 1000.0,
+			  (gint) stat->over,
+			  (stat->lag.count > 0) ? stat->lag.sum / 1000.0 / stat->lag.count : 0.0);
+}
@@ -0,0 +1,78 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+    Grig:  Gtk+ user interface for the Hamradio Control Libraries.
+
+    Copyright (C)  2001-2007  Alexandru Csete.
+
+    Authors: Alexandru Csete <oz9aec@gmail.com>
+
+    Comments, questions and bugreports should be submitted via
+    http://sourceforge.net/projects/groundstation/
+    More details can be found at the project home page:
+
+            http://groundstation.sourceforge.net/
+ 
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+  
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+  
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, visit http://www.fsf.org/
+ 
+ 
+ 
+*/
+/** \file grig-latency.h
+ *  \ingroup latency
+ *  \brief Main loop latency monitor.
+ *
+ * The monitor measures how long the callbacks run by the main loop take.
+ * Timeouts installed with grig_latency_timeout_add (or
+ * grig_trace_timeout_add, which uses it) are measured individually,
+ * including how late they were dispatched. Once grig_latency_init has been
+ * called, a periodic probe timeout measures the general dispatch lag of the
+ * main loop. This part only needs GLib and is shared with the daemon; Gdk
+ * events are measured by the GUI (see grig-gui-latency.h).
+ *
+ * Callbacks exceeding the frame budget of GRIG_LATENCY_BUDGET milliseconds
+ * are reported as warnings, which show up in the message window. The
+ * histograms are included in the daemon metrics and a summary is logged
+ * when the monitor is closed.
+ */
+#ifndef GRIG_LATENCY_H
+#define GRIG_LATENCY_H 1
+
+#include <glib.h>
+
+
+/** \brief Frame budget for main loop callbacks [msec]. */
+#define GRIG_LATENCY_BUDGET 16
+
+
+void     grig_latency_init             (void);
+void     grig_latency_close            (void);
+
+guint    grig_latency_timeout_add      (guint interval, GSourceFunc func,
+					gpointer data, const gchar *name);
+guint    grig_latency_timeout_add_full (guint interval, GSourceFunc func,
+					gpointer data, GDestroyNotify notify,
+					const gchar *name);
+
+void     grig_latency_format_metrics   (GString *str);
+
+
+/** \brief Statistics record of a measured callback source. */
+typedef struct _grig_latency_stat grig_latency_stat_t;
+
+grig_latency_stat_t *grig_latency_get_stat (const gchar *name);
+guint64  grig_latency_begin            (gint64 *start);
+void     grig_latency_end              (grig_latency_stat_t *stat,
+					gint64 start, guint64 seq);
+
+#endif
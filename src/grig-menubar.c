@@ -32,13 +32,18 @@
 #include "grig-about.h"
 #include "grig-config.h"
 #include "grig-menubar.h"
+#include "rig-ctx.h"
+#include "rig-gui.h"
 #include "rig-gui-info.h"
 #include "rig-gui-message-window.h"
 #include "rig-gui-rx.h"
 #include "rig-gui-tx.h"
 #include "rig-gui-func.h"
+#include "rig-gui-mem.h"
+#include "rig-gui-scope.h"
 #include "rig-state.h"
 #include "grig-debug.h"
+#include "grig-trace.h"
 
 
 
@@ -52,6 +57,11 @@ static void  grig_menu_set_debug_level (GtkRadioAction *, gpointer);
 static void  rx_window_cb (GtkToggleAction *toggleaction, gpointer data);
 static void  tx_window_cb (GtkToggleAction *toggleaction, gpointer data);
 static void  func_window_cb (GtkToggleAction *toggleaction, gpointer data);
+static void  scope_window_cb (GtkToggleAction *toggleaction, gpointer data);
+static void  trace_record_cb (GtkToggleAction *toggleaction, gpointer data);
+static void  trace_save_cb  (GtkWidget *widget, gpointer data);
+static void  grig_menu_add_rigs (GtkActionGroup *actgrp);
+static void  select_rig_cb (GtkRadioAction *action, GtkRadioAction *current, gpointer data);
 
 
 /** \brief Regular menu items. */
@@ -72,12 +82,13 @@ static GtkActionEntry entries[] = {
 
 	/* SettingsMenu */
 	{ "Debug", GTK_STOCK_HARDDISK, N_("_Debug Level"), NULL, N_("Set Hamlib debug level"), NULL },
+	{ "TraceSave", GTK_STOCK_SAVE_AS, N_("_Save Trace"), NULL, N_("Save recorded trace as Chrome trace JSON"), G_CALLBACK (trace_save_cb) },
 
 	/* ViewMenu */
 	{ "MsgWin", GTK_STOCK_JUSTIFY_LEFT, N_("Message _Window"), NULL, N_("Show window with debug messages"), G_CALLBACK (rig_gui_message_window_show) },
 
 	/* ToolsMenu */
-	{ "Mem", NULL, N_("_SW Memory"), NULL, N_("Software Memory Mamager"), NULL },
+	{ "Mem", GTK_STOCK_INDEX, N_("_SW Memory"), NULL, N_("Software Memory Manager"), G_CALLBACK (rig_gui_mem_show) },
 	{ "BandMap", GTK_STOCK_INDEX, N_("_Band Map"), NULL, N_("Show the band map"), NULL },
 	{ "Spectrum", GTK_STOCK_JUMP_TO, N_("S_pectrum Scope"), NULL, N_("Show the spectrum scope"), NULL },
 
@@ -103,6 +114,8 @@ static GtkToggleActionEntry toggle_entries[] =
 	{ "LevelsTX", NULL, N_("_TX Level Controls"), NULL, N_("Show transmitter level controls"), G_CALLBACK (tx_window_cb) },
 	{ "Tones", NULL, N_("_DCS/CTCSS"), NULL, N_("Show DCS and CTCSS controls"), NULL },
 	{ "Func", GTK_STOCK_DIALOG_INFO, N_("_Special Functions"), NULL, N_("Radio specific functions"), G_CALLBACK (func_window_cb) },
+	{ "Scope", NULL, N_("_Band Scope"), NULL, N_("Show a band scope made from frequency sweeps"), G_CALLBACK (scope_window_cb) },
+	{ "TraceRec", NULL, N_("_Record Trace"), NULL, N_("Record tracepoints of all subsystems"), G_CALLBACK (trace_record_cb) },
 };
 
 
@@ -113,6 +126,8 @@ static const char *menu_desc =
 "    <menu action='FileMenu'>"
 "       <menuitem action='Info'/>"
 "       <separator/>"
+"       <placeholder name='Rigs'/>"
+"       <separator/>"
 /*"       <menuitem action='Start'/>"
 "       <menuitem action='Stop'/>"
 "       <separator/>"*/
@@ -131,6 +146,9 @@ static const char *menu_desc =
 "          <menuitem action='Verbose'/>"
 "          <menuitem action='Trace'/>"
 "       </menu>"
+"       <separator/>"
+"       <menuitem action='TraceRec'/>"
+"       <menuitem action='TraceSave'/>"
 "    </menu>"
 "    <menu action='ViewMenu'>"
 "       <menuitem action='LevelsRX'/>"
@@ -138,14 +156,15 @@ static const char *menu_desc =
 "       <separator/>"
 /* "       <menuitem action='Tones'/>" */
 "       <menuitem action='Func'/>"
+"       <menuitem action='Scope'/>"
 "       <separator/>"
 "       <menuitem action='MsgWin'/>"
 "    </menu>"
-/* "    <menu action='ToolsMenu'>" */
-/* "       <menuitem action='Mem'/>" */
+"    <menu action='ToolsMenu'>"
+"       <menuitem action='Mem'/>"
 /* "       <menuitem action='BandMap'/>" */
 /* "       <menuitem action='Spectrum'/>" */
-/* "    </menu>" */
+"    </menu>"
 "    <menu action='HelpMenu'>"
 "       <menuitem action='About'/>"
 "    </menu>"
@@ -220,6 +239,17 @@ grig_menubar_create ()
 		return NULL;
 	}
 
+	/* radio selection when several rigs are controlled */
+	if (rig_ctx_count () > 1) {
+		grig_menu_add_rigs (actgrp);
+	}
+
+	/* reflect tracepoints enabled from the command line */
+	if (grig_trace_get_mask ()) {
+		gtk_toggle_action_set_active (GTK_TOGGLE_ACTION (gtk_action_group_get_action (actgrp, "TraceRec")),
+					      TRUE);
+	}
+
 	/* now, finally, get the menubar */
 	menubar = gtk_ui_manager_get_widget (uimgr, "/GrigMenu");
 
@@ -229,6 +259,69 @@ grig_menubar_create ()
 
 
 
+/** \brief Add the radio selection items.
+ *  \param actgrp The action group of the menubar.
+ *
+ * One radio item is added to the Radio menu for each rig context. The
+ * items are labelled with brand and model and can be selected with
+ * Ctrl+1 to Ctrl+RIG_CTX_MAX.
+ */
+static void
+grig_menu_add_rigs (GtkActionGroup *actgrp)
+{
+	GtkRadioActionEntry *rigs;
+	rig_ctx_t           *ctx;
+	guint                merge;
+	gint                 i, n;
+
+
+	n = rig_ctx_count ();
+	rigs = g_new0 (GtkRadioActionEntry, n);
+
+	for (i = 0; i < n; i++) {
+		ctx = rig_ctx_get (i);
+
+		rigs[i].name = g_strdup_printf ("Rig%d", i);
+		rigs[i].label = g_strdup_printf ("_%d %s %s", i + 1,
+						 ctx->rig->caps->mfg_name,
+						 ctx->rig->caps->model_name);
+		rigs[i].accelerator = g_strdup_printf ("<control>%d", i + 1);
+		rigs[i].tooltip = _("Show this radio in the main window");
+		rigs[i].value = i;
+	}
+
+	gtk_action_group_add_radio_actions (actgrp, rigs, n,
+					    rig_ctx_get_selected (),
+					    G_CALLBACK (select_rig_cb), NULL);
+
+	merge = gtk_ui_manager_new_merge_id (uimgr);
+
+	for (i = 0; i < n; i++) {
+		gtk_ui_manager_add_ui (uimgr, merge, "/GrigMenu/FileMenu/Rigs",
+				       rigs[i].name, rigs[i].name,
+				       GTK_UI_MANAGER_MENUITEM, FALSE);
+
+		g_free ((gchar *) rigs[i].name);
+		g_free ((gchar *) rigs[i].label);
+		g_free ((gchar *) rigs[i].accelerator);
+	}
+
+	g_free (rigs);
+}
+
+
+/** \brief Select the radio shown in the main window.
+ *  \param action The GtkRadioAction which received the signal.
+ *  \param current The selected radio item.
+ *  \param data User data (NULL).
+ */
+static void
+select_rig_cb (GtkRadioAction *action, GtkRadioAction *current, gpointer data)
+{
+	rig_gui_select_rig (gtk_radio_action_get_current_value (current));
+}
+
+
 /** \brief Exit application.
  *  \param widget The widget which received the signal.
  *  \param data   User data (NULL).
@@ -319,6 +412,78 @@ func_window_cb (GtkToggleAction *toggleaction, gpointer user_data)
 }
 
 
+/** \brief Show/hide the band scope
+ *
+ * This function is called when the user selects the "Band Scope" menu item.
+ * Depending on the state of the item (on/off) we have to either open or close
+ * the band scope window, which also starts or stops the sweeps.
+ */
+static void
+scope_window_cb (GtkToggleAction *toggleaction, gpointer user_data)
+{
+
+	if (gtk_toggle_action_get_active (toggleaction)) {
+		rig_gui_scope_create ();
+	}
+	else {
+		rig_gui_scope_close ();
+	}
+}
+
+
+/** \brief Start/stop recording tracepoints.
+ *
+ * This function is called when the user selects the "Record Trace" menu
+ * item. Activating the item enables all subsystems, unless some have
+ * already been enabled on the command line.
+ */
+static void
+trace_record_cb (GtkToggleAction *toggleaction, gpointer user_data)
+{
+
+	if (gtk_toggle_action_get_active (toggleaction)) {
+		if (!grig_trace_get_mask ())
+			grig_trace_set_mask ((1 << GRIG_TRACE_SUBSYS_NUMBER) - 1);
+	}
+	else {
+		grig_trace_set_mask (0);
+	}
+}
+
+
+/** \brief Save trace.
+ *
+ * This function is called when the user selects the "Save Trace" menu
+ * item. It asks for a file name and exports the contents of the trace
+ * buffer in Chrome trace event format.
+ */
+static void
+trace_save_cb (GtkWidget *widget, gpointer data)
+{
+	GtkWidget *dialog;
+	gchar     *filename;
+
+	dialog = gtk_file_chooser_dialog_new (_("Save Trace"),
+					      GTK_WINDOW (grigapp),
+					      GTK_FILE_CHOOSER_ACTION_SAVE,
+					      GTK_STOCK_CANCEL, GTK_RESPONSE_CANCEL,
+					      GTK_STOCK_SAVE, GTK_RESPONSE_ACCEPT,
+					      NULL);
+
+	gtk_file_chooser_set_current_name (GTK_FILE_CHOOSER (dialog), "grig-trace.json");
+	gtk_file_chooser_set_do_overwrite_confirmation (GTK_FILE_CHOOSER (dialog), TRUE);
+
+	if (gtk_dialog_run (GTK_DIALOG (dialog)) == GTK_RESPONSE_ACCEPT) {
+
+		filename = gtk_file_chooser_get_filename (GTK_FILE_CHOOSER (dialog));
+		grig_trace_export_json (filename);
+		g_free (filename);
+	}
+
+	gtk_widget_destroy (dialog);
+}
+
+
 /** \bried Force TX menu item.
  *
  * This function can be used to force the TX controls menu item to
@@ -370,3 +535,20 @@ grig_menubar_force_func_item (gboolean val)
 		gtk_check_menu_item_set_active (GTK_CHECK_MENU_ITEM (item), val);
 }
 
+/** \bried Force band scope menu item.
+ *
+ * This function can be used to force the band scope menu item to
+ * TRUE or FALSE. This is useful when the band scope window is closed
+ * without any menu action
+ */
+void
+grig_menubar_force_scope_item (gboolean val)
+{
+	GtkWidget *item = NULL;
+
+	item = gtk_ui_manager_get_widget (uimgr, "/GrigMenu/ViewMenu/Scope");
+
+	if (item != NULL)
+		gtk_check_menu_item_set_active (GTK_CHECK_MENU_ITEM (item), val);
+}
+
@@ -38,6 +38,7 @@ GtkWidget *grig_menubar_create (void);
 void grig_menubar_force_tx_item (gboolean val);
 void grig_menubar_force_rx_item (gboolean val);
 void grig_menubar_force_func_item (gboolean val);
+void grig_menubar_force_scope_item (gboolean val);
 
 
 #endif
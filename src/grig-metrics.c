@@ -0,0 +1,844 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+    Grig:  Gtk+ user interface for the Hamradio Control Libraries.
+
+    Copyright (C)  2001-2007  Alexandru Csete.
+
+    Authors: Alexandru Csete <oz9aec@gmail.com>
+
+    Comments, questions and bugreports should be submitted via
+    http://sourceforge.net/projects/groundstation/
+    More details can be found at the project home page:
+
+            http://groundstation.sourceforge.net/
+ 
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+  
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+  
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, visit http://www.fsf.org/
+ 
+ 
+ 
+*/
+/** \file grig-metrics.c
+ *  \ingroup metrics
+ *  \brief Daemon metrics in Prometheus text format.
+ *
+ * Counters and histograms are updated by the daemon thread under a mutex
+ * which is held only for a few additions, so the cost per command is a
+ * clock read and an uncontended lock. The exposition text is generated on
+ * demand when a client asks for it.
+ *
+ * The HTTP server is deliberately minimal: it runs in the Gtk+ main loop
+ * using GIOChannel watches on non-blocking sockets, reads the request
+ * header, answers GET /metrics (or /) with the current metrics and closes
+ * the connection. The TCP listener is only bound to the loopback interface.
+ *
+ * Exported metrics:
+ *
+ *   grig_commands_total{cmd}                  executed commands
+ *   grig_command_failures_total{cmd}          commands that returned an error
+ *   grig_command_duration_seconds{cmd}        histogram of command latency
+ *   grig_command_last_success_age_seconds{cmd} time since last success
+ *   grig_anomalies_total{cmd}                 anomalies raised
+ *   grig_cycles_total                         completed daemon cycles
+ *   grig_cycle_duration_seconds               histogram of cycle duration
+ *   grig_daemon_suspended                     1 if the daemon is suspended
+ *
+ * followed by the main loop latency histograms (see grig-latency.h).
+ */
+#include <glib.h>
+#include <glib/gi18n.h>
+#include <glib/gstdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <hamlib/rig.h>
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+#ifdef G_OS_WIN32
+#  include <winsock2.h>
+#else
+#  include <unistd.h>
+#  include <fcntl.h>
+#  include <sys/types.h>
+#  include <sys/socket.h>
+#  include <sys/un.h>
+#  include <netinet/in.h>
+#  include <arpa/inet.h>
+#endif
+#include "grig-debug.h"
+#include "grig-latency.h"
+#include "rig-daemon.h"
+#include "grig-metrics.h"
+
+
+/** \brief Number of histogram buckets, excluding +Inf. */
+#define METRICS_NUM_BUCKETS 13
+
+/** \brief Max size of an HTTP request header. */
+#define METRICS_MAX_REQUEST 4096
+
+/** \brief Histogram bucket upper bounds in seconds. */
+static const gdouble METRICS_BUCKETS[METRICS_NUM_BUCKETS] = {
+	0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1,
+	0.25, 0.5, 1.0, 2.5, 5.0, 10.0
+};
+
+
+/** \brief Histogram. */
+typedef struct {
+	guint64   bucket[METRICS_NUM_BUCKETS + 1];   /*!< Non-cumulative counts; last is +Inf. */
+	guint64   count;                             /*!< Number of observations. */
+	gdouble   sum;                               /*!< Sum of observations [sec]. */
+} metrics_hist_t;
+
+
+/** \brief Per command metrics. */
+typedef struct {
+	guint64          executed;      /*!< Number of executions. */
+	guint64          failed;        /*!< Number of failed executions. */
+	guint64          anomalies;     /*!< Number of anomalies raised. */
+	gint64           lastok;        /*!< Time of last success [usec] or 0. */
+	metrics_hist_t   duration;      /*!< Command duration. */
+} metrics_cmd_t;
+
+
+/** \brief HTTP client connection. */
+typedef struct {
+	gint         fd;       /*!< The socket. */
+	GIOChannel  *chan;     /*!< Channel wrapping the socket. */
+	guint        watch;    /*!< Active watch. */
+	GString     *in;       /*!< Request received so far. */
+	GString     *out;      /*!< Response. */
+	gsize        sent;     /*!< Number of response bytes sent. */
+} metrics_client_t;
+
+
+static volatile gboolean enabled = FALSE;   /*!< Whether metrics are collected. */
+
+static metrics_cmd_t   cmdstat[RIG_CMD_NUMBER];   /*!< Per command metrics. */
+static guint64         cycles = 0;                /*!< Number of completed cycles. */
+static metrics_hist_t  cycletime;                 /*!< Cycle duration. */
+static metrics_hist_t  linklag;                   /*!< Lag of the linked rig. */
+static metrics_hist_t  dopplererr;                /*!< Timing error of Doppler corrections. */
+
+static gint            listenfd = -1;       /*!< Listening socket. */
+static GIOChannel     *listenchan = NULL;   /*!< Channel wrapping the listening socket. */
+static guint           listenwatch = 0;     /*!< Accept watch. */
+static gchar          *sockpath = NULL;     /*!< Path of UNIX socket or NULL. */
+static GSList         *clients = NULL;      /*!< Open client connections. */
+
+#if GLIB_CHECK_VERSION(2,32,0)
+static GMutex      metricsmutex;
+#  define METRICS_LOCK()   g_mutex_lock (&metricsmutex)
+#  define METRICS_UNLOCK() g_mutex_unlock (&metricsmutex)
+#else
+static GStaticMutex metricsmutex = G_STATIC_MUTEX_INIT;
+#  define METRICS_LOCK()   g_static_mutex_lock (&metricsmutex)
+#  define METRICS_UNLOCK() g_static_mutex_unlock (&metricsmutex)
+#endif
+
+#ifdef G_OS_WIN32
+#  define metrics_close_socket(fd) closesocket (fd)
+#  define metrics_channel_new(fd)  g_io_channel_win32_new_socket (fd)
+#  define metrics_try_again()      ((WSAGetLastError () == WSAEWOULDBLOCK) || \
+				    (WSAGetLastError () == WSAEINTR))
+#else
+#  define metrics_close_socket(fd) close (fd)
+#  define metrics_channel_new(fd)  g_io_channel_unix_new (fd)
+#  define metrics_try_again()      ((errno == EAGAIN) || (errno == EINTR))
+#endif
+
+/* the GUI does not ignore SIGPIPE; a client going away must not kill it */
+#ifdef MSG_NOSIGNAL
+#  define METRICS_SEND_FLAGS MSG_NOSIGNAL
+#else
+#  define METRICS_SEND_FLAGS 0
+#endif
+
+
+static void     metrics_hist_add      (metrics_hist_t *hist, gdouble value);
+static void     metrics_hist_format   (GString *str, const gchar *name,
+				       const gchar *labels, const metrics_hist_t *hist);
+static void     metrics_double        (GString *str, gdouble value);
+static void     metrics_header        (GString *str, const gchar *name,
+				       const gchar *type, const gchar *help);
+static gboolean metrics_set_nonblock  (gint fd);
+static gboolean metrics_accept        (GIOChannel *chan, GIOCondition cond, gpointer data);
+static gboolean metrics_client_read   (GIOChannel *chan, GIOCondition cond, gpointer data);
+static gboolean metrics_client_write  (GIOChannel *chan, GIOCondition cond, gpointer data);
+static void     metrics_client_close  (metrics_client_t *client);
+static void     metrics_respond       (metrics_client_t *client);
+
+
+
+/** \brief Start serving metrics.
+ *  \param address TCP port number or path of a UNIX domain socket.
+ *  \return TRUE if the server has been started, FALSE otherwise.
+ *
+ * If address contains a '/' it is taken as the path of a UNIX domain
+ * socket, which is created (replacing an existing socket file). Otherwise
+ * it is taken as a TCP port number on the loopback interface. Metrics
+ * collection is enabled when the server has been started.
+ */
+gboolean
+grig_metrics_start   (const gchar *address)
+{
+	struct sockaddr_in  addr;
+#ifndef G_OS_WIN32
+	struct sockaddr_un  uaddr;
+#else
+	WSADATA             wsadata;
+#endif
+	gint                port;
+	gint                on = 1;
+
+
+	if ((address == NULL) || (listenfd != -1))
+		return FALSE;
+
+#ifdef G_OS_WIN32
+	if (WSAStartup (MAKEWORD (2, 2), &wsadata) != 0) {
+		grig_debug_local (RIG_DEBUG_ERR,
+				  _("%s: Could not initialise Winsock"),
+				  __FUNCTION__);
+		return FALSE;
+	}
+#endif
+
+	if (strchr (address, '/') != NULL) {
+
+#ifdef G_OS_WIN32
+		grig_debug_local (RIG_DEBUG_ERR,
+				  _("%s: UNIX sockets are not supported on this platform"),
+				  __FUNCTION__);
+		return FALSE;
+#else
+		if (strlen (address) >= sizeof (uaddr.sun_path)) {
+			grig_debug_local (RIG_DEBUG_ERR,
+					  _("%s: Socket path too long: %s"),
+					  __FUNCTION__, address);
+			return FALSE;
+		}
+
+		listenfd = socket (AF_UNIX, SOCK_STREAM, 0);
+		if (listenfd < 0) {
+			grig_debug_local (RIG_DEBUG_ERR,
+					  _("%s: Could not create socket (%s)"),
+					  __FUNCTION__, g_strerror (errno));
+			listenfd = -1;
+			return FALSE;
+		}
+
+		memset (&uaddr, 0, sizeof (uaddr));
+		uaddr.sun_family = AF_UNIX;
+		g_strlcpy (uaddr.sun_path, address, sizeof (uaddr.sun_path));
+
+		/* remove stale socket from a previous run */
+		g_unlink (address);
+
+		if (bind (listenfd, (struct sockaddr *) &uaddr, sizeof (uaddr)) < 0) {
+			grig_debug_local (RIG_DEBUG_ERR,
+					  _("%s: Could not bind to %s (%s)"),
+					  __FUNCTION__, address, g_strerror (errno));
+			metrics_close_socket (listenfd);
+			listenfd = -1;
+			return FALSE;
+		}
+
+		sockpath = g_strdup (address);
+#endif
+	}
+	else {
+		port = atoi (address);
+
+		if ((port <= 0) || (port > 65535)) {
+			grig_debug_local (RIG_DEBUG_ERR,
+					  _("%s: Invalid port: %s"),
+					  __FUNCTION__, address);
+			return FALSE;
+		}
+
+		listenfd = socket (AF_INET, SOCK_STREAM, 0);
+		if (listenfd < 0) {
+			grig_debug_local (RIG_DEBUG_ERR,
+					  _("%s: Could not create socket (%s)"),
+					  __FUNCTION__, g_strerror (errno));
+			listenfd = -1;
+			return FALSE;
+		}
+
+		setsockopt (listenfd, SOL_SOCKET, SO_REUSEADDR, (const void *) &on, sizeof (on));
+
+		memset (&addr, 0, sizeof (addr));
+		addr.sin_family = AF_INET;
+		addr.sin_port = htons ((guint16) port);
+		addr.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+
+		if (bind (listenfd, (struct sockaddr *) &addr, sizeof (addr)) < 0) {
+			grig_debug_local (RIG_DEBUG_ERR,
+					  _("%s: Could not bind to port %d (%s)"),
+					  __FUNCTION__, port, g_strerror (errno));
+			metrics_close_socket (listenfd);
+			listenfd = -1;
+			return FALSE;
+		}
+	}
+
+	if ((listen (listenfd, 5) < 0) || !metrics_set_nonblock (listenfd)) {
+		grig_debug_local (RIG_DEBUG_ERR,
+				  _("%s: Could not listen on %s (%s)"),
+				  __FUNCTION__, address, g_strerror (errno));
+		grig_metrics_stop ();
+		return FALSE;
+	}
+
+	listenchan = metrics_channel_new (listenfd);
+	listenwatch = g_io_add_watch (listenchan, G_IO_IN, metrics_accept, NULL);
+
+	enabled = TRUE;
+
+	grig_debug_local (RIG_DEBUG_VERBOSE,
+			  _("%s: Serving metrics on %s"),
+			  __FUNCTION__, address);
+
+	return TRUE;
+}
+
+
+/** \brief Stop serving metrics.
+ *
+ * Closes the listening socket and all client connections. Metrics
+ * collection is disabled.
+ */
+void
+grig_metrics_stop    ()
+{
+	enabled = FALSE;
+
+	while (clients != NULL) {
+		metrics_client_close ((metrics_client_t *) clients->data);
+	}
+
+	if (listenwatch != 0) {
+		g_source_remove (listenwatch);
+		listenwatch = 0;
+	}
+
+	if (listenchan != NULL) {
+		g_io_channel_unref (listenchan);
+		listenchan = NULL;
+	}
+
+	if (listenfd != -1) {
+		metrics_close_socket (listenfd);
+		listenfd = -1;
+	}
+
+	if (sockpath != NULL) {
+		g_unlink (sockpath);
+		g_free (sockpath);
+		sockpath = NULL;
+	}
+}
+
+
+/** \brief Get time stamp for measuring durations.
+ *  \return Monotonic time in microseconds, or 0 if metrics are disabled.
+ */
+gint64
+grig_metrics_time    ()
+{
+#if !GLIB_CHECK_VERSION(2,28,0)
+	GTimeVal tval;
+#endif
+
+	if (!enabled)
+		return 0;
+
+#if GLIB_CHECK_VERSION(2,28,0)
+	return g_get_monotonic_time ();
+#else
+	g_get_current_time (&tval);
+
+	return ((gint64) tval.tv_sec * G_USEC_PER_SEC) + tval.tv_usec;
+#endif
+}
+
+
+/** \brief Report an executed command.
+ *  \param cmd The command.
+ *  \param failed Flag indicating whether hamlib returned an error.
+ *  \param start Time stamp taken with grig_metrics_time() before execution.
+ */
+void
+grig_metrics_cmd     (rig_cmd_t cmd, gboolean failed, gint64 start)
+{
+	gint64 now;
+
+	if (!enabled || (start == 0) || ((guint) cmd >= RIG_CMD_NUMBER))
+		return;
+
+	now = grig_metrics_time ();
+
+	METRICS_LOCK ();
+
+	cmdstat[cmd].executed++;
+
+	if (failed)
+		cmdstat[cmd].failed++;
+	else
+		cmdstat[cmd].lastok = now;
+
+	metrics_hist_add (&cmdstat[cmd].duration, (gdouble) (now - start) / G_USEC_PER_SEC);
+
+	METRICS_UNLOCK ();
+}
+
+
+/** \brief Report a completed daemon cycle.
+ *  \param start Time stamp taken with grig_metrics_time() when the cycle started.
+ */
+void
+grig_metrics_cycle   (gint64 start)
+{
+	gint64 now;
+
+	if (!enabled || (start == 0))
+		return;
+
+	now = grig_metrics_time ();
+
+	METRICS_LOCK ();
+
+	cycles++;
+	metrics_hist_add (&cycletime, (gdouble) (now - start) / G_USEC_PER_SEC);
+
+	METRICS_UNLOCK ();
+}
+
+
+/** \brief Report an anomaly.
+ *  \param cmd The command which caused the anomaly.
+ */
+void
+grig_metrics_anomaly (rig_cmd_t cmd)
+{
+	if (!enabled || ((guint) cmd >= RIG_CMD_NUMBER))
+		return;
+
+	METRICS_LOCK ();
+	cmdstat[cmd].anomalies++;
+	METRICS_UNLOCK ();
+}
+
+
+/** \brief Report the lag of the linked rig.
+ *  \param start Time stamp taken with grig_metrics_time() when the source
+ *               rig has been read.
+ */
+void
+grig_metrics_link    (gint64 start)
+{
+	gint64 now;
+
+	if (!enabled || (start == 0))
+		return;
+
+	now = grig_metrics_time ();
+
+	METRICS_LOCK ();
+	metrics_hist_add (&linklag, (gdouble) (now - start) / G_USEC_PER_SEC);
+	METRICS_UNLOCK ();
+}
+
+
+/** \brief Report the timing error of a Doppler correction.
+ *  \param error Time from the computation of the correction until the rig
+ *               has been set [sec].
+ */
+void
+grig_metrics_doppler (gdouble error)
+{
+	if (!enabled)
+		return;
+
+	METRICS_LOCK ();
+	metrics_hist_add (&dopplererr, error);
+	METRICS_UNLOCK ();
+}
+
+
+/** \brief Format the metrics.
+ *  \return A newly allocated string in Prometheus text format.
+ */
+GString *
+grig_metrics_format  ()
+{
+	metrics_cmd_t   stat[RIG_CMD_NUMBER];
+	metrics_hist_t  ctime;
+	metrics_hist_t  lag;
+	metrics_hist_t  derr;
+	guint64         ncycles;
+	GString        *str;
+	gchar          *labels;
+	gint64          now;
+	guint           i;
+
+
+	/* take a snapshot */
+	METRICS_LOCK ();
+	memcpy (stat, cmdstat, sizeof (stat));
+	memcpy (&ctime, &cycletime, sizeof (ctime));
+	memcpy (&lag, &linklag, sizeof (lag));
+	memcpy (&derr, &dopplererr, sizeof (derr));
+	ncycles = cycles;
+	METRICS_UNLOCK ();
+
+	now = grig_metrics_time ();
+	str = g_string_sized_new (16384);
+
+	metrics_header (str, "grig_commands_total", "counter",
+			"Number of rig commands executed by the daemon.");
+	for (i = RIG_CMD_NONE + 1; i < RIG_CMD_NUMBER; i++) {
+		g_string_append_printf (str, "grig_commands_total{cmd=\"%s\"} %" G_GUINT64_FORMAT "\n",
+					rig_daemon_get_cmd_name (i), stat[i].executed);
+	}
+
+	metrics_header (str, "grig_command_failures_total", "counter",
+			"Number of rig commands that returned an error.");
+	for (i = RIG_CMD_NONE + 1; i < RIG_CMD_NUMBER; i++) {
+		g_string_append_printf (str, "grig_command_failures_total{cmd=\"%s\"} %" G_GUINT64_FORMAT "\n",
+					rig_daemon_get_cmd_name (i), stat[i].failed);
+	}
+
+	metrics_header (str, "grig_anomalies_total", "counter",
+			"Number of anomalies raised by the daemon.");
+	for (i = RIG_CMD_NONE + 1; i < RIG_CMD_NUMBER; i++) {
+		g_string_append_printf (str, "grig_anomalies_total{cmd=\"%s\"} %" G_GUINT64_FORMAT "\n",
+					rig_daemon_get_cmd_name (i), stat[i].anomalies);
+	}
+
+	/* only commands which have succeeded at least once */
+	metrics_header (str, "grig_command_last_success_age_seconds", "gauge",
+			"Time since the command last succeeded, i.e. staleness of the value it reads.");
+	for (i = RIG_CMD_NONE + 1; i < RIG_CMD_NUMBER; i++) {
+		if (stat[i].lastok == 0)
+			continue;
+
+		g_string_append_printf (str, "grig_command_last_success_age_seconds{cmd=\"%s\"} ",
+					rig_daemon_get_cmd_name (i));
+		metrics_double (str, (gdouble) (now - stat[i].lastok) / G_USEC_PER_SEC);
+		g_string_append_c (str, '\n');
+	}
+
+	metrics_header (str, "grig_command_duration_seconds", "histogram",
+			"Duration of rig commands including the serial round trip.");
+	for (i = RIG_CMD_NONE + 1; i < RIG_CMD_NUMBER; i++) {
+		if (stat[i].duration.count == 0)
+			continue;
+
+		labels = g_strdup_printf ("cmd=\"%s\",", rig_daemon_get_cmd_name (i));
+		metrics_hist_format (str, "grig_command_duration_seconds", labels, &stat[i].duration);
+		g_free (labels);
+	}
+
+	metrics_header (str, "grig_cycles_total", "counter",
+			"Number of completed daemon cycles.");
+	g_string_append_printf (str, "grig_cycles_total %" G_GUINT64_FORMAT "\n", ncycles);
+
+	metrics_header (str, "grig_cycle_duration_seconds", "histogram",
+			"Duration of daemon cycles.");
+	metrics_hist_format (str, "grig_cycle_duration_seconds", "", &ctime);
+
+	/* only when rigs are linked */
+	if (lag.count > 0) {
+		metrics_header (str, "grig_link_lag_seconds", "histogram",
+				"Time from reading the source rig until the linked rig has been set.");
+		metrics_hist_format (str, "grig_link_lag_seconds", "", &lag);
+	}
+
+	/* only when Doppler correction is running */
+	if (derr.count > 0) {
+		metrics_header (str, "grig_doppler_timing_error_seconds", "histogram",
+				"Time from computing a Doppler correction until the rig has been set.");
+		metrics_hist_format (str, "grig_doppler_timing_error_seconds", "", &derr);
+	}
+
+	metrics_header (str, "grig_daemon_suspended", "gauge",
+			"Whether the daemon is suspended.");
+	g_string_append_printf (str, "grig_daemon_suspended %d\n",
+				rig_daemon_get_suspend () ? 1 : 0);
+
+	/* main loop latency */
+	grig_latency_format_metrics (str);
+
+	return str;
+}
+
+
+/** \brief Add an observation to a histogram. */
+static void
+metrics_hist_add      (metrics_hist_t *hist, gdouble value)
+{
+	guint i;
+
+	for (i = 0; i < METRICS_NUM_BUCKETS; i++) {
+		if (value <= METRICS_BUCKETS[i])
+			break;
+	}
+
+	hist->bucket[i]++;
+	hist->count++;
+	hist->sum += value;
+}
+
+
+/** \brief Format a histogram.
+ *  \param str The string to append to.
+ *  \param name The metric name.
+ *  \param labels Additional labels, each followed by a comma, or "".
+ *  \param hist The histogram.
+ */
+static void
+metrics_hist_format   (GString *str, const gchar *name,
+		       const gchar *labels, const metrics_hist_t *hist)
+{
+	guint64 cumulative = 0;
+	guint   i;
+
+	for (i = 0; i < METRICS_NUM_BUCKETS; i++) {
+		cumulative += hist->bucket[i];
+
+		g_string_append_printf (str, "%s_bucket{%sle=\"", name, labels);
+		metrics_double (str, METRICS_BUCKETS[i]);
+		g_string_append_printf (str, "\"} %" G_GUINT64_FORMAT "\n", cumulative);
+	}
+
+	g_string_append_printf (str, "%s_bucket{%sle=\"+Inf\"} %" G_GUINT64_FORMAT "\n",
+				name, labels, hist->count);
+
+	/* strip the trailing comma for _sum and _count */
+	if (labels[0] != '\0') {
+		g_string_append_printf (str, "%s_sum{%.*s} ", name,
+					(gint) strlen (labels) - 1, labels);
+		metrics_double (str, hist->sum);
+		g_string_append_printf (str, "\n%s_count{%.*s} %" G_GUINT64_FORMAT "\n", name,
+					(gint) strlen (labels) - 1, labels, hist->count);
+	}
+	else {
+		g_string_append_printf (str, "%s_sum ", name);
+		metrics_double (str, hist->sum);
+		g_string_append_printf (str, "\n%s_count %" G_GUINT64_FORMAT "\n", name, hist->count);
+	}
+}
+
+
+/** \brief Append a floating point number independent of the locale. */
+static void
+metrics_double        (GString *str, gdouble value)
+{
+	gchar buf[G_ASCII_DTOSTR_BUF_SIZE];
+
+	g_string_append (str, g_ascii_formatd (buf, sizeof (buf), "%.6g", value));
+}
+
+
+/** \brief Append HELP and TYPE lines of a metric. */
+static void
+metrics_header        (GString *str, const gchar *name,
+		       const gchar *type, const gchar *help)
+{
+	g_string_append_printf (str, "# HELP %s %s\n# TYPE %s %s\n",
+				name, help, name, type);
+}
+
+
+/** \brief Make a socket non-blocking. */
+static gboolean
+metrics_set_nonblock  (gint fd)
+{
+#ifdef G_OS_WIN32
+	u_long on = 1;
+
+	return (ioctlsocket (fd, FIONBIO, &on) == 0);
+#else
+	gint flags;
+
+	flags = fcntl (fd, F_GETFL, 0);
+
+	return ((flags >= 0) && (fcntl (fd, F_SETFL, flags | O_NONBLOCK) == 0));
+#endif
+}
+
+
+/** \brief Accept a new client connection. */
+static gboolean
+metrics_accept        (GIOChannel *chan, GIOCondition cond, gpointer data)
+{
+	metrics_client_t *client;
+	gint              fd;
+
+	fd = accept (listenfd, NULL, NULL);
+	if (fd < 0)
+		return TRUE;
+
+	if (!metrics_set_nonblock (fd)) {
+		metrics_close_socket (fd);
+		return TRUE;
+	}
+
+#if !defined(MSG_NOSIGNAL) && defined(SO_NOSIGPIPE)
+	{
+		gint on = 1;
+
+		setsockopt (fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof (on));
+	}
+#endif
+
+	client = g_new0 (metrics_client_t, 1);
+	client->fd = fd;
+	client->chan = metrics_channel_new (fd);
+	client->in = g_string_new (NULL);
+	client->watch = g_io_add_watch (client->chan, G_IO_IN | G_IO_HUP | G_IO_ERR,
+					metrics_client_read, client);
+
+	clients = g_slist_prepend (clients, client);
+
+	return TRUE;
+}
+
+
+/** \brief Read request from client.
+ *
+ * The request is answered as soon as the complete header has been received.
+ */
+static gboolean
+metrics_client_read   (GIOChannel *chan, GIOCondition cond, gpointer data)
+{
+	metrics_client_t *client = (metrics_client_t *) data;
+	gchar             buf[1024];
+	gint              len;
+
+	len = recv (client->fd, buf, sizeof (buf), 0);
+
+	if (len <= 0) {
+		/* closed by peer or error; try again later if nothing arrived yet */
+		if ((len < 0) && !(cond & (G_IO_HUP | G_IO_ERR)) &&
+		    metrics_try_again ()) {
+			return TRUE;
+		}
+
+		client->watch = 0;
+		metrics_client_close (client);
+
+		return FALSE;
+	}
+
+	g_string_append_len (client->in, buf, len);
+
+	if ((strstr (client->in->str, "\r\n\r\n") == NULL) &&
+	    (strstr (client->in->str, "\n\n") == NULL) &&
+	    (client->in->len < METRICS_MAX_REQUEST)) {
+
+		return TRUE;
+	}
+
+	metrics_respond (client);
+
+	client->watch = g_io_add_watch (client->chan, G_IO_OUT | G_IO_HUP | G_IO_ERR,
+					metrics_client_write, client);
+
+	return FALSE;
+}
+
+
+/** \brief Send response to client; close the connection when done. */
+static gboolean
+metrics_client_write  (GIOChannel *chan, GIOCondition cond, gpointer data)
+{
+	metrics_client_t *client = (metrics_client_t *) data;
+	gint              len;
+
+	if (!(cond & (G_IO_HUP | G_IO_ERR))) {
+		len = send (client->fd, client->out->str + client->sent,
+			    client->out->len - client->sent, METRICS_SEND_FLAGS);
+
+		if (len > 0)
+			client->sent += len;
+
+		if ((client->sent < client->out->len) &&
+		    ((len > 0) || metrics_try_again ())) {
+
+			return TRUE;
+		}
+	}
+
+	client->watch = 0;
+	metrics_client_close (client);
+
+	return FALSE;
+}
+
+
+/** \brief Close client connection and free its resources. */
+static void
+metrics_client_close  (metrics_client_t *client)
+{
+	clients = g_slist_remove (clients, client);
+
+	if (client->watch != 0)
+		g_source_remove (client->watch);
+
+	g_io_channel_unref (client->chan);
+	metrics_close_socket (client->fd);
+
+	g_string_free (client->in, TRUE);
+	if (client->out != NULL)
+		g_string_free (client->out, TRUE);
+
+	g_free (client);
+}
+
+
+/** \brief Create the HTTP response for a request. */
+static void
+metrics_respond       (metrics_client_t *client)
+{
+	GString *body;
+	gchar   *header;
+
+	if (g_str_has_prefix (client->in->str, "GET /metrics ") ||
+	    g_str_has_prefix (client->in->str, "GET / ")) {
+
+		body = grig_metrics_format ();
+		header = g_strdup_printf ("HTTP/1.0 200 OK\r\n"
+					  "Content-Type: text/plain; version=0.0.4\r\n"
+					  "Content-Length: %" G_GSIZE_FORMAT "\r\n"
+					  "Connection: close\r\n\r\n",
+					  body->len);
+	}
+	else {
+		body = g_string_new ("Not found\n");
+		header = g_strdup_printf ("HTTP/1.0 404 Not Found\r\n"
+					  "Content-Type: text/plain\r\n"
+					  "Content-Length: %" G_GSIZE_FORMAT "\r\n"
+					  "Connection: close\r\n\r\n",
+					  body->len);
+	}
+
+	client->out = g_string_prepend (body, header);
+	client->sent = 0;
+
+	g_free (header);
+}
@@ -0,0 +1,65 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+    Grig:  Gtk+ user interface for the Hamradio Control Libraries.
+
+    Copyright (C)  2001-2007  Alexandru Csete.
+
+    Authors: Alexandru Csete <oz9aec@gmail.com>
+
+    Comments, questions and bugreports should be submitted via
+    http://sourceforge.net/projects/groundstation/
+    More details can be found at the project home page:
+
+            http://groundstation.sourceforge.net/
+ 
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+  
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+  
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, visit http://www.fsf.org/
+ 
+ 
+ 
+*/
+/** \file grig-metrics.h
+ *  \ingroup metrics
+ *  \brief Daemon metrics in Prometheus text format.
+ *
+ * The rig daemon reports executed commands, their duration and outcome,
+ * cycle durations and anomalies to this module. When enabled, the metrics
+ * are served over HTTP on a local TCP port or a UNIX domain socket in the
+ * Prometheus text exposition format, e.g.
+ *
+ *   curl http://localhost:9111/metrics
+ *   curl --unix-socket /tmp/grig.sock http://localhost/metrics
+ *
+ * Metrics collection is disabled by default; the report functions return
+ * immediately unless grig_metrics_start() has been called.
+ */
+#ifndef GRIG_METRICS_H
+#define GRIG_METRICS_H 1
+
+#include <glib.h>
+#include "rig-daemon.h"
+
+
+gboolean grig_metrics_start   (const gchar *address);
+void     grig_metrics_stop    (void);
+
+gint64   grig_metrics_time    (void);
+void     grig_metrics_cmd     (rig_cmd_t cmd, gboolean failed, gint64 start);
+void     grig_metrics_cycle   (gint64 start);
+void     grig_metrics_anomaly (rig_cmd_t cmd);
+void     grig_metrics_link    (gint64 start);
+void     grig_metrics_doppler (gdouble error);
+
+GString *grig_metrics_format  (void);
+
+#endif
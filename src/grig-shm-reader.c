@@ -0,0 +1,154 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+    Grig:  Gtk+ user interface for the Hamradio Control Libraries.
+
+    Copyright (C)  2001-2007  Alexandru Csete.
+
+    Authors: Alexandru Csete <oz9aec@gmail.com>
+
+    Comments, questions and bugreports should be submitted via
+    http://sourceforge.net/projects/groundstation/
+    More details can be found at the project home page:
+
+            http://groundstation.sourceforge.net/
+ 
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+  
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+  
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, visit http://www.fsf.org/
+ 
+ 
+ 
+*/
+/** \file grig-shm-reader.c
+ *  \ingroup shdata
+ *  \brief Sample reader for the rig state published by grig.
+ *
+ * Usage: grig-shm-reader [-f] [-b] [NAME]
+ *
+ *   -f  follow: print the state whenever it changes
+ *   -b  benchmark: measure the time of a read
+ *
+ * NAME defaults to GRIG_SHM_NAME. Start grig with --shm=NAME first.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "grig-shm.h"
+
+
+/** \brief Names of the hamlib modes, indexed by bit number. */
+static const char *MODE_NAMES[] = {
+	"AM", "CW", "USB", "LSB", "RTTY", "FM", "WFM", "CWR",
+	"RTTYR", "AMS", "PKTLSB", "PKTUSB", "PKTFM", "ECSSUSB", "ECSSLSB", "FAX"
+};
+
+
+static const char *
+mode_name (uint64_t mode)
+{
+	unsigned i;
+
+	for (i = 0; i < sizeof (MODE_NAMES) / sizeof (MODE_NAMES[0]); i++) {
+		if (mode == ((uint64_t) 1 << i))
+			return MODE_NAMES[i];
+	}
+
+	return "?";
+}
+
+
+static void
+print_state (const grig_shm_state_t *state)
+{
+	time_t sec = (time_t) (state->time / 1000000);
+	char   buf[32];
+
+	strftime (buf, sizeof (buf), "%H:%M:%S", localtime (&sec));
+
+	printf ("%s.%03d  #%llu  %.0f Hz  %s  S9%+d dB  PTT %d  RIT %d  SWR %.1f\n",
+		buf, (int) ((state->time / 1000) % 1000),
+		(unsigned long long) state->count,
+		state->freq1, mode_name (state->mode),
+		state->strength, state->ptt, state->rit, state->swr);
+}
+
+
+static double
+now (void)
+{
+	struct timespec ts;
+
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+
+int
+main (int argc, char **argv)
+{
+	const grig_shm_t *shm;
+	grig_shm_state_t  state;
+	const char       *name = GRIG_SHM_NAME;
+	int               follow = 0;
+	int               bench = 0;
+	uint64_t          last = 0;
+	double            t0;
+	long              i, n = 10000000;
+	int               arg;
+
+
+	for (arg = 1; arg < argc; arg++) {
+		if (!strcmp (argv[arg], "-f"))
+			follow = 1;
+		else if (!strcmp (argv[arg], "-b"))
+			bench = 1;
+		else
+			name = argv[arg];
+	}
+
+	shm = grig_shm_open (name);
+	if (shm == NULL) {
+		fprintf (stderr, "Could not open %s; is grig running with --shm=%s?\n",
+			 name, name);
+		return 1;
+	}
+
+	if (grig_shm_read (shm, &state) != 0) {
+		fprintf (stderr, "%s is not a valid grig segment\n", name);
+		grig_shm_close (shm);
+		return 1;
+	}
+
+	printf ("grig pid %d, rig model %d\n", (int) shm->pid, (int) shm->rig_model);
+	print_state (&state);
+
+	if (bench) {
+		t0 = now ();
+		for (i = 0; i < n; i++)
+			grig_shm_read (shm, &state);
+		printf ("%.1f ns per read\n", (now () - t0) * 1e9 / n);
+	}
+
+	while (follow && (shm->pid != 0)) {
+		if ((grig_shm_read (shm, &state) == 0) && (state.count != last)) {
+			print_state (&state);
+			last = state.count;
+		}
+		usleep (50000);
+	}
+
+	grig_shm_close (shm);
+
+	return 0;
+}
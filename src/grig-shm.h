@@ -0,0 +1,198 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+    Grig:  Gtk+ user interface for the Hamradio Control Libraries.
+
+    Copyright (C)  2001-2007  Alexandru Csete.
+
+    Authors: Alexandru Csete <oz9aec@gmail.com>
+
+    Comments, questions and bugreports should be submitted via
+    http://sourceforge.net/projects/groundstation/
+    More details can be found at the project home page:
+
+            http://groundstation.sourceforge.net/
+ 
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+  
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+  
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, visit http://www.fsf.org/
+ 
+ 
+ 
+*/
+/** \file grig-shm.h
+ *  \ingroup shdata
+ *  \brief Reader interface for the rig state published in shared memory.
+ *
+ * When started with --shm=NAME, grig publishes the settings read from the
+ * radio in a POSIX shared memory segment, so that local programs can follow
+ * frequency, mode, meters etc. without any traffic on the radio port.
+ *
+ * This header is self-contained (no glib or hamlib needed) and is all a
+ * reader needs:
+ *
+ *   const grig_shm_t *shm = grig_shm_open ("/grig");
+ *   grig_shm_state_t  state;
+ *
+ *   if (shm && grig_shm_read (shm, &state) == 0)
+ *       printf ("%.0f Hz\n", state.freq1);
+ *
+ * The snapshot is protected by a sequence lock: grig increments the
+ * sequence number before and after each update, and a reader retries
+ * while the number is odd or has changed during the copy. Readers never
+ * block grig and a read takes well below a microsecond.
+ *
+ * Link with -lrt on older C libraries.
+ */
+#ifndef GRIG_SHM_H
+#define GRIG_SHM_H 1
+
+#include <stdint.h>
+#include <string.h>
+#ifndef _WIN32
+#  include <fcntl.h>
+#  include <unistd.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#endif
+
+
+#define GRIG_SHM_NAME    "/grig"       /*!< Suggested segment name. */
+#define GRIG_SHM_MAGIC   0x47524947    /*!< "GRIG" */
+#define GRIG_SHM_VERSION 1             /*!< Layout version. */
+
+#if defined(__GNUC__)
+#  define GRIG_SHM_BARRIER() __sync_synchronize ()
+#else
+#  error "grig-shm.h needs a memory barrier for this compiler"
+#endif
+
+
+/** \brief Published rig state.
+ *
+ * The values correspond to the fields of grig_settings_t; enumerations
+ * use the hamlib values (e.g. mode is a RIG_MODE_xxx bit).
+ */
+typedef struct {
+	int64_t   time;        /*!< Time of the update [usec since 1970-01-01 UTC]. */
+	uint64_t  count;       /*!< Number of updates since grig started. */
+	double    freq1;       /*!< Primary (working) frequency [Hz]. */
+	double    freq2;       /*!< Secondary frequency [Hz]. */
+	uint64_t  mode;        /*!< Mode (hamlib rmode_t). */
+	int32_t   pbw;         /*!< Passband: 0 wide, 1 normal, 2 narrow. */
+	int32_t   vfo;         /*!< VFO (hamlib vfo_t). */
+	int32_t   pstat;       /*!< Power status (hamlib powerstat_t). */
+	int32_t   ptt;         /*!< PTT (hamlib ptt_t). */
+	int32_t   split;       /*!< Split (hamlib split_t). */
+	int32_t   lock;        /*!< Dial lock. */
+	int32_t   rit;         /*!< RIT [Hz]. */
+	int32_t   xit;         /*!< XIT [Hz]. */
+	int32_t   agc;         /*!< AGC level (hamlib enum agc_level_e). */
+	int32_t   att;         /*!< Attenuator [dB]. */
+	int32_t   preamp;      /*!< Pre-amplifier [dB]. */
+	int32_t   antenna;     /*!< Antenna (hamlib ant_t). */
+	int32_t   strength;    /*!< Signal strength [dB relative to S9]. */
+	float     power;       /*!< TX power [0..1]. */
+	float     swr;         /*!< SWR. */
+	float     alc;         /*!< ALC [0..1]. */
+	float     afg;         /*!< AF gain [0..1]. */
+	float     rfg;         /*!< RF gain [0..1]. */
+	float     sql;         /*!< Squelch [0..1]. */
+} grig_shm_state_t;
+
+
+/** \brief Shared memory segment. */
+typedef struct {
+	uint32_t           magic;        /*!< GRIG_SHM_MAGIC. */
+	uint32_t           version;      /*!< GRIG_SHM_VERSION. */
+	uint32_t           size;         /*!< sizeof (grig_shm_t). */
+	volatile uint32_t  seq;          /*!< Sequence number; odd while being written. */
+	volatile int32_t   pid;          /*!< Process ID of grig; 0 when grig has exited. */
+	int32_t            rig_model;    /*!< Hamlib model of the radio. */
+	int64_t            start_time;   /*!< Time grig started publishing [usec since 1970]. */
+	grig_shm_state_t   state;        /*!< The current state. */
+} grig_shm_t;
+
+
+/** \brief Read a consistent copy of the state.
+ *  \param shm The mapped segment.
+ *  \param state Location to store the state.
+ *  \return 0 on success, -1 if the segment is not valid or stuck.
+ */
+static inline int
+grig_shm_read (const grig_shm_t *shm, grig_shm_state_t *state)
+{
+	uint32_t seq;
+	long     tries = 0;
+
+	if ((shm->magic != GRIG_SHM_MAGIC) || (shm->version != GRIG_SHM_VERSION))
+		return -1;
+
+	do {
+		/* an update takes a few hundred nanoseconds; give up if grig
+		   has died in the middle of one */
+		do {
+			seq = shm->seq;
+
+			if (++tries > 10000000)
+				return -1;
+
+		} while (seq & 1);
+
+		GRIG_SHM_BARRIER ();
+		memcpy (state, (const void *) &shm->state, sizeof (grig_shm_state_t));
+		GRIG_SHM_BARRIER ();
+
+	} while (shm->seq != seq);
+
+	return 0;
+}
+
+
+#ifndef _WIN32
+
+/** \brief Map a segment published by grig.
+ *  \param name The segment name given to grig, e.g. GRIG_SHM_NAME.
+ *  \return The read-only segment or NULL if it does not exist.
+ */
+static inline const grig_shm_t *
+grig_shm_open (const char *name)
+{
+	struct stat  st;
+	void        *addr;
+	int          fd;
+
+	fd = shm_open (name, O_RDONLY, 0);
+	if (fd < 0)
+		return NULL;
+
+	if ((fstat (fd, &st) < 0) || (st.st_size < (off_t) sizeof (grig_shm_t))) {
+		close (fd);
+		return NULL;
+	}
+
+	addr = mmap (NULL, sizeof (grig_shm_t), PROT_READ, MAP_SHARED, fd, 0);
+	close (fd);
+
+	return (addr == MAP_FAILED) ? NULL : (const grig_shm_t *) addr;
+}
+
+
+/** \brief Unmap a segment. */
+static inline void
+grig_shm_close (const grig_shm_t *shm)
+{
+	munmap ((void *) shm, sizeof (grig_shm_t));
+}
+
+#endif
+
+#endif
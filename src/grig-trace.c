@@ -0,0 +1,608 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+    Grig:  Gtk+ user interface for the Hamradio Control Libraries.
+
+    Copyright (C)  2001-2007  Alexandru Csete.
+
+    Authors: Alexandru Csete <oz9aec@gmail.com>
+
+    Comments, questions and bugreports should be submitted via
+    http://sourceforge.net/projects/groundstation/
+    More details can be found at the project home page:
+
+            http://groundstation.sourceforge.net/
+ 
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+  
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+  
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, visit http://www.fsf.org/
+ 
+ 
+ 
+ 
+*/
+/** \file grig-trace.c
+ *  \ingroup trace
+ *  \brief Lightweight binary tracepoints.
+ *
+ * Tracepoint records are stored in a fixed size ring buffer acting as a
+ * flight recorder: when the buffer is full the oldest records are
+ * overwritten. Writers reserve a slot by atomically incrementing the head
+ * index and mark the slot as valid by storing the sequence number after the
+ * record has been filled in, so tracepoints can be emitted from the daemon
+ * thread and the GUI thread at the same time without locking. Readers skip
+ * slots which are being written.
+ *
+ * GUI timeouts are traced by installing them with grig_trace_timeout_add,
+ * which wraps the callback in begin and end events. The export to the
+ * Chrome trace event format turns begin/end pairs into spans on the thread
+ * where they were emitted and all other events into instant events.
+ *
+ * See grig-trace.h for a description of levels and subsystem masks.
+ */
+#include <glib.h>
+#include <glib/gi18n.h>
+#include <glib/gprintf.h>
+#include <glib/gstdio.h>
+#include <stdio.h>
+#include <string.h>
+#include <hamlib/rig.h>
+#include "grig-debug.h"
+#include "grig-latency.h"
+#include "rig-daemon.h"
+#include "grig-trace.h"
+
+
+/** \brief Runtime subsystem mask; all subsystems disabled by default. */
+volatile guint grig_trace_mask = 0;
+
+
+/** \brief One slot of the trace buffer. */
+typedef struct {
+	volatile gint     seq;   /*!< Sequence number + 1 of record, 0 if empty. */
+	grig_trace_rec_t  rec;   /*!< The record. */
+} grig_trace_slot_t;
+
+
+static grig_trace_slot_t buffer[GRIG_TRACE_BUFFER_SIZE];
+
+/** \brief Index of next slot to write (not wrapped). */
+static volatile gint head = 0;
+
+/** \brief The thread running the Gtk+ main loop. */
+static GThread *mainthread = NULL;
+
+
+/** \brief Data for traced timeout callbacks. */
+typedef struct {
+	GSourceFunc          func;     /*!< The real callback. */
+	gpointer             data;     /*!< User data for the callback. */
+	grig_trace_subsys_t  subsys;   /*!< Subsystem owning the timeout. */
+} grig_trace_timeout_t;
+
+
+/** \brief Subsystem names used in masks and dumps. */
+static const gchar *SUBSYS_NAME[GRIG_TRACE_SUBSYS_NUMBER] = {
+	"daemon",
+	"data",
+	"lcd",
+	"smeter",
+	"anomaly",
+	"buttons",
+	"ctrl2"
+};
+
+/** \brief Event names used in dumps. */
+static const gchar *EVENT_NAME[GRIG_TRACE_EV_NUMBER] = {
+	"none",
+	"cmd-begin",
+	"cmd-end",
+	"cycle",
+	"set-freq",
+	"set-mode",
+	"set-ptt",
+	"set-vfo",
+	"timeout-begin",
+	"timeout-end",
+	"anomaly-raise"
+};
+
+
+static gint64   grig_trace_time          (void);
+static gboolean grig_trace_timeout_exec  (gpointer data);
+static void     grig_trace_json_args     (FILE *file, const grig_trace_rec_t *rec);
+
+
+
+/** \brief Store a trace record.
+ *  \param subsys The subsystem emitting the event.
+ *  \param event The event.
+ *  \param a0 First event argument.
+ *  \param a1 Second event argument.
+ *  \param a2 Third event argument.
+ *
+ * This function should not be called directly; use the GRIG_TRACE macro
+ * which performs the level and mask checks.
+ */
+void
+grig_trace_emit (grig_trace_subsys_t subsys,
+		 grig_trace_event_t  event,
+		 gint32 a0, gint32 a1, gint32 a2)
+{
+	grig_trace_slot_t *slot;
+	guint pos;
+
+#if GLIB_CHECK_VERSION(2,30,0)
+	pos = (guint) g_atomic_int_add (&head, 1);
+#else
+	pos = (guint) g_atomic_int_exchange_and_add (&head, 1);
+#endif
+
+	slot = &buffer[pos & (GRIG_TRACE_BUFFER_SIZE - 1)];
+
+	/* invalidate slot while we write it */
+	g_atomic_int_set (&slot->seq, 0);
+
+	slot->rec.time   = grig_trace_time ();
+	slot->rec.thread = (g_thread_self () == mainthread) ?
+		GRIG_TRACE_THREAD_MAIN : GRIG_TRACE_THREAD_DAEMON;
+	slot->rec.subsys = (guint16) subsys;
+	slot->rec.event  = (guint16) event;
+	slot->rec.arg[0] = a0;
+	slot->rec.arg[1] = a1;
+	slot->rec.arg[2] = a2;
+
+	g_atomic_int_set (&slot->seq, (gint) (pos + 1));
+}
+
+
+/** \brief Set runtime subsystem mask.
+ *  \param mask Bitwise OR of (1 << grig_trace_subsys_t).
+ *
+ * The first call must be made from the thread running the Gtk+ main loop,
+ * since it is used to tell GUI events from daemon events.
+ */
+void
+grig_trace_set_mask (guint mask)
+{
+	if (mainthread == NULL)
+		mainthread = g_thread_self ();
+
+	grig_trace_mask = mask & ((1 << GRIG_TRACE_SUBSYS_NUMBER) - 1);
+
+	if (GRIG_TRACE_LEVEL == 0 && mask) {
+		grig_debug_local (RIG_DEBUG_WARN,
+				  _("%s: Tracepoints have been disabled at compile time"),
+				  __FUNCTION__);
+	}
+}
+
+
+/** \brief Get runtime subsystem mask. */
+guint
+grig_trace_get_mask (void)
+{
+	return grig_trace_mask;
+}
+
+
+/** \brief Parse a subsystem list into a mask.
+ *  \param list Comma separated list of subsystem names, "all" or "none".
+ *  \param mask Location where the mask is stored.
+ *  \return TRUE if the list could be parsed, FALSE otherwise.
+ *
+ * Valid subsystem names are daemon, data, lcd, smeter, anomaly, buttons
+ * and ctrl2.
+ */
+gboolean
+grig_trace_parse_mask (const gchar *list, guint *mask)
+{
+	gchar  **names;
+	guint    result = 0;
+	gboolean ok = TRUE;
+	gint     i,j;
+
+	if (list == NULL)
+		return FALSE;
+
+	names = g_strsplit (list, ",", 0);
+
+	for (i = 0; names[i] != NULL; i++) {
+
+		g_strstrip (names[i]);
+
+		if (!g_ascii_strcasecmp (names[i], "all")) {
+			result = (1 << GRIG_TRACE_SUBSYS_NUMBER) - 1;
+			continue;
+		}
+		if (!g_ascii_strcasecmp (names[i], "none") || (names[i][0] == '\0')) {
+			continue;
+		}
+
+		for (j = 0; j < GRIG_TRACE_SUBSYS_NUMBER; j++) {
+			if (!g_ascii_strcasecmp (names[i], SUBSYS_NAME[j])) {
+				result |= (1 << j);
+				break;
+			}
+		}
+
+		if (j == GRIG_TRACE_SUBSYS_NUMBER) {
+			grig_debug_local (RIG_DEBUG_ERR,
+					  _("%s: Unknown trace subsystem: %s"),
+					  __FUNCTION__, names[i]);
+			ok = FALSE;
+		}
+	}
+
+	g_strfreev (names);
+
+	if (ok)
+		*mask = result;
+
+	return ok;
+}
+
+
+/** \brief Copy trace records from the buffer.
+ *  \param recs Array where the records are stored.
+ *  \param max The size of recs.
+ *  \return The number of records copied.
+ *
+ * The most recent records are copied in chronological order. Records that
+ * are being written while the buffer is read are skipped.
+ */
+guint
+grig_trace_get_records (grig_trace_rec_t *recs, guint max)
+{
+	grig_trace_slot_t *slot;
+	guint end, start, pos;
+	guint n = 0;
+
+	end = (guint) g_atomic_int_get (&head);
+
+	if (max > GRIG_TRACE_BUFFER_SIZE)
+		max = GRIG_TRACE_BUFFER_SIZE;
+
+	start = (end > max) ? (end - max) : 0;
+
+	for (pos = start; pos != end; pos++) {
+
+		slot = &buffer[pos & (GRIG_TRACE_BUFFER_SIZE - 1)];
+
+		if (g_atomic_int_get (&slot->seq) != (gint) (pos + 1))
+			continue;
+
+		recs[n] = slot->rec;
+
+		/* discard if overwritten while copying */
+		if (g_atomic_int_get (&slot->seq) == (gint) (pos + 1))
+			n++;
+	}
+
+	return n;
+}
+
+
+/** \brief Clear the trace buffer.
+ *
+ * Must not be called while tracepoints are enabled.
+ */
+void
+grig_trace_clear (void)
+{
+	guint i;
+
+	for (i = 0; i < GRIG_TRACE_BUFFER_SIZE; i++)
+		g_atomic_int_set (&buffer[i].seq, 0);
+
+	g_atomic_int_set (&head, 0);
+}
+
+
+/** \brief Get name of subsystem. */
+const gchar *
+grig_trace_subsys_name (grig_trace_subsys_t subsys)
+{
+	if (subsys >= GRIG_TRACE_SUBSYS_NUMBER)
+		return "unknown";
+
+	return SUBSYS_NAME[subsys];
+}
+
+
+/** \brief Get name of event. */
+const gchar *
+grig_trace_event_name (grig_trace_event_t event)
+{
+	if (event >= GRIG_TRACE_EV_NUMBER)
+		return "unknown";
+
+	return EVENT_NAME[event];
+}
+
+
+/** \brief Write trace buffer to a text file.
+ *  \param filename The name of the file.
+ *  \return TRUE if the file has been written, FALSE otherwise.
+ *
+ * Each record is written on a separate line as
+ * time;thread;subsystem;event;a0;a1;a2 where time is in microseconds
+ * relative to the first record.
+ */
+gboolean
+grig_trace_dump (const gchar *filename)
+{
+	grig_trace_rec_t *recs;
+	FILE  *file;
+	guint  n,i;
+
+	file = g_fopen (filename, "w");
+
+	if (file == NULL) {
+		grig_debug_local (RIG_DEBUG_ERR,
+				  _("%s: Could not open %s for writing"),
+				  __FUNCTION__, filename);
+		return FALSE;
+	}
+
+	recs = g_new (grig_trace_rec_t, GRIG_TRACE_BUFFER_SIZE);
+	n = grig_trace_get_records (recs, GRIG_TRACE_BUFFER_SIZE);
+
+	for (i = 0; i < n; i++) {
+		fprintf (file, "%" G_GINT64_FORMAT ";%d;%s;%s;%d;%d;%d\n",
+			 recs[i].time - recs[0].time,
+			 recs[i].thread,
+			 grig_trace_subsys_name (recs[i].subsys),
+			 grig_trace_event_name (recs[i].event),
+			 recs[i].arg[0], recs[i].arg[1], recs[i].arg[2]);
+	}
+
+	g_free (recs);
+	fclose (file);
+
+	grig_debug_local (RIG_DEBUG_VERBOSE,
+			  _("%s: Wrote %d trace records to %s"),
+			  __FUNCTION__, n, filename);
+
+	return TRUE;
+}
+
+
+/** \brief Add a traced timeout.
+ *  \param interval The timeout interval in milliseconds.
+ *  \param func The callback function.
+ *  \param data User data passed to func.
+ *  \param subsys The subsystem owning the timeout.
+ *  \return The ID of the event source.
+ *
+ * This function can be used instead of g_timeout_add for the periodic GUI
+ * callbacks. Each execution of func is surrounded by TIMEOUT_BEGIN and
+ * TIMEOUT_END events of subsys. The returned ID can be passed to
+ * g_source_remove as usual. The timeout is also monitored by the main loop
+ * latency monitor under the name of the subsystem. If GUI timeouts are
+ * compiled out, this is the same as grig_latency_timeout_add.
+ */
+guint
+grig_trace_timeout_add (guint interval, GSourceFunc func,
+			gpointer data, grig_trace_subsys_t subsys)
+{
+	grig_trace_timeout_t *tmo;
+
+	if (GRIG_TRACE_LEVEL < GRIG_TRACE_LEVEL_CYCLE)
+		return grig_latency_timeout_add (interval, func, data, SUBSYS_NAME[subsys]);
+
+	tmo = g_new (grig_trace_timeout_t, 1);
+	tmo->func   = func;
+	tmo->data   = data;
+	tmo->subsys = subsys;
+
+	return grig_latency_timeout_add_full (interval, grig_trace_timeout_exec,
+					      tmo, g_free, SUBSYS_NAME[subsys]);
+}
+
+
+/** \brief Execute traced timeout callback.
+ *  \param data Pointer to the grig_trace_timeout_t structure.
+ *  \return The return value of the real callback.
+ */
+static gboolean
+grig_trace_timeout_exec (gpointer data)
+{
+	grig_trace_timeout_t *tmo = (grig_trace_timeout_t *) data;
+	gboolean retval;
+
+	GRIG_TRACE (GRIG_TRACE_LEVEL_CYCLE, tmo->subsys,
+		    GRIG_TRACE_EV_TIMEOUT_BEGIN, 0, 0, 0);
+
+	retval = tmo->func (tmo->data);
+
+	GRIG_TRACE (GRIG_TRACE_LEVEL_CYCLE, tmo->subsys,
+		    GRIG_TRACE_EV_TIMEOUT_END, retval, 0, 0);
+
+	return retval;
+}
+
+
+/** \brief Export trace buffer in Chrome trace event format.
+ *  \param filename The name of the file.
+ *  \return TRUE if the file has been written, FALSE otherwise.
+ *
+ * The file can be loaded into chrome://tracing or the Perfetto UI. Daemon
+ * commands and GUI timeouts are written as duration events on the thread
+ * where they were executed; the end event carries the result. All other
+ * events are written as instant events. End events whose begin event has
+ * already been overwritten in the ring buffer are skipped.
+ */
+gboolean
+grig_trace_export_json (const gchar *filename)
+{
+	grig_trace_rec_t *recs;
+	FILE        *file;
+	const gchar *name;
+	guint        depth[GRIG_TRACE_THREAD_DAEMON + 1] = { 0, 0, 0 };
+	guint        n,i;
+	guint        tid;
+	gchar        ph;
+
+	file = g_fopen (filename, "w");
+
+	if (file == NULL) {
+		grig_debug_local (RIG_DEBUG_ERR,
+				  _("%s: Could not open %s for writing"),
+				  __FUNCTION__, filename);
+		return FALSE;
+	}
+
+	recs = g_new (grig_trace_rec_t, GRIG_TRACE_BUFFER_SIZE);
+	n = grig_trace_get_records (recs, GRIG_TRACE_BUFFER_SIZE);
+
+	fprintf (file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+	fprintf (file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,"
+		 "\"args\":{\"name\":\"grig\"}},\n");
+	fprintf (file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,"
+		 "\"args\":{\"name\":\"main\"}},\n", GRIG_TRACE_THREAD_MAIN);
+	fprintf (file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,"
+		 "\"args\":{\"name\":\"daemon\"}}", GRIG_TRACE_THREAD_DAEMON);
+
+	for (i = 0; i < n; i++) {
+
+		tid = (recs[i].thread == GRIG_TRACE_THREAD_MAIN) ?
+			GRIG_TRACE_THREAD_MAIN : GRIG_TRACE_THREAD_DAEMON;
+
+		switch (recs[i].event) {
+
+		case GRIG_TRACE_EV_CMD_BEGIN:
+			name = rig_daemon_get_cmd_name (recs[i].arg[0]);
+			ph = 'B';
+			depth[tid]++;
+			break;
+
+		case GRIG_TRACE_EV_TIMEOUT_BEGIN:
+			name = grig_trace_subsys_name (recs[i].subsys);
+			ph = 'B';
+			depth[tid]++;
+			break;
+
+		case GRIG_TRACE_EV_CMD_END:
+		case GRIG_TRACE_EV_TIMEOUT_END:
+			if (depth[tid] == 0)
+				continue;
+			name = NULL;
+			ph = 'E';
+			depth[tid]--;
+			break;
+
+		default:
+			name = grig_trace_event_name (recs[i].event);
+			ph = 'i';
+			break;
+		}
+
+		fprintf (file, ",\n{\"ph\":\"%c\",\"pid\":1,\"tid\":%d,"
+			 "\"ts\":%" G_GINT64_FORMAT ",\"cat\":\"%s\"",
+			 ph, tid, recs[i].time - recs[0].time,
+			 grig_trace_subsys_name (recs[i].subsys));
+
+		if (name != NULL)
+			fprintf (file, ",\"name\":\"%s\"", name);
+
+		if (ph == 'i')
+			fprintf (file, ",\"s\":\"t\"");
+
+		if (ph != 'B')
+			grig_trace_json_args (file, &recs[i]);
+
+		fprintf (file, "}");
+	}
+
+	fprintf (file, "\n]}\n");
+
+	g_free (recs);
+	fclose (file);
+
+	grig_debug_local (RIG_DEBUG_VERBOSE,
+			  _("%s: Exported %d trace records to %s"),
+			  __FUNCTION__, n, filename);
+
+	return TRUE;
+}
+
+
+/** \brief Write the arguments of a trace record as JSON.
+ *  \param file The output file.
+ *  \param rec The trace record.
+ */
+static void
+grig_trace_json_args (FILE *file, const grig_trace_rec_t *rec)
+{
+	switch (rec->event) {
+
+	case GRIG_TRACE_EV_CMD_END:
+		fprintf (file, ",\"args\":{\"cmd\":\"%s\",\"executed\":%d,"
+			 "\"retcode\":%d}",
+			 rig_daemon_get_cmd_name (rec->arg[0]),
+			 rec->arg[1], rec->arg[2]);
+		break;
+
+	case GRIG_TRACE_EV_TIMEOUT_END:
+		fprintf (file, ",\"args\":{\"return\":%d}", rec->arg[0]);
+		break;
+
+	case GRIG_TRACE_EV_CYCLE:
+		fprintf (file, ",\"args\":{\"count\":%d}", rec->arg[0]);
+		break;
+
+	case GRIG_TRACE_EV_SET_FREQ:
+		fprintf (file, ",\"args\":{\"num\":%d,\"freq\":%" G_GINT64_FORMAT "}",
+			 rec->arg[0], (gint64) rec->arg[1] * 1000 + rec->arg[2]);
+		break;
+
+	case GRIG_TRACE_EV_SET_MODE:
+		fprintf (file, ",\"args\":{\"mode\":\"%s\"}",
+			 rig_strrmode ((rmode_t) rec->arg[0]));
+		break;
+
+	case GRIG_TRACE_EV_SET_PTT:
+		fprintf (file, ",\"args\":{\"ptt\":%d}", rec->arg[0]);
+		break;
+
+	case GRIG_TRACE_EV_SET_VFO:
+		fprintf (file, ",\"args\":{\"vfo\":\"%s\"}",
+			 rig_strvfo ((vfo_t) rec->arg[0]));
+		break;
+
+	case GRIG_TRACE_EV_ANOMALY_RAISE:
+		fprintf (file, ",\"args\":{\"cmd\":\"%s\"}",
+			 rig_daemon_get_cmd_name (rec->arg[0]));
+		break;
+
+	default:
+		fprintf (file, ",\"args\":{\"a0\":%d,\"a1\":%d,\"a2\":%d}",
+			 rec->arg[0], rec->arg[1], rec->arg[2]);
+		break;
+	}
+}
+
+
+/** \brief Get current time in microseconds. */
+static gint64
+grig_trace_time (void)
+{
+#if GLIB_CHECK_VERSION(2,28,0)
+	return g_get_monotonic_time ();
+#else
+	GTimeVal tval;
+
+	g_get_current_time (&tval);
+
+	return ((gint64) tval.tv_sec * G_USEC_PER_SEC) + tval.tv_usec;
+#endif
+}
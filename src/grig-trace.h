@@ -0,0 +1,161 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+    Grig:  Gtk+ user interface for the Hamradio Control Libraries.
+
+    Copyright (C)  2001-2007  Alexandru Csete.
+
+    Authors: Alexandru Csete <oz9aec@gmail.com>
+
+    Comments, questions and bugreports should be submitted via
+    http://sourceforge.net/projects/groundstation/
+    More details can be found at the project home page:
+
+            http://groundstation.sourceforge.net/
+ 
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+  
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+  
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, visit http://www.fsf.org/
+ 
+ 
+ 
+ 
+*/
+/** \file grig-trace.h
+ *  \ingroup trace
+ *  \brief Lightweight binary tracepoints.
+ *
+ * Tracepoints are emitted with the GRIG_TRACE macro. Each tracepoint has a
+ * level which is compared at compile time against GRIG_TRACE_LEVEL (set by
+ * the --with-trace-level configure option); tracepoints above the level are
+ * removed completely by the compiler. The remaining ones are gated at runtime
+ * by a per-subsystem enable mask and cost a single test when disabled.
+ *
+ * Enabled tracepoints store a small fixed-size binary record (timestamp,
+ * thread, subsystem, event and three integer arguments) into a lock-free
+ * ring buffer, which can be dumped to a text file or exported in the Chrome
+ * trace event JSON format understood by chrome://tracing and Perfetto.
+ */
+#ifndef GRIG_TRACE_H
+#define GRIG_TRACE_H 1
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+#include <glib.h>
+
+
+#ifndef GRIG_TRACE_LEVEL
+/** \brief Highest trace level compiled into the binary (0 disables all). */
+#  define GRIG_TRACE_LEVEL 5
+#endif
+
+/** \brief Number of records kept in the trace ring buffer (power of 2). */
+#define GRIG_TRACE_BUFFER_SIZE 4096
+
+
+/** \brief Trace levels. */
+typedef enum {
+	GRIG_TRACE_LEVEL_NONE  = 0,    /*!< Not used by tracepoints. */
+	GRIG_TRACE_LEVEL_ERROR = 1,    /*!< Errors and anomalies. */
+	GRIG_TRACE_LEVEL_INFO  = 2,    /*!< Rare, user triggered events. */
+	GRIG_TRACE_LEVEL_CMD   = 3,    /*!< Rig commands. */
+	GRIG_TRACE_LEVEL_CYCLE = 4,    /*!< Periodic cycles and timeouts. */
+	GRIG_TRACE_LEVEL_DEBUG = 5     /*!< Very verbose. */
+} grig_trace_level_t;
+
+
+/** \brief Trace subsystems; each has one bit in the runtime mask. */
+typedef enum {
+	GRIG_TRACE_DAEMON = 0,      /*!< Rig daemon. */
+	GRIG_TRACE_DATA,            /*!< Shared rig data. */
+	GRIG_TRACE_GUI_LCD,         /*!< LCD display. */
+	GRIG_TRACE_GUI_SMETER,      /*!< S-meter. */
+	GRIG_TRACE_ANOMALY,         /*!< Anomaly detection. */
+	GRIG_TRACE_GUI_BUTTONS,     /*!< Button panel. */
+	GRIG_TRACE_GUI_CTRL2,       /*!< Second control panel. */
+	GRIG_TRACE_SUBSYS_NUMBER    /*!< Number of subsystems. */
+} grig_trace_subsys_t;
+
+
+/** \brief Trace events. */
+typedef enum {
+	GRIG_TRACE_EV_NONE = 0,        /*!< Dummy event. */
+	GRIG_TRACE_EV_CMD_BEGIN,       /*!< Command started; a0 = cmd. */
+	GRIG_TRACE_EV_CMD_END,         /*!< Command finished; a0 = cmd, a1 = executed, a2 = retcode. */
+	GRIG_TRACE_EV_CYCLE,           /*!< Daemon cycle wrapped; a0 = cycle count. */
+	GRIG_TRACE_EV_SET_FREQ,        /*!< Frequency set; a0 = num, a1 = kHz, a2 = Hz. */
+	GRIG_TRACE_EV_SET_MODE,        /*!< Mode set; a0 = mode. */
+	GRIG_TRACE_EV_SET_PTT,         /*!< PTT set; a0 = ptt. */
+	GRIG_TRACE_EV_SET_VFO,         /*!< VFO set; a0 = vfo. */
+	GRIG_TRACE_EV_TIMEOUT_BEGIN,   /*!< GUI timeout callback started. */
+	GRIG_TRACE_EV_TIMEOUT_END,     /*!< GUI timeout callback finished; a0 = return value. */
+	GRIG_TRACE_EV_ANOMALY_RAISE,   /*!< Anomaly raised; a0 = cmd. */
+	GRIG_TRACE_EV_NUMBER           /*!< Number of events. */
+} grig_trace_event_t;
+
+
+/** \brief Thread identifiers stored in trace records. */
+typedef enum {
+	GRIG_TRACE_THREAD_MAIN   = 1,   /*!< The Gtk+ main loop. */
+	GRIG_TRACE_THREAD_DAEMON = 2    /*!< Any other thread, ie. the daemon. */
+} grig_trace_thread_t;
+
+
+/** \brief Binary trace record. */
+typedef struct {
+	gint64  time;       /*!< Timestamp in microseconds. */
+	guint16 thread;     /*!< Thread, see grig_trace_thread_t. */
+	guint16 subsys;     /*!< Subsystem, see grig_trace_subsys_t. */
+	guint16 event;      /*!< Event, see grig_trace_event_t. */
+	gint32  arg[3];     /*!< Event specific arguments. */
+} grig_trace_rec_t;
+
+
+/** \brief Runtime subsystem mask; do not modify directly. */
+extern volatile guint grig_trace_mask;
+
+
+/** \brief Emit a tracepoint.
+ *
+ * Compiles to nothing when level is above GRIG_TRACE_LEVEL; otherwise the
+ * record is only stored when the bit of subsys is set in the runtime mask.
+ */
+#define GRIG_TRACE(level,subsys,event,a0,a1,a2)                          \
+	do {                                                             \
+		if (((level) <= GRIG_TRACE_LEVEL) &&                     \
+		    (grig_trace_mask & (1 << (subsys))))                 \
+			grig_trace_emit ((subsys), (event), (gint32) (a0), \
+					 (gint32) (a1), (gint32) (a2));    \
+	} while (0)
+
+
+void         grig_trace_emit        (grig_trace_subsys_t subsys,
+				     grig_trace_event_t  event,
+				     gint32 a0, gint32 a1, gint32 a2);
+
+void         grig_trace_set_mask    (guint mask);
+guint        grig_trace_get_mask    (void);
+gboolean     grig_trace_parse_mask  (const gchar *list, guint *mask);
+
+guint        grig_trace_get_records (grig_trace_rec_t *recs, guint max);
+void         grig_trace_clear       (void);
+
+const gchar *grig_trace_subsys_name (grig_trace_subsys_t subsys);
+const gchar *grig_trace_event_name  (grig_trace_event_t event);
+
+guint        grig_trace_timeout_add (guint interval, GSourceFunc func,
+				     gpointer data, grig_trace_subsys_t subsys);
+
+gboolean     grig_trace_dump        (const gchar *filename);
+gboolean     grig_trace_export_json (const gchar *filename);
+
+#endif
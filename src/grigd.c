@@ -0,0 +1,484 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+    Grig:  Gtk+ user interface for the Hamradio Control Libraries.
+
+    Copyright (C)  2001-2007  Alexandru Csete.
+
+    Authors: Alexandru Csete <oz9aec@gmail.com>
+
+    Comments, questions and bugreports should be submitted via
+    http://sourceforge.net/projects/groundstation/
+    More details can be found at the project home page:
+
+            http://groundstation.sourceforge.net/
+ 
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+  
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+  
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, visit http://www.fsf.org/
+ 
+ 
+ 
+*/
+/** \file    grigd.c
+ *  \ingroup main
+ *  \brief   Headless rig daemon.
+ *
+ * grigd runs the rig daemon without a user interface so that the radio
+ * stays connected while grig user interfaces come and go. The user
+ * interfaces attach with grig --attach, see rig-ipc.h; on a remote host
+ * the socket can be forwarded with ssh, e.g.
+ *
+ *   ssh -L /tmp/grigd.sock:/home/user/.grig/grigd.sock station
+ *   grig --attach=/tmp/grigd.sock
+ *
+ * The rigctld server, shared memory publication, metrics, tracing and
+ * recording work as in grig.
+ */
+#include <stdlib.h>
+#include <signal.h>
+#include <glib.h>
+#include <glib/gi18n.h>
+#include <hamlib/rig.h>
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+#ifdef HAVE_GETOPT_H
+#  include <getopt.h>
+#endif
+#include "compat.h"
+#include "grig-config.h"
+#include "grig-debug.h"
+#include "grig-latency.h"
+#include "grig-metrics.h"
+#include "grig-trace.h"
+#include "rig-daemon.h"
+#include "rig-data.h"
+#include "rig-ipc.h"
+#include "rig-server.h"
+#include "rig-shm.h"
+
+
+/* command line arguments */
+static gint     rignum    = 0;       /*!< Hamlib model of the radio. */
+static gchar   *rigfile   = NULL;    /*!< The port where the rig is atached. */
+static gchar   *civaddr   = NULL;    /*!< CI-V address for ICOM rig. */
+static gchar   *rigconf   = NULL;    /*!< Configuration parameter. */
+static gint     rigspeed  = 0;       /*!< Optional serial speed. */
+static gint     debug     = RIG_DEBUG_WARN; /*!< Hamlib debug level. */
+static gint     delay     = 0;       /*!< Command delay. */
+static gchar   *logfile   = NULL;    /*!< Debug log file. */
+static gint     logsize   = 0;       /*!< Max size of log file segments in kB. */
+static gint     logcount  = 0;       /*!< Number of old log file segments. */
+static gboolean loggzip   = FALSE;   /*!< Compress old log file segments. */
+static guint    tracemask = 0;       /*!< Enabled trace subsystems. */
+static gchar   *tracejson = NULL;    /*!< Chrome trace file written at exit. */
+static gchar   *metrics   = NULL;    /*!< Metrics port or socket. */
+static gchar   *recfile   = NULL;    /*!< File to record rig traffic to. */
+static gchar   *replay    = NULL;    /*!< Recording to replay instead of using a rig. */
+static gdouble  replayspd = 1.0;     /*!< Replay speed factor. */
+static gint     rigctld   = 0;       /*!< Port for the rigctld compatible server. */
+static gchar   *shmname   = NULL;    /*!< Shared memory segment for the rig state. */
+static gchar   *listenaddr = NULL;   /*!< Address to serve grig clients at. */
+static gboolean nothread  = FALSE;   /*!< Don't use threads, just a regular timeout. */
+static gboolean pstat     = FALSE;   /*!< Enable power status. */
+static gboolean ptt       = FALSE;   /*!< Enable PTT. */
+static gboolean version   = FALSE;   /*!< Show version and exit. */
+static gboolean help      = FALSE;   /*!< Show help and exit. */
+
+static GMainLoop *loop = NULL;       /*!< The main loop. */
+
+
+/** \brief Short options. */
+#define SHORT_OPTIONS "m:r:s:c:C:d:D:L:S:N:T:J:M:R:Y:x:t:H:u:znpPhv"
+
+/** \brief Table of command line options. */
+static struct option long_options[] =
+{
+	{"model",        1, 0, 'm'},
+	{"rig-file",     1, 0, 'r'},
+	{"speed",        1, 0, 's'},
+	{"civaddr",      1, 0, 'c'},
+	{"set-conf",     1, 0, 'C'},
+	{"debug",        1, 0, 'd'},
+	{"delay",        1, 0, 'D'},
+	{"log-file",     1, 0, 'L'},
+	{"log-size",     1, 0, 'S'},
+	{"log-count",    1, 0, 'N'},
+	{"log-gzip",     0, 0, 'z'},
+	{"trace",        1, 0, 'T'},
+	{"trace-json",   1, 0, 'J'},
+	{"metrics",      1, 0, 'M'},
+	{"record",       1, 0, 'R'},
+	{"replay",       1, 0, 'Y'},
+	{"replay-speed", 1, 0, 'x'},
+	{"rigctld",      1, 0, 't'},
+	{"shm",          1, 0, 'H'},
+	{"listen",       1, 0, 'u'},
+	{"nothread",     0, 0, 'n'},
+	{"enable-ptt",   0, 0, 'p'},
+	{"enable-pwr",   0, 0, 'P'},
+	{"help",         0, 0, 'h'},
+	{"version",      0, 0, 'v'},
+	{NULL, 0, 0, 0}
+};
+
+
+static void grigd_show_help    (void);
+static void grigd_show_version (void);
+static void grigd_sig_handler  (int sig);
+
+
+
+/** \brief Main program execution entry.
+ *  \param argc The number o command line arguments.
+ *  \param argv List of command line arguments.
+ *  \return Execution status (non-zero mean error ocurred).
+ */
+int
+main (int argc, char *argv[])
+{
+	gchar *addr;
+
+
+	/* Initialize NLS support */
+#ifdef ENABLE_NLS
+	bindtextdomain (PACKAGE, PACKAGE_LOCALE_DIR);
+	bind_textdomain_codeset (PACKAGE, "UTF-8");
+	textdomain (PACKAGE);
+#endif
+
+#if !GLIB_CHECK_VERSION(2,32,0)
+	if (!g_thread_supported ())
+		g_thread_init (NULL);
+#endif
+
+	while (1) {
+		int c;
+		int option_index = 0;
+
+		c = getopt_long (argc, argv, SHORT_OPTIONS,
+				 long_options, &option_index);
+
+		if (c == -1)
+			break;
+
+		switch (c) {
+
+		case 'm':
+			rignum = atoi (optarg);
+			break;
+
+		case 'r':
+			rigfile = optarg;
+			break;
+
+		case 's':
+			rigspeed = atoi (optarg);
+			break;
+
+		case 'c':
+			civaddr = optarg;
+			break;
+
+		case 'C':
+			rigconf = optarg;
+			break;
+
+		case 'd':
+			debug = atoi (optarg);
+			break;
+
+		case 'D':
+			delay = atoi (optarg);
+			break;
+
+		case 'L':
+			logfile = optarg;
+			break;
+
+		case 'S':
+			logsize = atoi (optarg);
+			break;
+
+		case 'N':
+			logcount = atoi (optarg);
+			break;
+
+		case 'z':
+			loggzip = TRUE;
+			break;
+
+		case 'T':
+			if (!grig_trace_parse_mask (optarg, &tracemask)) {
+				help = TRUE;
+			}
+			break;
+
+		case 'J':
+			tracejson = optarg;
+			break;
+
+		case 'M':
+			metrics = optarg;
+			break;
+
+		case 'R':
+			recfile = optarg;
+			break;
+
+		case 'Y':
+			replay = optarg;
+			break;
+
+		case 'x':
+			replayspd = g_ascii_strtod (optarg, NULL);
+			break;
+
+		case 't':
+			rigctld = atoi (optarg);
+			break;
+
+		case 'H':
+			shmname = optarg;
+			break;
+
+		case 'u':
+			listenaddr = optarg;
+			break;
+
+		case 'n':
+			nothread = TRUE;
+			break;
+
+		case 'p':
+			ptt = TRUE;
+			break;
+
+		case 'P':
+			pstat = TRUE;
+			break;
+
+		case 'v':
+			version = TRUE;
+			break;
+
+		case 'h':
+		default:
+			help = TRUE;
+			break;
+		}
+	}
+
+	if (help) {
+		grigd_show_help ();
+		return 0;
+	}
+
+	if (version) {
+		grigd_show_version ();
+		return 0;
+	}
+
+	/* full debug output while the daemon is started */
+	grig_debug_set_level (RIG_DEBUG_TRACE);
+
+	grig_debug_set_log_rotation ((logsize > 0) ? 1024 * (gulong) logsize : 0,
+				     (logcount > 0) ? (guint) logcount : 0,
+				     loggzip);
+	grig_debug_init (logfile);
+
+	if ((tracejson != NULL) && (tracemask == 0)) {
+		tracemask = (1 << GRIG_TRACE_SUBSYS_NUMBER) - 1;
+	}
+	grig_trace_set_mask (tracemask);
+
+	if (metrics != NULL) {
+		grig_metrics_start (metrics);
+	}
+
+	/* the default socket lives in the configuration directory */
+	if (!grig_config_check ()) {
+		g_print (_("Grig configuration check failed!\n"));
+		grig_debug_close ();
+		return 1;
+	}
+
+	rig_daemon_set_record (recfile);
+	rig_daemon_set_replay (replay, replayspd);
+
+	if (rig_daemon_start (rignum, rigfile, rigspeed, civaddr, rigconf,
+			      delay, nothread, ptt, pstat)) {
+		grig_debug_close ();
+		return 1;
+	}
+
+	addr = (listenaddr != NULL) ? g_strdup (listenaddr) : rig_ipc_default_addr ();
+
+	if (!rig_ipc_server_start (addr)) {
+		g_free (addr);
+		rig_daemon_stop ();
+		grig_debug_close ();
+		return 1;
+	}
+
+	g_free (addr);
+
+	if (rigctld > 0) {
+		rig_server_start (rigctld);
+	}
+
+	if (shmname != NULL) {
+		rig_shm_start (shmname, rig_daemon_get_rig_id ());
+	}
+
+	if ((debug >= RIG_DEBUG_NONE) && (debug <= RIG_DEBUG_TRACE)) {
+		grig_debug_set_level (debug);
+	}
+	else {
+		grig_debug_set_level (RIG_DEBUG_WARN);
+	}
+
+	signal (SIGTERM, (void *) grigd_sig_handler);
+	signal (SIGINT,  (void *) grigd_sig_handler);
+#ifdef SIGPIPE
+	signal (SIGPIPE, SIG_IGN);
+#endif
+
+	loop = g_main_loop_new (NULL, FALSE);
+	g_main_loop_run (loop);
+	g_main_loop_unref (loop);
+
+	/* clean up in the same order as grig */
+	grig_debug_set_level (RIG_DEBUG_TRACE);
+
+	rig_server_stop ();
+	rig_ipc_server_stop ();
+	rig_daemon_stop ();
+	rig_shm_stop ();
+	grig_metrics_stop ();
+	grig_latency_close ();
+
+	if (tracejson != NULL) {
+		grig_trace_set_mask (0);
+		grig_trace_export_json (tracejson);
+	}
+	else if (grig_trace_get_mask ()) {
+		gchar *fname;
+
+		grig_trace_set_mask (0);
+		fname = get_conf_dir ("trace.txt");
+		grig_trace_dump (fname);
+		g_free (fname);
+	}
+
+	grig_debug_close ();
+
+	return 0;
+}
+
+
+/** \brief Stop the main loop on SIGTERM and SIGINT. */
+static void
+grigd_sig_handler  (int sig)
+{
+	grig_debug_local (RIG_DEBUG_VERBOSE,
+			  _("Received signal %d, exiting"),
+			  sig);
+
+	g_main_loop_quit (loop);
+}
+
+
+/** \brief Show help message. */
+static void
+grigd_show_help    ()
+{
+	gchar *addr;
+
+
+	addr = rig_ipc_default_addr ();
+
+	g_print (_("Usage: grigd [OPTION]...\n\n"));
+	g_print (_("  -m, --model=ID              "\
+		   "select radio model number; see grig --list\n"));
+	g_print (_("  -r, --rig-file=DEVICE       "\
+		   "set device of the radio, eg. /dev/ttyS0\n"));
+	g_print (_("  -s, --speed=BAUD            "\
+		   "set transfer rate (serial port only)\n"));
+	g_print (_("  -c, --civaddr=ID            "\
+		   "set CI-V address (decimal, ICOM only)\n"));
+	g_print (_("  -C, --set-conf=param=val    "\
+		   "set config parameter (same as in rigctl)\n"));
+	g_print (_("  -d, --debug=LEVEL           "\
+		   "set hamlib debug level (0..5)\n"));
+	g_print (_("  -D, --delay=val             "\
+		   "set delay between commands in msec\n"));
+	g_print (_("  -L, --log-file=FILE         "\
+		   "save debug messages to FILE\n"));
+	g_print (_("  -S, --log-size=KB           "\
+		   "start a new log file after KB kilobytes\n"));
+	g_print (_("  -N, --log-count=NUM         "\
+		   "number of old log files to keep\n"));
+	g_print (_("  -z, --log-gzip              "\
+		   "compress old log files\n"));
+	g_print (_("  -T, --trace=LIST            "\
+		   "enable tracepoints, see grig --help\n"));
+	g_print (_("  -J, --trace-json=FILE       "\
+		   "save trace in Chrome trace format to FILE\n"));
+	g_print (_("  -M, --metrics=PORT|PATH     "\
+		   "serve daemon metrics in Prometheus format\n"));
+	g_print (_("  -R, --record=FILE           "\
+		   "record the rig traffic to FILE\n"));
+	g_print (_("  -Y, --replay=FILE           "\
+		   "replay the rig traffic recorded in FILE\n"));
+	g_print (_("  -x, --replay-speed=FACTOR   "\
+		   "replay speed; 1 is real time (default)\n"));
+	g_print (_("  -t, --rigctld=PORT          "\
+		   "serve the rigctld protocol on localhost:PORT\n"));
+	g_print (_("  -H, --shm=NAME              "\
+		   "publish the rig state in shared memory NAME\n"));
+	g_print (_("  -u, --listen=PORT|PATH      "\
+		   "let grig attach at localhost:PORT or\n"\
+		   "                              "\
+		   "UNIX socket PATH (default %s)\n"), addr);
+	g_print (_("  -n, --nothread              "\
+		   "start daemon without using threads\n"));
+	g_print (_("  -p, --enable-ptt            "\
+		   "enable PTT\n"));
+	g_print (_("  -P, --enable-pwr            "\
+		   "enable POWER\n"));
+	g_print (_("  -h, --help                  "\
+		   "show this help message and exit\n"));
+	g_print (_("  -v, --version               "\
+		   "show version information and exit\n"));
+	g_print ("\n");
+
+	g_free (addr);
+}
+
+
+/** \brief Show version information. */
+static void
+grigd_show_version ()
+{
+	g_print (_("grigd %s\n"), VERSION);
+	g_print (_("Rig daemon for the Gtk+ user interface of the "\
+		   "Hamradio Control Libraries."));
+	g_print ("\n\n");
+	g_print (_("Copyright (C)  2001-2007  Alexandru Csete."));
+	g_print ("\n");
+	g_print (_("This is free software; see the source for "\
+		   "copying conditions. "));
+	g_print (_("There is NO warranty; not even for MERCHANTABILITY "
+		   "or FITNESS FOR A PARTICULAR PURPOSE."));
+	g_print ("\n");
+}
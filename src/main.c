@@ -53,10 +53,23 @@
 #include "grig-config.h"
 #include "rig-gui.h"
 #include "grig-debug.h"
+#include "grig-latency.h"
+#include "grig-gui-latency.h"
+#include "grig-metrics.h"
+#include "grig-trace.h"
 #include "rig-gui-message-window.h"
 #include "rig-daemon.h"
 #include "rig-data.h"
+#include "rig-doppler.h"
+#include "rig-ipc.h"
+#include "rig-link.h"
+#include "rig-mem.h"
+#include "rig-gui-smeter.h"
+#include "rig-scan.h"
 #include "rig-selector.h"
+#include "rig-server.h"
+#include "rig-shm.h"
+#include "rig-spectrum.h"
 #include "key-press-handler.h"
 
 
@@ -77,6 +90,25 @@ static gint     rigspeed  = 0;       /*!< Optional serial speed. */
 static gboolean listrigs  = FALSE;   /*!< List supported radios and exit. */ 
 gint debug     = RIG_DEBUG_NONE; /*!< Hamlib debug level. Note: not static since menubar.c needs access. */
 static gint     delay     = 0;       /*!< Command delay. */
+static gint     bgdelay   = 0;       /*!< Minimum command delay in background. */
+static gchar   *logfile   = NULL;    /*!< Debug log file. */
+static gint     logsize   = 0;       /*!< Max size of log file segments in kB. */
+static gint     logcount  = 0;       /*!< Number of old log file segments. */
+static gboolean loggzip   = FALSE;   /*!< Compress old log file segments. */
+static guint    tracemask = 0;       /*!< Enabled trace subsystems. */
+static gchar   *tracejson = NULL;    /*!< Chrome trace file written at exit. */
+static gchar   *metrics   = NULL;    /*!< Metrics port or socket. */
+static gchar   *recfile   = NULL;    /*!< File to record rig traffic to. */
+static gchar   *replay    = NULL;    /*!< Recording to replay instead of using a rig. */
+static gdouble  replayspd = 1.0;     /*!< Replay speed factor. */
+static gint     rigctld   = 0;       /*!< Port for the rigctld compatible server. */
+static gchar   *shmname   = NULL;    /*!< Shared memory segment for the rig state. */
+static gchar   *attach    = NULL;    /*!< Address of grigd to attach to. */
+static gchar   *listenaddr = NULL;   /*!< Address to serve grig clients at. */
+static GSList   *addrigs   = NULL;   /*!< Additional rigs as MODEL,PORT[,SPEED[,DELAY[,CONF]]]. */
+static gchar   *doppler   = NULL;    /*!< Range-rate samples of a satellite pass. */
+static gchar   *scanspec  = NULL;    /*!< Channels and settings of a scan. */
+static gchar   *memfile   = NULL;    /*!< Software memory file or NULL for the default. */
 static gboolean nothread  = FALSE;   /*!< Don't use threads, just a regular gtk-timeout. */
 static gboolean pstat     = FALSE;   /*!< Enable power status button. */
 static gboolean ptt       = FALSE;   /*!< Enable PTT button. */
@@ -84,9 +116,15 @@ static gboolean version   = FALSE;   /*!< Show version and exit. */
 static gboolean help      = FALSE;   /*!< Show help and exit. */
 //static gchar    *rigcfg   = NULL;    /*!< .radio file name. */
 
+/* main window state */
+static gboolean app_iconified  = FALSE;  /*!< Main window is iconified or withdrawn. */
+static gboolean app_unmapped   = FALSE;  /*!< Main window is not mapped (e.g. other workspace). */
+static gboolean app_obscured   = FALSE;  /*!< Main window is fully covered by other windows. */
+static gboolean app_background = FALSE;  /*!< Grig is in background mode. */
+
 /* group those which take no arg */
 /** \brief Short options. */
-#define SHORT_OPTIONS "m:r:s:c:C:d:D:nlpPhv"  
+#define SHORT_OPTIONS "m:r:s:c:C:d:D:B:L:S:N:T:J:M:R:Y:x:t:H:a:u:A:k:g:G:K:E:zWnlpPhv"  
 
 /** \brief Table of command line options. */
 static struct option long_options[] =
@@ -98,6 +136,28 @@ static struct option long_options[] =
 	{"set-conf",     1, 0, 'C'},
 	{"debug",        1, 0, 'd'},
 	{"delay",        1, 0, 'D'},
+	{"bg-delay",     1, 0, 'B'},
+	{"log-file",     1, 0, 'L'},
+	{"log-size",     1, 0, 'S'},
+	{"log-count",    1, 0, 'N'},
+	{"log-gzip",     0, 0, 'z'},
+	{"trace",        1, 0, 'T'},
+	{"trace-json",   1, 0, 'J'},
+	{"metrics",      1, 0, 'M'},
+	{"record",       1, 0, 'R'},
+	{"replay",       1, 0, 'Y'},
+	{"replay-speed", 1, 0, 'x'},
+	{"rigctld",      1, 0, 't'},
+	{"shm",          1, 0, 'H'},
+	{"attach",       1, 0, 'a'},
+	{"listen",       1, 0, 'u'},
+	{"add-rig",      1, 0, 'A'},
+	{"link",         1, 0, 'k'},
+	{"doppler",      1, 0, 'g'},
+	{"doppler-plan", 1, 0, 'G'},
+	{"scan",         1, 0, 'K'},
+	{"memory",       1, 0, 'E'},
+	{"spectrum",     0, 0, 'W'},
 	{"nothread",     0, 0, 'n'},
 	{"list",         0, 0, 'l'},
 	{"enable-ptt",   0, 0, 'p'},
@@ -122,7 +182,12 @@ typedef struct {
 static void        grig_list_rigs      (void);
 static GtkWidget  *grig_app_create     (gint);
 static gint        grig_app_delete     (GtkWidget *, GdkEvent *, gpointer);
+static gboolean    grig_app_state_cb   (GtkWidget *, GdkEventWindowState *, gpointer);
+static gboolean    grig_app_map_cb     (GtkWidget *, GdkEvent *, gpointer);
+static gboolean    grig_app_visibility_cb (GtkWidget *, GdkEventVisibility *, gpointer);
+static void        grig_app_update_background (void);
 static void        grig_app_destroy    (GtkWidget *, gpointer);
+static void        grig_add_rigs       (void);
 static void        grig_show_help      (void);
 static void        grig_show_version   (void);
 static gint        grig_list_add       (const struct rig_caps *, void *);
@@ -281,6 +346,207 @@ main (int argc, char *argv[])
 			}
 			break;
 
+			/* command delay in background */
+		case 'B':
+			if (!optarg) {
+				help = TRUE;
+			}
+			else {
+				bgdelay = atoi (optarg);
+			}
+			break;
+
+			/* debug log file */
+		case 'L':
+			if (!optarg) {
+				help = TRUE;
+			}
+			else {
+				logfile = optarg;
+			}
+			break;
+
+			/* max size of log file */
+		case 'S':
+			if (!optarg) {
+				help = TRUE;
+			}
+			else {
+				logsize = atoi (optarg);
+			}
+			break;
+
+			/* number of old log files */
+		case 'N':
+			if (!optarg) {
+				help = TRUE;
+			}
+			else {
+				logcount = atoi (optarg);
+			}
+			break;
+
+			/* compress old log files */
+		case 'z':
+			loggzip = TRUE;
+			break;
+
+			/* enable tracepoints */
+		case 'T':
+			if (!optarg || !grig_trace_parse_mask (optarg, &tracemask)) {
+				help = TRUE;
+			}
+			break;
+
+			/* export Chrome trace at exit */
+		case 'J':
+			if (!optarg) {
+				help = TRUE;
+			}
+			else {
+				tracejson = optarg;
+			}
+			break;
+
+			/* serve daemon metrics */
+		case 'M':
+			if (!optarg) {
+				help = TRUE;
+			}
+			else {
+				metrics = optarg;
+			}
+			break;
+
+			/* record rig traffic */
+		case 'R':
+			if (!optarg) {
+				help = TRUE;
+			}
+			else {
+				recfile = optarg;
+			}
+			break;
+
+			/* replay recorded rig traffic */
+		case 'Y':
+			if (!optarg) {
+				help = TRUE;
+			}
+			else {
+				replay = optarg;
+			}
+			break;
+
+			/* replay speed */
+		case 'x':
+			if (!optarg) {
+				help = TRUE;
+			}
+			else {
+				replayspd = g_ascii_strtod (optarg, NULL);
+			}
+			break;
+
+			/* rigctld compatible server */
+		case 't':
+			if (!optarg) {
+				help = TRUE;
+			}
+			else {
+				rigctld = atoi (optarg);
+			}
+			break;
+
+			/* shared memory publication */
+		case 'H':
+			if (!optarg) {
+				help = TRUE;
+			}
+			else {
+				shmname = optarg;
+			}
+			break;
+
+			/* attach to grigd */
+		case 'a':
+			if (!optarg) {
+				help = TRUE;
+			}
+			else {
+				attach = optarg;
+			}
+			break;
+
+			/* serve grig clients */
+		case 'u':
+			if (!optarg) {
+				help = TRUE;
+			}
+			else {
+				listenaddr = optarg;
+			}
+			break;
+
+			/* additional rig */
+		case 'A':
+			if (!optarg) {
+				help = TRUE;
+			}
+			else {
+				addrigs = g_slist_append (addrigs, optarg);
+			}
+			break;
+
+			/* link the additional rig to the primary rig */
+		case 'k':
+			if (!optarg || !rig_link_parse (optarg)) {
+				help = TRUE;
+			}
+			break;
+
+			/* Doppler correction */
+		case 'g':
+			if (!optarg) {
+				help = TRUE;
+			}
+			else {
+				doppler = optarg;
+			}
+			break;
+
+			/* Doppler frequency plan */
+		case 'G':
+			if (!optarg || !rig_doppler_set_plan (optarg)) {
+				help = TRUE;
+			}
+			break;
+
+			/* software scan */
+		case 'K':
+			if (!optarg) {
+				help = TRUE;
+			}
+			else {
+				scanspec = optarg;
+			}
+			break;
+
+			/* software memory file */
+		case 'E':
+			if (!optarg) {
+				help = TRUE;
+			}
+			else {
+				memfile = optarg;
+			}
+			break;
+
+			/* scope data of the rig */
+		case 'W':
+			rig_spectrum_enable (TRUE);
+			break;
+
 			/* no threads */
 		case 'n':
 			nothread = TRUE;
@@ -339,7 +605,21 @@ main (int argc, char *argv[])
 	grig_debug_set_level (RIG_DEBUG_TRACE);
 
 	/* initialise debug handler */
-	grig_debug_init (NULL);
+	grig_debug_set_log_rotation ((logsize > 0) ? 1024 * (gulong) logsize : 0,
+				     (logcount > 0) ? (guint) logcount : 0,
+				     loggzip);
+	grig_debug_init (logfile);
+
+	/* enable tracepoints; all of them if only a trace file is given */
+	if ((tracejson != NULL) && (tracemask == 0)) {
+		tracemask = (1 << GRIG_TRACE_SUBSYS_NUMBER) - 1;
+	}
+	grig_trace_set_mask (tracemask);
+
+	/* serve metrics; grig runs without them if this fails */
+	if (metrics != NULL) {
+		grig_metrics_start (metrics);
+	}
 
 	/* check configuration */
 	if (!grig_config_check ()) {
@@ -356,6 +636,9 @@ main (int argc, char *argv[])
 
 	/* At this point, configuration is OK. */
 
+	/* grig continues with an empty memory if the file is broken */
+	rig_mem_load (memfile);
+
 
     /* 1. prio: .grc file */
     
@@ -367,6 +650,11 @@ main (int argc, char *argv[])
 	/* launch rig daemon and pass the relevant
 	   command line options
 	*/
+	rig_daemon_set_bg_delay (bgdelay);
+	rig_daemon_set_record (recfile);
+	rig_daemon_set_replay (replay, replayspd);
+	rig_daemon_set_attach (attach);
+
 	if (rig_daemon_start (rignum,
 						  rigfile,
 						  rigspeed,
@@ -381,6 +669,35 @@ main (int argc, char *argv[])
 		return 1;
 	}
 
+	/* additional rigs; grig continues without the ones that fail */
+	grig_add_rigs ();
+
+	/* let other grig instances attach */
+	if (listenaddr != NULL) {
+		rig_ipc_server_start (listenaddr);
+	}
+
+	/* share the radio with other programs */
+	if (rigctld > 0) {
+		rig_server_start (rigctld);
+	}
+
+	/* publish the rig state to local programs */
+	if (shmname != NULL) {
+		rig_shm_start (shmname, rig_daemon_get_rig_id ());
+	}
+
+	/* correct the frequencies during a satellite pass */
+	if ((doppler != NULL) && !rig_doppler_start (doppler)) {
+		g_print (_("Doppler correction not started; check --doppler-plan and %s\n"),
+			 doppler);
+	}
+
+	/* scan with the primary rig */
+	if ((scanspec != NULL) && !rig_scan_start (scanspec)) {
+		g_print (_("Scan not started; check --scan\n"));
+	}
+
     /* install key press event handler */
     key_press_handler_init ();
 
@@ -401,6 +718,10 @@ main (int argc, char *argv[])
 	/* add contents */
 	gtk_container_add (GTK_CONTAINER (grigapp), rig_gui_create ());
 	gtk_widget_show (grigapp);
+
+	/* measure main loop callbacks */
+	grig_latency_init ();
+	grig_gui_latency_init ();
     
 	gtk_main ();
 
@@ -409,6 +730,52 @@ main (int argc, char *argv[])
 }
 
 
+/** \brief Start the additional rigs.
+ *
+ * Each rig given with --add-rig is specified as
+ * MODEL,PORT[,SPEED[,DELAY[,CONF]]] where CONF may contain further commas.
+ * A rig without DELAY uses the command delay of the primary rig. The rigs
+ * use the same thread, PTT and power settings as the primary rig.
+ */
+static void
+grig_add_rigs       ()
+{
+	GSList  *node;
+	gchar  **vec;
+	gint     speed;
+	gint     cmddel;
+
+
+	for (node = addrigs; node != NULL; node = node->next) {
+
+		vec = g_strsplit ((const gchar *) node->data, ",", 5);
+
+		if ((vec[0] == NULL) || (vec[1] == NULL)) {
+			g_print (_("Invalid rig specification: %s\n"),
+				 (const gchar *) node->data);
+			g_strfreev (vec);
+			continue;
+		}
+
+		speed = (vec[2] != NULL) ? atoi (vec[2]) : 0;
+		cmddel = ((vec[2] != NULL) && (vec[3] != NULL)) ? atoi (vec[3]) : 0;
+
+		if (rig_daemon_add (atoi (vec[0]), vec[1], speed, NULL,
+				    ((vec[2] != NULL) && (vec[3] != NULL)) ? vec[4] : NULL,
+				    (cmddel > 0) ? cmddel : delay,
+				    nothread, ptt, pstat)) {
+			g_print (_("Failed to start rig %s\n"),
+				 (const gchar *) node->data);
+		}
+
+		g_strfreev (vec);
+	}
+
+	g_slist_free (addrigs);
+	addrigs = NULL;
+}
+
+
 
 
 
@@ -458,6 +825,19 @@ grig_app_create       (gint rignum)
 	g_signal_connect (G_OBJECT (app), "destroy",
 			  G_CALLBACK (grig_app_destroy), NULL);
 
+	/* track whether the window can be seen so that we can
+	   save some power when it can not
+	*/
+	gtk_widget_add_events (app, GDK_VISIBILITY_NOTIFY_MASK);
+	g_signal_connect (G_OBJECT (app), "window_state_event",
+			  G_CALLBACK (grig_app_state_cb), NULL);
+	g_signal_connect (G_OBJECT (app), "map_event",
+			  G_CALLBACK (grig_app_map_cb), NULL);
+	g_signal_connect (G_OBJECT (app), "unmap_event",
+			  G_CALLBACK (grig_app_map_cb), NULL);
+	g_signal_connect (G_OBJECT (app), "visibility_notify_event",
+			  G_CALLBACK (grig_app_visibility_cb), NULL);
+
 	/* register UNIX signals as well so that we 
 	   have a chance to clean up hamlib.
 	*/
@@ -469,6 +849,86 @@ grig_app_create       (gint rignum)
 }
 
 
+/** \brief Handle state changes of the main window.
+ *  \param widget The main window.
+ *  \param event  The window state event.
+ *  \param data   User data; always NULL.
+ *  \return Always FALSE to let other handlers see the event.
+ */
+static gboolean
+grig_app_state_cb   (GtkWidget           *widget,
+		     GdkEventWindowState *event,
+		     gpointer             data)
+{
+	app_iconified = (event->new_window_state &
+			 (GDK_WINDOW_STATE_ICONIFIED | GDK_WINDOW_STATE_WITHDRAWN)) != 0;
+	grig_app_update_background ();
+
+	return FALSE;
+}
+
+
+/** \brief Handle map and unmap events of the main window.
+ *  \param widget The main window.
+ *  \param event  The map or unmap event.
+ *  \param data   User data; always NULL.
+ *  \return Always FALSE to let other handlers see the event.
+ *
+ * Most window managers unmap the windows on other workspaces.
+ */
+static gboolean
+grig_app_map_cb     (GtkWidget *widget,
+		     GdkEvent  *event,
+		     gpointer   data)
+{
+	app_unmapped = (event->type == GDK_UNMAP);
+	grig_app_update_background ();
+
+	return FALSE;
+}
+
+
+/** \brief Handle visibility changes of the main window.
+ *  \param widget The main window.
+ *  \param event  The visibility event.
+ *  \param data   User data; always NULL.
+ *  \return Always FALSE to let other handlers see the event.
+ */
+static gboolean
+grig_app_visibility_cb (GtkWidget          *widget,
+			GdkEventVisibility *event,
+			gpointer            data)
+{
+	app_obscured = (event->state == GDK_VISIBILITY_FULLY_OBSCURED);
+	grig_app_update_background ();
+
+	return FALSE;
+}
+
+
+/** \brief Switch between foreground and background mode.
+ *
+ * Grig is in the background when the main window is iconified, on another
+ * workspace or fully covered by other windows. In the background the meters
+ * stop rendering and the daemon polls the rig at a lower rate. Losing the
+ * focus alone does not count, since the window can still be seen.
+ */
+static void
+grig_app_update_background ()
+{
+	gboolean bg;
+
+	bg = app_iconified || app_unmapped || app_obscured;
+
+	if (bg != app_background) {
+		app_background = bg;
+
+		rig_daemon_set_background (bg);
+		rig_gui_smeter_set_background (bg);
+	}
+}
+
+
 /** \brief Handle terminate signals.
  *  \param sig The signal that has been received.
  *
@@ -533,9 +993,46 @@ grig_app_destroy    (GtkWidget *widget,
     /* remove key press event handler */
     key_press_handler_close ();
     
+	/* disconnect network clients */
+	rig_server_stop ();
+	rig_ipc_server_stop ();
+
+	/* no more corrections */
+	rig_doppler_stop ();
+
+	/* keep the channels downloaded so far */
+	rig_mem_transfer_stop ();
+
 	/* stop daemons */
 	rig_daemon_stop ();
 
+	/* save the software memory if it has been changed */
+	rig_mem_save ();
+
+	/* remove shared memory segment */
+	rig_shm_stop ();
+
+	/* stop serving metrics */
+	grig_metrics_stop ();
+
+	/* log main loop latency summary */
+	grig_gui_latency_close ();
+	grig_latency_close ();
+
+	/* save trace records */
+	if (tracejson != NULL) {
+		grig_trace_set_mask (0);
+		grig_trace_export_json (tracejson);
+	}
+	else if (grig_trace_get_mask ()) {
+		gchar *fname;
+
+		grig_trace_set_mask (0);
+		fname = get_conf_dir ("trace.txt");
+		grig_trace_dump (fname);
+		g_free (fname);
+	}
+
 	/* GUI timers are stopped automatically */
 
 	/* stop timeouts */
@@ -572,6 +1069,98 @@ grig_show_help      ()
 		   "set hamlib debug level (0..5)\n"));
 	g_print (_("  -D, --delay=val             "\
 		   "set delay between commands in msec\n"));
+	g_print (_("  -B, --bg-delay=val          "\
+		   "set minimum delay between commands in msec\n"\
+		   "                              "\
+		   "while grig is minimized or hidden and no\n"\
+		   "                              "\
+		   "rigctld, grig or shared memory client\n"\
+		   "                              "\
+		   "uses the rig\n"));
+	g_print (_("  -L, --log-file=FILE         "\
+		   "save debug messages to FILE\n"));
+	g_print (_("  -S, --log-size=KB           "\
+		   "start a new log file after KB kilobytes\n"));
+	g_print (_("  -N, --log-count=NUM         "\
+		   "number of old log files to keep\n"));
+	g_print (_("  -z, --log-gzip              "\
+		   "compress old log files\n"));
+	g_print (_("  -T, --trace=LIST            "\
+		   "enable tracepoints for the comma separated\n"\
+		   "                              "\
+		   "subsystems in LIST (daemon, data, lcd,\n"\
+		   "                              "\
+		   "smeter, anomaly, buttons, ctrl2 or all)\n"));
+	g_print (_("  -J, --trace-json=FILE       "\
+		   "save trace in Chrome trace format to FILE\n"\
+		   "                              "\
+		   "when grig exits\n"));
+	g_print (_("  -M, --metrics=PORT|PATH     "\
+		   "serve daemon metrics in Prometheus format\n"\
+		   "                              "\
+		   "on localhost:PORT or UNIX socket PATH\n"));
+	g_print (_("  -R, --record=FILE           "\
+		   "record the rig traffic to FILE\n"));
+	g_print (_("  -Y, --replay=FILE           "\
+		   "replay the rig traffic recorded in FILE\n"\
+		   "                              "\
+		   "instead of using a radio\n"));
+	g_print (_("  -x, --replay-speed=FACTOR   "\
+		   "replay speed; 1 is real time (default)\n"\
+		   "                              "\
+		   "and 0 is as fast as possible\n"));
+	g_print (_("  -t, --rigctld=PORT          "\
+		   "serve the rigctld protocol on localhost:PORT\n"\
+		   "                              "\
+		   "(rigctld uses port 4532)\n"));
+	g_print (_("  -H, --shm=NAME              "\
+		   "publish the rig state in shared memory NAME\n"\
+		   "                              "\
+		   "(e.g. /grig, see grig-shm.h)\n"));
+	g_print (_("  -a, --attach=PORT|PATH      "\
+		   "use the radio of a running grigd at\n"\
+		   "                              "\
+		   "localhost:PORT or UNIX socket PATH\n"));
+	g_print (_("  -u, --listen=PORT|PATH      "\
+		   "let other grig instances attach at\n"\
+		   "                              "\
+		   "localhost:PORT or UNIX socket PATH\n"));
+	g_print (_("  -A, --add-rig=MODEL,PORT[,SPEED[,DELAY[,CONF]]]\n"\
+		   "                              "\
+		   "control an additional radio; can be\n"\
+		   "                              "\
+		   "repeated and Ctrl+1..4 selects the radio\n"));
+	g_print (_("  -k, --link=SPEC             "\
+		   "let the first additional radio follow\n"\
+		   "                              "\
+		   "the first one; SPEC is offset=HZ or\n"\
+		   "                              "\
+		   "inverse=HZ and/or mode\n"));
+	g_print (_("  -g, --doppler=FILE          "\
+		   "correct the frequencies of a satellite\n"\
+		   "                              "\
+		   "pass using the range rates in FILE\n"));
+	g_print (_("  -G, --doppler-plan=DOWN[,UP[,RATE]]\n"\
+		   "                              "\
+		   "downlink and uplink frequency in Hz and\n"\
+		   "                              "\
+		   "corrections per second (1-10, default 2)\n"));
+	g_print (_("  -K, --scan=SPEC             "\
+		   "scan the channels in SPEC, a comma separated\n"\
+		   "                              "\
+		   "list of range=START:STOP:STEP, list=FILE,\n"\
+		   "                              "\
+		   "settle=MSEC, level=DB, dcd, dwell=MSEC,\n"\
+		   "                              "\
+		   "repeat and out=FILE\n"));
+	g_print (_("  -E, --memory=FILE           "\
+		   "keep the software memory in FILE\n"\
+		   "                              "\
+		   "instead of ~/.grig/grig.mem\n"));
+	g_print (_("  -W, --spectrum              "\
+		   "show the scope data sent by the rig\n"\
+		   "                              "\
+		   "in the band scope\n"));
 	g_print (_("  -n, --nothread              "\
 		   "start daemon without using threads\n"));
 	g_print (_("  -l, --list                  "\
@@ -46,6 +46,8 @@
  */
 #include <gtk/gtk.h>
 #include <hamlib/rig.h>
+#include "grig-metrics.h"
+#include "grig-trace.h"
 #include "rig-data.h"
 #include "rig-daemon.h"
 #include "rig-anomaly.h"
@@ -185,6 +187,10 @@ void
 rig_anomaly_raise (rig_cmd_t cmd)
 {
 
+	GRIG_TRACE (GRIG_TRACE_LEVEL_ERROR, GRIG_TRACE_ANOMALY,
+		    GRIG_TRACE_EV_ANOMALY_RAISE, cmd, 0, 0);
+	grig_metrics_anomaly (cmd);
+
 	/* check whether it is the first occurence */
 	if ((ANOMALY_COUNT[cmd] == 0) || (FIRST_ANOMALY[cmd] == 0)) {
 
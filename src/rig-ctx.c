@@ -0,0 +1,199 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+    Grig:  Gtk+ user interface for the Hamradio Control Libraries.
+
+    Copyright (C)  2001-2007  Alexandru Csete.
+
+    Authors: Alexandru Csete <oz9aec@gmail.com>
+
+    Comments, questions and bugreports should be submitted via
+    http://sourceforge.net/projects/groundstation/
+    More details can be found at the project home page:
+
+            http://groundstation.sourceforge.net/
+ 
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+  
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+  
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, visit http://www.fsf.org/
+ 
+ 
+ 
+*/
+/** \file rig-ctx.c
+ *  \ingroup shdata
+ *  \brief Rig contexts.
+ *
+ * The contexts live in a static table and are never freed, so pointers
+ * to them stay valid while daemon threads are running. The rig a thread
+ * is bound to is stored in thread private data; unbound threads use the
+ * selected rig.
+ */
+#include <glib.h>
+#include <string.h>
+#include <hamlib/rig.h>
+#include "rig-data.h"
+#include "rig-ctx.h"
+
+
+static rig_ctx_t rigs[RIG_CTX_MAX];   /*!< The rig contexts. */
+static gint      count    = 1;        /*!< Number of rigs in use; the primary rig always exists. */
+static gint      selected = 0;        /*!< Rig selected in the GUI. */
+
+#if GLIB_CHECK_VERSION(2,32,0)
+static GPrivate  bound = G_PRIVATE_INIT (NULL);
+#  define CTX_GET_BOUND()   ((rig_ctx_t *) g_private_get (&bound))
+#  define CTX_SET_BOUND(c)  g_private_set (&bound, (c))
+#else
+static GPrivate *bound = NULL;        /*!< Created by the first rig_ctx_bind(). */
+#  define CTX_GET_BOUND()   ((bound != NULL) ? (rig_ctx_t *) g_private_get (bound) : NULL)
+#  define CTX_SET_BOUND(c)  g_private_set (bound, (c))
+#endif
+
+
+
+/** \brief Add a rig.
+ *  \return The new context or NULL if RIG_CTX_MAX rigs are in use.
+ *
+ * Should be called from the main thread before the daemon of the new
+ * rig is started.
+ */
+rig_ctx_t *
+rig_ctx_new          ()
+{
+	rig_ctx_t *ctx;
+
+
+	if (count >= RIG_CTX_MAX)
+		return NULL;
+
+	ctx = &rigs[count];
+	memset (ctx, 0, sizeof (rig_ctx_t));
+	ctx->index = count;
+
+	count++;
+
+	return ctx;
+}
+
+
+/** \brief Remove the most recently added rig.
+ *  \param ctx The context returned by rig_ctx_new().
+ *
+ * Used when the rig could not be started. Other contexts and the primary
+ * rig are not removed.
+ */
+void
+rig_ctx_remove       (rig_ctx_t *ctx)
+{
+	if ((ctx == NULL) || (ctx->index == 0) || (ctx->index != count - 1))
+		return;
+
+	if (rig_ctx_get_selected () == ctx->index)
+		rig_ctx_select (0);
+
+	memset (ctx, 0, sizeof (rig_ctx_t));
+
+	count--;
+}
+
+
+/** \brief Get a rig context.
+ *  \param index The number of the rig.
+ *  \return The context or NULL if there is no such rig.
+ */
+rig_ctx_t *
+rig_ctx_get          (gint index)
+{
+	if ((index < 0) || (index >= count))
+		return NULL;
+
+	return &rigs[index];
+}
+
+
+/** \brief Get the number of rigs in use. */
+gint
+rig_ctx_count        ()
+{
+	return count;
+}
+
+
+/** \brief Get the rig of the calling thread.
+ *  \return The rig the thread is bound to, or the selected rig.
+ */
+rig_ctx_t *
+rig_ctx_current      ()
+{
+	rig_ctx_t *ctx;
+
+
+	ctx = CTX_GET_BOUND ();
+
+	if (ctx == NULL)
+		ctx = &rigs[g_atomic_int_get (&selected)];
+
+	return ctx;
+}
+
+
+/** \brief Bind the calling thread to a rig.
+ *  \param ctx The rig or NULL to use the selected rig.
+ *  \return The previous binding, to be restored by the caller.
+ *
+ * Daemon threads bind themselves to their rig for their lifetime. Code
+ * running in the main loop on behalf of a specific rig binds itself
+ * temporarily:
+ *
+ *   prev = rig_ctx_bind (rig_ctx_get (0));
+ *   ...
+ *   rig_ctx_bind (prev);
+ */
+rig_ctx_t *
+rig_ctx_bind         (rig_ctx_t *ctx)
+{
+	rig_ctx_t *prev;
+
+
+#if !GLIB_CHECK_VERSION(2,32,0)
+	/* the first binding is made by the main thread before any
+	   daemon thread is started */
+	if (bound == NULL)
+		bound = g_private_new (NULL);
+#endif
+
+	prev = CTX_GET_BOUND ();
+	CTX_SET_BOUND (ctx);
+
+	return prev;
+}
+
+
+/** \brief Select the rig shown in the GUI.
+ *  \param index The number of the rig.
+ *
+ * The caller is responsible for rebuilding the user interface.
+ */
+void
+rig_ctx_select       (gint index)
+{
+	if ((index >= 0) && (index < count))
+		g_atomic_int_set (&selected, index);
+}
+
+
+/** \brief Get the number of the rig shown in the GUI. */
+gint
+rig_ctx_get_selected ()
+{
+	return g_atomic_int_get (&selected);
+}
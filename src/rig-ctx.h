@@ -0,0 +1,88 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+    Grig:  Gtk+ user interface for the Hamradio Control Libraries.
+
+    Copyright (C)  2001-2007  Alexandru Csete.
+
+    Authors: Alexandru Csete <oz9aec@gmail.com>
+
+    Comments, questions and bugreports should be submitted via
+    http://sourceforge.net/projects/groundstation/
+    More details can be found at the project home page:
+
+            http://groundstation.sourceforge.net/
+ 
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+  
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+  
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, visit http://www.fsf.org/
+ 
+ 
+ 
+*/
+/** \file rig-ctx.h
+ *  \ingroup shdata
+ *  \brief Rig contexts (interface).
+ *
+ * A rig context holds everything grig needs to control one radio: the
+ * hamlib rig, the shared data and the state of its daemon. grig can
+ * control up to RIG_CTX_MAX radios at the same time, e.g. for SO2R or a
+ * transverter with its IF rig, each polled by its own daemon thread.
+ *
+ * Context 0 is the primary rig; it always exists so that the shared data
+ * can be used before the daemon is started. Recording, replay, grigd and
+ * the network services only work with the primary rig.
+ *
+ * The rig_data and rig_daemon functions work with the current rig of the
+ * calling thread. Daemon threads are bound to their rig with
+ * rig_ctx_bind(); all other code, including the GUI, works with the rig
+ * selected by the user unless it binds itself temporarily.
+ */
+#ifndef RIG_CTX_H
+#define RIG_CTX_H 1
+
+#include <glib.h>
+#include <hamlib/rig.h>
+#include "rig-data.h"
+
+
+/** \brief Max number of rigs controlled at the same time. */
+#define RIG_CTX_MAX 4
+
+
+/** \brief Rig context. */
+typedef struct {
+	gint         index;        /*!< Number of the rig; 0 is the primary rig. */
+	RIG         *rig;          /*!< The hamlib rig or NULL if not running. */
+	rig_data_t   data;         /*!< Shared data of the rig. */
+
+	/* used by the rig daemon only */
+	gboolean     daemonclear;  /*!< Set when the daemon thread has finished. */
+	guint        timeoutid;    /*!< Cycle timeout when no thread is used, or 0. */
+	gboolean     timeout_busy; /*!< Flag used to avoid two callbacks at the same time. */
+	GTimer      *metertimer;   /*!< Time since the meter has last been sampled. */
+	guint        cyclecount;   /*!< Number of completed cycles. */
+	gint         cmddelay;     /*!< Delay between two RX commands [msec]; TX = 3*RX. */
+} rig_ctx_t;
+
+
+rig_ctx_t *rig_ctx_new          (void);
+void       rig_ctx_remove       (rig_ctx_t *ctx);
+rig_ctx_t *rig_ctx_get          (gint index);
+gint       rig_ctx_count        (void);
+
+rig_ctx_t *rig_ctx_current      (void);
+rig_ctx_t *rig_ctx_bind         (rig_ctx_t *ctx);
+
+void       rig_ctx_select       (gint index);
+gint       rig_ctx_get_selected (void);
+
+#endif
@@ -52,16 +52,25 @@
 #include <stdlib.h>
 #include "grig-config.h"
 #include "grig-debug.h"
+#include "grig-latency.h"
+#include "grig-metrics.h"
+#include "grig-trace.h"
 #include "rig-anomaly.h"
+#include "rig-ctx.h"
 #include "rig-data.h"
-#include "rig-gui-smeter.h"
+#include "rig-doppler.h"
+#include "rig-ipc.h"
+#include "rig-link.h"
+#include "rig-mem.h"
+#include "rig-meter.h"
 #include "rig-daemon-check.h"
 #include "rig-daemon.h"
+#include "rig-record.h"
+#include "rig-scan.h"
+#include "rig-shm.h"
+#include "rig-spectrum.h"
 
 
-
-RIG *myrig;  /*!< The rig structure. We keep this public so GUI can access the info fields. */
-
 //#define GRIG_DEBUG 1
 
 #ifdef GRIG_DEBUG
@@ -415,23 +424,138 @@ static const gchar *ERR_TO_STR[] = {
 };
 
 
-static gboolean stopdaemon   = FALSE;   /*!< Used to signal the daemon thread that it should stop */
-static gboolean daemonclear  = FALSE;   /*!< Used to signal back when daemon is finished */
-static gint     cmd_delay    = 0;       /*!< Delay between two RX commands TX = 3*RX */
-static gint     timeoutid    = -1;      /*!< The ID of the timeout callback when we don't use threads. */
-static gboolean timeout_busy = FALSE;   /*!< Flag used to avoid to callbacks at the same time. */
+/** \brief Command names used in traces; must follow rig_cmd_t. */
+static const gchar *CMD_TO_STR[RIG_CMD_NUMBER] = {
+	"NONE",
+	"GET_FREQ_1",
+	"SET_FREQ_1",
+	"GET_FREQ_2",
+	"SET_FREQ_2",
+	"GET_RIT",
+	"SET_RIT",
+	"GET_XIT",
+	"SET_XIT",
+	"GET_VFO",
+	"SET_VFO",
+	"GET_PSTAT",
+	"SET_PSTAT",
+	"GET_PTT",
+	"SET_PTT",
+	"GET_MODE",
+	"SET_MODE",
+	"GET_AGC",
+	"SET_AGC",
+	"GET_ATT",
+	"SET_ATT",
+	"GET_PREAMP",
+	"SET_PREAMP",
+	"SET_SPLIT",
+	"GET_SPLIT",
+	"SET_AF",
+	"GET_AF",
+	"SET_RF",
+	"GET_RF",
+	"SET_SQL",
+	"GET_SQL",
+	"SET_IFS",
+	"GET_IFS",
+	"SET_APF",
+	"GET_APF",
+	"SET_NR",
+	"GET_NR",
+	"SET_NOTCH",
+	"GET_NOTCH",
+	"SET_PBT_IN",
+	"GET_PBT_IN",
+	"SET_PBT_OUT",
+	"GET_PBT_OUT",
+	"SET_CW_PITCH",
+	"GET_CW_PITCH",
+	"SET_KEYSPD",
+	"GET_KEYSPD",
+	"SET_BKINDEL",
+	"GET_BKINDEL",
+	"SET_BALANCE",
+	"GET_BALANCE",
+	"SET_VOXDEL",
+	"GET_VOXDEL",
+	"SET_VOXGAIN",
+	"GET_VOXGAIN",
+	"SET_ANTIVOX",
+	"GET_ANTIVOX",
+	"SET_MICGAIN",
+	"GET_MICGAIN",
+	"SET_COMP",
+	"GET_COMP",
+	"GET_STRENGTH",
+	"SET_POWER",
+	"GET_POWER",
+	"GET_SWR",
+	"SET_ALC",
+	"GET_ALC",
+	"GET_LOCK",
+	"SET_LOCK",
+	"VFO_TOGGLE",
+	"VFO_COPY",
+	"VFO_XCHG",
+	"SET_FUNC",
+	"GET_FUNC"
+};
+
+
+static gboolean stopdaemon   = FALSE;   /*!< Used to signal the daemon threads that they should stop */
 static gboolean suspended    = FALSE;   /*!< Flag indicating whether the daemon is susended or not. */
+static gint     bg_delay     = C_DEF_BG_CMD_DELAY; /*!< Minimum command delay while grig is in the background. */
+static gboolean background   = FALSE;   /*!< Flag indicating whether grig is in the background. */
+static gint     consumers    = 0;       /*!< Number of clients using the rig state outside the GUI. */
+static gchar   *recordfile   = NULL;    /*!< File to record the rig traffic to or NULL. */
+static gchar   *replayfile   = NULL;    /*!< Recording to replay instead of using a rig or NULL. */
+static gdouble  replayspeed  = 1.0;     /*!< Replay speed factor; 0 means as fast as possible. */
+static gboolean recording    = FALSE;   /*!< Flag indicating whether traffic is being recorded. */
+static gboolean replaying    = FALSE;   /*!< Flag indicating whether a recording is replayed. */
+static gchar   *attachaddr   = NULL;    /*!< Address of grigd to attach to or NULL. */
+static gboolean attached     = FALSE;   /*!< Flag indicating whether grigd runs the rig. */
 
 /* private function prototypes */
-static void     rig_daemon_post_init (gboolean, gboolean);
+static gint     rig_daemon_open      (rig_ctx_t *, int, const gchar *,
+				      int, const gchar *, const gchar *,
+				      gboolean, gboolean, gboolean);
+static void     rig_daemon_post_init (rig_ctx_t *, gboolean, gboolean);
 static gpointer rig_daemon_cycle     (gpointer);
 static gint     rig_daemon_cycle_cb  (gpointer);
+static void     rig_daemon_sample_meter (grig_settings_t *,
+					 grig_settings_t *,
+					 grig_cmd_avail_t *,
+					 grig_cmd_avail_t *,
+					 grig_cmd_avail_t *);
+static gboolean rig_daemon_scan      (rig_ctx_t *,
+				      grig_settings_t  *,
+				      grig_cmd_avail_t *);
+static void     rig_daemon_mem       (rig_ctx_t *,
+				      grig_settings_t  *);
+static rig_cmd_t rig_daemon_filter_cmd (rig_cmd_t);
+static gint     rig_daemon_get_cycle_delay (void);
+static gboolean rig_daemon_in_background   (void);
 static gint     rig_daemon_exec_cmd  (rig_cmd_t,
 				      grig_settings_t  *,
 				      grig_settings_t  *,
 				      grig_cmd_avail_t *,
 				      grig_cmd_avail_t *,
 				      grig_cmd_avail_t *);
+static gint     rig_daemon_exec_hamlib (rig_cmd_t,
+					grig_settings_t  *,
+					grig_settings_t  *,
+					grig_cmd_avail_t *,
+					grig_cmd_avail_t *,
+					grig_cmd_avail_t *,
+					gint             *);
+static gint     rig_daemon_exec_replay (rig_cmd_t,
+					grig_settings_t  *,
+					gint             *);
+static gint     rig_daemon_replay_start (void);
+static gpointer rig_daemon_replay    (gpointer);
+static gint     rig_daemon_attach_start (void);
+static void     rig_daemon_add_sample (rig_meter_t, gfloat);
 
 
 
@@ -466,17 +590,6 @@ rig_daemon_start       (int          rigid,
 			gboolean     ptt,
 			gboolean     pstat)
 {
-
-	gchar  *rigport;
-	gint    retcode;
-	gchar **confvec;   
-	gchar **confent;
-	GError *err = NULL;  /* used when starting daemon thread */
-#if GLIB_CHECK_VERSION(2,32,0)
-  GThread* thread = NULL;
-#endif
-
-
 	grig_debug_local (RIG_DEBUG_TRACE,
 			  _("%s entered"),
 			  __FUNCTION__);
@@ -485,18 +598,119 @@ rig_daemon_start       (int          rigid,
 	   we set it already here
 	*/
 	if (cmddel > 0) {
-		cmd_delay = cmddel;
+		rig_ctx_get (0)->cmddelay = cmddel;
 	}
 	else {
-		cmd_delay = C_DEF_RX_CMD_DELAY;
+		rig_ctx_get (0)->cmddelay = C_DEF_RX_CMD_DELAY;
 	}
 
+	/* reset meter sample buffers */
+	rig_meter_init ();
+
 
 	/* check if rig is already initialized */
-	if (myrig != NULL) {
+	if (rig_ctx_get (0)->rig != NULL) {
+		return 1;
+	}
+
+	/* replay a recording instead of talking to a rig */
+	if (replayfile != NULL) {
+		return rig_daemon_replay_start ();
+	}
+
+	/* let a running grigd talk to the rig */
+	if (attachaddr != NULL) {
+		return rig_daemon_attach_start ();
+	}
+
+	return rig_daemon_open (rig_ctx_get (0), rigid, port, speed, civaddr,
+				rigconf, nothread, ptt, pstat);
+}
+
+
+/** \brief Start the daemon of an additional radio.
+ *  \param rignum   The Hamlib ID of the radio (0 to use default).
+ *  \param port     The port device (NULL to use default).
+ *  \param speed    The serial speed (0 to use default).
+ *  \param civaddr  CIV address for ICOM rigs (NULL means no need to set conf).
+ *  \param rigconf  Additional config options necessary for some rigs.
+ *  \param cmddel   Delay between two RX commands of this radio.
+ *  \param nothread Whether to use threads (FALSE) or just a timeout callback.
+ *  \return 0 if the daemon has been initialized correctly.
+ *
+ * The radio gets its own context with its own shared data and daemon
+ * thread, see rig-ctx.h. The primary radio must have been started with
+ * rig_daemon_start() before; additional radios can not be used while a
+ * recording is replayed or grig is attached to grigd.
+ */
+int
+rig_daemon_add         (int          rigid,
+			const gchar *port,
+			int          speed,
+			const gchar *civaddr,
+			const gchar *rigconf,
+			gint         cmddel,
+			gboolean     nothread,
+			gboolean     ptt,
+			gboolean     pstat)
+{
+	rig_ctx_t *ctx;
+
+
+	if (replaying || attached || (rig_ctx_get (0)->rig == NULL)) {
+		grig_debug_local (RIG_DEBUG_ERR,
+				  _("%s: Additional rigs need a local primary rig"),
+				  __FUNCTION__);
+		return 1;
+	}
+
+	ctx = rig_ctx_new ();
+
+	if (ctx == NULL) {
+		grig_debug_local (RIG_DEBUG_ERR,
+				  _("%s: Can not control more than %d rigs"),
+				  __FUNCTION__, RIG_CTX_MAX);
+		return 1;
+	}
+
+	ctx->cmddelay = (cmddel > 0) ? cmddel : C_DEF_RX_CMD_DELAY;
+
+	if (rig_daemon_open (ctx, rigid, port, speed, civaddr, rigconf,
+			     nothread, ptt, pstat)) {
+		rig_ctx_remove (ctx);
 		return 1;
 	}
 
+	return 0;
+}
+
+
+/** \brief Open a radio and start its daemon.
+ *  \param ctx The context of the radio.
+ *
+ * See rig_daemon_start() for the other parameters.
+ */
+static gint
+rig_daemon_open        (rig_ctx_t   *ctx,
+			int          rigid,
+			const gchar *port,
+			int          speed,
+			const gchar *civaddr,
+			const gchar *rigconf,
+			gboolean     nothread,
+			gboolean     ptt,
+			gboolean     pstat)
+{
+	gchar  *rigport;
+	gint    retcode;
+	gchar **confvec;   
+	gchar **confent;
+	GError *err = NULL;  /* used when starting daemon thread */
+#if GLIB_CHECK_VERSION(2,32,0)
+  GThread* thread = NULL;
+#endif
+
+
 	/* use dummy backend if no ID pecified */
 	if (!rigid) {
 		rigid = 1;
@@ -520,13 +734,13 @@ rig_daemon_start       (int          rigid,
 
 
 	grig_debug_local (RIG_DEBUG_TRACE,
-			  _("%s: Initializing rig (id=%d)"),
-			  __FUNCTION__, rigid);
+			  _("%s: Initializing rig %d (id=%d)"),
+			  __FUNCTION__, ctx->index, rigid);
 
 	/* initilize rig */
-	myrig = rig_init (rigid);
+	ctx->rig = rig_init (rigid);
 
-	if (myrig == NULL) {
+	if (ctx->rig == NULL) {
 
 		grig_debug_local (RIG_DEBUG_ERR,
 				  _("%s: Init failed; Hamlib returned NULL!"),
@@ -537,16 +751,16 @@ rig_daemon_start       (int          rigid,
 	}
 
 	/* configure and open rig device */
-	strncpy (myrig->state.rigport.pathname, rigport, HAMLIB_FILPATHLEN);
+	strncpy (ctx->rig->state.rigport.pathname, rigport, HAMLIB_FILPATHLEN);
 	g_free (rigport);
 
 	/* set speed if any special whishes */
 	if (speed) {
-		myrig->state.rigport.parm.serial.rate = speed;
+		ctx->rig->state.rigport.parm.serial.rate = speed;
 	}
 
 	if (civaddr) {
-		retcode = rig_set_conf (myrig, rig_token_lookup (myrig, "civaddr"), civaddr);
+		retcode = rig_set_conf (ctx->rig, rig_token_lookup (ctx->rig, "civaddr"), civaddr);
 	}
 
 	/* split conf parameter string; */
@@ -566,8 +780,8 @@ rig_daemon_start       (int          rigid,
 					  _("%s: Setting conf param (%s,%s)..."),
 					  __FUNCTION__, confent[0], confent[1]);
 
-			retcode = rig_set_conf (myrig,
-						rig_token_lookup (myrig, confent[0]),
+			retcode = rig_set_conf (ctx->rig,
+						rig_token_lookup (ctx->rig, confent[0]),
 						confent[1]);
 
 			if (retcode == RIG_OK) {
@@ -590,19 +804,25 @@ rig_daemon_start       (int          rigid,
 	}
 
 
+	/* scope data needs asynchronous mode, which is set before opening */
+	if (ctx->index == 0) {
+		rig_spectrum_prepare (ctx->rig);
+	}
+
 #ifndef DISABLE_HW
 	/* open rig */
-	retcode = rig_open (myrig);
+	retcode = rig_open (ctx->rig);
 	if (retcode != RIG_OK) {
 
 		/* send error report */
 		grig_debug_local (RIG_DEBUG_ERR,
 				  _("%s: Failed to open rig port %s: %s (permissions?)"),
 				  __FUNCTION__,
-				  myrig->state.rigport.pathname,
+				  ctx->rig->state.rigport.pathname,
 				  rigerror(retcode));
 
-		rig_cleanup (myrig);
+		rig_cleanup (ctx->rig);
+		ctx->rig = NULL;
 		return 1;
 	}
 #endif
@@ -612,7 +832,22 @@ rig_daemon_start       (int          rigid,
 			  __FUNCTION__);
 
 	/* get capabilities and settings  */
-	rig_daemon_post_init (ptt, pstat);
+	rig_daemon_post_init (ctx, ptt, pstat);
+
+	/* only the primary rig is recorded */
+	if ((recordfile != NULL) && (ctx->index == 0)) {
+		recording = rig_record_start (recordfile, rigid,
+					      &ctx->data.get,
+					      &ctx->data.has_get,
+					      &ctx->data.has_set);
+	}
+
+#ifndef DISABLE_HW
+	/* the scope lines arrive in a thread of hamlib */
+	if (ctx->index == 0) {
+		rig_spectrum_start (ctx->rig);
+	}
+#endif
 
 	grig_debug_local (RIG_DEBUG_TRACE,
 			  _("%s: Starting rig daemon"),
@@ -626,23 +861,23 @@ rig_daemon_start       (int          rigid,
 	if (nothread == TRUE) {
 
 		/* we start a regular g_timeout;
-		   we use C_MAX_CYCLES * C_MAX_CMD_PER_CYCLE * cmd_delay
+		   we use C_MAX_CYCLES * C_MAX_CMD_PER_CYCLE * cmddelay
 		   for delay.
 		*/
-		timeoutid = g_timeout_add (2 * C_MAX_CYCLES * C_MAX_CMD_PER_CYCLE * cmd_delay,
-					   rig_daemon_cycle_cb,
-					   NULL);
+		ctx->timeoutid = grig_latency_timeout_add (2 * C_MAX_CYCLES * C_MAX_CMD_PER_CYCLE * ctx->cmddelay,
+							   rig_daemon_cycle_cb,
+							   ctx, "daemon-cycle");
 
 		grig_debug_local (RIG_DEBUG_VERBOSE,
 				  _("%s: Daemon timeout started, ID: %d"),
-				  __FUNCTION__, timeoutid);
+				  __FUNCTION__, ctx->timeoutid);
 
 	}
 	else {
 #if !GLIB_CHECK_VERSION(2,32,0)
-		g_thread_create (rig_daemon_cycle, NULL, FALSE, &err);
+		g_thread_create (rig_daemon_cycle, ctx, FALSE, &err);
 #else
-    thread = g_thread_try_new ("daemon thread", rig_daemon_cycle, NULL, &err);
+    thread = g_thread_try_new ("daemon thread", rig_daemon_cycle, ctx, &err);
     if (thread != NULL) {
       g_thread_unref(thread);
     }
@@ -661,8 +896,9 @@ rig_daemon_start       (int          rigid,
 					  _("%s: Error %d: %s"),
 					    __FUNCTION__, err->code, err->message);
 
-			rig_close (myrig);
-			rig_cleanup (myrig);
+			rig_close (ctx->rig);
+			rig_cleanup (ctx->rig);
+			ctx->rig = NULL;
 
 			return err->code;
 		}
@@ -689,61 +925,116 @@ rig_daemon_start       (int          rigid,
 void
 rig_daemon_stop  ()
 {
-	guint i = 0;
-
+	rig_ctx_t *ctx;
+	guint i;
+	gint  index;
+
+
+	/* there is no local daemon; grigd keeps running */
+	if (attached) {
+		ctx = rig_ctx_get (0);
+		attached = FALSE;
+		rig_ipc_disconnect ();
+		rig_cleanup (ctx->rig);
+		ctx->rig = NULL;
+		rig_meter_free ();
+		return;
+	}
 
 	/* send a debug message */
 	grig_debug_local (RIG_DEBUG_TRACE,
 			  _("%s: Sending stop signal to rig daemon"),
 			  __FUNCTION__);
 
+	/* the stop signal is seen by the threads of all rigs */
+	stopdaemon = TRUE;
 
-	/* if we are running in time-out mode
-	   we can remove the callback directly here;
-	   otherwise, send stop signal to daemon and
-	   wait until 'daemonclear' flag is TRUE or
-	   we time out (in case of time out we also send
-	   and error message
+	/* stop the additional rigs first; the primary rig owns the
+	   recording and the replay
 	*/
-	if (timeoutid != -1) {
-		g_source_remove (timeoutid);
-	}
-	else {
-		stopdaemon = TRUE;
+	for (index = rig_ctx_count () - 1; index >= 0; index--) {
 
-		/* wait until flag is clear or we time out */
-		while ((daemonclear == FALSE) &&
-		       (i*C_RIG_DAEMON_STOP_SLEEP_TIME < C_RIG_DAEMON_STOP_TIMEOUT)) {
+		ctx = rig_ctx_get (index);
 
-			i++;
-			g_usleep (C_RIG_DAEMON_STOP_SLEEP_TIME * 1000);
+		if (ctx->rig == NULL) {
+			continue;
 		}
 
-		/* print an error message if the flag has not been cleared */
-		if (daemonclear == FALSE) {
-			g_print ("\n\nCRITICAL: Daemon process has not been shut down properly. "\
-				 "You may have a zombie hanging around :-(\n\n");
+		/* if we are running in time-out mode
+		   we can remove the callback directly here;
+		   otherwise wait until 'daemonclear' flag is TRUE or
+		   we time out (in case of time out we also send
+		   and error message
+		*/
+		if (ctx->timeoutid != 0) {
+			g_source_remove (ctx->timeoutid);
+			ctx->timeoutid = 0;
 		}
-	}
+		else {
+			/* wait until flag is clear or we time out */
+			i = 0;
+			while ((ctx->daemonclear == FALSE) &&
+			       (i*C_RIG_DAEMON_STOP_SLEEP_TIME < C_RIG_DAEMON_STOP_TIMEOUT)) {
 
-	/* send a debug message */
-	grig_debug_local (RIG_DEBUG_TRACE,
-			  _("%s: Cleaning up rig"),
-			  __FUNCTION__);
+				i++;
+				g_usleep (C_RIG_DAEMON_STOP_SLEEP_TIME * 1000);
+			}
+
+			/* print an error message if the flag has not been cleared */
+			if (ctx->daemonclear == FALSE) {
+				g_print ("\n\nCRITICAL: Daemon process has not been shut down properly. "\
+					 "You may have a zombie hanging around :-(\n\n");
+			}
+		}
+
+		/* send a debug message */
+		grig_debug_local (RIG_DEBUG_TRACE,
+				  _("%s: Cleaning up rig %d"),
+				  __FUNCTION__, index);
+
+		/* finish recording; the daemon does not execute commands anymore */
+		if (recording && (index == 0)) {
+			recording = FALSE;
+			rig_record_stop ();
+		}
 
 #ifndef DISABLE_HW
-	/* close radio device */
-	rig_close (myrig);
+		/* close radio device; it has not been opened for replay */
+		if (!replaying) {
+			if (index == 0) {
+				rig_spectrum_stop (ctx->rig);
+			}
+			rig_close (ctx->rig);
+		}
 #endif
 
-	/* clean up hamlib */
-	rig_cleanup (myrig);
+		/* clean up hamlib */
+		rig_cleanup (ctx->rig);
+
+		ctx->rig = NULL;
+
+		if (ctx->metertimer != NULL) {
+			g_timer_destroy (ctx->metertimer);
+			ctx->metertimer = NULL;
+		}
+
+		if (index > 0) {
+			rig_ctx_remove (ctx);
+		}
+	}
+
+	if (replaying) {
+		replaying = FALSE;
+		rig_replay_unload ();
+	}
 
-	myrig = NULL;
+	/* free meter resources */
+	rig_meter_free ();
 }
 
 
 /** \brief Execute post initialization tasks.
+ *  \param ctx The context of the radio.
  *  \param ptt Flag indicating whether to enable PTT.
  *  \param pstat Flag indicting whether to enable POWER.
  *
@@ -754,14 +1045,18 @@ rig_daemon_stop  ()
  *
  */
 static void
-rig_daemon_post_init (gboolean ptt, gboolean pstat)
+rig_daemon_post_init (rig_ctx_t *ctx, gboolean ptt, gboolean pstat)
 {
+	RIG              *myrig = ctx->rig;
+	rig_ctx_t        *prev;
 	grig_settings_t  *get;        /* pointer to shared data 'get' */
 	grig_settings_t  *set;        /* pointer to shared data 'set' */
 	grig_cmd_avail_t *has_get;    /* pointer to shared data 'has_get' */
 	grig_cmd_avail_t *has_set;    /* pointer to shared data 'has_set' */
 
 
+	prev = rig_ctx_bind (ctx);
+
 	/* get pointers to shared data */
 	get     = rig_data_get_get_addr ();
 	set     = rig_data_get_set_addr ();
@@ -845,12 +1140,13 @@ rig_daemon_post_init (gboolean ptt, gboolean pstat)
 */
 		);
 
+	rig_ctx_bind (prev);
 }
 
 
 
 /** \brief Radio control daemon main cycle (threaded version).
- *  \param data Unused.
+ *  \param data The context of the radio.
  *  \return Always NULL.
  *
  * This function implements the main cycle of the radio control daemon. The executed
@@ -865,8 +1161,13 @@ rig_daemon_cycle     (gpointer data)
 	grig_cmd_avail_t *has_get;         /* pointer to shared data 'has_get' */
 	grig_cmd_avail_t *has_set;         /* pointer to shared data 'has_set' */
 
+	rig_ctx_t *ctx = (rig_ctx_t *) data;
 	guint step;    /* step counter */
+	gint64 start;  /* start time of cycle */
+
 
+	/* the thread only works on its own rig */
+	rig_ctx_bind (ctx);
 
 	/* get pointers to shared data */
 	get     = rig_data_get_get_addr ();
@@ -890,9 +1191,19 @@ rig_daemon_cycle     (gpointer data)
 		*/
 		if (get->pstat == RIG_POWER_ON) {
 
+			/* a scan replaces the cycle, except during dwells and between sweep slices */
+			if (rig_daemon_scan (ctx, get, new)) {
+				continue;
+			}
+
+			/* memory channel transfers take a slice of each cycle */
+			rig_daemon_mem (ctx, get);
+
 			/* execute one cylce; note that the switch between the
 			   RX and TX tables can happen within a cycle :-)
 			*/
+			start = grig_metrics_time ();
+
 			for (step = 0; step < C_MAX_CMD_PER_CYCLE; step++) {
 				
 				/* only execute commands if the daemon is not
@@ -904,39 +1215,50 @@ rig_daemon_cycle     (gpointer data)
 					if (get->ptt == RIG_PTT_OFF) {
 
 						/* Execute a receiver command */
-						rig_daemon_exec_cmd (DEF_RX_CYCLE[step],
+						rig_daemon_exec_cmd (rig_daemon_filter_cmd (DEF_RX_CYCLE[step]),
 								     get,
 								     set,
 								     new,
 								     has_get,
 								     has_set);
+						rig_daemon_sample_meter (get, set, new,
+									 has_get, has_set);
 /* slow motion in debug mode */
 #ifdef GRIG_DEBUG
-						g_usleep (5000 * cmd_delay);
+						g_usleep (5000 * rig_daemon_get_cycle_delay ());
 #else
-						g_usleep (1000 * cmd_delay);
+						g_usleep (1000 * rig_daemon_get_cycle_delay ());
 #endif
 					}
 					else {
 
 						/* Execute transmitter command */
-						rig_daemon_exec_cmd (DEF_TX_CYCLE[step],
+						rig_daemon_exec_cmd (rig_daemon_filter_cmd (DEF_TX_CYCLE[step]),
 								     get,
 								     set,
 								     new,
 								     has_get,
 								     has_set);
+						rig_daemon_sample_meter (get, set, new,
+									 has_get, has_set);
 /* slow motion in debug mode */
 #ifdef GRIG_DEBUG
-						g_usleep (15000 * cmd_delay);
+						g_usleep (15000 * rig_daemon_get_cycle_delay ());
 #else
-						g_usleep (3000 * cmd_delay);
+						g_usleep (3000 * rig_daemon_get_cycle_delay ());
 #endif
 					}
 				}
 
 			}
 
+			ctx->cyclecount++;
+			GRIG_TRACE (GRIG_TRACE_LEVEL_CYCLE, GRIG_TRACE_DAEMON,
+				    GRIG_TRACE_EV_CYCLE, ctx->cyclecount, 0, 0);
+			grig_metrics_cycle (start);
+
+			if (recording && (ctx->index == 0))
+				rig_record_cycle ();
 		}
 
 		/* otherwise check the power status, but only if daemon
@@ -953,185 +1275,962 @@ rig_daemon_cycle     (gpointer data)
    is no guarantee that the rig will react to a wake-up command.
 */
 
-/* #ifdef GRIG_DEBUG */
-/* 				g_usleep (15000 * cmd_delay); */
-/* #else */
-/* 				g_usleep (3000 * cmd_delay); */
-/* #endif */
-/* 				rig_daemon_exec_cmd (RIG_CMD_GET_PSTAT, */
-/* 						     get, set, new, */
-/* 						     has_get, has_set); */
-			}
+/* #ifdef GRIG_DEBUG */
+/* 				g_usleep (15000 * cmd_delay); */
+/* #else */
+/* 				g_usleep (3000 * cmd_delay); */
+/* #endif */
+/* 				rig_daemon_exec_cmd (RIG_CMD_GET_PSTAT, */
+/* 						     get, set, new, */
+/* 						     has_get, has_set); */
+			}
+
+/* slow motion in debug mode */
+#ifdef GRIG_DEBUG
+			g_usleep (15000 * rig_daemon_get_cycle_delay ());
+#else
+			g_usleep (3000 * rig_daemon_get_cycle_delay ());
+#endif
+
+		}
+
+	}
+
+	/* send a debug message */
+	grig_debug_local (RIG_DEBUG_TRACE, _("%s stopped"), __FUNCTION__);
+
+	/* set clear flag to indicate that daemon terminated */
+	ctx->daemonclear = TRUE;
+
+	return NULL;
+}
+
+
+/** \brief Start replaying a recording.
+ *  \return 0 if the replay has been started.
+ *
+ * This function is used by rig_daemon_start() instead of opening a rig
+ * when a recording has been selected with rig_daemon_set_replay(). The
+ * recorded rig model is initialised to provide the capabilities but the
+ * port is not opened. The shared data are initialised from the recording
+ * and a thread feeding the recorded commands to rig_daemon_exec_cmd() is
+ * started.
+ */
+static gint
+rig_daemon_replay_start ()
+{
+	rig_ctx_t *ctx = rig_ctx_get (0);
+	gint    rigid;
+	GError *err = NULL;
+#if GLIB_CHECK_VERSION(2,32,0)
+	GThread *thread = NULL;
+#endif
+
+
+	if (!rig_replay_load (replayfile, &rigid,
+			      rig_data_get_get_addr (),
+			      rig_data_get_has_get_addr (),
+			      rig_data_get_has_set_addr ())) {
+		return 1;
+	}
+
+	/* start with the recorded settings */
+	memcpy (rig_data_get_set_addr (), rig_data_get_get_addr (),
+		sizeof (grig_settings_t));
+
+	ctx->rig = rig_init (rigid);
+
+	if (ctx->rig == NULL) {
+
+		grig_debug_local (RIG_DEBUG_ERR,
+				  _("%s: Init failed; Hamlib returned NULL!"),
+				  __FUNCTION__);
+
+		rig_replay_unload ();
+		return 1;
+	}
+
+	replaying = TRUE;
+
+#if !GLIB_CHECK_VERSION(2,32,0)
+	g_thread_create (rig_daemon_replay, ctx, FALSE, &err);
+#else
+	thread = g_thread_try_new ("replay thread", rig_daemon_replay, ctx, &err);
+	if (thread != NULL) {
+		g_thread_unref (thread);
+	}
+#endif
+
+	if (err != NULL) {
+
+		grig_debug_local (RIG_DEBUG_ERR,
+				  _("%s: Error %d: %s"),
+				  __FUNCTION__, err->code, err->message);
+
+		rig_cleanup (ctx->rig);
+		ctx->rig = NULL;
+		replaying = FALSE;
+		rig_replay_unload ();
+
+		return err->code;
+	}
+
+	grig_debug_local (RIG_DEBUG_VERBOSE,
+			  _("%s: Replaying %s (rig model %d) at speed %.2f"),
+			  __FUNCTION__, replayfile, rigid, replayspeed);
+
+	return 0;
+}
+
+
+/** \brief Attach to a running grigd.
+ *  \return 0 if successful, 1 otherwise.
+ *
+ * The rig is initialised for its capabilities only; the port is opened by
+ * grigd. The shared data are kept up to date by the IPC client and settings
+ * changed by the user interface are executed by grigd.
+ */
+static gint
+rig_daemon_attach_start ()
+{
+	rig_ctx_t *ctx = rig_ctx_get (0);
+	gint rigid;
+
+
+	if (!rig_ipc_connect (attachaddr, &rigid)) {
+		return 1;
+	}
+
+	ctx->rig = rig_init (rigid);
+
+	if (ctx->rig == NULL) {
+
+		grig_debug_local (RIG_DEBUG_ERR,
+				  _("%s: Init failed; Hamlib returned NULL!"),
+				  __FUNCTION__);
+
+		rig_ipc_disconnect ();
+		return 1;
+	}
+
+	attached = TRUE;
+
+	grig_debug_local (RIG_DEBUG_VERBOSE,
+			  _("%s: Attached to grigd at %s (rig model %d)"),
+			  __FUNCTION__, attachaddr, rigid);
+
+	return 0;
+}
+
+
+/** \brief Replay thread.
+ *  \param data The context of the primary radio.
+ *  \return Always NULL.
+ *
+ * This function executes the recorded commands at their recorded time
+ * scaled by the replay speed, or back to back if the speed is 0. The
+ * suspend flag is ignored so that benchmarks are not disturbed. When the
+ * end of the recording is reached, the number of commands and the elapsed
+ * time are reported and the thread waits for the stop signal.
+ */
+static gpointer
+rig_daemon_replay    (gpointer data)
+{
+	grig_settings_t  *get;             /* pointer to shared data 'get' */
+	grig_settings_t  *set;             /* pointer to shared data 'set' */
+	grig_cmd_avail_t *new;             /* pointer to shared data 'new' */
+	grig_cmd_avail_t *has_get;         /* pointer to shared data 'has_get' */
+	grig_cmd_avail_t *has_set;         /* pointer to shared data 'has_set' */
+
+	rig_ctx_t *ctx = (rig_ctx_t *) data;
+	rig_cmd_t cmd;
+	gint64    when;         /* recorded time of the command */
+	gint64    begin;        /* start time of the replay */
+	gint64    due;          /* time when the next command is due */
+	gint64    now;
+	gint64    start;        /* start time of cycle */
+	guint     count = 0;    /* number of replayed commands */
+	gdouble   elapsed;
+
+
+	rig_ctx_bind (ctx);
+
+	get     = rig_data_get_get_addr ();
+	set     = rig_data_get_set_addr ();
+	new     = rig_data_get_new_addr ();
+	has_get = rig_data_get_has_get_addr ();
+	has_set = rig_data_get_has_set_addr ();
+
+	grig_debug_local (RIG_DEBUG_TRACE, _("%s started."), __FUNCTION__);
+
+	begin = rig_record_time ();
+	start = grig_metrics_time ();
+
+	while (!stopdaemon && rig_replay_next (&cmd, &when)) {
+
+		/* wait until the command is due */
+		if (replayspeed > 0.0) {
+			due = begin + (gint64) (when / replayspeed);
+
+			while (!stopdaemon && ((now = rig_record_time ()) < due)) {
+				g_usleep (MIN (due - now, 1000 * C_RIG_DAEMON_STOP_SLEEP_TIME));
+			}
+		}
+
+		if (cmd == RIG_CMD_NONE) {
+			ctx->cyclecount++;
+			GRIG_TRACE (GRIG_TRACE_LEVEL_CYCLE, GRIG_TRACE_DAEMON,
+				    GRIG_TRACE_EV_CYCLE, ctx->cyclecount, 0, 0);
+			grig_metrics_cycle (start);
+			start = grig_metrics_time ();
+		}
+		else {
+			rig_daemon_exec_cmd (cmd, get, set, new, has_get, has_set);
+			count++;
+		}
+	}
+
+	elapsed = (rig_record_time () - begin) / (gdouble) G_USEC_PER_SEC;
+
+	grig_debug_local (RIG_DEBUG_VERBOSE,
+			  _("%s: Replay finished: %d commands in %.3f s (%.0f commands/s)"),
+			  __FUNCTION__, count, elapsed,
+			  (elapsed > 0.0) ? count / elapsed : 0.0);
+
+	while (!stopdaemon) {
+		g_usleep (C_RIG_DAEMON_STOP_SLEEP_TIME * 1000);
+	}
+
+	grig_debug_local (RIG_DEBUG_TRACE, _("%s stopped"), __FUNCTION__);
+
+	ctx->daemonclear = TRUE;
+
+	return NULL;
+}
+
+
+/** \brief Radio control daemon main cycle (callback version).
+ *  \param data The context of the radio.
+ *  \return Always TRUE.
+ *
+ * This function implements the main cycle of the radio control daemon. The executed
+ * commands are defined in the DEF_RX_CYCLE and DEF_TX_CYCLE constant arrays.
+ */
+static gint
+rig_daemon_cycle_cb  (gpointer data)
+{
+
+	grig_settings_t  *get;             /* pointer to shared data 'get' */
+	grig_settings_t  *set;             /* pointer to shared data 'set' */
+	grig_cmd_avail_t *new;             /* pointer to shared data 'new' */
+	grig_cmd_avail_t *has_get;         /* pointer to shared data 'has_get' */
+	grig_cmd_avail_t *has_set;         /* pointer to shared data 'has_set' */
+
+	rig_ctx_t *ctx = (rig_ctx_t *) data;
+	rig_ctx_t *prev;
+	guint step;        /* step counter */
+	gint64 start;      /* start time of cycle */
+
+	/* check whether the previous callback has terminated.
+	   if not, skip this cycle.
+	*/
+	if (ctx->timeout_busy == TRUE) {
+		return TRUE;
+	}
+
+	ctx->timeout_busy = TRUE;
+
+	/* the callback runs in the main loop, which may be bound to
+	   another rig
+	*/
+	prev = rig_ctx_bind (ctx);
+
+	/* get pointers to shared data */
+	get     = rig_data_get_get_addr ();
+	set     = rig_data_get_set_addr ();
+	new     = rig_data_get_new_addr ();
+	has_get = rig_data_get_has_get_addr ();
+	has_set = rig_data_get_has_set_addr ();
+
+
+	/* send a debug message */
+	grig_debug_local (RIG_DEBUG_TRACE, _("%s called."), __FUNCTION__);
+
+	/* a scan replaces the cycle, except during dwells and between sweep slices */
+	if (rig_daemon_scan (ctx, get, new)) {
+		rig_ctx_bind (prev);
+		ctx->timeout_busy = FALSE;
+
+		return TRUE;
+	}
+
+	/* memory channel transfers take a slice of each cycle */
+	rig_daemon_mem (ctx, get);
+
+	/* first we check whether rig is powered ON since some rigs
+	   will not talk to us in power-off state.
+	   NOTE: code should be safe even if rig does not support
+	   get_powerstat since get->pstat is set to ON if rig
+	   does not have functionality.
+	*/
+	if (get->pstat == RIG_POWER_ON) {
+
+		start = grig_metrics_time ();
+
+		for (step = 0; step < C_MAX_CMD_PER_CYCLE; step++) {
+
+			/* check whether we are in RX or TX mode; */
+			if (get->ptt == RIG_PTT_OFF) {
+
+				/* Execute receiver command;
+				   sleep for cmd_delay ms if command has been executed
+				*/
+				if (rig_daemon_exec_cmd (rig_daemon_filter_cmd (DEF_RX_CYCLE[step]),
+							 get,
+							 set,
+							 new,
+							 has_get,
+							 has_set)) {
+/* slow motion in debug mode */
+#ifdef GRIG_DEBUG
+					g_usleep (5000 * rig_daemon_get_cycle_delay ());
+#else
+					g_usleep (1000 * rig_daemon_get_cycle_delay ());
+#endif
+				}
+
+				rig_daemon_sample_meter (get, set, new,
+							 has_get, has_set);
+
+			}
+			else {
+				
+				/* Execute transmitter command;
+				   sleep for cmd_delay ms if command has been executed
+				*/
+				if (rig_daemon_exec_cmd (rig_daemon_filter_cmd (DEF_TX_CYCLE[step]),
+							 get,
+							 set,
+							 new,
+							 has_get,
+							 has_set)) {
+/* slow motion in debug mode */
+#ifdef GRIG_DEBUG
+					g_usleep (10000 * rig_daemon_get_cycle_delay ());
+#else
+					g_usleep (2000 * rig_daemon_get_cycle_delay ());
+#endif
+				}
+
+				rig_daemon_sample_meter (get, set, new,
+							 has_get, has_set);
+			}
+		}
+
+		ctx->cyclecount++;
+		GRIG_TRACE (GRIG_TRACE_LEVEL_CYCLE, GRIG_TRACE_DAEMON,
+			    GRIG_TRACE_EV_CYCLE, ctx->cyclecount, 0, 0);
+		grig_metrics_cycle (start);
+
+		if (recording && (ctx->index == 0))
+			rig_record_cycle ();
+	}
+
+	/* otherwise check the power status only */
+	else {
+		if (rig_daemon_exec_cmd (RIG_CMD_SET_PSTAT, get, set, new, has_get, has_set)) {
+
+/* slow motion in debug mode */
+#ifdef GRIG_DEBUG
+			g_usleep (15000 * rig_daemon_get_cycle_delay ());
+#else
+			g_usleep (3000 * rig_daemon_get_cycle_delay ());
+#endif
+		}
+
+		rig_daemon_exec_cmd (RIG_CMD_GET_PSTAT, get, set, new, has_get, has_set);
+	}
+
+
+	rig_ctx_bind (prev);
+
+	ctx->timeout_busy = FALSE;
+
+
+	return TRUE;
+}
+
+
+
+
+/** \brief Sample the active meter at a high rate.
+ *  \param get Pointer to the 'get' command buffer.
+ *  \param set Pointer to the 'set' command buffer.
+ *  \param new Pointer to the 'new' command buffer.
+ *  \param has_get Pointer to get capabilities record.
+ *  \param has_set Pointer to set capabilities record.
+ *
+ * The meters are listed only a few times in the RX and TX cycles, which
+ * means that short peaks are easily lost. This function is called after
+ * each command in the cycle and reads the currently displayed meter if
+ * more than C_DEF_METER_INTERVAL msec (three times as much in TX mode)
+ * have elapsed since the previous reading. The acquired samples are
+ * stored in the meter buffers by rig_daemon_exec_cmd().
+ *
+ * Only the selected rig is displayed, so the other rigs do not sample
+ * their meters at all.
+ */
+static void
+rig_daemon_sample_meter (grig_settings_t  *get,
+			 grig_settings_t  *set,
+			 grig_cmd_avail_t *new,
+			 grig_cmd_avail_t *has_get,
+			 grig_cmd_avail_t *has_set)
+{
+	rig_ctx_t *ctx = rig_ctx_current ();
+	rig_cmd_t  cmd;
+	gulong     interval;
+	gint       executed;
+
+
+	/* nobody is looking at the meter */
+	if (rig_daemon_in_background () || (ctx->index != rig_ctx_get_selected ())) {
+		return;
+	}
+
+	if (ctx->metertimer == NULL) {
+		ctx->metertimer = g_timer_new ();
+	}
+
+	if (get->ptt == RIG_PTT_OFF) {
+		cmd = RIG_CMD_GET_STRENGTH;
+		interval = C_DEF_METER_INTERVAL;
+	}
+	else {
+		switch (rig_data_get_tx_meter ()) {
+
+		case SMETER_TX_MODE_POWER:
+			cmd = RIG_CMD_GET_POWER;
+			break;
+
+		case SMETER_TX_MODE_SWR:
+			cmd = RIG_CMD_GET_SWR;
+			break;
+
+		case SMETER_TX_MODE_ALC:
+			cmd = RIG_CMD_GET_ALC;
+			break;
+
+		default:
+			return;
+		}
+
+		interval = 3 * C_DEF_METER_INTERVAL;
+	}
+
+	if (1000.0 * g_timer_elapsed (ctx->metertimer, NULL) < interval) {
+		return;
+	}
+
+	executed = rig_daemon_exec_cmd (cmd, get, set, new, has_get, has_set);
+
+	g_timer_start (ctx->metertimer);
+
+	/* give the rig some rest after an extra command */
+	if (executed) {
+		g_usleep (1000 * rig_daemon_get_cycle_delay ());
+	}
+}
+
+
+
+/** \brief Run the scan engine for a while.
+ *  \param ctx The context of the rig.
+ *  \param get Pointer to the 'get' command buffer.
+ *  \param new Pointer to the 'new' command buffer.
+ *  \return TRUE if channels have been scanned, FALSE if the normal cycle
+ *          should be executed.
+ *
+ * The channels are scanned in a tight loop of hamlib calls for up to
+ * C_SCAN_SLICE msec, which is much faster than going through the RX
+ * cycle. The frequency and signal strength are put into the 'get' buffer
+ * and the s-meter so that the user interface follows the scan. The scan
+ * is paused while transmitting or powered off and stopped when the user
+ * tunes the rig.
+ *
+ * Band-scope sweeps leave the 'get' buffer and the s-meter alone. The rig
+ * is tuned back to its frequency at the end of each slice and the normal
+ * cycle is executed between the slices, so frequency changes by the user
+ * are sent before the sweep goes on. See rig-scan.h.
+ */
+static gboolean
+rig_daemon_scan      (rig_ctx_t        *ctx,
+		      grig_settings_t  *get,
+		      grig_cmd_avail_t *new)
+{
+	GTimer   *timer;
+	freq_t    home;
+	freq_t    freq;
+	gulong    settle;
+	gboolean  usedcd;
+	gboolean  sweep;
+	value_t   val;
+	dcd_t     dcd;
+	gint      retcode;
+	gboolean  scanned = FALSE;
+
+
+	if (replaying || suspended || (get->pstat != RIG_POWER_ON) ||
+	    (get->ptt != RIG_PTT_OFF) || !rig_scan_running ())
+		return FALSE;
+
+	sweep = rig_scan_sweeping ();
+
+	/* the user has tuned the rig */
+	if (new->freq1) {
+		if (!sweep)
+			rig_scan_stop ();
+
+		return FALSE;
+	}
+
+	home = get->freq1;
+	timer = g_timer_new ();
+
+	while (!stopdaemon && (g_timer_elapsed (timer, NULL) < C_SCAN_SLICE / 1000.0) &&
+	       rig_scan_next (home, &freq, &settle, &usedcd)) {
+
+		scanned = TRUE;
+		val.i = 0;
+		dcd = RIG_DCD_OFF;
+
+		retcode = rig_set_freq (ctx->rig, RIG_VFO_CURR, freq);
+
+		if (retcode == RIG_OK) {
+			if (!sweep)
+				get->freq1 = freq;
+
+			g_usleep (1000 * settle);
+
+			if (usedcd) {
+				retcode = rig_get_dcd (ctx->rig, RIG_VFO_CURR, &dcd);
+			}
+			else {
+				retcode = rig_get_level (ctx->rig, RIG_VFO_CURR,
+							 RIG_LEVEL_STRENGTH, &val);
+				if ((retcode == RIG_OK) && !sweep) {
+					get->strength = val.i;
+					rig_daemon_add_sample (RIG_METER_STRENGTH, (gfloat) val.i);
+				}
+			}
+		}
+
+		if (retcode != RIG_OK) {
+			grig_debug_local (RIG_DEBUG_ERR,
+					  _("%s: Failed to scan %.0f Hz:\n%s"),
+					  __FUNCTION__, freq, ERR_TO_STR[abs(retcode)]);
+		}
+
+		rig_scan_result (retcode, val.i,
+				 usedcd ? (dcd == RIG_DCD_ON) : -1);
+	}
+
+	g_timer_destroy (timer);
+
+	/* a sweep must not take the rig away from the user */
+	if (scanned && sweep) {
+		retcode = rig_set_freq (ctx->rig, RIG_VFO_CURR, home);
+
+		if (retcode != RIG_OK) {
+			grig_debug_local (RIG_DEBUG_ERR,
+					  _("%s: Failed to tune back to %.0f Hz:\n%s"),
+					  __FUNCTION__, home, ERR_TO_STR[abs(retcode)]);
+		}
+	}
+	else if (scanned && (ctx->index == 0)) {
+		rig_shm_publish (get);
+	}
+
+	return scanned && !sweep;
+}
+
+
+/** \brief Transfer memory channels between the rig and the software memory.
+ *  \param ctx The rig context.
+ *  \param get The 'get' buffer of the rig.
+ *
+ * Channels are read with rig_get_channel(); channels to be uploaded are
+ * then filled with the stored settings and written with rig_set_channel().
+ * This is done back to back for up to C_MEM_SLICE msec, after which the normal cycle is
+ * executed so that the meters and the display keep being updated during a
+ * long transfer. Transfers are paused while transmitting or powered off.
+ * See rig-mem.h.
+ */
+static void
+rig_daemon_mem       (rig_ctx_t        *ctx,
+		      grig_settings_t  *get)
+{
+	GTimer    *timer = NULL;
+	channel_t  chan;
+	gboolean   upload;
+	gint       retcode;
+
+
+	if (replaying || suspended || (get->pstat != RIG_POWER_ON) ||
+	    (get->ptt != RIG_PTT_OFF))
+		return;
+
+	while (!stopdaemon && rig_mem_transfer_next (&chan, &upload)) {
+
+		/* no timer while idle; this is checked in every cycle */
+		if (timer == NULL)
+			timer = g_timer_new ();
+
+		/* an upload keeps whatever the stored channel does not cover */
+		retcode = rig_get_channel (ctx->rig, RIG_VFO_MEM, &chan, TRUE);
+
+		if (upload) {
+			rig_mem_transfer_fill (&chan, (retcode == RIG_OK));
+			retcode = rig_set_channel (ctx->rig, RIG_VFO_MEM, &chan);
+		}
+
+		if (retcode != RIG_OK) {
+			grig_debug_local (RIG_DEBUG_ERR,
+					  upload ? _("%s: Failed to write memory channel %d:\n%s") :
+					  _("%s: Failed to read memory channel %d:\n%s"),
+					  __FUNCTION__, chan.channel_num, ERR_TO_STR[abs(retcode)]);
+		}
+
+		rig_mem_transfer_result (retcode, &chan);
+
+		if (g_timer_elapsed (timer, NULL) >= C_MEM_SLICE / 1000.0)
+			break;
+	}
+
+	if (timer != NULL)
+		g_timer_destroy (timer);
+}
+
+
+/** \brief Skip commands reading fields that nobody looks at.
+ *  \param cmd The command from the RX or TX cycle.
+ *  \return The command or RIG_CMD_NONE if it should be skipped.
+ *
+ * Most of the levels and the func's are only displayed in the RX, TX and
+ * Func windows. When these windows are closed, there is no need to read
+ * these values at full rate; they are only read in every C_KEEPALIVE_CYCLES
+ * cycle so that the values are not too old when a window is opened.
+ * Set commands are never skipped.
+ *
+ * While the frequency of a linked rig is pending, the SET_FREQ command is
+ * executed instead of the next GET_FREQ_1 or empty slot; a pending Doppler
+ * correction takes the next GET_FREQ_1, GET_FREQ_2 or empty slot. Other
+ * commands, such as PTT and mode, are never displaced. See rig-link.h and
+ * rig-doppler.h.
+ *
+ * \note TX power and ALC are also used by the s-meter and are therefore
+ *       checked in rig_daemon_exec_cmd().
+ */
+static rig_cmd_t
+rig_daemon_filter_cmd (rig_cmd_t cmd)
+{
+	rig_data_field_t field;
+	rig_cmd_t        doppler;
+
+
+	/* a linked rig follows its source in the next slot that would
+	   only read the frequency or do nothing; other commands must
+	   not be starved by a fast moving source */
+	if (rig_link_pending () &&
+	    ((cmd == RIG_CMD_GET_FREQ_1) || (cmd == RIG_CMD_NONE))) {
+
+		return RIG_CMD_SET_FREQ_1;
+	}
+
+	/* so do Doppler corrections, which may also take the slots
+	   reading the uplink frequency */
+	if ((cmd == RIG_CMD_GET_FREQ_1) || (cmd == RIG_CMD_GET_FREQ_2) ||
+	    (cmd == RIG_CMD_NONE)) {
+
+		doppler = rig_doppler_pending ();
+		if (doppler != RIG_CMD_NONE) {
+			return doppler;
+		}
+	}
+
+	switch (cmd) {
+
+	case RIG_CMD_GET_AF:
+		field = RIG_DATA_FIELD_AFG;
+		break;
+
+	case RIG_CMD_GET_RF:
+		field = RIG_DATA_FIELD_RFG;
+		break;
+
+	case RIG_CMD_GET_SQL:
+		field = RIG_DATA_FIELD_SQL;
+		break;
+
+	case RIG_CMD_GET_IFS:
+		field = RIG_DATA_FIELD_IFS;
+		break;
+
+	case RIG_CMD_GET_APF:
+		field = RIG_DATA_FIELD_APF;
+		break;
+
+	case RIG_CMD_GET_NR:
+		field = RIG_DATA_FIELD_NR;
+		break;
+
+	case RIG_CMD_GET_NOTCH:
+		field = RIG_DATA_FIELD_NOTCH;
+		break;
+
+	case RIG_CMD_GET_PBT_IN:
+		field = RIG_DATA_FIELD_PBTIN;
+		break;
+
+	case RIG_CMD_GET_PBT_OUT:
+		field = RIG_DATA_FIELD_PBTOUT;
+		break;
+
+	case RIG_CMD_GET_CW_PITCH:
+		field = RIG_DATA_FIELD_CWPITCH;
+		break;
+
+	case RIG_CMD_GET_BALANCE:
+		field = RIG_DATA_FIELD_BALANCE;
+		break;
+
+	case RIG_CMD_GET_KEYSPD:
+		field = RIG_DATA_FIELD_KEYSPD;
+		break;
+
+	case RIG_CMD_GET_BKINDEL:
+		field = RIG_DATA_FIELD_BKINDEL;
+		break;
+
+	case RIG_CMD_GET_VOXDEL:
+		field = RIG_DATA_FIELD_VOXDEL;
+		break;
+
+	case RIG_CMD_GET_VOXGAIN:
+		field = RIG_DATA_FIELD_VOXG;
+		break;
+
+	case RIG_CMD_GET_ANTIVOX:
+		field = RIG_DATA_FIELD_ANTIVOX;
+		break;
+
+	case RIG_CMD_GET_MICGAIN:
+		field = RIG_DATA_FIELD_MICG;
+		break;
+
+	case RIG_CMD_GET_COMP:
+		field = RIG_DATA_FIELD_COMP;
+		break;
 
-/* slow motion in debug mode */
-#ifdef GRIG_DEBUG
-			g_usleep (15000 * cmd_delay);
-#else
-			g_usleep (3000 * cmd_delay);
-#endif
+	case RIG_CMD_GET_FUNC:
+		field = RIG_DATA_FIELD_FUNC;
+		break;
 
-		}
+	default:
+		return cmd;
+		break;
+	}
 
+	if (rig_data_has_interest (field) ||
+	    ((rig_ctx_current ()->cyclecount % C_KEEPALIVE_CYCLES) == 0)) {
+		return cmd;
 	}
 
-	/* send a debug message */
-	grig_debug_local (RIG_DEBUG_TRACE, _("%s stopped"), __FUNCTION__);
+	return RIG_CMD_NONE;
+}
 
-	/* set clear flag to indicate that daemon terminated */
-	daemonclear = TRUE;
 
-	return NULL;
+
+/** \brief Add a meter sample of the current rig.
+ *  \param meter The meter.
+ *  \param value The new reading.
+ *
+ * There is only one set of meter buffers, which shows the selected rig.
+ * Readings of the other rigs are dropped.
+ */
+static void
+rig_daemon_add_sample (rig_meter_t meter, gfloat value)
+{
+	if (rig_ctx_current ()->index == rig_ctx_get_selected ()) {
+		rig_meter_add_sample (meter, value);
+	}
 }
 
 
-/** \brief Radio control daemon main cycle (callback version).
- *  \param data Unused.
- *  \return Always TRUE.
+
+/** \brief Execute a specific command.
+ *  \param cmd The command to be executed.
+ *  \param get Pointer to the 'get' command buffer.
+ *  \param set Pointer to the 'set' command buffer.
+ *  \param new Pointer to the 'new' command buffer.
+ *  \param has_get Pointer to get capabilities record.
+ *  \param has_set Pointer to set capabilities record.
+ *  \return 1 if the command has been executed, 0 otherwise.
  *
- * This function implements the main cycle of the radio control daemon. The executed
- * commands are defined in the DEF_RX_CYCLE and DEF_TX_CYCLE constant arrays.
+ * This function is responsible for the execution of the specified rig command.
+ * First, it checks whether the command is supported by the current radio, if yes,
+ * it executes the corresponding hamlib API call. If the command execution is not
+ * successfull, an anomaly report is sent to the rig error manager which will take
+ * care of any further actions like disabling repeatedly failing commands.
+ *
+ * When traffic is being recorded, the command and the changes it made to the
+ * 'get' buffer are passed to the recorder. While a recording is replayed, the
+ * recorded results are used instead of calling hamlib.
+ *
+ * \note The 'get' commands use local buffers for the acquired value and do not
+ *       write directly to the shared memory. This way the contents of the shared memory
+ *       do not get corrupted if the command execution was erroneous.
  */
 static gint
-rig_daemon_cycle_cb  (gpointer data)
+rig_daemon_exec_cmd         (rig_cmd_t cmd,
+			     grig_settings_t  *get,
+			     grig_settings_t  *set,
+			     grig_cmd_avail_t *new,
+			     grig_cmd_avail_t *has_get,
+			     grig_cmd_avail_t *has_set)
+
 {
+	grig_settings_t before;
+	gint   retcode = RIG_OK;
+	gint   status = 0;
+	gint64 start = 0;
+	gint64 recstart = 0;
+	gboolean primary;
 
-	grig_settings_t  *get;             /* pointer to shared data 'get' */
-	grig_settings_t  *set;             /* pointer to shared data 'set' */
-	grig_cmd_avail_t *new;             /* pointer to shared data 'new' */
-	grig_cmd_avail_t *has_get;         /* pointer to shared data 'has_get' */
-	grig_cmd_avail_t *has_set;         /* pointer to shared data 'has_set' */
 
-	guint step;        /* step counter */
+	if (cmd == RIG_CMD_NONE)
+		return 0;
 
-	/* check whether the previous callback has terminated.
-	   if not, skip this cycle.
-	*/
-	if (timeout_busy == TRUE) {
-		return TRUE;
-	}
+	/* recording and shared memory only cover the primary rig */
+	primary = (rig_ctx_current ()->index == 0);
 
-	timeout_busy = TRUE;
+	GRIG_TRACE (GRIG_TRACE_LEVEL_CMD, GRIG_TRACE_DAEMON,
+		    GRIG_TRACE_EV_CMD_BEGIN, cmd, 0, 0);
+	start = grig_metrics_time ();
 
-	/* get pointers to shared data */
-	get     = rig_data_get_get_addr ();
-	set     = rig_data_get_set_addr ();
-	new     = rig_data_get_new_addr ();
-	has_get = rig_data_get_has_get_addr ();
-	has_set = rig_data_get_has_set_addr ();
+	if (replaying) {
+		status = rig_daemon_exec_replay (cmd, get, &retcode);
+	}
+	else if (recording && primary) {
+		memcpy (&before, get, sizeof (grig_settings_t));
+		recstart = rig_record_time ();
 
+		status = rig_daemon_exec_hamlib (cmd, get, set, new,
+						 has_get, has_set, &retcode);
 
-	/* send a debug message */
-	grig_debug_local (RIG_DEBUG_TRACE, _("%s called."), __FUNCTION__);
+		if (status)
+			rig_record_cmd (cmd, status, retcode, recstart, &before, get);
+	}
+	else {
+		status = rig_daemon_exec_hamlib (cmd, get, set, new,
+						 has_get, has_set, &retcode);
+	}
 
+	GRIG_TRACE (GRIG_TRACE_LEVEL_CMD, GRIG_TRACE_DAEMON,
+		    GRIG_TRACE_EV_CMD_END, cmd, status, retcode);
 
-	/* first we check whether rig is powered ON since some rigs
-	   will not talk to us in power-off state.
-	   NOTE: code should be safe even if rig does not support
-	   get_powerstat since get->pstat is set to ON if rig
-	   does not have functionality.
-	*/
-	if (get->pstat == RIG_POWER_ON) {
+	/* only commands which have actually been sent to the rig */
+	if (status) {
+		grig_metrics_cmd (cmd, retcode != RIG_OK, start);
+		if (primary)
+			rig_shm_publish (get);
+	}
 
-		for (step = 0; step < C_MAX_CMD_PER_CYCLE; step++) {
+	rig_link_cmd (cmd, status, retcode, get);
+	rig_doppler_cmd (cmd, status, retcode);
 
-			/* check whether we are in RX or TX mode; */
-			if (get->ptt == RIG_PTT_OFF) {
+	return status;
+}
 
-				/* Execute receiver command;
-				   sleep for cmd_delay ms if command has been executed
-				*/
-				if (rig_daemon_exec_cmd (DEF_RX_CYCLE[step],
-							 get,
-							 set,
-							 new,
-							 has_get,
-							 has_set)) {
-/* slow motion in debug mode */
-#ifdef GRIG_DEBUG
-					g_usleep (5000 * cmd_delay);
-#else
-					g_usleep (1000 * cmd_delay);
-#endif
-				}
 
-			}
-			else {
-				
-				/* Execute transmitter command;
-				   sleep for cmd_delay ms if command has been executed
-				*/
-				if (rig_daemon_exec_cmd (DEF_TX_CYCLE[step],
-							 get,
-							 set,
-							 new,
-							 has_get,
-							 has_set)) {
-/* slow motion in debug mode */
-#ifdef GRIG_DEBUG
-					g_usleep (10000 * cmd_delay);
-#else
-					g_usleep (2000 * cmd_delay);
-#endif
-				}
-			}
-		}
+/** \brief Execute a recorded command.
+ *  \param cmd The command to be executed.
+ *  \param get Pointer to the 'get' command buffer.
+ *  \param retcode Location to store the recorded hamlib return code.
+ *  \return The recorded status.
+ *
+ * This function is used instead of rig_daemon_exec_hamlib() while replaying
+ * a recording. It applies the recorded changes to the 'get' buffer and
+ * feeds the meter and the anomaly manager the same way the hamlib calls do.
+ */
+static gint
+rig_daemon_exec_replay      (rig_cmd_t cmd,
+			     grig_settings_t  *get,
+			     gint             *retcode)
+{
+	gint status;
 
-	}
 
-	/* otherwise check the power status only */
-	else {
-		if (rig_daemon_exec_cmd (RIG_CMD_SET_PSTAT, get, set, new, has_get, has_set)) {
+	status = rig_replay_exec (get, retcode, replayspeed);
 
-/* slow motion in debug mode */
-#ifdef GRIG_DEBUG
-			g_usleep (15000 * cmd_delay);
-#else
-			g_usleep (3000 * cmd_delay);
-#endif
-		}
+	if (!status)
+		return 0;
 
-		rig_daemon_exec_cmd (RIG_CMD_GET_PSTAT, get, set, new, has_get, has_set);
+	if (*retcode != RIG_OK) {
+		rig_anomaly_raise (cmd);
+		return status;
 	}
 
+	switch (cmd) {
+
+	case RIG_CMD_GET_STRENGTH:
+		rig_daemon_add_sample (RIG_METER_STRENGTH, (gfloat) get->strength);
+		break;
 
-	timeout_busy = FALSE;
+	case RIG_CMD_GET_POWER:
+		rig_daemon_add_sample (RIG_METER_POWER, get->power);
+		break;
 
+	case RIG_CMD_GET_SWR:
+		rig_daemon_add_sample (RIG_METER_SWR, get->swr);
+		break;
 
-	return TRUE;
-}
+	case RIG_CMD_GET_ALC:
+		rig_daemon_add_sample (RIG_METER_ALC, get->alc);
+		break;
 
+	default:
+		break;
+	}
 
+	return status;
+}
 
 
-/** \brief Execute a specific command.
+/** \brief Execute a specific command using hamlib.
  *  \param cmd The command to be executed.
  *  \param get Pointer to the 'get' command buffer.
  *  \param set Pointer to the 'set' command buffer.
  *  \param new Pointer to the 'new' command buffer.
  *  \param has_get Pointer to get capabilities record.
  *  \param has_set Pointer to set capabilities record.
+ *  \param result Location to store the hamlib return code.
  *  \return 1 if the command has been executed, 0 otherwise.
  *
- * This function is responsible for the execution of the specified rig command.
- * First, it checks whether the command is supported by the current radio, if yes,
- * it executes the corresponding hamlib API call. If the command execution is not
- * successfull, an anomaly report is sent to the rig error manager which will take
- * care of any further actions like disabling repeatedly failing commands.
- *
- * \note The 'get' commands use local buffers for the acquired value and do not
- *       write directly to the shared memory. This way the contents of the shared memory
- *       do not get corrupted if the command execution was erroneous.
+ * See rig_daemon_exec_cmd().
  */
 static gint
-rig_daemon_exec_cmd         (rig_cmd_t cmd,
+rig_daemon_exec_hamlib      (rig_cmd_t cmd,
 			     grig_settings_t  *get,
 			     grig_settings_t  *set,
 			     grig_cmd_avail_t *new,
 			     grig_cmd_avail_t *has_get,
-			     grig_cmd_avail_t *has_set)
+			     grig_cmd_avail_t *has_set,
+			     gint             *result)
 
 {
-	int  retcode;
+	RIG *myrig = rig_ctx_current ()->rig;
+	int  retcode = RIG_OK;
 	gint status = 0;
 	setting_t func;
 	int i;
@@ -1990,6 +3089,7 @@ rig_daemon_exec_cmd         (rig_cmd_t cmd,
 			}
 			else {
 				get->strength = val.i;
+				rig_daemon_add_sample (RIG_METER_STRENGTH, (gfloat) val.i);
 			}
 
 			status = 1;
@@ -2031,7 +3131,9 @@ rig_daemon_exec_cmd         (rig_cmd_t cmd,
 	case RIG_CMD_GET_POWER:
 
 		/* check whether command is available */
-		if (has_get->power && (rig_gui_smeter_get_tx_mode() == SMETER_TX_MODE_POWER)) {
+		if (has_get->power &&
+		    ((rig_data_get_tx_meter () == SMETER_TX_MODE_POWER) ||
+		     rig_data_has_interest (RIG_DATA_FIELD_POWER))) {
 			value_t val;
 
 			/* try to execute command */
@@ -2047,6 +3149,7 @@ rig_daemon_exec_cmd         (rig_cmd_t cmd,
 			}
 			else {
 				get->power = val.f;
+				rig_daemon_add_sample (RIG_METER_POWER, val.f);
 			}
 
 			status = 1;
@@ -2058,7 +3161,7 @@ rig_daemon_exec_cmd         (rig_cmd_t cmd,
 	case RIG_CMD_GET_SWR:
 
 		/* check whether command is available */
-		if (has_get->swr && (rig_gui_smeter_get_tx_mode() == SMETER_TX_MODE_SWR)) {
+		if (has_get->swr && (rig_data_get_tx_meter () == SMETER_TX_MODE_SWR)) {
 			value_t val;
 
 			/* try to execute command */
@@ -2074,6 +3177,7 @@ rig_daemon_exec_cmd         (rig_cmd_t cmd,
 			}
 			else {
 				get->swr = val.f;
+				rig_daemon_add_sample (RIG_METER_SWR, val.f);
 			}
 
 			status = 1;
@@ -2085,7 +3189,9 @@ rig_daemon_exec_cmd         (rig_cmd_t cmd,
 	case RIG_CMD_GET_ALC:
 
 		/* check whether command is available */
-		if (has_get->alc && (rig_gui_smeter_get_tx_mode() == SMETER_TX_MODE_ALC)) {
+		if (has_get->alc &&
+		    ((rig_data_get_tx_meter () == SMETER_TX_MODE_ALC) ||
+		     rig_data_has_interest (RIG_DATA_FIELD_ALC))) {
 			value_t val;
 
 			/* try to execute command */
@@ -2101,6 +3207,7 @@ rig_daemon_exec_cmd         (rig_cmd_t cmd,
 			}
 			else {
 				get->alc = val.f;
+				rig_daemon_add_sample (RIG_METER_ALC, val.f);
 			}
 
 			status = 1;
@@ -3263,17 +4370,37 @@ rig_daemon_exec_cmd         (rig_cmd_t cmd,
 
 	}
 
+	*result = retcode;
+
 	return status;
 
 }
 
 
+/** \brief Get name of daemon command.
+ *  \param cmd The command.
+ *  \return The name of the command, e.g. "GET_FREQ_1".
+ */
+const gchar *
+rig_daemon_get_cmd_name (rig_cmd_t cmd)
+{
+	if ((guint) cmd >= RIG_CMD_NUMBER) {
+		return "UNKNOWN";
+	}
+
+	return CMD_TO_STR[cmd];
+}
+
+
 /** \brief Get hamlib id of radio.
  *  \return The id of the rig
  */
 gint
 rig_daemon_get_rig_id ()
 {
+	RIG *myrig = rig_ctx_current ()->rig;
+
+
 	if (myrig == NULL) {
 		return -1;
 	}
@@ -3291,6 +4418,7 @@ rig_daemon_get_rig_id ()
 gchar *
 rig_daemon_get_brand ()
 {
+	RIG   *myrig = rig_ctx_current ()->rig;
 	gchar *text;
 
 	if (myrig == NULL) {
@@ -3312,6 +4440,7 @@ rig_daemon_get_brand ()
 gchar *
 rig_daemon_get_model ()
 {
+	RIG   *myrig = rig_ctx_current ()->rig;
 	gchar *text;
 
 	if (myrig == NULL) {
@@ -3326,14 +4455,152 @@ rig_daemon_get_model ()
 /** \brief Get command delay.
  *  \return The current command delay in msec.
  *
- * This function returns the current command delay
+ * This function returns the command delay of the current rig
  * in milliseconds. This allows the GUI to have a rough idea
  * about what delay to use in the readback timeout functions.
  */
 gint
 rig_daemon_get_delay ()
 {
-	return cmd_delay;
+	return rig_ctx_current ()->cmddelay;
+}
+
+
+/** \brief Get the delay to use in the daemon cycle.
+ *  \return The delay between two RX commands in msec.
+ *
+ * This function returns the command delay of the current rig, or the
+ * background delay if grig is in the background and the background delay
+ * is larger.
+ */
+static gint
+rig_daemon_get_cycle_delay ()
+{
+	gint delay = rig_ctx_current ()->cmddelay;
+
+	if (rig_daemon_in_background () && (bg_delay > delay)) {
+		return bg_delay;
+	}
+
+	return delay;
+}
+
+
+/** \brief Check whether the daemon may poll at the background rate.
+ *  \return TRUE if grig is in the background and nobody else uses the rig state.
+ */
+static gboolean
+rig_daemon_in_background ()
+{
+	return background && (g_atomic_int_get (&consumers) == 0);
+}
+
+
+/** \brief Set background command delay.
+ *  \param delay The minimum delay between two RX commands in msec.
+ *
+ * This function sets the lower limit for the polling rate which is used
+ * while grig is in the background, i.e. the main window is iconified or
+ * can not be seen. A value of 0 or less means use the default.
+ */
+void
+rig_daemon_set_bg_delay (gint delay)
+{
+	if (delay > 0) {
+		bg_delay = delay;
+	}
+	else {
+		bg_delay = C_DEF_BG_CMD_DELAY;
+	}
+}
+
+
+/** \brief Record the rig traffic to a file.
+ *  \param filename The file to record to or NULL to disable recording.
+ *
+ * Every command executed by the daemon is recorded together with its timing,
+ * result and the settings it changed, see rig-record.h. This function must be
+ * called before rig_daemon_start().
+ */
+void
+rig_daemon_set_record (const gchar *filename)
+{
+	g_free (recordfile);
+	recordfile = g_strdup (filename);
+}
+
+
+/** \brief Replay a recording instead of using a rig.
+ *  \param filename The recording or NULL to use a rig.
+ *  \param speed Speed factor; 1.0 replays with the original timing and
+ *               0 replays as fast as possible.
+ *
+ * This function must be called before rig_daemon_start(), which will then
+ * ignore the port settings and replay the recording. Commands issued by the
+ * user interface are not executed during replay.
+ */
+void
+rig_daemon_set_replay (const gchar *filename, gdouble speed)
+{
+	g_free (replayfile);
+	replayfile = g_strdup (filename);
+	replayspeed = (speed > 0.0) ? speed : 0.0;
+}
+
+
+/** \brief Attach to a running grigd instead of using a rig.
+ *  \param addr Socket path or TCP port of grigd, or NULL to use a rig.
+ *
+ * This function must be called before rig_daemon_start(), which will then
+ * ignore the port settings and connect to grigd, see rig-ipc.h.
+ */
+void
+rig_daemon_set_attach (const gchar *addr)
+{
+	g_free (attachaddr);
+	attachaddr = g_strdup (addr);
+}
+
+
+/** \brief Enable or disable background mode.
+ *  \param bg Flag indicating whether grig is in the background.
+ *
+ * When grig is in the background, the daemon uses the background command
+ * delay and stops the high rate meter sampling, unless the rig state is
+ * used outside the GUI, see rig_daemon_add_consumer(). The normal
+ * behaviour is restored as soon as the background mode is disabled.
+ */
+void
+rig_daemon_set_background (gboolean bg)
+{
+	background = bg;
+
+	grig_debug_local (RIG_DEBUG_VERBOSE, _("%s: %d"), __FUNCTION__, bg);
+}
+
+
+/** \brief Register a user of the rig state outside the GUI.
+ *
+ * The rigctld server, the grig server and the shared memory call this for
+ * each client or while publishing. As long as there is such a consumer,
+ * the rig is polled at full rate even when grig is in the background,
+ * since a minimized grig feeding a logger must not serve stale values.
+ */
+void
+rig_daemon_add_consumer ()
+{
+	g_atomic_int_inc (&consumers);
+}
+
+
+/** \brief Unregister a user of the rig state outside the GUI.
+ *
+ * See rig_daemon_add_consumer().
+ */
+void
+rig_daemon_remove_consumer ()
+{
+	g_atomic_int_add (&consumers, -1);
 }
 
 
@@ -39,6 +39,11 @@
 #define C_MAX_CYCLES          6    /*!< Number of cycles */
 
 #define C_DEF_RX_CMD_DELAY    10   /*!< Default delay between two RX commands [msec] */
+#define C_DEF_METER_INTERVAL  50   /*!< Interval between two meter readings in RX [msec] */
+#define C_KEEPALIVE_CYCLES    10   /*!< Unobserved levels are only polled in every Nth cycle */
+#define C_DEF_BG_CMD_DELAY    100  /*!< Default minimum delay between two RX commands in background [msec] */
+#define C_SCAN_SLICE          250  /*!< Max time the scan engine keeps the rig before the daemon checks its state [msec] */
+#define C_MEM_SLICE           100  /*!< Max time spent on memory channel transfers per cycle [msec] */
 
 
 #define C_RIG_DAEMON_STOP_TIMEOUT 10000  /*!< Timeout to let the daemon process stop [msec] */
@@ -142,12 +147,24 @@ int       rig_daemon_start       (int, const gchar *,
 				  int, const gchar *,
 				  const gchar *, gint,
 				  gboolean, gboolean, gboolean);
+int       rig_daemon_add         (int, const gchar *,
+				  int, const gchar *,
+				  const gchar *, gint,
+				  gboolean, gboolean, gboolean);
 void      rig_daemon_stop        (void);
 void      rig_daemon_set_suspend (gboolean);
 gboolean  rig_daemon_get_suspend (void);
 gchar    *rig_daemon_get_brand   (void);
 gchar    *rig_daemon_get_model   (void);
 gint      rig_daemon_get_rig_id  (void);
+const gchar *rig_daemon_get_cmd_name (rig_cmd_t);
 gint      rig_daemon_get_delay   (void);
+void      rig_daemon_set_bg_delay   (gint);
+void      rig_daemon_set_background (gboolean);
+void      rig_daemon_add_consumer   (void);
+void      rig_daemon_remove_consumer (void);
+void      rig_daemon_set_record     (const gchar *);
+void      rig_daemon_set_replay     (const gchar *, gdouble);
+void      rig_daemon_set_attach     (const gchar *);
 
 #endif
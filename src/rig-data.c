@@ -37,6 +37,10 @@
  * while the rig daemon should access them directly, the GUI should
  * only use the API functions.
  *
+ * Every rig has its own copy of the data in its context, see rig-ctx.h.
+ * The functions use the data of the rig the calling thread is bound to;
+ * for the GUI this is the rig selected by the user.
+ *
  * \note The rig-daemon object is responsible for the correct initialization
  *       of the shared data structures and their contents before they can
  *       be accessed by the GUI.
@@ -53,27 +57,17 @@
 #include <gtk/gtk.h>
 #include <hamlib/rig.h>
 #include <glib/gi18n.h>
+#include "grig-trace.h"
 #include "rig-data.h"
+#include "rig-ctx.h"
 
 
-grig_settings_t  set;      /*!< These values are sent to the radio. */
-grig_settings_t  get;      /*!< These values are read from the radio. */
-grig_cmd_avail_t new;      /*!< Flags to indicate whether new value is available. */
-grig_cmd_avail_t has_set;  /*!< Flags to indicate writing capabilities. */
-grig_cmd_avail_t has_get;  /*!< Flags to indicate reading capabilities. */
-
-
-/** \brief List of attenuator values (absolute values). */
-static int att[HAMLIB_MAXDBLSTSIZ];
-
-/** \brief List of preamp values. */
-static int preamp[HAMLIB_MAXDBLSTSIZ];
-
-/** \brief Bit field of available VFO's */
-static int vfo_list;
-
-/** \brief Maximum power in W */
-static float maxpwr = 0.0;
+/** \brief Get the shared data of the current rig. */
+static rig_data_t *
+rig_data_current ()
+{
+	return &rig_ctx_current ()->data;
+}
 
 
 /** \brief Getavailable VFOs.
@@ -87,7 +81,9 @@ static float maxpwr = 0.0;
 int
 rig_data_get_vfos         ()
 {
-	return vfo_list;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->vfo_list;
 }
 
 
@@ -100,7 +96,9 @@ rig_data_get_vfos         ()
 void
 rig_data_set_vfos         (int vfos)
 {
-	vfo_list = vfos;
+	rig_data_t *rdata = rig_data_current ();
+
+	rdata->vfo_list = vfos;
 }
 
 
@@ -116,8 +114,10 @@ rig_data_set_vfos         (int vfos)
 void
 rig_data_set_att_data (int index, int data)
 {
+	rig_data_t *rdata = rig_data_current ();
+
 	if ((index >= 0) && (index < HAMLIB_MAXDBLSTSIZ))
-		att[index] = data;
+		rdata->att[index] = data;
 }
 
 
@@ -132,8 +132,10 @@ rig_data_set_att_data (int index, int data)
 int
 rig_data_get_att_data (int index)
 {
+	rig_data_t *rdata = rig_data_current ();
+
 	if ((index >= 0) && (index < HAMLIB_MAXDBLSTSIZ)) {
-		return att[index];
+		return rdata->att[index];
 	}
 	else {
 		return 0;
@@ -151,6 +153,7 @@ rig_data_get_att_data (int index)
 int
 rig_data_get_att_index    (int data)
 {
+	rig_data_t *rdata = rig_data_current ();
 	int i = 0;
 
 	/* invali att value */
@@ -158,8 +161,8 @@ rig_data_get_att_index    (int data)
 		return -1;
 
 	/* scan through the array */
-	while ((i < HAMLIB_MAXDBLSTSIZ) && (att[i] != 0)) {
-		if (att[i] == data) {
+	while ((i < HAMLIB_MAXDBLSTSIZ) && (rdata->att[i] != 0)) {
+		if (rdata->att[i] == data) {
 			return i;
 		}
 		i++;
@@ -182,8 +185,10 @@ rig_data_get_att_index    (int data)
 void
 rig_data_set_preamp_data (int index, int data)
 {
+	rig_data_t *rdata = rig_data_current ();
+
 	if ((index >= 0) && (index < HAMLIB_MAXDBLSTSIZ))
-		preamp[index] = data;
+		rdata->preamp[index] = data;
 }
 
 
@@ -198,8 +203,10 @@ rig_data_set_preamp_data (int index, int data)
 int
 rig_data_get_preamp_data (int index)
 {
+	rig_data_t *rdata = rig_data_current ();
+
 	if ((index >= 0) && (index < HAMLIB_MAXDBLSTSIZ)) {
-		return preamp[index];
+		return rdata->preamp[index];
 	}
 	else {
 		return 0;
@@ -218,6 +225,7 @@ rig_data_get_preamp_data (int index)
 int
 rig_data_get_preamp_index    (int data)
 {
+	rig_data_t *rdata = rig_data_current ();
 	int i = 0;
 
 	/* invalid preamp value */
@@ -225,8 +233,8 @@ rig_data_get_preamp_index    (int data)
 		return -1;
 
 	/* scan through the array */
-	while ((i < HAMLIB_MAXDBLSTSIZ) && (preamp[i] != 0)) {
-		if (preamp[i] == data) {
+	while ((i < HAMLIB_MAXDBLSTSIZ) && (rdata->preamp[i] != 0)) {
+		if (rdata->preamp[i] == data) {
 			return i;
 		}
 		i++;
@@ -245,9 +253,11 @@ rig_data_get_preamp_index    (int data)
 void 
 rig_data_set_pstat   (powerstat_t pwr)
 {
-	set.pstat = pwr;
-	get.pstat = pwr;
-	new.pstat = 1;
+	rig_data_t *rdata = rig_data_current ();
+
+	rdata->set.pstat = pwr;
+	rdata->get.pstat = pwr;
+	rdata->new.pstat = 1;
 }
 
 
@@ -260,9 +270,14 @@ rig_data_set_pstat   (powerstat_t pwr)
 void
 rig_data_set_ptt     (ptt_t ptt)
 {
-	set.ptt = ptt;
-	get.ptt = ptt;
-	new.ptt = 1;
+	rig_data_t *rdata = rig_data_current ();
+
+	rdata->set.ptt = ptt;
+	rdata->get.ptt = ptt;
+	rdata->new.ptt = 1;
+
+	GRIG_TRACE (GRIG_TRACE_LEVEL_INFO, GRIG_TRACE_DATA,
+		    GRIG_TRACE_EV_SET_PTT, ptt, 0, 0);
 }
 
 
@@ -279,9 +294,11 @@ rig_data_set_ptt     (ptt_t ptt)
 void
 rig_data_set_power   (float power)
 {
-	set.power = power;
-	get.power = power;
-	new.power = TRUE;
+	rig_data_t *rdata = rig_data_current ();
+
+	rdata->set.power = power;
+	rdata->get.power = power;
+	rdata->new.power = TRUE;
 }
 
 
@@ -299,9 +316,14 @@ rig_data_set_power   (float power)
 void
 rig_data_set_mode    (rmode_t mode)
 {
-	set.mode = mode;
-	get.mode = mode;
-	new.mode = 1;
+	rig_data_t *rdata = rig_data_current ();
+
+	rdata->set.mode = mode;
+	rdata->get.mode = mode;
+	rdata->new.mode = 1;
+
+	GRIG_TRACE (GRIG_TRACE_LEVEL_INFO, GRIG_TRACE_DATA,
+		    GRIG_TRACE_EV_SET_MODE, mode, 0, 0);
 }
 
 
@@ -317,9 +339,11 @@ rig_data_set_mode    (rmode_t mode)
 void
 rig_data_set_pbwidth (rig_data_pbw_t pbw)
 {
-	set.pbw = pbw;
-	get.pbw = pbw;
-	new.pbw = 1;
+	rig_data_t *rdata = rig_data_current ();
+
+	rdata->set.pbw = pbw;
+	rdata->get.pbw = pbw;
+	rdata->new.pbw = 1;
 }
 
 
@@ -333,18 +357,24 @@ rig_data_set_pbwidth (rig_data_pbw_t pbw)
 void
 rig_data_set_freq    (int num, freq_t freq)
 {
+	rig_data_t *rdata = rig_data_current ();
+
+	/* the frequency is split into kHz and Hz to fit 32 bit args */
+	GRIG_TRACE (GRIG_TRACE_LEVEL_INFO, GRIG_TRACE_DATA, GRIG_TRACE_EV_SET_FREQ,
+		    num, (gint64) freq / 1000, (gint64) freq % 1000);
+
 	switch (num) {
 
 		/* primary frequency */
-	case 1: set.freq1 = freq;
-		get.freq1 = freq;
-		new.freq1 = 1;
+	case 1: rdata->set.freq1 = freq;
+		rdata->get.freq1 = freq;
+		rdata->new.freq1 = 1;
 		break;
 
 		/* secondary frequency */
-	case 2: set.freq2 = freq;
-		get.freq2 = freq;
-		new.freq2 = 1;
+	case 2: rdata->set.freq2 = freq;
+		rdata->get.freq2 = freq;
+		rdata->new.freq2 = 1;
 		break;
 
 		/* this is a bug */
@@ -363,9 +393,11 @@ rig_data_set_freq    (int num, freq_t freq)
 void
 rig_data_set_rit     (shortfreq_t rit)
 {
-	set.rit = rit;
-	get.rit = rit;
-	new.rit = 1;
+	rig_data_t *rdata = rig_data_current ();
+
+	rdata->set.rit = rit;
+	rdata->get.rit = rit;
+	rdata->new.rit = 1;
 }
 
 
@@ -377,9 +409,11 @@ rig_data_set_rit     (shortfreq_t rit)
 void
 rig_data_set_xit     (shortfreq_t xit)
 {
-	set.xit = xit;
-	get.xit = xit;
-	new.xit = 1;
+	rig_data_t *rdata = rig_data_current ();
+
+	rdata->set.xit = xit;
+	rdata->get.xit = xit;
+	rdata->new.xit = 1;
 }
 
 
@@ -391,9 +425,11 @@ rig_data_set_xit     (shortfreq_t xit)
 void
 rig_data_set_agc     (int agc)
 {
-	set.agc = agc;
-	get.agc = agc;
-	new.agc = 1;
+	rig_data_t *rdata = rig_data_current ();
+
+	rdata->set.agc = agc;
+	rdata->get.agc = agc;
+	rdata->new.agc = 1;
 }
 
 
@@ -405,9 +441,11 @@ rig_data_set_agc     (int agc)
 void
 rig_data_set_att     (int att)
 {
-	set.att = att;
-	get.att = att;
-	new.att = 1;
+	rig_data_t *rdata = rig_data_current ();
+
+	rdata->set.att = att;
+	rdata->get.att = att;
+	rdata->new.att = 1;
 }
 
 
@@ -419,9 +457,11 @@ rig_data_set_att     (int att)
 void
 rig_data_set_preamp     (int preamp)
 {
-	set.preamp = preamp;
-	get.preamp = preamp;
-	new.preamp = 1;
+	rig_data_t *rdata = rig_data_current ();
+
+	rdata->set.preamp = preamp;
+	rdata->get.preamp = preamp;
+	rdata->new.preamp = 1;
 }
 
 
@@ -433,9 +473,11 @@ rig_data_set_preamp     (int preamp)
 void
 rig_data_set_antenna    (ant_t antenna)
 {
-	set.antenna = antenna;
-	get.antenna = antenna;
-	new.antenna = 1;
+	rig_data_t *rdata = rig_data_current ();
+
+	rdata->set.antenna = antenna;
+	rdata->get.antenna = antenna;
+	rdata->new.antenna = 1;
 }
 
 
@@ -447,7 +489,9 @@ rig_data_set_antenna    (ant_t antenna)
 powerstat_t
 rig_data_get_pstat   ()
 {
-	return get.pstat;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->get.pstat;
 }
 
 
@@ -459,7 +503,9 @@ rig_data_get_pstat   ()
 ptt_t
 rig_data_get_ptt     ()
 {
-	return get.ptt;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->get.ptt;
 }
 
 
@@ -467,28 +513,39 @@ rig_data_get_ptt     ()
 vfo_t
 rig_data_get_vfo     ()
 {
-	return get.vfo;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->get.vfo;
 }
 
 void
 rig_data_set_vfo     (vfo_t vfo)
 {
-	set.vfo = vfo;
-	get.vfo = vfo;
-	new.vfo = 1;
+	rig_data_t *rdata = rig_data_current ();
+
+	rdata->set.vfo = vfo;
+	rdata->get.vfo = vfo;
+	rdata->new.vfo = 1;
+
+	GRIG_TRACE (GRIG_TRACE_LEVEL_INFO, GRIG_TRACE_DATA,
+		    GRIG_TRACE_EV_SET_VFO, vfo, 0, 0);
 }
 
 int
 rig_data_has_get_vfo  ()
 {
-	return has_get.vfo;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->has_get.vfo;
 }
 
 
 int
 rig_data_has_set_vfo  ()
 {
-	return has_set.vfo;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->has_set.vfo;
 }
 
 
@@ -501,7 +558,9 @@ rig_data_has_set_vfo  ()
 rmode_t
 rig_data_get_mode    ()
 {
-	return get.mode;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->get.mode;
 }
 
 
@@ -514,7 +573,9 @@ rig_data_get_mode    ()
 rig_data_pbw_t
 rig_data_get_pbwidth ()
 {
-	return get.pbw;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->get.pbw;
 }
 
 
@@ -530,19 +591,21 @@ rig_data_get_pbwidth ()
 freq_t
 rig_data_get_freq    (int num)
 {
+	rig_data_t *rdata = rig_data_current ();
+
 	switch (num) {
 
 		/* primary frequency */
-	case 1: return get.freq1;
+	case 1: return rdata->get.freq1;
 		break;
 
 		/* secondary frequenct */
-	case 2: return get.freq2;
+	case 2: return rdata->get.freq2;
 		break;
 
 		/* bug */
 	default: g_warning (_("%s: Invalid target: %d\n"), __FUNCTION__, num);
-		return get.freq1;
+		return rdata->get.freq1;
 		break;
 	}
 }
@@ -557,7 +620,9 @@ rig_data_get_freq    (int num)
 freq_t
 rig_data_get_fmin     ()
 {
-	return get.fmin;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->get.fmin;
 }
 
 
@@ -571,7 +636,9 @@ rig_data_get_fmin     ()
 freq_t
 rig_data_get_fmax     ()
 {
-	return get.fmax;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->get.fmax;
 }
 
 
@@ -585,7 +652,9 @@ rig_data_get_fmax     ()
 shortfreq_t
 rig_data_get_fstep    ()
 {
-	return get.fstep;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->get.fstep;
 }
 
 
@@ -598,7 +667,9 @@ rig_data_get_fstep    ()
 shortfreq_t
 rig_data_get_rit     ()
 {
-	return get.rit;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->get.rit;
 }
 
 
@@ -610,7 +681,9 @@ rig_data_get_rit     ()
 shortfreq_t
 rig_data_get_xit     ()
 {
-	return get.xit;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->get.xit;
 }
 
 
@@ -622,7 +695,9 @@ rig_data_get_xit     ()
 int
 rig_data_get_agc     ()
 {
-	return get.agc;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->get.agc;
 }
 
 
@@ -634,7 +709,9 @@ rig_data_get_agc     ()
 int
 rig_data_get_att     ()
 {
-	return get.att;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->get.att;
 }
 
 
@@ -646,7 +723,9 @@ rig_data_get_att     ()
 int
 rig_data_get_preamp     ()
 {
-	return get.preamp;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->get.preamp;
 }
 
 
@@ -658,7 +737,9 @@ rig_data_get_preamp     ()
 int
 rig_data_get_strength ()
 {
-	return get.strength;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->get.strength;
 }
 
 
@@ -670,7 +751,9 @@ rig_data_get_strength ()
 float
 rig_data_get_power    ()
 {
-	return get.power;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->get.power;
 }
 
 
@@ -682,7 +765,9 @@ rig_data_get_power    ()
 float
 rig_data_get_swr      ()
 {
-	return get.swr;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->get.swr;
 }
 
 
@@ -694,15 +779,19 @@ rig_data_get_swr      ()
 float
 rig_data_get_alc      ()
 {
-	return get.alc;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->get.alc;
 }
 
 
 void
 rig_data_set_alc      (float alc)
 {
-	set.alc = alc;
-	new.alc = TRUE;
+	rig_data_t *rdata = rig_data_current ();
+
+	rdata->set.alc = alc;
+	rdata->new.alc = TRUE;
 }
 
 /** \brief Get current antenna.
@@ -713,7 +802,9 @@ rig_data_set_alc      (float alc)
 ant_t
 rig_data_get_antenna    ()
 {
-	return get.antenna;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->get.antenna;
 }
 
 
@@ -725,7 +816,9 @@ rig_data_get_antenna    ()
 int
 rig_data_has_get_strength ()
 {
-	return has_get.strength;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->has_get.strength;
 }
 
 
@@ -739,7 +832,9 @@ rig_data_has_get_strength ()
 int
 rig_data_has_get_pstat ()
 {
-	return has_get.pstat;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->has_get.pstat;
 }
 
 
@@ -752,7 +847,9 @@ rig_data_has_get_pstat ()
 int
 rig_data_has_get_ptt ()
 {
-	return has_get.ptt;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->has_get.ptt;
 }
 
 
@@ -765,7 +862,9 @@ rig_data_has_get_ptt ()
 int
 rig_data_has_get_rit ()
 {
-	return has_get.rit;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->has_get.rit;
 }
 
 
@@ -778,7 +877,9 @@ rig_data_has_get_rit ()
 int
 rig_data_has_get_xit ()
 {
-	return has_get.xit;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->has_get.xit;
 }
 
 
@@ -790,7 +891,9 @@ rig_data_has_get_xit ()
 int
 rig_data_has_set_rit ()
 {
-	return has_set.rit;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->has_set.rit;
 }
 
 
@@ -803,7 +906,9 @@ rig_data_has_set_rit ()
 int
 rig_data_has_set_xit ()
 {
-	return has_set.xit;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->has_set.xit;
 }
 
 
@@ -815,7 +920,9 @@ rig_data_has_set_xit ()
 int
 rig_data_has_get_agc ()
 {
-	return has_get.agc;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->has_get.agc;
 }
 
 
@@ -828,7 +935,9 @@ rig_data_has_get_agc ()
 int
 rig_data_has_get_att ()
 {
-	return has_get.att;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->has_get.att;
 }
 
 
@@ -841,7 +950,9 @@ rig_data_has_get_att ()
 int
 rig_data_has_get_preamp ()
 {
-	return has_get.preamp;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->has_get.preamp;
 }
 
 
@@ -856,7 +967,9 @@ rig_data_has_get_preamp ()
 int
 rig_data_has_get_freq1     ()
 {
-	return has_get.freq1;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->has_get.freq1;
 }
 
 
@@ -870,7 +983,9 @@ rig_data_has_get_freq1     ()
 int
 rig_data_has_get_freq2     ()
 {
-	return has_get.freq2;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->has_get.freq2;
 }
 
 
@@ -884,13 +999,17 @@ rig_data_has_get_freq2     ()
 int
 rig_data_has_get_power    ()
 {
-	return has_get.power;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->has_get.power;
 }
 
 int
 rig_data_has_set_power    ()
 {
-	return has_set.power;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->has_set.power;
 }
 
 
@@ -904,7 +1023,9 @@ rig_data_has_set_power    ()
 int
 rig_data_has_get_swr      ()
 {
-	return has_get.swr;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->has_get.swr;
 }
 
 
@@ -917,14 +1038,18 @@ rig_data_has_get_swr      ()
 int
 rig_data_has_get_alc      ()
 {
-	return has_get.alc;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->has_get.alc;
 }
 
 
 int
 rig_data_has_set_alc      ()
 {
-	return has_set.alc;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->has_set.alc;
 }
 
 /** \brief Get availablility of power status.
@@ -935,7 +1060,9 @@ rig_data_has_set_alc      ()
 int
 rig_data_has_set_pstat ()
 {
-	return has_set.pstat;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->has_set.pstat;
 }
 
 
@@ -948,7 +1075,9 @@ rig_data_has_set_pstat ()
 int
 rig_data_has_set_ptt ()
 {
-	return has_set.ptt;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->has_set.ptt;
 }
 
 
@@ -965,7 +1094,9 @@ rig_data_has_set_ptt ()
 int
 rig_data_has_set_freq1     ()
 {
-	return has_set.freq1;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->has_set.freq1;
 }
 
 
@@ -980,7 +1111,9 @@ rig_data_has_set_freq1     ()
 int
 rig_data_has_set_freq2     ()
 {
-	return has_set.freq2;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->has_set.freq2;
 }
 
 
@@ -995,7 +1128,23 @@ rig_data_has_set_freq2     ()
 int
 rig_data_has_set_att    ()
 {
-	return has_set.att;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->has_set.att;
+}
+
+
+/** \brief Get availability of setting AGC.
+ *  \return 1 if available, otherwise 0.
+ *
+ * This function returns the value of the has_set.agc variable.
+ */
+int
+rig_data_has_set_agc    ()
+{
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->has_set.agc;
 }
 
 
@@ -1011,7 +1160,9 @@ rig_data_has_set_att    ()
 int
 rig_data_has_set_preamp     ()
 {
-	return has_set.preamp;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->has_set.preamp;
 }
 
 
@@ -1025,7 +1176,9 @@ rig_data_has_set_preamp     ()
 shortfreq_t
 rig_data_get_ritmin     ()
 {
-	return -get.ritmax;
+	rig_data_t *rdata = rig_data_current ();
+
+	return -rdata->get.ritmax;
 }
 
 
@@ -1039,7 +1192,9 @@ rig_data_get_ritmin     ()
 shortfreq_t
 rig_data_get_ritmax     ()
 {
-	return get.ritmax;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->get.ritmax;
 }
 
 
@@ -1053,7 +1208,9 @@ rig_data_get_ritmax     ()
 shortfreq_t
 rig_data_get_ritstep    ()
 {
-	return get.ritstep;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->get.ritstep;
 }
 
 
@@ -1067,7 +1224,9 @@ rig_data_get_ritstep    ()
 shortfreq_t
 rig_data_get_xitmin     ()
 {
-	return -get.xitmax;
+	rig_data_t *rdata = rig_data_current ();
+
+	return -rdata->get.xitmax;
 }
 
 
@@ -1081,7 +1240,9 @@ rig_data_get_xitmin     ()
 shortfreq_t
 rig_data_get_xitmax     ()
 {
-	return get.xitmax;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->get.xitmax;
 }
 
 
@@ -1095,7 +1256,9 @@ rig_data_get_xitmax     ()
 shortfreq_t
 rig_data_get_xitstep    ()
 {
-	return get.xitstep;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->get.xitstep;
 }
 
 
@@ -1103,58 +1266,74 @@ rig_data_get_xitstep    ()
 int
 rig_data_has_set_func (setting_t func)
 {
-	return has_set.funcs[rig_setting2idx(func)];
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->has_set.funcs[rig_setting2idx(func)];
 }
 
 
 int
 rig_data_has_get_func (setting_t func)
 {
-	return has_get.funcs[rig_setting2idx(func)];
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->has_get.funcs[rig_setting2idx(func)];
 }
 
 
 void
 rig_data_set_func     (setting_t func, int status)
 {
-	set.funcs[rig_setting2idx(func)] = status;
-	new.funcs[rig_setting2idx(func)] = 1;
+	rig_data_t *rdata = rig_data_current ();
+
+	rdata->set.funcs[rig_setting2idx(func)] = status;
+	rdata->new.funcs[rig_setting2idx(func)] = 1;
 }
 
 
 int
 rig_data_get_func     (setting_t func)
 {
-	return get.funcs[rig_setting2idx(func)];
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->get.funcs[rig_setting2idx(func)];
 }
 
 /***   LOCK  ***/
 int
 rig_data_has_set_lock ()
 {
-	return has_set.lock;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->has_set.lock;
 }
 
 
 int
 rig_data_has_get_lock ()
 {
-	return has_get.lock;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->has_get.lock;
 }
 
 
 void
 rig_data_set_lock     (int lock)
 {
-	set.lock = lock;
-	new.lock = 1;
+	rig_data_t *rdata = rig_data_current ();
+
+	rdata->set.lock = lock;
+	rdata->new.lock = 1;
 }
 
 
 int
 rig_data_get_lock     ()
 {
-	return get.lock;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->get.lock;
 }
 
 
@@ -1162,15 +1341,19 @@ rig_data_get_lock     ()
 int
 rig_data_has_vfo_op_toggle ()
 {
-	return has_set.vfo_op_toggle;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->has_set.vfo_op_toggle;
 }
 
 
 void
 rig_data_vfo_op_toggle     ()
 {
-	set.vfo_op_toggle = 1;
-	new.vfo_op_toggle = 1;
+	rig_data_t *rdata = rig_data_current ();
+
+	rdata->set.vfo_op_toggle = 1;
+	rdata->new.vfo_op_toggle = 1;
 }
 
 
@@ -1178,15 +1361,19 @@ rig_data_vfo_op_toggle     ()
 int
 rig_data_has_vfo_op_copy ()
 {
-	return has_set.vfo_op_copy;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->has_set.vfo_op_copy;
 }
 
 
 void
 rig_data_vfo_op_copy     ()
 {
-	set.vfo_op_copy = 1;
-	new.vfo_op_copy = 1;
+	rig_data_t *rdata = rig_data_current ();
+
+	rdata->set.vfo_op_copy = 1;
+	rdata->new.vfo_op_copy = 1;
 }
 
 
@@ -1194,15 +1381,19 @@ rig_data_vfo_op_copy     ()
 int
 rig_data_has_vfo_op_xchg ()
 {
-	return has_set.vfo_op_xchg;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->has_set.vfo_op_xchg;
 }
 
 
 void
 rig_data_vfo_op_xchg     ()
 {
-	set.vfo_op_xchg = 1;
-	new.vfo_op_xchg = 1;
+	rig_data_t *rdata = rig_data_current ();
+
+	rdata->set.vfo_op_xchg = 1;
+	rdata->new.vfo_op_xchg = 1;
 }
 
 
@@ -1210,30 +1401,38 @@ rig_data_vfo_op_xchg     ()
 int
 rig_data_has_set_split ()
 {
-	return has_set.split;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->has_set.split;
 }
 
 int
 rig_data_has_get_split ()
 {
-	return has_get.split;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->has_get.split;
 }
 
 void
 rig_data_set_split (int split)
 {
+	rig_data_t *rdata = rig_data_current ();
+
 	if (split)
-		set.split = RIG_SPLIT_ON;
+		rdata->set.split = RIG_SPLIT_ON;
 	else
-		set.split = RIG_SPLIT_OFF;
+		rdata->set.split = RIG_SPLIT_OFF;
 
-	new.split = TRUE;
+	rdata->new.split = TRUE;
 }
 
 int
 rig_data_get_split ()
 {
-	return (get.split == RIG_SPLIT_ON ? 1 : 0);
+	rig_data_t *rdata = rig_data_current ();
+
+	return (rdata->get.split == RIG_SPLIT_ON ? 1 : 0);
 }
 
 
@@ -1248,7 +1447,9 @@ rig_data_get_split ()
 grig_settings_t  *
 rig_data_get_get_addr ()
 {
-	return &get;
+	rig_data_t *rdata = rig_data_current ();
+
+	return &rdata->get;
 }
 
 
@@ -1263,7 +1464,9 @@ rig_data_get_get_addr ()
 grig_settings_t  *
 rig_data_get_set_addr ()
 {
-	return &set;
+	rig_data_t *rdata = rig_data_current ();
+
+	return &rdata->set;
 }
 
 
@@ -1278,7 +1481,9 @@ rig_data_get_set_addr ()
 grig_cmd_avail_t *
 rig_data_get_new_addr ()
 {
-	return &new;
+	rig_data_t *rdata = rig_data_current ();
+
+	return &rdata->new;
 }
 
 
@@ -1293,7 +1498,9 @@ rig_data_get_new_addr ()
 grig_cmd_avail_t *
 rig_data_get_has_set_addr ()
 {
-	return &has_set;
+	rig_data_t *rdata = rig_data_current ();
+
+	return &rdata->has_set;
 }
 
 
@@ -1308,7 +1515,9 @@ rig_data_get_has_set_addr ()
 grig_cmd_avail_t *
 rig_data_get_has_get_addr ()
 {
-	return &has_get;
+	rig_data_t *rdata = rig_data_current ();
+
+	return &rdata->has_get;
 }
 
 
@@ -1317,7 +1526,9 @@ rig_data_get_has_get_addr ()
 int
 rig_data_get_all_modes    ()
 {
-	return get.allmodes;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->get.allmodes;
 }
 
 
@@ -1325,7 +1536,9 @@ rig_data_get_all_modes    ()
 int
 rig_data_get_all_antennas    ()
 {
-	return get.allantennas;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->get.allantennas;
 }
 
 
@@ -1333,7 +1546,9 @@ rig_data_get_all_antennas    ()
 void
 rig_data_set_max_rfpwr (float maxpow)
 {
-	maxpwr = maxpow;
+	rig_data_t *rdata = rig_data_current ();
+
+	rdata->maxpwr = maxpow;
 }
 
 
@@ -1341,7 +1556,9 @@ rig_data_set_max_rfpwr (float maxpow)
 float
 rig_data_get_max_rfpwr ()
 {
-	return maxpwr;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->maxpwr;
 }
 
 
@@ -1349,27 +1566,35 @@ rig_data_get_max_rfpwr ()
 int
 rig_data_has_get_afg (void)
 {
-	return has_get.afg;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->has_get.afg;
 }
 
 int
 rig_data_has_set_afg (void)
 {
-	return has_set.afg;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->has_set.afg;
 }
 
 float
 rig_data_get_afg     (void)
 {
-	return get.afg;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->get.afg;
 }
 
 void
 rig_data_set_afg     (float afg)
 {
-	set.afg = afg;
-	get.afg = afg;
-	new.afg = TRUE;
+	rig_data_t *rdata = rig_data_current ();
+
+	rdata->set.afg = afg;
+	rdata->get.afg = afg;
+	rdata->new.afg = TRUE;
 }
 
 
@@ -1377,27 +1602,35 @@ rig_data_set_afg     (float afg)
 int
 rig_data_has_get_rfg (void)
 {
-	return has_get.rfg;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->has_get.rfg;
 }
 
 int
 rig_data_has_set_rfg (void)
 {
-	return has_set.rfg;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->has_set.rfg;
 }
 
 float
 rig_data_get_rfg     (void)
 {
-	return get.rfg;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->get.rfg;
 }
 
 void
 rig_data_set_rfg     (float rfg)
 {
-	set.rfg = rfg;
-	get.rfg = rfg;
-	new.rfg = TRUE;
+	rig_data_t *rdata = rig_data_current ();
+
+	rdata->set.rfg = rfg;
+	rdata->get.rfg = rfg;
+	rdata->new.rfg = TRUE;
 }
 
 
@@ -1405,27 +1638,35 @@ rig_data_set_rfg     (float rfg)
 int
 rig_data_has_get_sql (void)
 {
-	return has_get.sql;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->has_get.sql;
 }
 
 int
 rig_data_has_set_sql (void)
 {
-	return has_set.sql;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->has_set.sql;
 }
 
 float
 rig_data_get_sql     (void)
 {
-	return get.sql;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->get.sql;
 }
 
 void
 rig_data_set_sql     (float sql)
 {
-	set.sql = sql;
-	get.sql = sql;
-	new.sql = TRUE;
+	rig_data_t *rdata = rig_data_current ();
+
+	rdata->set.sql = sql;
+	rdata->get.sql = sql;
+	rdata->new.sql = TRUE;
 }
 
 
@@ -1433,39 +1674,51 @@ rig_data_set_sql     (float sql)
 int
 rig_data_has_get_ifs (void)
 {
-	return has_get.ifs;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->has_get.ifs;
 }
 
 int
 rig_data_has_set_ifs (void)
 {
-	return has_set.ifs;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->has_set.ifs;
 }
 
 int
 rig_data_get_ifs     (void)
 {
-	return get.ifs;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->get.ifs;
 }
 
 void
 rig_data_set_ifs     (int ifs)
 {
-	set.ifs = ifs;
-	get.ifs = ifs;
-	new.ifs = TRUE;
+	rig_data_t *rdata = rig_data_current ();
+
+	rdata->set.ifs = ifs;
+	rdata->get.ifs = ifs;
+	rdata->new.ifs = TRUE;
 }
 
 shortfreq_t
 rig_data_get_ifsmax     ()
 {
-	return get.ifsmax;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->get.ifsmax;
 }
 
 shortfreq_t
 rig_data_get_ifsstep    ()
 {
-	return get.ifsstep;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->get.ifsstep;
 }
 
 
@@ -1473,27 +1726,35 @@ rig_data_get_ifsstep    ()
 int
 rig_data_has_get_apf (void)
 {
-	return has_get.apf;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->has_get.apf;
 }
 
 int
 rig_data_has_set_apf (void)
 {
-	return has_set.apf;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->has_set.apf;
 }
 
 float
 rig_data_get_apf     (void)
 {
-	return get.apf;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->get.apf;
 }
 
 void
 rig_data_set_apf     (float apf)
 {
-	set.apf = apf;
-	get.apf = apf;
-	new.apf = TRUE;
+	rig_data_t *rdata = rig_data_current ();
+
+	rdata->set.apf = apf;
+	rdata->get.apf = apf;
+	rdata->new.apf = TRUE;
 }
 
 
@@ -1501,25 +1762,33 @@ rig_data_set_apf     (float apf)
 int
 rig_data_has_get_nr (void)
 {
-	return has_get.nr;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->has_get.nr;
 }
 
 int
 rig_data_has_set_nr (void)
 {
-	return has_set.nr;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->has_set.nr;
 }
 
 float rig_data_get_nr     (void)
 {
-	return get.nr;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->get.nr;
 }
 
 void  rig_data_set_nr     (float nr)
 {
-	set.nr = nr;
-	get.nr = nr;
-	new.nr = TRUE;
+	rig_data_t *rdata = rig_data_current ();
+
+	rdata->set.nr = nr;
+	rdata->get.nr = nr;
+	rdata->new.nr = TRUE;
 }
 	
 
@@ -1527,27 +1796,35 @@ void  rig_data_set_nr     (float nr)
 int
 rig_data_has_get_notch (void)
 {
-	return has_get.notch;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->has_get.notch;
 }
 
 int
 rig_data_has_set_notch (void)
 {
-	return has_set.notch;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->has_set.notch;
 }
 
 int
 rig_data_get_notch     (void)
 {
-	return get.notch;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->get.notch;
 }
 
 void
 rig_data_set_notch     (int notch)
 {
-	set.notch = notch;
-	get.notch = notch;
-	new.notch = TRUE;
+	rig_data_t *rdata = rig_data_current ();
+
+	rdata->set.notch = notch;
+	rdata->get.notch = notch;
+	rdata->new.notch = TRUE;
 }
 
 
@@ -1555,27 +1832,35 @@ rig_data_set_notch     (int notch)
 int
 rig_data_has_get_pbtin (void)
 {
-	return has_get.pbtin;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->has_get.pbtin;
 }
 
 int
 rig_data_has_set_pbtin (void)
 {
-	return has_set.pbtin;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->has_set.pbtin;
 }
 
 float
 rig_data_get_pbtin     (void)
 {
-	return get.pbtin;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->get.pbtin;
 }
 
 void
 rig_data_set_pbtin     (float pbt)
 {
-	set.pbtin = pbt;
-	get.pbtin = pbt;
-	new.pbtin = TRUE;
+	rig_data_t *rdata = rig_data_current ();
+
+	rdata->set.pbtin = pbt;
+	rdata->get.pbtin = pbt;
+	rdata->new.pbtin = TRUE;
 }
 
 
@@ -1583,54 +1868,70 @@ rig_data_set_pbtin     (float pbt)
 int
 rig_data_has_get_pbtout (void)
 {
-	return has_get.pbtout;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->has_get.pbtout;
 }
 
 int
 rig_data_has_set_pbtout (void)
 {
-	return has_set.pbtout;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->has_set.pbtout;
 }
 
 float
 rig_data_get_pbtout     (void)
 {
-	return get.pbtout;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->get.pbtout;
 }
 
 void
 rig_data_set_pbtout     (float pbt)
 {
-	set.pbtout = pbt;
-	get.pbtout = pbt;
-	new.pbtout = TRUE;
+	rig_data_t *rdata = rig_data_current ();
+
+	rdata->set.pbtout = pbt;
+	rdata->get.pbtout = pbt;
+	rdata->new.pbtout = TRUE;
 }
 
 /* CW pitch */
 int
 rig_data_has_get_cwpitch (void)
 {
-	return has_get.cwpitch;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->has_get.cwpitch;
 }
 
 int
 rig_data_has_set_cwpitch (void)
 {
-	return has_set.cwpitch;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->has_set.cwpitch;
 }
 
 int
 rig_data_get_cwpitch     (void)
 {
-	return get.cwpitch;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->get.cwpitch;
 }
 
 void
 rig_data_set_cwpitch     (int cwp)
 {
-	set.cwpitch = cwp;
-	get.cwpitch = cwp;
-	new.cwpitch = TRUE;
+	rig_data_t *rdata = rig_data_current ();
+
+	rdata->set.cwpitch = cwp;
+	rdata->get.cwpitch = cwp;
+	rdata->new.cwpitch = TRUE;
 }
 
 
@@ -1638,54 +1939,70 @@ rig_data_set_cwpitch     (int cwp)
 int
 rig_data_has_get_keyspd (void)
 {
-	return has_get.keyspd;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->has_get.keyspd;
 }
 
 int
 rig_data_has_set_keyspd (void)
 {
-	return has_set.keyspd;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->has_set.keyspd;
 }
 
 int
 rig_data_get_keyspd     (void)
 {
-	return get.keyspd;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->get.keyspd;
 }
 
 void
 rig_data_set_keyspd     (int keyspd)
 {
-	set.keyspd = keyspd;
-	get.keyspd = keyspd;
-	new.keyspd = TRUE;
+	rig_data_t *rdata = rig_data_current ();
+
+	rdata->set.keyspd = keyspd;
+	rdata->get.keyspd = keyspd;
+	rdata->new.keyspd = TRUE;
 }
 
 /* break-in delay */
 int
 rig_data_has_get_bkindel (void)
 {
-	return has_get.bkindel;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->has_get.bkindel;
 }
 
 int
 rig_data_has_set_bkindel (void)
 {
-	return has_set.bkindel;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->has_set.bkindel;
 }
 
 int
 rig_data_get_bkindel     (void)
 {
-	return get.bkindel;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->get.bkindel;
 }
 
 void
 rig_data_set_bkindel     (int bkindel)
 {
-	set.bkindel = bkindel;
-	get.bkindel = bkindel;
-	new.bkindel = TRUE;
+	rig_data_t *rdata = rig_data_current ();
+
+	rdata->set.bkindel = bkindel;
+	rdata->get.bkindel = bkindel;
+	rdata->new.bkindel = TRUE;
 }
 
 
@@ -1693,162 +2010,285 @@ rig_data_set_bkindel     (int bkindel)
 int
 rig_data_has_get_balance (void)
 {
-	return has_get.balance;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->has_get.balance;
 }
 
 int
 rig_data_has_set_balance (void)
 {
-	return has_set.balance;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->has_set.balance;
 }
 
 float
 rig_data_get_balance     (void)
 {
-	return get.balance;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->get.balance;
 }
 
 void
 rig_data_set_balance     (float bal)
 {
-	set.balance = bal;
-	get.balance = bal;
-	new.balance = TRUE;
+	rig_data_t *rdata = rig_data_current ();
+
+	rdata->set.balance = bal;
+	rdata->get.balance = bal;
+	rdata->new.balance = TRUE;
 }
 
 /* VOX delay */
 int
 rig_data_has_get_voxdel (void)
 {
-	return has_get.voxdel;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->has_get.voxdel;
 }
 
 int
 rig_data_has_set_voxdel (void)
 {
-	return has_set.voxdel;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->has_set.voxdel;
 }
 
 int
 rig_data_get_voxdel     (void)
 {
-	return get.voxdel;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->get.voxdel;
 }
 
 void
 rig_data_set_voxdel     (int voxdel)
 {
-	set.voxdel = voxdel;
-	get.voxdel = voxdel;
-	new.voxdel = TRUE;
+	rig_data_t *rdata = rig_data_current ();
+
+	rdata->set.voxdel = voxdel;
+	rdata->get.voxdel = voxdel;
+	rdata->new.voxdel = TRUE;
 }
 
 /* VOX gain */
 int
 rig_data_has_get_voxg (void)
 {
-	return has_get.voxg;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->has_get.voxg;
 }
 
 int
 rig_data_has_set_voxg (void)
 {
-	return has_set.voxg;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->has_set.voxg;
 }
 
 float
 rig_data_get_voxg     (void)
 {
-	return get.voxg;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->get.voxg;
 }
 
 void
 rig_data_set_voxg     (float voxg)
 {
-	set.voxg = voxg;
-	get.voxg = voxg;
-	new.voxg = TRUE;
+	rig_data_t *rdata = rig_data_current ();
+
+	rdata->set.voxg = voxg;
+	rdata->get.voxg = voxg;
+	rdata->new.voxg = TRUE;
 }
 
 /* anti VOX */
 int
 rig_data_has_get_antivox (void)
 {
-	return has_get.antivox;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->has_get.antivox;
 }
 
 int
 rig_data_has_set_antivox (void)
 {
-	return has_set.antivox;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->has_set.antivox;
 }
 
 float
 rig_data_get_antivox     (void)
 {
-	return get.antivox;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->get.antivox;
 }
 
 void
 rig_data_set_antivox     (float antivox)
 {
-	set.antivox = antivox;
-	get.antivox = antivox;
-	new.antivox = TRUE;
+	rig_data_t *rdata = rig_data_current ();
+
+	rdata->set.antivox = antivox;
+	rdata->get.antivox = antivox;
+	rdata->new.antivox = TRUE;
 }
 
 /* MIC gain */
 int
 rig_data_has_get_micg (void)
 {
-	return has_get.micg;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->has_get.micg;
 }
 
 int
 rig_data_has_set_micg (void)
 {
-	return has_set.micg;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->has_set.micg;
 }
 
 float
 rig_data_get_micg     (void)
 {
-	return get.micg;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->get.micg;
 }
 
 void
 rig_data_set_micg     (float micg)
 {
-	set.micg = micg;
-	get.micg = micg;
-	new.micg = TRUE;
+	rig_data_t *rdata = rig_data_current ();
+
+	rdata->set.micg = micg;
+	rdata->get.micg = micg;
+	rdata->new.micg = TRUE;
 }
 
 /* compression */
 int
 rig_data_has_get_comp (void)
 {
-	return has_get.comp;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->has_get.comp;
 }
 
 int
 rig_data_has_set_comp (void)
 {
-	return has_set.comp;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->has_set.comp;
 }
 
 float
 rig_data_get_comp     (void)
 {
-	return get.comp;
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->get.comp;
 }
 
 void
 rig_data_set_comp     (float comp)
 {
-	set.comp = comp;
-	get.comp = comp;
-	new.comp = TRUE;
+	rig_data_t *rdata = rig_data_current ();
+
+	rdata->set.comp = comp;
+	rdata->get.comp = comp;
+	rdata->new.comp = TRUE;
+}
+
+
+/** \brief Select the meter shown while transmitting.
+ *  \param mode The TX meter mode.
+ *
+ * This function is used by the s-meter to tell the daemon which TX meter
+ * it should sample at the meter rate while the rig is transmitting.
+ */
+void
+rig_data_set_tx_meter    (smeter_tx_mode_t mode)
+{
+	rig_data_t *rdata = rig_data_current ();
+
+	if (mode < SMETER_TX_MODE_LAST)
+		rdata->txmeter = mode;
 }
 
 
+/** \brief Get the meter shown while transmitting.
+ *  \return The TX meter mode.
+ */
+smeter_tx_mode_t
+rig_data_get_tx_meter    ()
+{
+	rig_data_t *rdata = rig_data_current ();
+
+	return rdata->txmeter;
+}
+
+
+/** \brief Register interest in a field.
+ *  \param field The field.
+ *
+ * This function should be called by the GUI when a widget displaying
+ * the field is created. The daemon polls the field at full rate as
+ * long as at least one widget is interested in it.
+ */
+void
+rig_data_add_interest    (rig_data_field_t field)
+{
+	rig_data_t *rdata = rig_data_current ();
+
+	if (field < RIG_DATA_FIELD_NUMBER)
+		rdata->interest[field]++;
+}
+
+
+/** \brief Unregister interest in a field.
+ *  \param field The field.
+ *
+ * This function should be called by the GUI when a widget displaying
+ * the field is destroyed.
+ */
+void
+rig_data_remove_interest (rig_data_field_t field)
+{
+	rig_data_t *rdata = rig_data_current ();
+
+	if ((field < RIG_DATA_FIELD_NUMBER) && (rdata->interest[field] > 0))
+		rdata->interest[field]--;
+}
+
+
+/** \brief Check whether anybody is interested in a field.
+ *  \param field The field.
+ *  \return TRUE if at least one widget displays the field.
+ */
+int
+rig_data_has_interest    (rig_data_field_t field)
+{
+	rig_data_t *rdata = rig_data_current ();
+
+	if (field < RIG_DATA_FIELD_NUMBER)
+		return (rdata->interest[field] > 0);
+
+	return FALSE;
+}
@@ -188,6 +188,77 @@ typedef struct {
 } grig_cmd_avail_t;
 
 
+/** \brief Fields which are only polled on demand.
+ *
+ * These fields are only displayed in the RX, TX and Func windows. The
+ * windows register their interest in the fields while they are open and
+ * the daemon will poll the fields nobody is interested in at a low
+ * keep-alive rate only.
+ */
+typedef enum {
+	RIG_DATA_FIELD_AFG = 0,   /*!< AF gain */
+	RIG_DATA_FIELD_RFG,       /*!< RF gain */
+	RIG_DATA_FIELD_SQL,       /*!< Squelch */
+	RIG_DATA_FIELD_IFS,       /*!< IF shift */
+	RIG_DATA_FIELD_APF,       /*!< APF */
+	RIG_DATA_FIELD_NR,        /*!< Noise reduction */
+	RIG_DATA_FIELD_NOTCH,     /*!< Notch freq */
+	RIG_DATA_FIELD_PBTIN,     /*!< PBT in */
+	RIG_DATA_FIELD_PBTOUT,    /*!< PBT out */
+	RIG_DATA_FIELD_CWPITCH,   /*!< CW pitch */
+	RIG_DATA_FIELD_BALANCE,   /*!< Balance */
+	RIG_DATA_FIELD_KEYSPD,    /*!< Keyer speed */
+	RIG_DATA_FIELD_BKINDEL,   /*!< Break-in delay */
+	RIG_DATA_FIELD_VOXDEL,    /*!< VOX delay */
+	RIG_DATA_FIELD_VOXG,      /*!< VOX gain */
+	RIG_DATA_FIELD_ANTIVOX,   /*!< Anti VOX */
+	RIG_DATA_FIELD_MICG,      /*!< MIC gain */
+	RIG_DATA_FIELD_COMP,      /*!< Compression */
+	RIG_DATA_FIELD_POWER,     /*!< TX power (also polled for the s-meter) */
+	RIG_DATA_FIELD_ALC,       /*!< ALC (also polled for the s-meter) */
+	RIG_DATA_FIELD_FUNC,      /*!< Func's */
+	RIG_DATA_FIELD_NUMBER     /*!< Number of fields */
+} rig_data_field_t;
+
+
+/** \brief TX mode setting.
+ *
+ * These values are used to select the meter display mode when the rig is
+ * in TX mode. The daemon only samples the selected TX meter at the high
+ * meter rate.
+ */
+typedef enum {
+	SMETER_TX_MODE_NONE = 0,       /*!< No display in TX mode. */
+	SMETER_TX_MODE_POWER,          /*!< Show TX power.         */
+	SMETER_TX_MODE_SWR,            /*!< Show SWR.              */
+	SMETER_TX_MODE_ALC,            /*!< Show ALC level.        */
+	SMETER_TX_MODE_LAST            /*!< Dummy...               */
+} smeter_tx_mode_t;
+
+
+/** \brief Shared data of one radio.
+ *
+ * Every radio has its own copy of the shared data, see rig-ctx.h. The
+ * rig_data functions use the copy of the radio the calling thread works
+ * with.
+ */
+typedef struct {
+	grig_settings_t   set;       /*!< These values are sent to the radio. */
+	grig_settings_t   get;       /*!< These values are read from the radio. */
+	grig_cmd_avail_t  new;       /*!< Flags to indicate whether new value is available. */
+	grig_cmd_avail_t  has_set;   /*!< Flags to indicate writing capabilities. */
+	grig_cmd_avail_t  has_get;   /*!< Flags to indicate reading capabilities. */
+
+	int               att[HAMLIB_MAXDBLSTSIZ];     /*!< Attenuator values (absolute values). */
+	int               preamp[HAMLIB_MAXDBLSTSIZ];  /*!< Preamp values. */
+	int               vfo_list;  /*!< Bit field of available VFOs. */
+	float             maxpwr;    /*!< Max RF power in W. */
+
+	unsigned int      interest[RIG_DATA_FIELD_NUMBER]; /*!< Number of widgets interested in each on-demand field. */
+	smeter_tx_mode_t  txmeter;   /*!< TX meter shown by the s-meter. */
+} rig_data_t;
+
+
 #define GRIG_LEVEL_RD (RIG_LEVEL_RFPOWER | RIG_LEVEL_AGC | RIG_LEVEL_SWR | RIG_LEVEL_ALC | \
                        RIG_LEVEL_STRENGTH | RIG_LEVEL_ATT | RIG_LEVEL_PREAMP | \
                        RIG_LEVEL_VOXDELAY | RIG_LEVEL_AF | RIG_LEVEL_RF | RIG_LEVEL_SQL | \
@@ -303,6 +374,7 @@ int   rig_data_has_set_freq2    (void);
 int   rig_data_has_set_rit      (void);
 int   rig_data_has_set_xit      (void);
 int   rig_data_has_set_att      (void);
+int   rig_data_has_set_agc      (void);
 int   rig_data_has_set_preamp   (void);
 int   rig_data_has_set_split    (void);
 
@@ -463,6 +535,15 @@ int   rig_data_has_set_vfo  (void);
 vfo_t rig_data_get_vfo      (void);
 void  rig_data_set_vfo      (vfo_t);
 
+/* TX meter */
+void             rig_data_set_tx_meter (smeter_tx_mode_t mode);
+smeter_tx_mode_t rig_data_get_tx_meter (void);
+
+/* demand-driven polling */
+void  rig_data_add_interest    (rig_data_field_t field);
+void  rig_data_remove_interest (rig_data_field_t field);
+int   rig_data_has_interest    (rig_data_field_t field);
+
 /* address acquisition functions */
 grig_settings_t  *rig_data_get_get_addr     (void);
 grig_settings_t  *rig_data_get_set_addr     (void);
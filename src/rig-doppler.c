@@ -0,0 +1,501 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+    Grig:  Gtk+ user interface for the Hamradio Control Libraries.
+
+    Copyright (C)  2001-2007  Alexandru Csete.
+
+    Authors: Alexandru Csete <oz9aec@gmail.com>
+
+    Comments, questions and bugreports should be submitted via
+    http://sourceforge.net/projects/groundstation/
+    More details can be found at the project home page:
+
+            http://groundstation.sourceforge.net/
+ 
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+  
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+  
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, visit http://www.fsf.org/
+ 
+ 
+ 
+*/
+/** \file rig-doppler.c
+ *  \ingroup shdata
+ *  \brief Doppler correction for satellite work.
+ *
+ * The correction is computed in a main loop timeout and put into the
+ * shared data of the primary rig like any other setting. The pending
+ * flags let the daemon set the new frequency in the next slot of its cycle
+ * that would only read a frequency or is empty, instead of waiting for the
+ * next SET_FREQ slot; the daemon reports back through rig_doppler_cmd()
+ * when the frequency has been set.
+ */
+#include <glib.h>
+#include <glib/gi18n.h>
+#include <math.h>
+#include <string.h>
+#include <hamlib/rig.h>
+#include "grig-debug.h"
+#include "grig-latency.h"
+#include "grig-metrics.h"
+#include "rig-ctx.h"
+#include "rig-data.h"
+#include "rig-doppler.h"
+
+
+#define DOPPLER_C  299792.458   /*!< Speed of light [km/s]. */
+
+
+/** \brief Range-rate sample. */
+typedef struct {
+	gdouble  time;   /*!< Seconds since 1970-01-01 UTC. */
+	gdouble  rate;   /*!< Range rate [km/s]. */
+} doppler_sample_t;
+
+
+static GArray   *samples  = NULL;    /*!< The pass; NULL when not running. */
+static guint     timerid  = 0;       /*!< Correction timeout. */
+static freq_t    downlink = 0;       /*!< Downlink frequency without Doppler [Hz]. */
+static freq_t    uplink   = 0;       /*!< Uplink frequency without Doppler [Hz] or 0. */
+static gint      rate     = RIG_DOPPLER_DEF_RATE;  /*!< Corrections per second. */
+static freq_t    sent[2];            /*!< Last corrected FREQ_1 and FREQ_2. */
+static gboolean  started  = FALSE;   /*!< The pass has begun. */
+
+/* shared with the daemon thread */
+static gboolean  pending[2];         /*!< FREQ_1 and FREQ_2 have not been set yet. */
+static gdouble   when[2];            /*!< Time the pending corrections are computed for. */
+static guint     count    = 0;       /*!< Number of corrections set. */
+static gdouble   errsum   = 0.0;     /*!< Sum of timing errors [sec]. */
+static gdouble   errmax   = 0.0;     /*!< Largest timing error [sec]. */
+
+#if GLIB_CHECK_VERSION(2,32,0)
+static GMutex        mutex;
+#  define DOPPLER_LOCK()   g_mutex_lock (&mutex)
+#  define DOPPLER_UNLOCK() g_mutex_unlock (&mutex)
+#else
+static GStaticMutex  mutex = G_STATIC_MUTEX_INIT;
+#  define DOPPLER_LOCK()   g_static_mutex_lock (&mutex)
+#  define DOPPLER_UNLOCK() g_static_mutex_unlock (&mutex)
+#endif
+
+
+static gdouble  doppler_now        (void);
+static GArray  *doppler_load       (const gchar *filename);
+static gboolean doppler_range_rate (gdouble time, gdouble *rr);
+static gboolean doppler_tick       (gpointer data);
+static void     doppler_correct    (gint num, freq_t freq, shortfreq_t step, gdouble now);
+static void     doppler_summary    (void);
+
+
+
+/** \brief Set the frequency plan.
+ *  \param spec DOWNLINK[,UPLINK[,RATE]] with the frequencies in Hz and
+ *              the number of corrections per second.
+ *  \return TRUE if the plan is valid.
+ */
+gboolean
+rig_doppler_set_plan (const gchar *spec)
+{
+	gchar  **vec;
+	gchar   *end;
+	gboolean ok = TRUE;
+
+	if (spec == NULL)
+		return FALSE;
+
+	vec = g_strsplit (spec, ",", 3);
+
+	downlink = g_ascii_strtod (vec[0], &end);
+	ok = (end != vec[0]) && (*end == '\0') && (downlink > 0);
+
+	if (ok && (vec[1] != NULL)) {
+		uplink = g_ascii_strtod (vec[1], &end);
+		ok = (end != vec[1]) && (*end == '\0') && (uplink >= 0);
+	}
+
+	if (ok && (vec[1] != NULL) && (vec[2] != NULL)) {
+		rate = (gint) g_ascii_strtoll (vec[2], &end, 10);
+		ok = (end != vec[2]) && (*end == '\0') &&
+			(rate > 0) && (rate <= RIG_DOPPLER_MAX_RATE);
+	}
+
+	g_strfreev (vec);
+
+	if (!ok) {
+		downlink = 0;
+		uplink = 0;
+		rate = RIG_DOPPLER_DEF_RATE;
+	}
+
+	return ok;
+}
+
+
+/** \brief Start correcting the frequencies of the primary rig.
+ *  \param filename The file with the range-rate samples of the pass.
+ *  \return TRUE if the engine has been started.
+ *
+ * The frequency plan must have been set with rig_doppler_set_plan().
+ * Nothing is sent to the rig before the first or after the last sample.
+ */
+gboolean
+rig_doppler_start    (const gchar *filename)
+{
+	if ((downlink <= 0) || (samples != NULL))
+		return FALSE;
+
+	samples = doppler_load (filename);
+
+	if (samples == NULL)
+		return FALSE;
+
+	memset (sent, 0, sizeof (sent));
+	memset (pending, 0, sizeof (pending));
+	started = FALSE;
+	count = 0;
+	errsum = 0.0;
+	errmax = 0.0;
+
+	timerid = grig_latency_timeout_add (1000 / rate, doppler_tick, NULL, "doppler");
+
+	grig_debug_local (RIG_DEBUG_VERBOSE,
+			  _("%s: Correcting %.0f Hz / %.0f Hz %d times per second "\
+			    "(%d samples)"),
+			  __FUNCTION__, downlink, uplink, rate, samples->len);
+
+	return TRUE;
+}
+
+
+/** \brief Stop the Doppler engine. */
+void
+rig_doppler_stop     ()
+{
+	if (samples == NULL)
+		return;
+
+	if (timerid != 0) {
+		g_source_remove (timerid);
+		timerid = 0;
+		doppler_summary ();
+	}
+
+	DOPPLER_LOCK ();
+	memset (pending, 0, sizeof (pending));
+	DOPPLER_UNLOCK ();
+
+	g_array_free (samples, TRUE);
+	samples = NULL;
+}
+
+
+/** \brief Get the command setting a pending correction.
+ *  \return RIG_CMD_SET_FREQ_1, RIG_CMD_SET_FREQ_2 or RIG_CMD_NONE.
+ *
+ * Only the primary rig is corrected.
+ */
+rig_cmd_t
+rig_doppler_pending  ()
+{
+	rig_cmd_t cmd = RIG_CMD_NONE;
+
+	if (rig_ctx_current ()->index != 0)
+		return RIG_CMD_NONE;
+
+	DOPPLER_LOCK ();
+	if (pending[0])
+		cmd = RIG_CMD_SET_FREQ_1;
+	else if (pending[1])
+		cmd = RIG_CMD_SET_FREQ_2;
+	DOPPLER_UNLOCK ();
+
+	return cmd;
+}
+
+
+/** \brief Account for a frequency set by the daemon.
+ *  \param cmd The command which has been executed.
+ *  \param status Whether the command has been sent to the rig.
+ *  \param retcode The hamlib return code.
+ *
+ * This function is called by the daemon after each command. The pending
+ * flag is cleared even if the command failed so that the daemon goes on
+ * with its cycle.
+ */
+void
+rig_doppler_cmd      (rig_cmd_t cmd, gint status, gint retcode)
+{
+	gdouble error;
+	gint    i;
+
+	if (cmd == RIG_CMD_SET_FREQ_1)
+		i = 0;
+	else if (cmd == RIG_CMD_SET_FREQ_2)
+		i = 1;
+	else
+		return;
+
+	if (rig_ctx_current ()->index != 0)
+		return;
+
+	DOPPLER_LOCK ();
+
+	if (!pending[i]) {
+		DOPPLER_UNLOCK ();
+		return;
+	}
+
+	pending[i] = FALSE;
+
+	if (status && (retcode == RIG_OK)) {
+		error = doppler_now () - when[i];
+
+		count++;
+		errsum += error;
+		if (error > errmax)
+			errmax = error;
+	}
+	else {
+		error = -1.0;
+	}
+
+	DOPPLER_UNLOCK ();
+
+	if (error >= 0.0)
+		grig_metrics_doppler (error);
+}
+
+
+/** \brief Get the current time in seconds since 1970-01-01 UTC. */
+static gdouble
+doppler_now          ()
+{
+#if GLIB_CHECK_VERSION(2,28,0)
+	return g_get_real_time () / (gdouble) G_USEC_PER_SEC;
+#else
+	GTimeVal tval;
+
+	g_get_current_time (&tval);
+
+	return tval.tv_sec + tval.tv_usec / (gdouble) G_USEC_PER_SEC;
+#endif
+}
+
+
+/** \brief Load range-rate samples.
+ *  \param filename The file to read.
+ *  \return The samples or NULL if the file is invalid.
+ */
+static GArray *
+doppler_load         (const gchar *filename)
+{
+	GArray           *array;
+	GError           *err = NULL;
+	gchar            *contents;
+	gchar           **lines;
+	gchar            *field;
+	gchar            *end;
+	doppler_sample_t  sample;
+	gboolean          ok = TRUE;
+	gint              i;
+
+
+	if (!g_file_get_contents (filename, &contents, NULL, &err)) {
+		grig_debug_local (RIG_DEBUG_ERR,
+				  _("%s: Can not read %s: %s"),
+				  __FUNCTION__, filename, err->message);
+		g_clear_error (&err);
+		return NULL;
+	}
+
+	array = g_array_new (FALSE, FALSE, sizeof (doppler_sample_t));
+	lines = g_strsplit (contents, "\n", 0);
+	g_free (contents);
+
+	for (i = 0; ok && (lines[i] != NULL); i++) {
+
+		g_strstrip (lines[i]);
+
+		if ((lines[i][0] == '\0') || (lines[i][0] == '#'))
+			continue;
+
+		sample.time = g_ascii_strtod (lines[i], &end);
+		ok = (end != lines[i]);
+
+		if (ok) {
+			field = end;
+			sample.rate = g_ascii_strtod (field, &end);
+			ok = (end != field);
+		}
+
+		/* the samples must be in chronological order */
+		if (ok && (array->len > 0)) {
+			ok = sample.time >
+				g_array_index (array, doppler_sample_t, array->len - 1).time;
+		}
+
+		if (ok) {
+			g_array_append_val (array, sample);
+		}
+		else {
+			grig_debug_local (RIG_DEBUG_ERR,
+					  _("%s: Invalid sample in line %d of %s"),
+					  __FUNCTION__, i + 1, filename);
+		}
+	}
+
+	g_strfreev (lines);
+
+	if (ok && (array->len < 2)) {
+		grig_debug_local (RIG_DEBUG_ERR,
+				  _("%s: %s contains less than two samples"),
+				  __FUNCTION__, filename);
+		ok = FALSE;
+	}
+
+	if (!ok) {
+		g_array_free (array, TRUE);
+		return NULL;
+	}
+
+	return array;
+}
+
+
+/** \brief Interpolate the range rate.
+ *  \param time The time in seconds since 1970-01-01 UTC.
+ *  \param rr Location to store the range rate [km/s].
+ *  \return FALSE if the time is outside of the pass.
+ */
+static gboolean
+doppler_range_rate   (gdouble time, gdouble *rr)
+{
+	doppler_sample_t *s = (doppler_sample_t *) samples->data;
+	guint lo = 0;
+	guint hi = samples->len - 1;
+	guint mid;
+
+	if ((time < s[lo].time) || (time > s[hi].time))
+		return FALSE;
+
+	while (hi - lo > 1) {
+		mid = (lo + hi) / 2;
+
+		if (s[mid].time <= time)
+			lo = mid;
+		else
+			hi = mid;
+	}
+
+	*rr = s[lo].rate + (s[hi].rate - s[lo].rate) *
+		(time - s[lo].time) / (s[hi].time - s[lo].time);
+
+	return TRUE;
+}
+
+
+/** \brief Compute the corrections.
+ *  \param data Unused.
+ *  \return FALSE at the end of the pass.
+ */
+static gboolean
+doppler_tick         (gpointer data)
+{
+	rig_ctx_t   *prev;
+	shortfreq_t  step;
+	gdouble      now;
+	gdouble      rr;
+
+
+	now = doppler_now ();
+
+	if (!doppler_range_rate (now, &rr)) {
+
+		if (now < g_array_index (samples, doppler_sample_t, 0).time)
+			return TRUE;
+
+		grig_debug_local (RIG_DEBUG_VERBOSE,
+				  _("%s: End of pass"),
+				  __FUNCTION__);
+		doppler_summary ();
+		timerid = 0;
+
+		return FALSE;
+	}
+
+	if (!started) {
+		started = TRUE;
+		grig_debug_local (RIG_DEBUG_VERBOSE,
+				  _("%s: Start of pass"),
+				  __FUNCTION__);
+	}
+
+	/* the main loop may be bound to another rig */
+	prev = rig_ctx_bind (rig_ctx_get (0));
+
+	step = rig_data_get_fstep ();
+	if (step <= 0)
+		step = 1;
+
+	doppler_correct (1, downlink * (1.0 - rr / DOPPLER_C), step, now);
+
+	if (uplink > 0)
+		doppler_correct (2, uplink * (1.0 + rr / DOPPLER_C), step, now);
+
+	rig_ctx_bind (prev);
+
+	return TRUE;
+}
+
+
+/** \brief Send a corrected frequency if it has changed by one step.
+ *  \param num 1 for the downlink, 2 for the uplink.
+ *  \param freq The corrected frequency.
+ *  \param step The tuning step of the rig.
+ *  \param now The time the correction has been computed for.
+ */
+static void
+doppler_correct      (gint num, freq_t freq, shortfreq_t step, gdouble now)
+{
+	freq = step * floor (freq / step + 0.5);
+
+	if (fabs (freq - sent[num - 1]) < step)
+		return;
+
+	sent[num - 1] = freq;
+	rig_data_set_freq (num, freq);
+
+	DOPPLER_LOCK ();
+	pending[num - 1] = TRUE;
+	when[num - 1] = now;
+	DOPPLER_UNLOCK ();
+}
+
+
+/** \brief Log the timing errors of the pass. */
+static void
+doppler_summary      ()
+{
+	guint   n;
+	gdouble sum, max;
+
+	DOPPLER_LOCK ();
+	n = count;
+	sum = errsum;
+	max = errmax;
+	DOPPLER_UNLOCK ();
+
+	grig_debug_local (RIG_DEBUG_VERBOSE,
+			  _("%s: %d corrections, timing error mean %.1f ms, max %.1f ms"),
+			  __FUNCTION__, n,
+			  (n > 0) ? 1000.0 * sum / n : 0.0, 1000.0 * max);
+}
@@ -0,0 +1,70 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+    Grig:  Gtk+ user interface for the Hamradio Control Libraries.
+
+    Copyright (C)  2001-2007  Alexandru Csete.
+
+    Authors: Alexandru Csete <oz9aec@gmail.com>
+
+    Comments, questions and bugreports should be submitted via
+    http://sourceforge.net/projects/groundstation/
+    More details can be found at the project home page:
+
+            http://groundstation.sourceforge.net/
+ 
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+  
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+  
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, visit http://www.fsf.org/
+ 
+ 
+ 
+*/
+/** \file rig-doppler.h
+ *  \ingroup shdata
+ *  \brief Doppler correction for satellite work (interface).
+ *
+ * The Doppler engine corrects the downlink frequency (FREQ_1) and the
+ * optional uplink frequency (FREQ_2) of the primary rig during a pass.
+ * The pass is described by a file of range-rate samples, one per line:
+ *
+ *   TIME RANGE_RATE
+ *
+ * where TIME is in seconds since 1970-01-01 UTC and RANGE_RATE is the
+ * rate of change of the distance to the satellite in km/s (positive when
+ * the satellite moves away). Lines starting with # are ignored. The file
+ * is usually written by a satellite tracking program from the TLE of the
+ * satellite.
+ *
+ * The correction is computed up to RIG_DOPPLER_MAX_RATE times per second
+ * and a frequency is only sent to the rig when it has changed by at least
+ * the tuning step. The time from the computation until the rig has been
+ * set is reported as the grig_doppler_timing_error_seconds metric and
+ * summarised in the log at the end of the pass.
+ */
+#ifndef RIG_DOPPLER_H
+#define RIG_DOPPLER_H 1
+
+#include <glib.h>
+#include "rig-daemon.h"
+
+
+#define RIG_DOPPLER_DEF_RATE  2     /*!< Default number of corrections per second. */
+#define RIG_DOPPLER_MAX_RATE  10    /*!< Max number of corrections per second. */
+
+
+gboolean  rig_doppler_set_plan (const gchar *spec);
+gboolean  rig_doppler_start    (const gchar *filename);
+void      rig_doppler_stop     (void);
+rig_cmd_t rig_doppler_pending  (void);
+void      rig_doppler_cmd      (rig_cmd_t cmd, gint status, gint retcode);
+
+#endif
@@ -35,6 +35,7 @@
 #include "rig-data.h"
 #include "rig-utils.h"
 #include "grig-gtk-workarounds.h"
+#include "grig-trace.h"
 #include "rig-gui-buttons.h"
 
 
@@ -76,7 +77,7 @@ static void rig_gui_buttons_att_cb      (GtkWidget *, gpointer);
 static void rig_gui_buttons_preamp_cb   (GtkWidget *, gpointer);
 
 static gint rig_gui_buttons_timeout_exec  (gpointer);
-static gint rig_gui_buttons_timeout_stop  (gpointer);
+static void rig_gui_buttons_timeout_stop  (GtkWidget *, gpointer);
 static void rig_gui_buttons_update        (GtkWidget *, gpointer);
 
 
@@ -115,13 +116,15 @@ rig_gui_buttons_create ()
                 FALSE, FALSE, 0);
 
     /* start readback timer */
-    timerid = g_timeout_add (RIG_GUI_BUTTONS_DEF_TVAL,
+    timerid = grig_trace_timeout_add (RIG_GUI_BUTTONS_DEF_TVAL,
                     rig_gui_buttons_timeout_exec,
-                    vbox);
+                    vbox, GRIG_TRACE_GUI_BUTTONS);
 
-    /* register timer_stop function at exit */
-    gtk_quit_add (gtk_main_level (), rig_gui_buttons_timeout_stop,
-                GUINT_TO_POINTER (timerid));
+    /* stop the timer with the widget, which is rebuilt when
+       another rig is selected */
+    g_signal_connect (G_OBJECT (vbox), "destroy",
+                      G_CALLBACK (rig_gui_buttons_timeout_stop),
+                      GUINT_TO_POINTER (timerid));
 
     gtk_widget_show_all (vbox);
 
@@ -518,20 +521,18 @@ rig_gui_buttons_timeout_exec  (gpointer vbox)
 
 
 /** \brief Stop timeout function.
+ *  \param widget The widget being destroyed.
  *  \param timer The ID of the timer to stop.
- *  \return Always TRUE.
  *
- * This function is used to stop the readback timer just before the
- * program is quit. It should be called automatically by Gtk+ when
- * the gtk_main_loop is exited.
+ * This function is used to stop the readback timer when the widget
+ * is destroyed, either because another rig has been selected or
+ * because the program is quit.
  */
-static gint 
-rig_gui_buttons_timeout_stop  (gpointer timer)
+static void
+rig_gui_buttons_timeout_stop  (GtkWidget *widget, gpointer timer)
 {
 
     g_source_remove (GPOINTER_TO_UINT (timer));
-
-    return TRUE;
 }
 
 
@@ -38,6 +38,7 @@
 #include "rig-utils.h"
 #include "rig-gui-func.h"
 #include "grig-debug.h"
+#include "grig-latency.h"
 #include "grig-menubar.h"
 
 /* defined in main.c */
@@ -56,6 +57,11 @@ static GtkWidget *dialog;
 static gboolean visible = FALSE;
 static guint timerid = 0;
 
+/** \brief Fields displayed in this window; polled at full rate while open. */
+static const rig_data_field_t FUNC_FIELDS[] = {
+	RIG_DATA_FIELD_FUNC
+};
+
 
 /* controls */
 static GtkWidget *fctrls[RIG_SETTING_MAX];
@@ -75,6 +81,7 @@ rig_gui_func_create ()
 {
 	GtkWidget *hbox;
 	gchar     *title;
+	guint      i;
 
 
 	if (visible) {
@@ -114,10 +121,15 @@ rig_gui_func_create ()
 
 	visible = TRUE;
 
+	/* tell the daemon that we need these fields */
+	for (i = 0; i < G_N_ELEMENTS (FUNC_FIELDS); i++) {
+		rig_data_add_interest (FUNC_FIELDS[i]);
+	}
+
 	gtk_widget_show_all (dialog);
 
 	/* start callback */
-	timerid = g_timeout_add (1073, func_levels_update, NULL);
+	timerid = grig_latency_timeout_add (1073, func_levels_update, NULL, "func-levels");
 }
 
 
@@ -140,12 +152,16 @@ static void
 func_window_destroy    (GtkWidget *widget,
 		      gpointer   data)
 {
+	guint i;
 
 	/* stop callback */
 	g_source_remove (timerid);
 	timerid = 0;
 
 	/* clear func-active flag in rig-data */
+	for (i = 0; i < G_N_ELEMENTS (FUNC_FIELDS); i++) {
+		rig_data_remove_interest (FUNC_FIELDS[i]);
+	}
 
 	visible = FALSE;
 
@@ -39,12 +39,13 @@
 #include <gtk/gtk.h>
 #include <hamlib/rig.h>
 #include <glib/gi18n.h>
+#include "rig-ctx.h"
 #include "rig-data.h"
 #include "rig-gui-info.h"
 #include "rig-gui-info-data.h"
 
 extern GtkWidget   *grigapp;    /* defined in main.c */
-extern RIG         *myrig;      /* define in rig-demon.c */
+static RIG        *myrig;      /* the selected rig */
 
 
 /* subsystem containers */
@@ -73,6 +74,8 @@ rig_gui_info_run ()
 	GtkWidget *vbox3;
 	GtkWidget *vbox4;
 
+	myrig = rig_ctx_current ()->rig;
+
 	vbox1 = gtk_vbox_new (FALSE, 5);
 	gtk_box_pack_start (GTK_BOX (vbox1), 
 			    rig_gui_info_create_if_frame (),
@@ -85,6 +85,7 @@
 #include "compat.h"
 #include "rig-data.h"
 #include "grig-gtk-workarounds.h"
+#include "grig-trace.h"
 #include "rig-gui-lcd.h"
 
 
@@ -136,7 +137,7 @@ static void           rig_gui_lcd_draw_text        (void);
 static void	      rig_gui_lcd_draw_digit	   (gint position, char digit);
 
 static gint           rig_gui_lcd_timeout_exec     (gpointer);
-static gint           rig_gui_lcd_timeout_stop     (gpointer);
+static void           rig_gui_lcd_timeout_stop     (GtkWidget *, gpointer);
 
 static void           ritval_to_bytearr            (gchar *, shortfreq_t);
 
@@ -180,6 +181,7 @@ rig_gui_lcd_create ()
 
 	/* create canvas */
 	lcd.canvas = gtk_drawing_area_new ();
+	gtk_widget_set_name (lcd.canvas, "grig-lcd");
 	gtk_widget_set_size_request (lcd.canvas, lcd.width, lcd.height);
 
 	/* connect expose handler which will take care of adding
@@ -208,13 +210,14 @@ rig_gui_lcd_create ()
 #ifndef DISABLE_HW
 	if (rig_data_has_get_freq1 ()) {
 #endif
-		timerid = g_timeout_add (RIG_GUI_LCD_DEF_TVAL,
-                                 rig_gui_lcd_timeout_exec,
-                                 NULL);
-
-		/* register timer_stop function at exit */
-		gtk_quit_add (gtk_main_level (), rig_gui_lcd_timeout_stop,
-                      GUINT_TO_POINTER (timerid));
+		timerid = grig_trace_timeout_add (RIG_GUI_LCD_DEF_TVAL,
+                                          rig_gui_lcd_timeout_exec,
+                                          NULL, GRIG_TRACE_GUI_LCD);
+
+		/* stop the timer with the widget */
+		g_signal_connect (G_OBJECT (lcd.canvas), "destroy",
+                          G_CALLBACK (rig_gui_lcd_timeout_stop),
+                          GUINT_TO_POINTER (timerid));
 #ifndef DISABLE_HW
 	}
 #endif
@@ -1352,22 +1355,17 @@ rig_gui_lcd_timeout_exec  (gpointer data)
 
 
 /** \brief Stop timeout function.
+ *  \param widget The widget being destroyed.
  *  \param timer The ID of the timer to stop.
- *  \return Always TRUE.
- *
- * This function is used to stop the readback timer just before the
- * program is quit. It should be called automatically by Gtk+ when
- * the gtk_main_loop is exited.
  *
- * \bug DDD is wrong; copied from smeter.
+ * This function is used to stop the readback timer when the LCD
+ * is destroyed.
  */
-static gint 
-rig_gui_lcd_timeout_stop  (gpointer timer)
+static void
+rig_gui_lcd_timeout_stop  (GtkWidget *widget, gpointer timer)
 {
 
 	g_source_remove (GPOINTER_TO_UINT (timer));
-
-	return TRUE;
 }
 
 
@@ -0,0 +1,644 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+    Grig:  Gtk+ user interface for the Hamradio Control Libraries.
+
+    Copyright (C)  2001-2007  Alexandru Csete.
+
+    Authors: Alexandru Csete <oz9aec@gmail.com>
+
+    Comments, questions and bugreports should be submitted via
+    http://sourceforge.net/projects/groundstation/
+    More details can be found at the project home page:
+
+            http://groundstation.sourceforge.net/
+ 
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+  
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+  
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, visit http://www.fsf.org/
+ 
+ 
+ 
+ 
+*/
+/** \file rig-gui-log-index.c
+ *  \ingroup msgwin
+ *  \brief Inverted index for filtering debug messages.
+ *
+ * The index keeps a posting list, i.e. a sorted array of line numbers, for
+ * each debug level, each message source and each word occurring in the
+ * messages. Words are runs of ASCII letters and digits, folded to lower
+ * case; single characters are not indexed. A small per-line attribute array
+ * holding level and source serves as forward index.
+ *
+ * A query picks the shortest posting list among the search words and the
+ * selected levels or sources and checks the other conditions for each of
+ * its entries, so the cost depends on the number of candidates rather
+ * than on the size of the log.
+ *
+ * The search text matches wherever it occurs in a message, also in the
+ * middle of a word. A query word enclosed by other characters of the search
+ * text must be a whole word of the message and is looked up directly. The
+ * first word may be the end of a longer word, the last one the beginning,
+ * and a search text consisting of a single word may occur anywhere in a
+ * word; such partial words are looked up by scanning the words of the index
+ * and merging the posting lists of all words that match. When the search
+ * text contains anything other than a single word, the result is a superset
+ * which the caller has to verify against the message text.
+ *
+ * The index does no locking of its own.
+ */
+#include <string.h>
+#include <glib.h>
+#include <hamlib/rig.h>
+#include "rig-gui-log-index.h"
+
+
+/** \brief Max length of an indexed word; longer words are truncated. */
+#define LOG_INDEX_MAX_WORD 32
+
+/** \brief Min length of an indexed word. */
+#define LOG_INDEX_MIN_WORD 2
+
+
+struct _grig_log_index {
+	GArray     *attr;                          /*!< Level and source of each line (guint8). */
+	GArray     *level[RIG_DEBUG_TRACE + 1];    /*!< Posting list of each level. */
+	GArray     *source[GRIG_LOG_SRC_NUMBER];   /*!< Posting list of each source. */
+	GHashTable *words;                         /*!< Posting list of each word. */
+};
+
+
+#define ATTR_LEVEL(a)  ((a) & 0x0F)
+#define ATTR_SOURCE(a) ((a) >> 4)
+
+
+/** \brief The word touches the start of the text. */
+#define LOG_WORD_AT_START  1
+
+/** \brief The word touches the end of the text. */
+#define LOG_WORD_AT_END    2
+
+
+/** \brief Callback for log_index_words. */
+typedef void (*log_word_func_t) (const gchar *word, guint where, gpointer data);
+
+
+static guint  log_index_words       (const gchar *text, gsize len,
+				     log_word_func_t func, gpointer data);
+static void   log_index_add_word    (const gchar *word, guint where, gpointer data);
+static void   log_index_find_word   (const gchar *word, guint where, gpointer data);
+static void   log_index_match_word  (gpointer key, gpointer value, gpointer data);
+static guint  posting_lower_bound   (GArray *list, guint line);
+static guint  posting_count         (GArray *list, guint from, guint to);
+static gint   posting_compare       (gconstpointer a, gconstpointer b);
+static void   posting_free          (gpointer list);
+static guint  filter_mask           (guint mask, guint n);
+static gboolean log_index_is_exact  (const gchar *text);
+
+
+/** \brief Data passed to log_index_add_word. */
+typedef struct {
+	grig_log_index_t *index;
+	guint             line;
+} add_word_t;
+
+/** \brief Data passed to log_index_find_word. */
+typedef struct {
+	grig_log_index_t *index;
+	GPtrArray        *lists;    /*!< Posting lists of the query words. */
+	GPtrArray        *merged;   /*!< Merged posting lists to be freed. */
+	gboolean          missing;  /*!< A query word is not in the index. */
+	gboolean          inexact;  /*!< A truncated word was taken as match. */
+} find_word_t;
+
+/** \brief Data passed to log_index_match_word. */
+typedef struct {
+	const gchar      *word;     /*!< The partial query word. */
+	guint             where;    /*!< Where the word is in the search text. */
+	GPtrArray        *lists;    /*!< Posting lists of the matching words. */
+	gboolean          inexact;  /*!< A truncated word was taken as match. */
+} match_word_t;
+
+
+
+/** \brief Create a new, empty index. */
+grig_log_index_t *
+grig_log_index_new ()
+{
+	grig_log_index_t *index;
+	guint i;
+
+	index = g_new0 (grig_log_index_t, 1);
+
+	index->attr = g_array_new (FALSE, FALSE, sizeof (guint8));
+
+	for (i = 0; i <= RIG_DEBUG_TRACE; i++)
+		index->level[i] = g_array_new (FALSE, FALSE, sizeof (guint32));
+
+	for (i = 0; i < GRIG_LOG_SRC_NUMBER; i++)
+		index->source[i] = g_array_new (FALSE, FALSE, sizeof (guint32));
+
+	index->words = g_hash_table_new_full (g_str_hash, g_str_equal,
+					      g_free, posting_free);
+
+	return index;
+}
+
+
+/** \brief Free an index and all its posting lists. */
+void
+grig_log_index_free (grig_log_index_t *index)
+{
+	guint i;
+
+	if (index == NULL)
+		return;
+
+	g_array_free (index->attr, TRUE);
+
+	for (i = 0; i <= RIG_DEBUG_TRACE; i++)
+		g_array_free (index->level[i], TRUE);
+
+	for (i = 0; i < GRIG_LOG_SRC_NUMBER; i++)
+		g_array_free (index->source[i], TRUE);
+
+	g_hash_table_destroy (index->words);
+
+	g_free (index);
+}
+
+
+/** \brief Add a line to the index.
+ *  \param index The index.
+ *  \param line The line number; lines must be added in order starting at 0.
+ *  \param level The debug level of the message.
+ *  \param source The source of the message.
+ *  \param msg The message text (not NUL terminated).
+ *  \param len The length of the message.
+ */
+void
+grig_log_index_add (grig_log_index_t *index,
+		    guint line, guint level, grig_log_src_t source,
+		    const gchar *msg, gsize len)
+{
+	add_word_t data;
+	guint32    l = line;
+	guint8     attr;
+
+	g_return_if_fail (line == index->attr->len);
+
+	level = MIN (level, RIG_DEBUG_TRACE);
+	attr = (guint8) (level | (source << 4));
+
+	g_array_append_val (index->attr, attr);
+	g_array_append_val (index->level[level], l);
+	g_array_append_val (index->source[source], l);
+
+	data.index = index;
+	data.line  = line;
+
+	log_index_words (msg, len, log_index_add_word, &data);
+}
+
+
+/** \brief Get number of lines in the index. */
+guint
+grig_log_index_size (grig_log_index_t *index)
+{
+	return index->attr->len;
+}
+
+
+/** \brief Find lines matching a filter.
+ *  \param index The index.
+ *  \param filter The filter.
+ *  \param from The first line to consider.
+ *  \param to The line after the last line to consider.
+ *  \param result Array of guint32 where the matching line numbers are
+ *                stored in ascending order. The array is cleared first.
+ *  \return TRUE if the result is exact, FALSE if it may contain lines that
+ *          do not contain the filter text.
+ */
+gboolean
+grig_log_index_query (grig_log_index_t *index,
+		      const grig_log_filter_t *filter,
+		      guint from, guint to,
+		      GArray *result)
+{
+	find_word_t  words;
+	GArray      *driver = NULL;     /* shortest word posting list */
+	GArray     **unionlists = NULL; /* level or source lists to merge */
+	guint        unionmask = 0;
+	guint        unionsize = 0;
+	guint        levels, sources;
+	guint        best;              /* number of candidates */
+	guint        n,i,j,k;
+	guint32      line;
+	guint8       attr;
+	gboolean     ok;
+	gboolean     exact;
+
+	g_array_set_size (result, 0);
+
+	exact = log_index_is_exact (filter->text);
+
+	to = MIN (to, index->attr->len);
+	if (from >= to)
+		return exact;
+
+	levels  = filter_mask (filter->levels, RIG_DEBUG_TRACE + 1);
+	sources = filter_mask (filter->sources, GRIG_LOG_SRC_NUMBER);
+
+	/* look up query words */
+	words.index = index;
+	words.lists = g_ptr_array_new ();
+	words.merged = g_ptr_array_new ();
+	words.missing = FALSE;
+	words.inexact = FALSE;
+
+	if (filter->text != NULL)
+		log_index_words (filter->text, strlen (filter->text),
+				 log_index_find_word, &words);
+
+	if (words.inexact)
+		exact = FALSE;
+
+	if (words.missing)
+		goto done;
+
+	/* select the cheapest candidate set */
+	best = to - from;
+
+	for (i = 0; i < words.lists->len; i++) {
+		n = posting_count (g_ptr_array_index (words.lists, i), from, to);
+		if (n < best) {
+			best = n;
+			driver = g_ptr_array_index (words.lists, i);
+		}
+	}
+
+	if (levels) {
+		for (i = 0, n = 0; i <= RIG_DEBUG_TRACE; i++)
+			if (levels & (1 << i))
+				n += posting_count (index->level[i], from, to);
+		if (n < best) {
+			best = n;
+			driver = NULL;
+			unionlists = index->level;
+			unionmask = levels;
+			unionsize = RIG_DEBUG_TRACE + 1;
+		}
+	}
+
+	if (sources) {
+		for (i = 0, n = 0; i < GRIG_LOG_SRC_NUMBER; i++)
+			if (sources & (1 << i))
+				n += posting_count (index->source[i], from, to);
+		if (n < best) {
+			best = n;
+			driver = NULL;
+			unionlists = index->source;
+			unionmask = sources;
+			unionsize = GRIG_LOG_SRC_NUMBER;
+		}
+	}
+
+	/* walk candidates and check remaining conditions */
+	for (k = 0; (k < unionsize) || (k == 0); k++) {
+
+		GArray *list = driver;
+		guint   first, last;
+
+		if (unionlists != NULL) {
+			if (!(unionmask & (1 << k)))
+				continue;
+			list = unionlists[k];
+		}
+
+		if (list != NULL) {
+			first = posting_lower_bound (list, from);
+			last  = posting_lower_bound (list, to);
+		}
+		else {
+			first = from;
+			last  = to;
+		}
+
+		for (i = first; i < last; i++) {
+
+			line = (list != NULL) ? g_array_index (list, guint32, i) : i;
+			attr = g_array_index (index->attr, guint8, line);
+
+			if (levels && !(levels & (1 << ATTR_LEVEL (attr))))
+				continue;
+			if (sources && !(sources & (1 << ATTR_SOURCE (attr))))
+				continue;
+
+			ok = TRUE;
+			for (j = 0; ok && (j < words.lists->len); j++) {
+				GArray *wl = g_ptr_array_index (words.lists, j);
+
+				if (wl == list)
+					continue;
+
+				n = posting_lower_bound (wl, line);
+				ok = (n < wl->len) && (g_array_index (wl, guint32, n) == line);
+			}
+
+			if (ok)
+				g_array_append_val (result, line);
+		}
+	}
+
+	/* results from several level or source lists are not in order */
+	if ((unionlists != NULL) && (unionmask & (unionmask - 1)))
+		g_array_sort (result, posting_compare);
+
+ done:
+	for (i = 0; i < words.merged->len; i++)
+		g_array_free (g_ptr_array_index (words.merged, i), TRUE);
+
+	g_ptr_array_free (words.merged, TRUE);
+	g_ptr_array_free (words.lists, TRUE);
+
+	return exact;
+}
+
+
+/** \brief Check whether the filter text is a single word that can be
+ *         matched without looking at the message text.
+ */
+static gboolean
+log_index_is_exact (const gchar *text)
+{
+	gsize len, i;
+
+	if (text == NULL)
+		return TRUE;
+
+	len = strlen (text);
+
+	if (len == 0)
+		return TRUE;
+
+	if ((len < LOG_INDEX_MIN_WORD) || (len > LOG_INDEX_MAX_WORD))
+		return FALSE;
+
+	for (i = 0; i < len; i++)
+		if (!g_ascii_isalnum (text[i]))
+			return FALSE;
+
+	return TRUE;
+}
+
+
+/** \brief Check whether a filter accepts every line. */
+gboolean
+grig_log_filter_is_empty (const grig_log_filter_t *filter)
+{
+	if (filter == NULL)
+		return TRUE;
+
+	return (filter_mask (filter->levels, RIG_DEBUG_TRACE + 1) == 0) &&
+		(filter_mask (filter->sources, GRIG_LOG_SRC_NUMBER) == 0) &&
+		((filter->text == NULL) || (filter->text[0] == '\0'));
+}
+
+
+
+/** \brief Split text into words.
+ *  \return The number of words.
+ *
+ * Calls func for each word of at least LOG_INDEX_MIN_WORD characters,
+ * folded to lower case and truncated to LOG_INDEX_MAX_WORD characters,
+ * telling whether the word touches the start or the end of the text.
+ */
+static guint
+log_index_words (const gchar *text, gsize len, log_word_func_t func, gpointer data)
+{
+	gchar word[LOG_INDEX_MAX_WORD + 1];
+	guint wlen = 0;
+	guint count = 0;
+	gsize start = 0;
+	gsize i;
+
+	for (i = 0; i <= len; i++) {
+
+		if ((i < len) && g_ascii_isalnum (text[i])) {
+			if (wlen == 0)
+				start = i;
+			if (wlen < LOG_INDEX_MAX_WORD)
+				word[wlen++] = g_ascii_tolower (text[i]);
+			continue;
+		}
+
+		if (wlen >= LOG_INDEX_MIN_WORD) {
+			word[wlen] = '\0';
+			func (word,
+			      ((start == 0) ? LOG_WORD_AT_START : 0) |
+			      ((i == len) ? LOG_WORD_AT_END : 0),
+			      data);
+			count++;
+		}
+		wlen = 0;
+	}
+
+	return count;
+}
+
+
+/** \brief Add line to the posting list of a word. */
+static void
+log_index_add_word (const gchar *word, guint where, gpointer data)
+{
+	add_word_t *add = (add_word_t *) data;
+	GArray     *list;
+	guint32     line = add->line;
+
+	list = g_hash_table_lookup (add->index->words, word);
+
+	if (list == NULL) {
+		list = g_array_new (FALSE, FALSE, sizeof (guint32));
+		g_hash_table_insert (add->index->words, g_strdup (word), list);
+	}
+	else if (g_array_index (list, guint32, list->len - 1) == line) {
+		/* word occurs more than once in the same line */
+		return;
+	}
+
+	g_array_append_val (list, line);
+}
+
+
+/** \brief Look up the posting list of a query word.
+ *
+ * A word enclosed by other characters of the search text is looked up
+ * directly. Otherwise the posting lists of all indexed words containing it
+ * at the proper place are merged into a new list.
+ */
+static void
+log_index_find_word (const gchar *word, guint where, gpointer data)
+{
+	find_word_t  *find = (find_word_t *) data;
+	match_word_t  match;
+	GArray       *list;
+	GArray       *wl;
+	guint         i,n;
+
+	if (where == 0) {
+		list = g_hash_table_lookup (find->index->words, word);
+
+		if (list == NULL)
+			find->missing = TRUE;
+		else
+			g_ptr_array_add (find->lists, list);
+
+		return;
+	}
+
+	match.word = word;
+	match.where = where;
+	match.lists = g_ptr_array_new ();
+	match.inexact = FALSE;
+
+	g_hash_table_foreach (find->index->words, log_index_match_word, &match);
+
+	if (match.inexact)
+		find->inexact = TRUE;
+
+	if (match.lists->len == 0) {
+		find->missing = TRUE;
+	}
+	else if (match.lists->len == 1) {
+		g_ptr_array_add (find->lists, g_ptr_array_index (match.lists, 0));
+	}
+	else {
+		list = g_array_new (FALSE, FALSE, sizeof (guint32));
+
+		for (i = 0; i < match.lists->len; i++) {
+			wl = g_ptr_array_index (match.lists, i);
+			g_array_append_vals (list, wl->data, wl->len);
+		}
+
+		/* a line may contain several matching words */
+		g_array_sort (list, posting_compare);
+
+		for (i = 1, n = 1; i < list->len; i++)
+			if (g_array_index (list, guint32, i) != g_array_index (list, guint32, n - 1))
+				g_array_index (list, guint32, n++) = g_array_index (list, guint32, i);
+
+		g_array_set_size (list, n);
+
+		g_ptr_array_add (find->lists, list);
+		g_ptr_array_add (find->merged, list);
+	}
+
+	g_ptr_array_free (match.lists, TRUE);
+}
+
+
+/** \brief Check whether an indexed word matches a partial query word.
+ *
+ * The first word of the search text has to match the end of the indexed
+ * word, the last one its beginning, and a single word anywhere. Indexed
+ * words that have been truncated may continue with the query word, so
+ * they are taken as candidates for the first or only word of the text.
+ */
+static void
+log_index_match_word (gpointer key, gpointer value, gpointer data)
+{
+	match_word_t *match = (match_word_t *) data;
+	const gchar  *word = (const gchar *) key;
+	gboolean      ok;
+
+	switch (match->where) {
+
+	case LOG_WORD_AT_END:
+		ok = g_str_has_prefix (word, match->word);
+		break;
+
+	case LOG_WORD_AT_START:
+		ok = g_str_has_suffix (word, match->word);
+		break;
+
+	default:
+		ok = (strstr (word, match->word) != NULL);
+		break;
+	}
+
+	if (!ok && (match->where & LOG_WORD_AT_START) &&
+	    (strlen (word) == LOG_INDEX_MAX_WORD)) {
+
+		ok = TRUE;
+		match->inexact = TRUE;
+	}
+
+	if (ok)
+		g_ptr_array_add (match->lists, value);
+}
+
+
+/** \brief Find index of first entry >= line in a posting list. */
+static guint
+posting_lower_bound (GArray *list, guint line)
+{
+	guint lo = 0;
+	guint hi = list->len;
+	guint mid;
+
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (g_array_index (list, guint32, mid) < line)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo;
+}
+
+
+/** \brief Count entries of a posting list in the range [from;to). */
+static guint
+posting_count (GArray *list, guint from, guint to)
+{
+	return posting_lower_bound (list, to) - posting_lower_bound (list, from);
+}
+
+
+static gint
+posting_compare (gconstpointer a, gconstpointer b)
+{
+	guint32 la = *((const guint32 *) a);
+	guint32 lb = *((const guint32 *) b);
+
+	return (la > lb) - (la < lb);
+}
+
+
+/** \brief Normalise a level or source mask.
+ *  \return The mask limited to n bits, 0 if all n bits are set.
+ */
+static guint
+filter_mask (guint mask, guint n)
+{
+	mask &= (1 << n) - 1;
+
+	return (mask == (guint) ((1 << n) - 1)) ? 0 : mask;
+}
+
+
+static void
+posting_free (gpointer list)
+{
+	g_array_free ((GArray *) list, TRUE);
+}
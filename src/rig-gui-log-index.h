@@ -0,0 +1,76 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+    Grig:  Gtk+ user interface for the Hamradio Control Libraries.
+
+    Copyright (C)  2001-2007  Alexandru Csete.
+
+    Authors: Alexandru Csete <oz9aec@gmail.com>
+
+    Comments, questions and bugreports should be submitted via
+    http://sourceforge.net/projects/groundstation/
+    More details can be found at the project home page:
+
+            http://groundstation.sourceforge.net/
+ 
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+  
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+  
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, visit http://www.fsf.org/
+ 
+ 
+ 
+ 
+*/
+/** \file rig-gui-log-index.h
+ *  \ingroup msgwin
+ *  \brief Inverted index for filtering debug messages.
+ */
+#ifndef RIG_GUI_LOG_INDEX_H
+#define RIG_GUI_LOG_INDEX_H 1
+
+#include <glib.h>
+#include <hamlib/rig.h>
+
+
+/** \brief Message source classes. */
+typedef enum {
+	GRIG_LOG_SRC_HAMLIB = 0,   /*!< Messages from hamlib. */
+	GRIG_LOG_SRC_GRIG,         /*!< Messages from grig. */
+	GRIG_LOG_SRC_OTHER,        /*!< Messages from Gtk+, Glib, etc. */
+	GRIG_LOG_SRC_NUMBER        /*!< Number of source classes. */
+} grig_log_src_t;
+
+
+/** \brief Message filter. */
+typedef struct {
+	guint   levels;    /*!< Bitmask of accepted debug levels (1 << level); 0 for all. */
+	guint   sources;   /*!< Bitmask of accepted sources (1 << grig_log_src_t); 0 for all. */
+	gchar  *text;      /*!< Text the message must contain or NULL. */
+} grig_log_filter_t;
+
+
+typedef struct _grig_log_index grig_log_index_t;
+
+
+grig_log_index_t *grig_log_index_new    (void);
+void              grig_log_index_free   (grig_log_index_t *index);
+void              grig_log_index_add    (grig_log_index_t *index,
+					 guint line, guint level, grig_log_src_t source,
+					 const gchar *msg, gsize len);
+guint             grig_log_index_size   (grig_log_index_t *index);
+gboolean          grig_log_index_query  (grig_log_index_t *index,
+					 const grig_log_filter_t *filter,
+					 guint from, guint to,
+					 GArray *result);
+
+gboolean          grig_log_filter_is_empty (const grig_log_filter_t *filter);
+
+#endif
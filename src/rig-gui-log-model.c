@@ -0,0 +1,1026 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+    Grig:  Gtk+ user interface for the Hamradio Control Libraries.
+
+    Copyright (C)  2001-2007  Alexandru Csete.
+
+    Authors: Alexandru Csete <oz9aec@gmail.com>
+
+    Comments, questions and bugreports should be submitted via
+    http://sourceforge.net/projects/groundstation/
+    More details can be found at the project home page:
+
+            http://groundstation.sourceforge.net/
+ 
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+  
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+  
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, visit http://www.fsf.org/
+ 
+ 
+ 
+ 
+*/
+/** \file rig-gui-log-model.c
+ *  \ingroup msgwin
+ *  \brief Lazy tree model for debug log files.
+ *
+ * GrigLogModel is a flat GtkTreeModel showing the lines of a debug log
+ * file. The file is memory mapped and never read into memory as a whole:
+ * a background thread scans the mapping for line breaks and builds an index
+ * of line offsets, and rows are only split into columns when the tree view
+ * asks for them. Memory use is thus one offset per line plus the handful
+ * of rows actually visible.
+ *
+ * The indexer keeps watching the file after reaching the end. When the file
+ * grows it is mapped again and only the new part is scanned, which allows
+ * the model to tail a log that is being written. If the file shrinks,
+ * e.g. because it has been rotated, indexing stops and the model reports
+ * that it needs to be reloaded.
+ *
+ * Lines indexed by the background thread are published to the tree view by
+ * grig_log_model_update, which must be called periodically from the main
+ * loop. Publishing can be done with or without row-inserted signals; the
+ * latter is much faster for large batches but requires that the model is
+ * detached from the view while it is updated.
+ *
+ * While scanning, the indexer also adds each line to an inverted index
+ * (see rig-gui-log-index.c) over debug level, source and message words.
+ * When a filter is set, the model only shows the matching lines; the row
+ * list is obtained from the index, so filtering does not need to look at
+ * the text of the lines, except to verify phrase searches.
+ */
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <gtk/gtk.h>
+#include <glib/gi18n.h>
+#include <glib/gstdio.h>
+#include <hamlib/rig.h>
+#include "grig-debug.h"
+#include "rig-gui-log-model.h"
+
+
+/** \brief Indexer sleep time while waiting for new data [msec]. */
+#define LOG_MODEL_INDEXER_SLEEP 100
+
+/** \brief Number of bytes scanned before publishing new lines. */
+#define LOG_MODEL_CHUNK_SIZE (256*1024)
+
+
+#if GLIB_CHECK_VERSION(2,32,0)
+#  define MODEL_LOCK(m)   g_mutex_lock (&(m)->mutex)
+#  define MODEL_UNLOCK(m) g_mutex_unlock (&(m)->mutex)
+#else
+#  define MODEL_LOCK(m)   g_mutex_lock ((m)->mutex)
+#  define MODEL_UNLOCK(m) g_mutex_unlock ((m)->mutex)
+#endif
+
+#if GLIB_CHECK_VERSION(2,22,0)
+#  define MAPPED_FILE_UNREF(f) g_mapped_file_unref (f)
+#else
+#  define MAPPED_FILE_UNREF(f) g_mapped_file_free (f)
+#endif
+
+
+struct _GrigLogModel
+{
+	GObject      parent;
+
+	gint         stamp;       /*!< Iterator stamp. */
+	gchar       *filename;    /*!< The log file. */
+	goffset      skip;        /*!< Offset where indexing starts. */
+
+	/* shared with the indexer; protected by mutex */
+#if GLIB_CHECK_VERSION(2,32,0)
+	GMutex       mutex;
+#else
+	GMutex      *mutex;
+#endif
+	GMappedFile *map;         /*!< Current mapping of the file. */
+	GArray      *lines;       /*!< Offsets of indexed lines (goffset). */
+	grig_log_index_t *index;  /*!< Inverted index of indexed lines. */
+	grig_log_counts_t counts; /*!< Message counters of indexed lines. */
+	gboolean     reset;       /*!< File has shrunk; reload needed. */
+
+	volatile gint run;        /*!< Indexer should keep running. */
+	GThread     *indexer;     /*!< The indexer thread. */
+
+	/* main loop only */
+	guint        nlines;      /*!< Number of lines published to the view. */
+	guint        nrows;       /*!< Number of rows visible in the view. */
+	gboolean     filtered;    /*!< Whether a filter is active. */
+	grig_log_filter_t filter; /*!< The active filter. */
+	GArray      *rows;        /*!< Line numbers of visible rows if filtered (guint32). */
+	gint         cacherow;    /*!< Row held in the cache or -1. */
+	gchar       *cache[GRIG_LOG_COL_NUMBER];  /*!< Columns of the cached row. */
+};
+
+struct _GrigLogModelClass
+{
+	GObjectClass parent_class;
+};
+
+
+/** \brief A line split into columns. */
+typedef struct {
+	const gchar *field[GRIG_LOG_COL_NUMBER];  /*!< Start of each field. */
+	gsize        len[GRIG_LOG_COL_NUMBER];    /*!< Length of each field. */
+	guint        nfields;                     /*!< Number of fields found. */
+} log_line_t;
+
+
+static const gchar *DEBUG_STR[RIG_DEBUG_TRACE + 1] = {
+	N_("NONE"),
+	N_("BUG"),
+	N_("ERROR"),
+	N_("WARNING"),
+	N_("DEBUG"),
+	N_("TRACE")
+};
+
+
+static GObjectClass *parent_class = NULL;
+
+
+static void     grig_log_model_init            (GrigLogModel *model);
+static void     grig_log_model_class_init      (GrigLogModelClass *klass);
+static void     grig_log_model_tree_model_init (GtkTreeModelIface *iface);
+static void     grig_log_model_finalize        (GObject *object);
+static gpointer grig_log_model_indexer         (gpointer data);
+
+static void     log_line_split     (const gchar *line, gsize len, log_line_t *split);
+static void     log_line_classify  (const gchar *line, gsize len, guint number,
+				    grig_log_counts_t *counts, grig_log_index_t *index);
+static guint    log_line_level     (const log_line_t *split);
+static void     log_model_fill_cache (GrigLogModel *model, gint row);
+static void     log_model_query    (GrigLogModel *model, guint from, guint to,
+				    GArray *result);
+static gboolean log_model_line_contains (GrigLogModel *model, guint line,
+					 const gchar *text);
+
+static GtkTreeModelFlags grig_log_model_get_flags       (GtkTreeModel *tree_model);
+static gint              grig_log_model_get_n_columns   (GtkTreeModel *tree_model);
+static GType             grig_log_model_get_column_type (GtkTreeModel *tree_model,
+							  gint          index);
+static gboolean          grig_log_model_get_iter        (GtkTreeModel *tree_model,
+							  GtkTreeIter  *iter,
+							  GtkTreePath  *path);
+static GtkTreePath      *grig_log_model_get_path        (GtkTreeModel *tree_model,
+							  GtkTreeIter  *iter);
+static void              grig_log_model_get_value       (GtkTreeModel *tree_model,
+							  GtkTreeIter  *iter,
+							  gint          column,
+							  GValue       *value);
+static gboolean          grig_log_model_iter_next       (GtkTreeModel *tree_model,
+							  GtkTreeIter  *iter);
+static gboolean          grig_log_model_iter_children   (GtkTreeModel *tree_model,
+							  GtkTreeIter  *iter,
+							  GtkTreeIter  *parent);
+static gboolean          grig_log_model_iter_has_child  (GtkTreeModel *tree_model,
+							  GtkTreeIter  *iter);
+static gint              grig_log_model_iter_n_children (GtkTreeModel *tree_model,
+							  GtkTreeIter  *iter);
+static gboolean          grig_log_model_iter_nth_child  (GtkTreeModel *tree_model,
+							  GtkTreeIter  *iter,
+							  GtkTreeIter  *parent,
+							  gint          n);
+static gboolean          grig_log_model_iter_parent     (GtkTreeModel *tree_model,
+							  GtkTreeIter  *iter,
+							  GtkTreeIter  *child);
+
+
+
+GType
+grig_log_model_get_type (void)
+{
+	static GType grig_log_model_type = 0;
+
+	if (!grig_log_model_type) {
+
+		static const GTypeInfo grig_log_model_info = {
+			sizeof (GrigLogModelClass),
+			NULL, NULL,
+			(GClassInitFunc) grig_log_model_class_init,
+			NULL, NULL,
+			sizeof (GrigLogModel),
+			0,
+			(GInstanceInitFunc) grig_log_model_init,
+		};
+
+		static const GInterfaceInfo tree_model_info = {
+			(GInterfaceInitFunc) grig_log_model_tree_model_init,
+			NULL,
+			NULL
+		};
+
+		grig_log_model_type = g_type_register_static (G_TYPE_OBJECT,
+							      "GrigLogModel",
+							      &grig_log_model_info,
+							      0);
+
+		g_type_add_interface_static (grig_log_model_type,
+					     GTK_TYPE_TREE_MODEL,
+					     &tree_model_info);
+	}
+
+	return grig_log_model_type;
+}
+
+
+static void
+grig_log_model_class_init (GrigLogModelClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+	parent_class = g_type_class_peek_parent (klass);
+
+	object_class->finalize = grig_log_model_finalize;
+}
+
+
+static void
+grig_log_model_tree_model_init (GtkTreeModelIface *iface)
+{
+	iface->get_flags       = grig_log_model_get_flags;
+	iface->get_n_columns   = grig_log_model_get_n_columns;
+	iface->get_column_type = grig_log_model_get_column_type;
+	iface->get_iter        = grig_log_model_get_iter;
+	iface->get_path        = grig_log_model_get_path;
+	iface->get_value       = grig_log_model_get_value;
+	iface->iter_next       = grig_log_model_iter_next;
+	iface->iter_children   = grig_log_model_iter_children;
+	iface->iter_has_child  = grig_log_model_iter_has_child;
+	iface->iter_n_children = grig_log_model_iter_n_children;
+	iface->iter_nth_child  = grig_log_model_iter_nth_child;
+	iface->iter_parent     = grig_log_model_iter_parent;
+}
+
+
+static void
+grig_log_model_init (GrigLogModel *model)
+{
+	model->stamp    = g_random_int ();
+	model->lines    = g_array_new (FALSE, FALSE, sizeof (goffset));
+	model->index    = grig_log_index_new ();
+	model->rows     = g_array_new (FALSE, FALSE, sizeof (guint32));
+	model->cacherow = -1;
+
+#if GLIB_CHECK_VERSION(2,32,0)
+	g_mutex_init (&model->mutex);
+#else
+	model->mutex = g_mutex_new ();
+#endif
+}
+
+
+static void
+grig_log_model_finalize (GObject *object)
+{
+	GrigLogModel *model = GRIG_LOG_MODEL (object);
+	guint i;
+
+	/* stop indexer */
+	if (model->indexer != NULL) {
+		g_atomic_int_set (&model->run, 0);
+		g_thread_join (model->indexer);
+		model->indexer = NULL;
+	}
+
+	if (model->map != NULL)
+		MAPPED_FILE_UNREF (model->map);
+
+	g_array_free (model->lines, TRUE);
+	g_array_free (model->rows, TRUE);
+	grig_log_index_free (model->index);
+	g_free (model->filter.text);
+	g_free (model->filename);
+
+	for (i = 0; i < GRIG_LOG_COL_NUMBER; i++)
+		g_free (model->cache[i]);
+
+#if GLIB_CHECK_VERSION(2,32,0)
+	g_mutex_clear (&model->mutex);
+#else
+	g_mutex_free (model->mutex);
+#endif
+
+	(* parent_class->finalize) (object);
+}
+
+
+/** \brief Create new log model.
+ *  \param filename The log file or NULL to create an empty model.
+ *  \param skip Skip lines already in the file and only show new ones.
+ *  \return A new GrigLogModel.
+ *
+ * The indexer thread is started immediately; no rows are visible until
+ * grig_log_model_update is called.
+ */
+GrigLogModel *
+grig_log_model_new (const gchar *filename, gboolean skip)
+{
+	GrigLogModel *model;
+	struct stat   buf;
+	GError       *err = NULL;
+
+	model = GRIG_LOG_MODEL (g_object_new (GRIG_LOG_MODEL_TYPE, NULL));
+
+	if (filename == NULL)
+		return model;
+
+	model->filename = g_strdup (filename);
+
+	if (skip && (g_stat (filename, &buf) == 0))
+		model->skip = buf.st_size;
+
+	g_atomic_int_set (&model->run, 1);
+
+#if !GLIB_CHECK_VERSION(2,32,0)
+	model->indexer = g_thread_create (grig_log_model_indexer, model, TRUE, &err);
+#else
+	model->indexer = g_thread_try_new ("log indexer", grig_log_model_indexer, model, &err);
+#endif
+
+	if (model->indexer == NULL) {
+		grig_debug_local (RIG_DEBUG_ERR,
+				  _("%s: Could not start log indexer (%s)"),
+				  __FUNCTION__, err ? err->message : "?");
+		g_clear_error (&err);
+		g_atomic_int_set (&model->run, 0);
+	}
+
+	return model;
+}
+
+
+/** \brief Get the name of the log file shown by the model. */
+const gchar *
+grig_log_model_get_filename (GrigLogModel *model)
+{
+	return model->filename;
+}
+
+
+/** \brief Get number of indexed lines not yet visible in the model. */
+guint
+grig_log_model_get_pending (GrigLogModel *model)
+{
+	guint pending;
+
+	MODEL_LOCK (model);
+	pending = model->lines->len - model->nlines;
+	MODEL_UNLOCK (model);
+
+	return pending;
+}
+
+
+/** \brief Publish indexed lines.
+ *  \param model The log model.
+ *  \param emit Emit row-inserted for each new row.
+ *  \return The number of new rows.
+ *
+ * If a filter is active, only the new lines matching the filter become
+ * visible. If emit is FALSE, the model must not be attached to a view.
+ */
+guint
+grig_log_model_update (GrigLogModel *model, gboolean emit)
+{
+	GtkTreePath *path;
+	GtkTreeIter  iter;
+	guint        total;
+	guint        first;
+
+	MODEL_LOCK (model);
+
+	total = model->lines->len;
+
+	if (model->filtered && (total > model->nlines)) {
+		GArray *match = g_array_new (FALSE, FALSE, sizeof (guint32));
+
+		log_model_query (model, model->nlines, total, match);
+		g_array_append_vals (model->rows, match->data, match->len);
+		g_array_free (match, TRUE);
+	}
+
+	MODEL_UNLOCK (model);
+
+	model->nlines = total;
+	first = model->nrows;
+
+	if (!emit) {
+		model->nrows = model->filtered ? model->rows->len : total;
+		return model->nrows - first;
+	}
+
+	total = model->filtered ? model->rows->len : total;
+
+	while (model->nrows < total) {
+
+		iter.stamp = model->stamp;
+		iter.user_data = GUINT_TO_POINTER (model->nrows);
+
+		model->nrows++;
+
+		path = gtk_tree_path_new ();
+		gtk_tree_path_append_index (path, model->nrows - 1);
+		gtk_tree_model_row_inserted (GTK_TREE_MODEL (model), path, &iter);
+		gtk_tree_path_free (path);
+	}
+
+	return total - first;
+}
+
+
+/** \brief Set filter.
+ *  \param model The log model.
+ *  \param filter The new filter or NULL to show all lines.
+ *
+ * The rows matching the filter are looked up in the index. The model must
+ * not be attached to a view while the filter is changed.
+ */
+void
+grig_log_model_set_filter (GrigLogModel *model, const grig_log_filter_t *filter)
+{
+	g_free (model->filter.text);
+	memset (&model->filter, 0, sizeof (grig_log_filter_t));
+
+	model->filtered = !grig_log_filter_is_empty (filter);
+	model->cacherow = -1;
+	model->stamp++;
+
+	g_array_set_size (model->rows, 0);
+
+	if (!model->filtered) {
+		model->nrows = model->nlines;
+		return;
+	}
+
+	model->filter.levels = filter->levels;
+	model->filter.sources = filter->sources;
+	if ((filter->text != NULL) && (filter->text[0] != '\0'))
+		model->filter.text = g_strdup (filter->text);
+
+	MODEL_LOCK (model);
+	log_model_query (model, 0, model->nlines, model->rows);
+	MODEL_UNLOCK (model);
+
+	model->nrows = model->rows->len;
+}
+
+
+/** \brief Get number of lines published, regardless of the filter. */
+guint
+grig_log_model_get_n_lines (GrigLogModel *model)
+{
+	return model->nlines;
+}
+
+
+/** \brief Check whether the log file has shrunk since it was indexed. */
+gboolean
+grig_log_model_needs_reload (GrigLogModel *model)
+{
+	gboolean reset;
+
+	MODEL_LOCK (model);
+	reset = model->reset;
+	MODEL_UNLOCK (model);
+
+	return reset;
+}
+
+
+/** \brief Get message counters of all indexed lines. */
+void
+grig_log_model_get_counts (GrigLogModel *model, grig_log_counts_t *counts)
+{
+	MODEL_LOCK (model);
+	*counts = model->counts;
+	MODEL_UNLOCK (model);
+}
+
+
+
+/** \brief Background thread building the line index.
+ *  \param data Pointer to the GrigLogModel.
+ */
+static gpointer
+grig_log_model_indexer (gpointer data)
+{
+	GrigLogModel     *model = GRIG_LOG_MODEL (data);
+	GMappedFile      *map;
+	GMappedFile      *old;
+	struct stat       buf;
+	const gchar      *contents;
+	const gchar      *nl;
+	goffset           size;
+	goffset           scanned;   /* number of bytes scanned */
+	goffset           start;     /* start of current line */
+	goffset           pos,end;
+	gboolean          partial;   /* first line is incomplete (skip mode) */
+
+	scanned = start = model->skip;
+	partial = (model->skip > 0);
+
+	while (g_atomic_int_get (&model->run)) {
+
+		/* wait for new data */
+		if ((g_stat (model->filename, &buf) != 0) || (buf.st_size == scanned)) {
+			g_usleep (1000 * LOG_MODEL_INDEXER_SLEEP);
+			continue;
+		}
+
+		if (buf.st_size < scanned) {
+			break;
+		}
+
+		map = g_mapped_file_new (model->filename, FALSE, NULL);
+		if (map == NULL) {
+			g_usleep (1000 * LOG_MODEL_INDEXER_SLEEP);
+			continue;
+		}
+
+		size = g_mapped_file_get_length (map);
+		contents = g_mapped_file_get_contents (map);
+
+		if (size < scanned) {
+			MAPPED_FILE_UNREF (map);
+			break;
+		}
+
+		/* we keep using our reference; old mapping is only
+		   released after the new one has been installed */
+		MODEL_LOCK (model);
+		old = model->map;
+		model->map = map;
+		MODEL_UNLOCK (model);
+
+		if (old != NULL)
+			MAPPED_FILE_UNREF (old);
+
+		/* a line started before the skip offset is dropped */
+		if (partial) {
+			if (contents[scanned - 1] != '\n') {
+				nl = memchr (contents + scanned, '\n', size - scanned);
+				if (nl == NULL) {
+					g_usleep (1000 * LOG_MODEL_INDEXER_SLEEP);
+					continue;
+				}
+				scanned = start = (nl - contents) + 1;
+			}
+			partial = FALSE;
+		}
+
+		while ((scanned < size) && g_atomic_int_get (&model->run)) {
+
+			end = MIN (size, scanned + LOG_MODEL_CHUNK_SIZE);
+
+			/* lines are published and indexed chunk by chunk */
+			MODEL_LOCK (model);
+
+			pos = scanned;
+			while (pos < end) {
+				nl = memchr (contents + pos, '\n', end - pos);
+				if (nl == NULL)
+					break;
+
+				log_line_classify (contents + start,
+						   (nl - contents) - start,
+						   model->lines->len,
+						   &model->counts, model->index);
+				g_array_append_val (model->lines, start);
+
+				start = (nl - contents) + 1;
+				pos = start;
+			}
+
+			MODEL_UNLOCK (model);
+
+			scanned = end;
+		}
+	}
+
+	/* we only get here on stop or if the file has shrunk */
+	if (g_atomic_int_get (&model->run)) {
+		grig_debug_local (RIG_DEBUG_VERBOSE,
+				  _("%s: %s has been truncated"),
+				  __FUNCTION__, model->filename);
+		MODEL_LOCK (model);
+		model->reset = TRUE;
+		MODEL_UNLOCK (model);
+	}
+
+	return NULL;
+}
+
+
+/** \brief Split a log line into columns.
+ *
+ * Lines are of the form time;;source;;level;;message. Lines written by
+ * Gtk+ or Glib only have the message.
+ */
+static void
+log_line_split (const gchar *line, gsize len, log_line_t *split)
+{
+	const gchar *p = line;
+	const gchar *end = line + len;
+	const gchar *sep;
+	gsize        seplen = strlen (GRIG_DEBUG_SEPARATOR);
+
+	/* ignore CR of DOS line endings */
+	if ((len > 0) && (line[len - 1] == '\r'))
+		end--;
+
+	split->nfields = 0;
+
+	while (split->nfields < GRIG_LOG_COL_NUMBER - 1) {
+
+		sep = g_strstr_len (p, end - p, GRIG_DEBUG_SEPARATOR);
+		if (sep == NULL)
+			break;
+
+		split->field[split->nfields] = p;
+		split->len[split->nfields] = sep - p;
+		split->nfields++;
+
+		p = sep + seplen;
+	}
+
+	split->field[split->nfields] = p;
+	split->len[split->nfields] = end - p;
+	split->nfields++;
+}
+
+
+/** \brief Get debug level of a split line. */
+static guint
+log_line_level (const log_line_t *split)
+{
+	guint level;
+
+	if (split->nfields != GRIG_LOG_COL_NUMBER)
+		return RIG_DEBUG_ERR;
+
+	level = (guint) g_ascii_strtoull (split->field[GRIG_LOG_COL_LEVEL], NULL, 10);
+
+	return MIN (level, RIG_DEBUG_TRACE);
+}
+
+
+/** \brief Update message counters and index with one line.
+ *  \param line The line.
+ *  \param len The length of the line.
+ *  \param number The line number.
+ *  \param counts The message counters.
+ *  \param index The inverted index.
+ */
+static void
+log_line_classify (const gchar *line, gsize len, guint number,
+		   grig_log_counts_t *counts, grig_log_index_t *index)
+{
+	log_line_t     split;
+	grig_log_src_t source;
+	guint          level;
+
+	log_line_split (line, len, &split);
+
+	level = log_line_level (&split);
+
+	if (split.nfields == 1) {
+		source = GRIG_LOG_SRC_OTHER;
+	}
+	else if (split.nfields != GRIG_LOG_COL_NUMBER) {
+		source = GRIG_LOG_SRC_GRIG;
+	}
+	else if ((split.len[GRIG_LOG_COL_SOURCE] == 6) &&
+		 !g_ascii_strncasecmp (split.field[GRIG_LOG_COL_SOURCE], "HAMLIB", 6)) {
+		source = GRIG_LOG_SRC_HAMLIB;
+	}
+	else if ((split.len[GRIG_LOG_COL_SOURCE] == 4) &&
+		 !g_ascii_strncasecmp (split.field[GRIG_LOG_COL_SOURCE], "GRIG", 4)) {
+		source = GRIG_LOG_SRC_GRIG;
+	}
+	else {
+		source = GRIG_LOG_SRC_OTHER;
+	}
+
+	counts->level[level]++;
+
+	switch (source) {
+	case GRIG_LOG_SRC_HAMLIB:
+		counts->hamlib++;
+		break;
+	case GRIG_LOG_SRC_GRIG:
+		counts->grig++;
+		break;
+	default:
+		counts->other++;
+		break;
+	}
+
+	/* corrupt lines are shown with a fixed message, so only
+	   well-formed and foreign lines have searchable text */
+	if (split.nfields == 1) {
+		grig_log_index_add (index, number, level, source,
+				    split.field[0], split.len[0]);
+	}
+	else if (split.nfields == GRIG_LOG_COL_NUMBER) {
+		grig_log_index_add (index, number, level, source,
+				    split.field[GRIG_LOG_COL_MSG],
+				    split.len[GRIG_LOG_COL_MSG]);
+	}
+	else {
+		grig_log_index_add (index, number, level, source, NULL, 0);
+	}
+}
+
+
+/** \brief Find lines matching the active filter.
+ *  \param model The log model.
+ *  \param from The first line to consider.
+ *  \param to The line after the last line to consider.
+ *  \param result Array of guint32 where the line numbers are stored.
+ *
+ * The model must be locked.
+ */
+static void
+log_model_query (GrigLogModel *model, guint from, guint to, GArray *result)
+{
+	guint i,n;
+	guint32 line;
+
+	if (grig_log_index_query (model->index, &model->filter, from, to, result))
+		return;
+
+	/* drop candidates not containing the text */
+	for (i = 0, n = 0; i < result->len; i++) {
+		line = g_array_index (result, guint32, i);
+		if (log_model_line_contains (model, line, model->filter.text))
+			g_array_index (result, guint32, n++) = line;
+	}
+
+	g_array_set_size (result, n);
+}
+
+
+/** \brief Check whether the message of a line contains a text.
+ *
+ * The comparison is case insensitive for ASCII characters. The model must
+ * be locked.
+ */
+static gboolean
+log_model_line_contains (GrigLogModel *model, guint line, const gchar *text)
+{
+	log_line_t   split;
+	const gchar *contents;
+	const gchar *msg;
+	const gchar *nl;
+	goffset      start;
+	gsize        msglen, tlen, i, j;
+
+	contents = g_mapped_file_get_contents (model->map);
+	start = g_array_index (model->lines, goffset, line);
+	nl = memchr (contents + start, '\n',
+		     g_mapped_file_get_length (model->map) - start);
+
+	log_line_split (contents + start, nl - (contents + start), &split);
+
+	if (split.nfields == 1) {
+		msg = split.field[0];
+		msglen = split.len[0];
+	}
+	else if (split.nfields == GRIG_LOG_COL_NUMBER) {
+		msg = split.field[GRIG_LOG_COL_MSG];
+		msglen = split.len[GRIG_LOG_COL_MSG];
+	}
+	else {
+		return FALSE;
+	}
+
+	tlen = strlen (text);
+
+	for (i = 0; i + tlen <= msglen; i++) {
+		for (j = 0; j < tlen; j++)
+			if (g_ascii_tolower (msg[i + j]) != g_ascii_tolower (text[j]))
+				break;
+		if (j == tlen)
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+
+/** \brief Parse a row into the cache. */
+static void
+log_model_fill_cache (GrigLogModel *model, gint row)
+{
+	log_line_t   split;
+	const gchar *contents;
+	const gchar *nl;
+	goffset      start;
+	goffset      size;
+	guint        i;
+
+	for (i = 0; i < GRIG_LOG_COL_NUMBER; i++) {
+		g_free (model->cache[i]);
+		model->cache[i] = NULL;
+	}
+
+	model->cacherow = row;
+
+	if (model->filtered)
+		row = g_array_index (model->rows, guint32, row);
+
+	MODEL_LOCK (model);
+
+	contents = g_mapped_file_get_contents (model->map);
+	size = g_mapped_file_get_length (model->map);
+	start = g_array_index (model->lines, goffset, row);
+	nl = memchr (contents + start, '\n', size - start);
+
+	log_line_split (contents + start, nl - (contents + start), &split);
+
+	switch (split.nfields) {
+
+	case 1:
+		model->cache[GRIG_LOG_COL_TIME] = g_strdup ("");
+		model->cache[GRIG_LOG_COL_SOURCE] = g_strdup (_("SYS"));
+		model->cache[GRIG_LOG_COL_MSG] = g_strndup (split.field[0], split.len[0]);
+		break;
+
+	case GRIG_LOG_COL_NUMBER:
+		for (i = 0; i < GRIG_LOG_COL_NUMBER; i++) {
+			if (i != GRIG_LOG_COL_LEVEL)
+				model->cache[i] = g_strndup (split.field[i], split.len[i]);
+		}
+		break;
+
+	default:
+		model->cache[GRIG_LOG_COL_TIME] = g_strdup ("");
+		model->cache[GRIG_LOG_COL_SOURCE] = g_strdup (_("GRIG"));
+		model->cache[GRIG_LOG_COL_MSG] = g_strdup (_("Log file seems corrupt"));
+		break;
+	}
+
+	MODEL_UNLOCK (model);
+
+	model->cache[GRIG_LOG_COL_LEVEL] = g_strdup (_(DEBUG_STR[log_line_level (&split)]));
+}
+
+
+
+static GtkTreeModelFlags
+grig_log_model_get_flags (GtkTreeModel *tree_model)
+{
+	return GTK_TREE_MODEL_LIST_ONLY | GTK_TREE_MODEL_ITERS_PERSIST;
+}
+
+
+static gint
+grig_log_model_get_n_columns (GtkTreeModel *tree_model)
+{
+	return GRIG_LOG_COL_NUMBER;
+}
+
+
+static GType
+grig_log_model_get_column_type (GtkTreeModel *tree_model, gint index)
+{
+	return G_TYPE_STRING;
+}
+
+
+static gboolean
+grig_log_model_get_iter (GtkTreeModel *tree_model,
+			 GtkTreeIter  *iter,
+			 GtkTreePath  *path)
+{
+	GrigLogModel *model = GRIG_LOG_MODEL (tree_model);
+	gint          row;
+
+	if (gtk_tree_path_get_depth (path) != 1)
+		return FALSE;
+
+	row = gtk_tree_path_get_indices (path)[0];
+
+	if ((row < 0) || (row >= (gint) model->nrows))
+		return FALSE;
+
+	iter->stamp = model->stamp;
+	iter->user_data = GINT_TO_POINTER (row);
+
+	return TRUE;
+}
+
+
+static GtkTreePath *
+grig_log_model_get_path (GtkTreeModel *tree_model, GtkTreeIter *iter)
+{
+	GtkTreePath *path;
+
+	path = gtk_tree_path_new ();
+	gtk_tree_path_append_index (path, GPOINTER_TO_INT (iter->user_data));
+
+	return path;
+}
+
+
+static void
+grig_log_model_get_value (GtkTreeModel *tree_model,
+			  GtkTreeIter  *iter,
+			  gint          column,
+			  GValue       *value)
+{
+	GrigLogModel *model = GRIG_LOG_MODEL (tree_model);
+	gint          row = GPOINTER_TO_INT (iter->user_data);
+
+	g_value_init (value, G_TYPE_STRING);
+
+	if ((row >= (gint) model->nrows) || (column >= GRIG_LOG_COL_NUMBER))
+		return;
+
+	/* the view asks for one column at a time */
+	if (row != model->cacherow)
+		log_model_fill_cache (model, row);
+
+	g_value_set_string (value, model->cache[column]);
+}
+
+
+static gboolean
+grig_log_model_iter_next (GtkTreeModel *tree_model, GtkTreeIter *iter)
+{
+	GrigLogModel *model = GRIG_LOG_MODEL (tree_model);
+	gint          row = GPOINTER_TO_INT (iter->user_data) + 1;
+
+	if (row >= (gint) model->nrows)
+		return FALSE;
+
+	iter->user_data = GINT_TO_POINTER (row);
+
+	return TRUE;
+}
+
+
+static gboolean
+grig_log_model_iter_children (GtkTreeModel *tree_model,
+			      GtkTreeIter  *iter,
+			      GtkTreeIter  *parent)
+{
+	return grig_log_model_iter_nth_child (tree_model, iter, parent, 0);
+}
+
+
+static gboolean
+grig_log_model_iter_has_child (GtkTreeModel *tree_model, GtkTreeIter *iter)
+{
+	return FALSE;
+}
+
+
+static gint
+grig_log_model_iter_n_children (GtkTreeModel *tree_model, GtkTreeIter *iter)
+{
+	if (iter != NULL)
+		return 0;
+
+	return GRIG_LOG_MODEL (tree_model)->nrows;
+}
+
+
+static gboolean
+grig_log_model_iter_nth_child (GtkTreeModel *tree_model,
+			       GtkTreeIter  *iter,
+			       GtkTreeIter  *parent,
+			       gint          n)
+{
+	GrigLogModel *model = GRIG_LOG_MODEL (tree_model);
+
+	if ((parent != NULL) || (n < 0) || (n >= (gint) model->nrows))
+		return FALSE;
+
+	iter->stamp = model->stamp;
+	iter->user_data = GINT_TO_POINTER (n);
+
+	return TRUE;
+}
+
+
+static gboolean
+grig_log_model_iter_parent (GtkTreeModel *tree_model,
+			    GtkTreeIter  *iter,
+			    GtkTreeIter  *child)
+{
+	return FALSE;
+}
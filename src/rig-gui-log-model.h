@@ -0,0 +1,90 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+    Grig:  Gtk+ user interface for the Hamradio Control Libraries.
+
+    Copyright (C)  2001-2007  Alexandru Csete.
+
+    Authors: Alexandru Csete <oz9aec@gmail.com>
+
+    Comments, questions and bugreports should be submitted via
+    http://sourceforge.net/projects/groundstation/
+    More details can be found at the project home page:
+
+            http://groundstation.sourceforge.net/
+ 
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+  
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+  
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, visit http://www.fsf.org/
+ 
+ 
+ 
+ 
+*/
+/** \file rig-gui-log-model.h
+ *  \ingroup msgwin
+ *  \brief Lazy tree model for debug log files.
+ */
+#ifndef RIG_GUI_LOG_MODEL_H
+#define RIG_GUI_LOG_MODEL_H 1
+
+#include <glib.h>
+#include <glib-object.h>
+#include <gtk/gtk.h>
+#include <hamlib/rig.h>
+#include "rig-gui-log-index.h"
+
+
+G_BEGIN_DECLS
+
+#define GRIG_LOG_MODEL_TYPE            (grig_log_model_get_type ())
+#define GRIG_LOG_MODEL(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), GRIG_LOG_MODEL_TYPE, GrigLogModel))
+#define IS_GRIG_LOG_MODEL(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), GRIG_LOG_MODEL_TYPE))
+
+
+/** \brief Columns of the log model; all of type G_TYPE_STRING. */
+typedef enum {
+	GRIG_LOG_COL_TIME = 0,   /*!< Date and time. */
+	GRIG_LOG_COL_SOURCE,     /*!< Message source. */
+	GRIG_LOG_COL_LEVEL,      /*!< Debug level. */
+	GRIG_LOG_COL_MSG,        /*!< The message. */
+	GRIG_LOG_COL_NUMBER      /*!< Number of columns. */
+} grig_log_col_t;
+
+
+/** \brief Message counters. */
+typedef struct {
+	guint  level[RIG_DEBUG_TRACE + 1];   /*!< Number of messages per debug level. */
+	guint  hamlib;                       /*!< Number of messages from hamlib. */
+	guint  grig;                         /*!< Number of messages from grig. */
+	guint  other;                        /*!< Number of messages from other sources. */
+} grig_log_counts_t;
+
+
+typedef struct _GrigLogModel       GrigLogModel;
+typedef struct _GrigLogModelClass  GrigLogModelClass;
+
+
+GType          grig_log_model_get_type        (void);
+GrigLogModel  *grig_log_model_new             (const gchar *filename, gboolean skip);
+const gchar   *grig_log_model_get_filename    (GrigLogModel *model);
+guint          grig_log_model_get_pending     (GrigLogModel *model);
+guint          grig_log_model_update          (GrigLogModel *model, gboolean emit);
+guint          grig_log_model_get_n_lines     (GrigLogModel *model);
+void           grig_log_model_set_filter      (GrigLogModel *model,
+					       const grig_log_filter_t *filter);
+gboolean       grig_log_model_needs_reload    (GrigLogModel *model);
+void           grig_log_model_get_counts      (GrigLogModel *model,
+					       grig_log_counts_t *counts);
+
+G_END_DECLS
+
+#endif
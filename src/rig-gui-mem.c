@@ -0,0 +1,607 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+    Grig:  Gtk+ user interface for the Hamradio Control Libraries.
+
+    Copyright (C)  2001-2007  Alexandru Csete.
+
+    Authors: Alexandru Csete <oz9aec@gmail.com>
+
+    Comments, questions and bugreports should be submitted via
+    http://sourceforge.net/projects/groundstation/
+    More details can be found at the project home page:
+
+            http://groundstation.sourceforge.net/
+ 
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+  
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+  
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, visit http://www.fsf.org/
+ 
+ 
+ 
+*/
+/** \file rig-gui-mem.c
+ *  \brief Software memory window.
+ *
+ * The window lists the channels of the software memory (see rig-mem.h)
+ * that are in a frequency range and have a tag. Activating a channel
+ * tunes the rig to it. The buttons import channels from a text file,
+ * delete the selected channels, read all memory channels of the rig,
+ * write the selected channels, or all listed channels if none is
+ * selected, to the rig, and save the memory.
+ *
+ * The progress of a transfer is polled from a timeout, which also
+ * refreshes the list when the memory has changed, e.g. when downloaded
+ * channels have been merged into it at the end of a transfer. The list
+ * keeps the generation of the memory it was filled from (see rig-mem.h),
+ * so that channels listed before a change are never acted on; the action
+ * is refused and the list refreshed instead.
+ */
+#include <gtk/gtk.h>
+#include <glib/gi18n.h>
+#include <hamlib/rig.h>
+#include "grig-debug.h"
+#include "grig-latency.h"
+#include "rig-data.h"
+#include "rig-mem.h"
+#include "rig-gui-mem.h"
+
+/* defined in main.c */
+extern GtkWidget *grigapp;
+
+
+#define MEM_POLL_TVAL  250   /*!< Interval for checking the progress of a transfer [msec]. */
+
+
+/** \brief Columns of the channel list. */
+typedef enum {
+	MEM_COL_INDEX = 0,   /*!< Index in the software memory; not shown. */
+	MEM_COL_FREQ,        /*!< Frequency. */
+	MEM_COL_MODE,        /*!< Mode. */
+	MEM_COL_TONE,        /*!< CTCSS tone or DCS code. */
+	MEM_COL_NAME,        /*!< Name. */
+	MEM_COL_TAGS,        /*!< Tags. */
+	MEM_COL_CHANNEL,     /*!< Channel number in the rig. */
+	MEM_COL_NUMBER
+} mem_col_t;
+
+
+/** \brief Column titles. */
+const gchar *MEM_LIST_COL_TITLE[MEM_COL_NUMBER] = {
+	NULL,
+	N_("Frequency [MHz]"),
+	N_("Mode"),
+	N_("Tone"),
+	N_("Name"),
+	N_("Tags"),
+	N_("Ch")
+};
+
+
+static GtkWidget    *dialog;
+static GtkWidget    *treeview;
+static GtkListStore *store;
+static GtkWidget    *lowentry;
+static GtkWidget    *highentry;
+static GtkWidget    *tagentry;
+static GtkWidget    *countlabel;
+static GtkWidget    *progress;
+static GtkWidget    *downbutton;
+static GtkWidget    *upbutton;
+static GtkWidget    *stopbutton;
+static gboolean      visible = FALSE;
+static guint         listgen = 0;     /*!< Generation of the memory the list was filled from. */
+static guint         timerid = 0;
+
+
+static GtkWidget *mem_create_filter   (void);
+static GtkWidget *mem_create_list     (void);
+static GtkWidget *mem_create_buttons  (void);
+static void       mem_window_destroy  (GtkWidget *widget, gpointer data);
+static void       mem_refresh         (void);
+static void       mem_find_cb         (GtkWidget *widget, gpointer data);
+static void       mem_activated_cb    (GtkTreeView *view, GtkTreePath *path,
+				       GtkTreeViewColumn *column, gpointer data);
+static void       mem_import_cb       (GtkWidget *widget, gpointer data);
+static void       mem_delete_cb       (GtkWidget *widget, gpointer data);
+static void       mem_download_cb     (GtkWidget *widget, gpointer data);
+static void       mem_upload_cb       (GtkWidget *widget, gpointer data);
+static void       mem_stop_cb         (GtkWidget *widget, gpointer data);
+static void       mem_save_cb         (GtkWidget *widget, gpointer data);
+static gboolean   mem_poll            (gpointer data);
+static GArray    *mem_get_indices     (gboolean selected);
+static freq_t     mem_entry_freq      (GtkWidget *entry, freq_t dflt);
+
+
+
+/** \brief Show the software memory window.
+ *
+ * The window is raised if it is already shown.
+ */
+void
+rig_gui_mem_show ()
+{
+	GtkWidget *vbox;
+	gchar     *title;
+
+
+	if (visible) {
+		gtk_window_present (GTK_WINDOW (dialog));
+		return;
+	}
+
+	vbox = gtk_vbox_new (FALSE, 5);
+	gtk_box_pack_start (GTK_BOX (vbox), mem_create_filter (), FALSE, FALSE, 0);
+	gtk_box_pack_start (GTK_BOX (vbox), mem_create_list (), TRUE, TRUE, 0);
+	gtk_box_pack_start (GTK_BOX (vbox), mem_create_buttons (), FALSE, FALSE, 0);
+
+	/* create dialog window */
+	title = g_strdup_printf (_("%s (Software Memory)"),
+				 gtk_window_get_title (GTK_WINDOW (grigapp)));
+	dialog = gtk_dialog_new_with_buttons (title,
+					      GTK_WINDOW (grigapp),
+					      GTK_DIALOG_DESTROY_WITH_PARENT,
+					      NULL);
+	g_free (title);
+
+	/* allow interaction with other windows */
+	gtk_window_set_modal (GTK_WINDOW (dialog), FALSE);
+
+	g_signal_connect (dialog, "destroy",
+			  G_CALLBACK (mem_window_destroy), NULL);
+
+	gtk_container_add (GTK_CONTAINER (GTK_DIALOG (dialog)->vbox), vbox);
+
+	visible = TRUE;
+
+	mem_refresh ();
+	mem_poll (NULL);
+
+	gtk_widget_show_all (dialog);
+
+	timerid = grig_latency_timeout_add (MEM_POLL_TVAL, mem_poll, NULL, "memory");
+}
+
+
+/** \brief Create the frequency range and tag entries. */
+static GtkWidget *
+mem_create_filter    ()
+{
+	GtkWidget *hbox;
+	GtkWidget *button;
+
+	lowentry = gtk_entry_new ();
+	gtk_entry_set_width_chars (GTK_ENTRY (lowentry), 12);
+	gtk_widget_set_tooltip_text (lowentry, _("Lowest frequency in MHz; empty for no limit"));
+
+	highentry = gtk_entry_new ();
+	gtk_entry_set_width_chars (GTK_ENTRY (highentry), 12);
+	gtk_widget_set_tooltip_text (highentry, _("Highest frequency in MHz; empty for no limit"));
+
+	tagentry = gtk_entry_new ();
+	gtk_entry_set_width_chars (GTK_ENTRY (tagentry), 12);
+	gtk_widget_set_tooltip_text (tagentry, _("Show only channels with this tag"));
+
+	button = gtk_button_new_from_stock (GTK_STOCK_FIND);
+
+	g_signal_connect (lowentry, "activate", G_CALLBACK (mem_find_cb), NULL);
+	g_signal_connect (highentry, "activate", G_CALLBACK (mem_find_cb), NULL);
+	g_signal_connect (tagentry, "activate", G_CALLBACK (mem_find_cb), NULL);
+	g_signal_connect (button, "clicked", G_CALLBACK (mem_find_cb), NULL);
+
+	hbox = gtk_hbox_new (FALSE, 5);
+	gtk_box_pack_start (GTK_BOX (hbox), gtk_label_new (_("From:")), FALSE, FALSE, 0);
+	gtk_box_pack_start (GTK_BOX (hbox), lowentry, FALSE, FALSE, 0);
+	gtk_box_pack_start (GTK_BOX (hbox), gtk_label_new (_("To:")), FALSE, FALSE, 0);
+	gtk_box_pack_start (GTK_BOX (hbox), highentry, FALSE, FALSE, 0);
+	gtk_box_pack_start (GTK_BOX (hbox), gtk_label_new (_("Tag:")), FALSE, FALSE, 0);
+	gtk_box_pack_start (GTK_BOX (hbox), tagentry, FALSE, FALSE, 0);
+	gtk_box_pack_start (GTK_BOX (hbox), button, FALSE, FALSE, 0);
+
+	return hbox;
+}
+
+
+/** \brief Create the channel list. */
+static GtkWidget *
+mem_create_list      ()
+{
+	GtkWidget         *swin;
+	GtkCellRenderer   *renderer;
+	GtkTreeViewColumn *column;
+	guint              i;
+
+
+	store = gtk_list_store_new (MEM_COL_NUMBER,
+				    G_TYPE_UINT,
+				    G_TYPE_STRING,
+				    G_TYPE_STRING,
+				    G_TYPE_STRING,
+				    G_TYPE_STRING,
+				    G_TYPE_STRING,
+				    G_TYPE_STRING);
+
+	treeview = gtk_tree_view_new_with_model (GTK_TREE_MODEL (store));
+	g_object_unref (store);
+
+	for (i = MEM_COL_FREQ; i < MEM_COL_NUMBER; i++) {
+		renderer = gtk_cell_renderer_text_new ();
+		column = gtk_tree_view_column_new_with_attributes (_(MEM_LIST_COL_TITLE[i]),
+								   renderer,
+								   "text", i,
+								   NULL);
+		gtk_tree_view_column_set_resizable (column, TRUE);
+		gtk_tree_view_insert_column (GTK_TREE_VIEW (treeview), column, -1);
+	}
+
+	gtk_tree_selection_set_mode (gtk_tree_view_get_selection (GTK_TREE_VIEW (treeview)),
+				     GTK_SELECTION_MULTIPLE);
+
+	g_signal_connect (treeview, "row-activated",
+			  G_CALLBACK (mem_activated_cb), NULL);
+
+	swin = gtk_scrolled_window_new (NULL, NULL);
+	gtk_scrolled_window_set_policy (GTK_SCROLLED_WINDOW (swin),
+					GTK_POLICY_AUTOMATIC,
+					GTK_POLICY_AUTOMATIC);
+	gtk_widget_set_size_request (swin, 600, 300);
+	gtk_container_add (GTK_CONTAINER (swin), treeview);
+
+	return swin;
+}
+
+
+/** \brief Create the progress bar and the buttons. */
+static GtkWidget *
+mem_create_buttons   ()
+{
+	GtkWidget *vbox;
+	GtkWidget *hbox;
+	GtkWidget *button;
+
+	countlabel = gtk_label_new (NULL);
+	gtk_misc_set_alignment (GTK_MISC (countlabel), 0.0, 0.5);
+
+	progress = gtk_progress_bar_new ();
+
+	hbox = gtk_hbox_new (FALSE, 5);
+	gtk_box_pack_start (GTK_BOX (hbox), countlabel, FALSE, FALSE, 0);
+	gtk_box_pack_start (GTK_BOX (hbox), progress, TRUE, TRUE, 0);
+
+	vbox = gtk_vbox_new (FALSE, 5);
+	gtk_box_pack_start (GTK_BOX (vbox), hbox, FALSE, FALSE, 0);
+
+	hbox = gtk_hbox_new (FALSE, 5);
+
+	button = gtk_button_new_with_mnemonic (_("_Import"));
+	gtk_widget_set_tooltip_text (button, _("Add the channels of a text file"));
+	g_signal_connect (button, "clicked", G_CALLBACK (mem_import_cb), NULL);
+	gtk_box_pack_start (GTK_BOX (hbox), button, FALSE, FALSE, 0);
+
+	button = gtk_button_new_from_stock (GTK_STOCK_DELETE);
+	gtk_widget_set_tooltip_text (button, _("Delete the selected channels"));
+	g_signal_connect (button, "clicked", G_CALLBACK (mem_delete_cb), NULL);
+	gtk_box_pack_start (GTK_BOX (hbox), button, FALSE, FALSE, 0);
+
+	downbutton = gtk_button_new_with_mnemonic (_("_Read Rig"));
+	gtk_widget_set_tooltip_text (downbutton, _("Read all memory channels of the rig"));
+	g_signal_connect (downbutton, "clicked", G_CALLBACK (mem_download_cb), NULL);
+	gtk_box_pack_start (GTK_BOX (hbox), downbutton, FALSE, FALSE, 0);
+
+	upbutton = gtk_button_new_with_mnemonic (_("_Write Rig"));
+	gtk_widget_set_tooltip_text (upbutton,
+				     _("Write the selected channels, or all listed channels, "\
+				       "to the memory channels of the rig"));
+	g_signal_connect (upbutton, "clicked", G_CALLBACK (mem_upload_cb), NULL);
+	gtk_box_pack_start (GTK_BOX (hbox), upbutton, FALSE, FALSE, 0);
+
+	stopbutton = gtk_button_new_from_stock (GTK_STOCK_STOP);
+	gtk_widget_set_tooltip_text (stopbutton, _("Stop the transfer"));
+	g_signal_connect (stopbutton, "clicked", G_CALLBACK (mem_stop_cb), NULL);
+	gtk_box_pack_start (GTK_BOX (hbox), stopbutton, FALSE, FALSE, 0);
+
+	button = gtk_button_new_from_stock (GTK_STOCK_SAVE);
+	gtk_widget_set_tooltip_text (button, _("Save the software memory"));
+	g_signal_connect (button, "clicked", G_CALLBACK (mem_save_cb), NULL);
+	gtk_box_pack_end (GTK_BOX (hbox), button, FALSE, FALSE, 0);
+
+	gtk_box_pack_start (GTK_BOX (vbox), hbox, FALSE, FALSE, 0);
+
+	return vbox;
+}
+
+
+/** \brief Stop polling when the window is closed.
+ *
+ * A transfer goes on without the window.
+ */
+static void
+mem_window_destroy   (GtkWidget *widget,
+		      gpointer   data)
+{
+	g_source_remove (timerid);
+	timerid = 0;
+
+	visible = FALSE;
+}
+
+
+/** \brief Fill the list with the channels matching the entries. */
+static void
+mem_refresh          ()
+{
+	rig_mem_chan_t  chan;
+	GtkTreeIter     iter;
+	guint          *found;
+	guint           count, i;
+	gchar          *freq, *tone, *tags, *number, *text;
+	freq_t          low, high;
+
+
+	low = mem_entry_freq (lowentry, 0.0);
+	high = mem_entry_freq (highentry, G_MAXDOUBLE);
+
+	count = rig_mem_find (low, high, gtk_entry_get_text (GTK_ENTRY (tagentry)),
+			      &found, &listgen);
+
+	/* detach the model so that the view is not updated for every row */
+	gtk_tree_view_set_model (GTK_TREE_VIEW (treeview), NULL);
+	gtk_list_store_clear (store);
+
+	for (i = 0; i < count; i++) {
+		/* changed meanwhile; the next poll refreshes again */
+		if (!rig_mem_get (found[i], listgen, &chan))
+			break;
+
+		freq = g_strdup_printf ("%.6f", chan.freq / 1.0e6);
+
+		if (chan.ctcss > 0)
+			tone = g_strdup_printf ("%.1f", chan.ctcss / 10.0);
+		else if (chan.dcs > 0)
+			tone = g_strdup_printf ("D%03u", chan.dcs);
+		else
+			tone = g_strdup ("");
+
+		number = (chan.number >= 0) ? g_strdup_printf ("%d", chan.number) : g_strdup ("");
+		tags = rig_mem_tags_to_string (chan.tags);
+
+		gtk_list_store_append (store, &iter);
+		gtk_list_store_set (store, &iter,
+				    MEM_COL_INDEX, found[i],
+				    MEM_COL_FREQ, freq,
+				    MEM_COL_MODE, (chan.mode != RIG_MODE_NONE) ? rig_strrmode (chan.mode) : "",
+				    MEM_COL_TONE, tone,
+				    MEM_COL_NAME, chan.name,
+				    MEM_COL_TAGS, tags,
+				    MEM_COL_CHANNEL, number,
+				    -1);
+
+		g_free (freq);
+		g_free (tone);
+		g_free (number);
+		g_free (tags);
+	}
+
+	gtk_tree_view_set_model (GTK_TREE_VIEW (treeview), GTK_TREE_MODEL (store));
+
+	text = g_strdup_printf (_("%u of %u channels"), count, rig_mem_count ());
+	gtk_label_set_text (GTK_LABEL (countlabel), text);
+	g_free (text);
+
+	g_free (found);
+}
+
+
+static void
+mem_find_cb          (GtkWidget *widget, gpointer data)
+{
+	mem_refresh ();
+}
+
+
+/** \brief Tune the rig to the activated channel. */
+static void
+mem_activated_cb     (GtkTreeView       *view,
+		      GtkTreePath       *path,
+		      GtkTreeViewColumn *column,
+		      gpointer           data)
+{
+	rig_mem_chan_t chan;
+	GtkTreeIter    iter;
+	guint          index;
+
+	if (!gtk_tree_model_get_iter (GTK_TREE_MODEL (store), &iter, path))
+		return;
+
+	gtk_tree_model_get (GTK_TREE_MODEL (store), &iter, MEM_COL_INDEX, &index, -1);
+
+	if (!rig_mem_get (index, listgen, &chan)) {
+		mem_refresh ();
+		return;
+	}
+
+	rig_data_set_freq (1, chan.freq);
+
+	if (chan.mode != RIG_MODE_NONE)
+		rig_data_set_mode (chan.mode);
+}
+
+
+/** \brief Import channels from a text file chosen by the user. */
+static void
+mem_import_cb        (GtkWidget *widget, gpointer data)
+{
+	GtkWidget *chooser;
+	gchar     *filename;
+
+	chooser = gtk_file_chooser_dialog_new (_("Import Channels"),
+					       GTK_WINDOW (dialog),
+					       GTK_FILE_CHOOSER_ACTION_OPEN,
+					       GTK_STOCK_CANCEL, GTK_RESPONSE_CANCEL,
+					       GTK_STOCK_OPEN, GTK_RESPONSE_ACCEPT,
+					       NULL);
+
+	if (gtk_dialog_run (GTK_DIALOG (chooser)) == GTK_RESPONSE_ACCEPT) {
+		filename = gtk_file_chooser_get_filename (GTK_FILE_CHOOSER (chooser));
+
+		rig_mem_import (filename);
+		mem_refresh ();
+
+		g_free (filename);
+	}
+
+	gtk_widget_destroy (chooser);
+}
+
+
+/** \brief Delete the selected channels. */
+static void
+mem_delete_cb        (GtkWidget *widget, gpointer data)
+{
+	GArray *indices;
+
+	indices = mem_get_indices (TRUE);
+	rig_mem_remove ((guint *) indices->data, indices->len, listgen);
+	g_array_free (indices, TRUE);
+
+	mem_refresh ();
+}
+
+
+static void
+mem_download_cb      (GtkWidget *widget, gpointer data)
+{
+	if (rig_mem_download ())
+		mem_poll (NULL);
+}
+
+
+/** \brief Write the selected or all listed channels to the rig. */
+static void
+mem_upload_cb        (GtkWidget *widget, gpointer data)
+{
+	GArray *indices;
+
+	indices = mem_get_indices (TRUE);
+
+	if (indices->len == 0) {
+		g_array_free (indices, TRUE);
+		indices = mem_get_indices (FALSE);
+	}
+
+	if (rig_mem_upload ((guint *) indices->data, indices->len, listgen))
+		mem_poll (NULL);
+	else if (rig_mem_generation () != listgen)
+		mem_refresh ();
+
+	g_array_free (indices, TRUE);
+}
+
+
+static void
+mem_stop_cb          (GtkWidget *widget, gpointer data)
+{
+	rig_mem_transfer_stop ();
+	mem_poll (NULL);
+}
+
+
+static void
+mem_save_cb          (GtkWidget *widget, gpointer data)
+{
+	rig_mem_save ();
+}
+
+
+/** \brief Show the progress of the transfer.
+ *  \param data Unused.
+ *  \return Always TRUE to keep the timeout running.
+ */
+static gboolean
+mem_poll             (gpointer data)
+{
+	gboolean  running;
+	guint     done, total, failed;
+	gchar    *text;
+
+	running = rig_mem_transfer_running (&done, &total, &failed);
+
+	gtk_widget_set_sensitive (downbutton, !running);
+	gtk_widget_set_sensitive (upbutton, !running);
+	gtk_widget_set_sensitive (stopbutton, running);
+
+	if (total > 0) {
+		gtk_progress_bar_set_fraction (GTK_PROGRESS_BAR (progress), (gdouble) done / total);
+
+		text = g_strdup_printf (running ? _("%u of %u channels, %u failed") :
+					_("Done: %u of %u channels, %u failed"),
+					done, total, failed);
+		gtk_progress_bar_set_text (GTK_PROGRESS_BAR (progress), text);
+		g_free (text);
+	}
+
+	/* e.g. downloaded channels have been merged */
+	if (rig_mem_generation () != listgen)
+		mem_refresh ();
+
+	return TRUE;
+}
+
+
+/** \brief Get the memory indices of the selected or all listed channels.
+ *  \return Newly allocated array of guint.
+ */
+static GArray *
+mem_get_indices      (gboolean selected)
+{
+	GtkTreeSelection *selection;
+	GtkTreeIter       iter;
+	GArray           *indices;
+	gboolean          valid;
+	guint             index;
+
+	indices = g_array_new (FALSE, FALSE, sizeof (guint));
+	selection = gtk_tree_view_get_selection (GTK_TREE_VIEW (treeview));
+
+	valid = gtk_tree_model_get_iter_first (GTK_TREE_MODEL (store), &iter);
+
+	while (valid) {
+		if (!selected || gtk_tree_selection_iter_is_selected (selection, &iter)) {
+			gtk_tree_model_get (GTK_TREE_MODEL (store), &iter, MEM_COL_INDEX, &index, -1);
+			g_array_append_val (indices, index);
+		}
+
+		valid = gtk_tree_model_iter_next (GTK_TREE_MODEL (store), &iter);
+	}
+
+	return indices;
+}
+
+
+/** \brief Read a frequency in MHz from an entry.
+ *  \param entry The entry.
+ *  \param dflt The frequency to use if the entry is empty or invalid [Hz].
+ *  \return The frequency [Hz].
+ */
+static freq_t
+mem_entry_freq       (GtkWidget *entry, freq_t dflt)
+{
+	const gchar *text = gtk_entry_get_text (GTK_ENTRY (entry));
+	gchar       *end;
+	gdouble      mhz;
+
+	mhz = g_ascii_strtod (text, &end);
+
+	if ((end == text) || (*end != '\0'))
+		return dflt;
+
+	return 1.0e6 * mhz;
+}
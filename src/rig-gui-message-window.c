@@ -30,38 +30,32 @@
  
 */
 #include <stdarg.h>
+#include <string.h>
 #include <time.h>
 #include <gtk/gtk.h>
 #include <glib/gi18n.h>
 #include <glib/gprintf.h>
 #include <hamlib/rig.h>
 #include "grig-debug.h"
+#include "grig-latency.h"
+#include "rig-gui-log-model.h"
 #include "rig-gui-message-window.h"
 
 
-/* define message level type for convenience */
-typedef enum rig_debug_level_e level_t;
+/* interval for checking the log model for new lines [msec] */
+#define MSG_WIN_POLL_TVAL   250
 
-/* columns in the message list */
-typedef enum {
-	MSG_LIST_COL_TIME = 0,
-	MSG_LIST_COL_SOURCE,
-	MSG_LIST_COL_LEVEL,
-	MSG_LIST_COL_MSG,
-	MSG_LIST_COL_NUMBER
-} msg_list_col_t;
+/* above this many new lines the view is detached while the model
+   is updated instead of inserting the rows one by one */
+#define MSG_WIN_MAX_INSERT  5000
 
-
-/* data structure to hold one message */
-typedef struct {
-	time_t    time;     /* time stamp */
-	level_t   level;    /* debug level */
-	gchar    *message;  /* the message itself */
-} message_t;
+/* delay between the last key stroke in the search entry and
+   applying the filter [msec] */
+#define MSG_WIN_FILTER_TVAL 150
 
 
 /* Easy access to column titles */
-const gchar *MSG_LIST_COL_TITLE[MSG_LIST_COL_NUMBER] = {
+const gchar *MSG_LIST_COL_TITLE[GRIG_LOG_COL_NUMBER] = {
 	N_("Time"),
 	N_("Source"),
 	N_("Level"),
@@ -69,18 +63,47 @@ const gchar *MSG_LIST_COL_TITLE[MSG_LIST_COL_NUMBER] = {
 };
 
 
-const gfloat MSG_LIST_COL_TITLE_ALIGN[MSG_LIST_COL_NUMBER] = {
+const gfloat MSG_LIST_COL_TITLE_ALIGN[GRIG_LOG_COL_NUMBER] = {
 	0.5, 0.0, 0.5, 0.0
 };
 
+/* Initial column widths; columns have fixed size so that rows need not
+   be measured (see create_message_list) */
+const gint MSG_LIST_COL_WIDTH[GRIG_LOG_COL_NUMBER] = {
+	150, 70, 70, 600
+};
+
+
+/* Entries of the level filter and the corresponding level masks */
+#define MSG_FILTER_LEVELS 7
+
+const gchar *MSG_FILTER_LEVEL_TITLE[MSG_FILTER_LEVELS] = {
+	N_("All levels"),
+	N_("Bug"),
+	N_("Error"),
+	N_("Warning"),
+	N_("Verbose"),
+	N_("Trace"),
+	N_("Warning and worse")
+};
+
+const guint MSG_FILTER_LEVEL_MASK[MSG_FILTER_LEVELS] = {
+	0,
+	1 << RIG_DEBUG_BUG,
+	1 << RIG_DEBUG_ERR,
+	1 << RIG_DEBUG_WARN,
+	1 << RIG_DEBUG_VERBOSE,
+	1 << RIG_DEBUG_TRACE,
+	(1 << RIG_DEBUG_BUG) | (1 << RIG_DEBUG_ERR) | (1 << RIG_DEBUG_WARN)
+};
+
 
-const gchar *DEBUG_STR[6] = {
-	N_("NONE"),
-	N_("BUG"),
-	N_("ERROR"),
-	N_("WARNING"),
-	N_("DEBUG"),
-	N_("TRACE")
+/* Entries of the source filter; entry N > 0 selects source N-1 */
+const gchar *MSG_FILTER_SOURCE_TITLE[GRIG_LOG_SRC_NUMBER + 1] = {
+	N_("All sources"),
+	N_("Hamlib"),
+	N_("Grig"),
+	N_("Other")
 };
 
 
@@ -89,16 +112,6 @@ extern GtkWidget    *grigapp;
 static gboolean visible     = FALSE;   /* Is message window visible? */
 static gboolean initialised = FALSE;   /* Is module initialised? */
 
-/* counters */
-static guint32  bugs        = 0;       /* Number of bug messages */    
-static guint32  errors      = 0;       /* Number of error messages */
-static guint32  warnings    = 0;       /* Number of warning messages */
-static guint32  verboses    = 0;       /* Number of verbose messages */
-static guint32  traces      = 0;       /* Number of trace messages */
-static guint32  hamlibs     = 0;       /* Number of messages from hamlib */
-static guint32  grigs       = 0;       /* Number of messages from grig */
-static guint32  others      = 0;       /* Number of messages from other sources */
-
 /* summary labels; they need to be accessible at runtime */
 static GtkWidget *buglabel,*errlabel,*warnlabel,*verblabel,*tracelabel,*sumlabel;
 static GtkWidget *hamliblabel, *griglabel, *otherlabel;
@@ -107,8 +120,20 @@ static GtkWidget *hamliblabel, *griglabel, *otherlabel;
 static GtkWidget *window;
 
 
-/* the tree view model */
-GtkTreeModel      *model;
+/* the tree view and the model showing the log file */
+static GtkWidget    *treeview;
+static GrigLogModel *model = NULL;
+
+/* timer checking the model for new lines */
+static guint         polltimer = 0;
+
+/* filter widgets and the active filter */
+static GtkWidget         *filterentry;
+static GtkWidget         *levelcombo;
+static GtkWidget         *sourcecombo;
+static GtkWidget         *matchlabel;
+static grig_log_filter_t  filter = { 0, 0, NULL };
+static guint              filtertimer = 0;
 
 
 static void message_window_destroy  (GtkWidget *, gpointer);
@@ -116,18 +141,22 @@ static void message_window_response (GtkWidget *, gint, gpointer);
 
 /* message list and tree widget functions */
 static GtkWidget    *create_message_list    (void);
-static GtkTreeModel *create_list_model      (void);
+static GtkWidget    *create_message_filter  (void);
 static GtkWidget    *create_message_summary (void);
+static void          update_message_summary (void);
 
 /* load debug file related */
-static void load_debug_file    (void);
-static int  read_debug_file    (const gchar *filename);
-static void clear_message_list (void);
-
-static void add_debug_message (const gchar *datetime,
-			       const gchar *source,
-			       enum rig_debug_level_e debug_level,
-			       const char *message);
+static void     load_debug_file    (void);
+static int      read_debug_file    (const gchar *filename);
+static void     clear_message_list (void);
+static void     set_log_model      (GrigLogModel *newmodel);
+static gboolean message_list_poll  (gpointer data);
+
+/* filter related */
+static void     filter_text_changed (GtkWidget *widget, gpointer data);
+static void     filter_combo_changed (GtkWidget *widget, gpointer data);
+static gboolean filter_timeout      (gpointer data);
+static void     apply_filter        (void);
 
 /* Initialise message window.
  *
@@ -139,15 +168,24 @@ void
 rig_gui_message_window_init  ()
 {
 	GtkWidget *hbox;
+	GtkWidget *vbox;
+	gchar     *logfile;
 
 	if (!initialised) {
 
-		/* do some init stuff */
 
+		/* filter bar above the message list */
+		vbox = gtk_vbox_new (FALSE, 5);
+		gtk_box_pack_start (GTK_BOX (vbox),
+				    create_message_filter (),
+				    FALSE, FALSE, 0);
+		gtk_box_pack_start (GTK_BOX (vbox),
+				    create_message_list (),
+				    TRUE, TRUE, 0);
 
 		hbox = gtk_hbox_new (FALSE, 10);
 		gtk_box_pack_start (GTK_BOX (hbox),
-					     create_message_list (),
+					     vbox,
 					     TRUE,
 					     TRUE,
 					     0);
@@ -185,6 +223,15 @@ rig_gui_message_window_init  ()
 		g_signal_connect (G_OBJECT (window), "destroy",
 				  G_CALLBACK (message_window_destroy), NULL);
 
+		/* follow the active log file, if any */
+		logfile = grig_debug_get_log_file ();
+		if (logfile != NULL) {
+			read_debug_file (logfile);
+			g_free (logfile);
+		}
+
+		polltimer = grig_latency_timeout_add (MSG_WIN_POLL_TVAL, message_list_poll,
+						      NULL, "msgwin-poll");
 
 		initialised = TRUE;
 	}
@@ -246,100 +293,163 @@ rig_gui_message_window_hide  ()
 
 
 
-/** \brief Add a message to message list */
+/** \brief Update the summary labels from the model counters. */
 static void
-add_debug_message (const gchar *datetime,
-		   const gchar *source,
-		   enum rig_debug_level_e debug_level,
-		   const char *message)
+update_message_summary ()
 {
-	guint        total;     /* totalt number of messages */
-	gchar       *str;       /* string to show message count */
-	GtkTreeIter  item;      /* new item added to the list store */
-
-
-	gtk_list_store_append (GTK_LIST_STORE (model), &item);
-	gtk_list_store_set (GTK_LIST_STORE (model), &item,
-			    MSG_LIST_COL_TIME, datetime,
-			    MSG_LIST_COL_SOURCE, source,
-			    MSG_LIST_COL_LEVEL, _(DEBUG_STR[debug_level]),
-			    MSG_LIST_COL_MSG, message,
-			    -1);
-
-	/* increment source counter */
-	if (!g_ascii_strcasecmp (source, "HAMLIB")) {
-		hamlibs++;
-		str = g_strdup_printf ("%d", hamlibs);
-		gtk_label_set_text (GTK_LABEL (hamliblabel), str);
-		g_free (str);
-	}
-	else if (!g_ascii_strcasecmp (source, "GRIG")) {
-		grigs++;
-		str = g_strdup_printf ("%d", grigs);
-		gtk_label_set_text (GTK_LABEL (griglabel), str);
-		g_free (str);
+	grig_log_counts_t counts;
+	guint             total = 0;    /* totalt number of messages */
+	gchar            *str;          /* string to show message count */
+	guint             i;
+
+	if (model != NULL) {
+		grig_log_model_get_counts (model, &counts);
 	}
 	else {
-		others++;
-		str = g_strdup_printf ("%d", others);
-		gtk_label_set_text (GTK_LABEL (otherlabel), str);
-		g_free (str);
+		memset (&counts, 0, sizeof (counts));
 	}
 
+	str = g_strdup_printf ("%d", counts.hamlib);
+	gtk_label_set_text (GTK_LABEL (hamliblabel), str);
+	g_free (str);
 
-	/* increment severity counter */
-	switch (debug_level) {
-		
-		/* internal bugs */
-	case RIG_DEBUG_BUG:
-		bugs++;
-		str = g_strdup_printf ("%d", bugs);
-		gtk_label_set_text (GTK_LABEL (buglabel), str);
-		g_free (str);
-		break;
+	str = g_strdup_printf ("%d", counts.grig);
+	gtk_label_set_text (GTK_LABEL (griglabel), str);
+	g_free (str);
 
-		/* runtime error */
-	case RIG_DEBUG_ERR:
-		errors++;
-		str = g_strdup_printf ("%d", errors);
-		gtk_label_set_text (GTK_LABEL (errlabel), str);
-		g_free (str);
-		break;
+	str = g_strdup_printf ("%d", counts.other);
+	gtk_label_set_text (GTK_LABEL (otherlabel), str);
+	g_free (str);
 
-		/* warning */
-	case RIG_DEBUG_WARN:
-		warnings++;
-		str = g_strdup_printf ("%d", warnings);
-		gtk_label_set_text (GTK_LABEL (warnlabel), str);
-		g_free (str);
-		break;
+	str = g_strdup_printf ("%d", counts.level[RIG_DEBUG_BUG]);
+	gtk_label_set_text (GTK_LABEL (buglabel), str);
+	g_free (str);
 
-		/* verbose info */
-	case RIG_DEBUG_VERBOSE:
-		verboses++;
-		str = g_strdup_printf ("%d", verboses);
-		gtk_label_set_text (GTK_LABEL (verblabel), str);
-		g_free (str);
-		break;
+	str = g_strdup_printf ("%d", counts.level[RIG_DEBUG_ERR]);
+	gtk_label_set_text (GTK_LABEL (errlabel), str);
+	g_free (str);
 
-		/* trace */
-	case RIG_DEBUG_TRACE:
-		traces++;
-		str = g_strdup_printf ("%d", traces);
-		gtk_label_set_text (GTK_LABEL (tracelabel), str);
-		g_free (str);
-		break;
+	str = g_strdup_printf ("%d", counts.level[RIG_DEBUG_WARN]);
+	gtk_label_set_text (GTK_LABEL (warnlabel), str);
+	g_free (str);
 
-	default:
-		break;
-	}
+	str = g_strdup_printf ("%d", counts.level[RIG_DEBUG_VERBOSE]);
+	gtk_label_set_text (GTK_LABEL (verblabel), str);
+	g_free (str);
+
+	str = g_strdup_printf ("%d", counts.level[RIG_DEBUG_TRACE]);
+	gtk_label_set_text (GTK_LABEL (tracelabel), str);
+	g_free (str);
+
+	for (i = RIG_DEBUG_BUG; i <= RIG_DEBUG_TRACE; i++)
+		total += counts.level[i];
 
-	/* the sum does not have to be updated for each line */
-	total = bugs+errors+warnings+verboses+traces;
 	str = g_strdup_printf ("<b>%d</b>", total);
 	gtk_label_set_markup (GTK_LABEL (sumlabel), str);
 	g_free (str);
 
+	/* rows shown with the current filter */
+	if (model != NULL) {
+		str = g_strdup_printf (_("%d of %d messages"),
+				       gtk_tree_model_iter_n_children (GTK_TREE_MODEL (model), NULL),
+				       grig_log_model_get_n_lines (model));
+	}
+	else {
+		str = g_strdup_printf (_("%d of %d messages"), 0, 0);
+	}
+	gtk_label_set_text (GTK_LABEL (matchlabel), str);
+	g_free (str);
+}
+
+
+/** \brief Show new lines from the log model.
+ *
+ * This function is called periodically to move lines indexed by the
+ * log model into the view. Small batches are inserted row by row; for
+ * large batches, e.g. while a big file is being loaded, the model is
+ * detached from the view during the update, which is much faster. If the
+ * view was scrolled to the end it follows the new lines, otherwise the
+ * first visible row is kept.
+ */
+static gboolean
+message_list_poll (gpointer data)
+{
+	GtkAdjustment *adj;
+	GtkTreePath   *first = NULL;
+	GtkTreePath   *last;
+	guint          pending;
+	gint           rows;
+	gboolean       atend;
+
+	if (!visible || (model == NULL))
+		return TRUE;
+
+	/* log file rotated or truncated; start over */
+	if (grig_log_model_needs_reload (model)) {
+		set_log_model (grig_log_model_new (grig_log_model_get_filename (model), FALSE));
+		return TRUE;
+	}
+
+	pending = grig_log_model_get_pending (model);
+	if (pending == 0)
+		return TRUE;
+
+	adj = gtk_tree_view_get_vadjustment (GTK_TREE_VIEW (treeview));
+	atend = (adj->value >= adj->upper - adj->page_size - 1.0);
+
+	if (pending > MSG_WIN_MAX_INSERT) {
+
+		if (!atend)
+			gtk_tree_view_get_visible_range (GTK_TREE_VIEW (treeview), &first, NULL);
+
+		g_object_ref (model);
+		gtk_tree_view_set_model (GTK_TREE_VIEW (treeview), NULL);
+		grig_log_model_update (model, FALSE);
+		gtk_tree_view_set_model (GTK_TREE_VIEW (treeview), GTK_TREE_MODEL (model));
+		g_object_unref (model);
+
+		if (first != NULL) {
+			gtk_tree_view_scroll_to_cell (GTK_TREE_VIEW (treeview), first,
+						      NULL, TRUE, 0.0, 0.0);
+			gtk_tree_path_free (first);
+		}
+	}
+	else {
+		grig_log_model_update (model, TRUE);
+	}
+
+	rows = gtk_tree_model_iter_n_children (GTK_TREE_MODEL (model), NULL);
+	if (atend && (rows > 0)) {
+		last = gtk_tree_path_new_from_indices (rows - 1, -1);
+		gtk_tree_view_scroll_to_cell (GTK_TREE_VIEW (treeview), last,
+					      NULL, FALSE, 0.0, 0.0);
+		gtk_tree_path_free (last);
+	}
+
+	update_message_summary ();
+
+	return TRUE;
+}
+
+
+/** \brief Replace the model shown in the message list.
+ *  \param newmodel The new model; the message list takes the reference.
+ *
+ * The active filter is carried over to the new model.
+ */
+static void
+set_log_model (GrigLogModel *newmodel)
+{
+	grig_log_model_set_filter (newmodel, &filter);
+
+	gtk_tree_view_set_model (GTK_TREE_VIEW (treeview), GTK_TREE_MODEL (newmodel));
+
+	if (model != NULL)
+		g_object_unref (model);
+
+	model = newmodel;
+
+	update_message_summary ();
 }
 
 
@@ -351,7 +461,23 @@ message_window_destroy    (GtkWidget *widget,
 			   gpointer   data)
 {
 	/* clean up memory */
-	/* GSList, ... */
+	if (polltimer != 0) {
+		g_source_remove (polltimer);
+		polltimer = 0;
+	}
+
+	if (filtertimer != 0) {
+		g_source_remove (filtertimer);
+		filtertimer = 0;
+	}
+
+	g_free (filter.text);
+	filter.text = NULL;
+
+	if (model != NULL) {
+		g_object_unref (model);
+		model = NULL;
+	}
 
 	visible = FALSE;
 	initialised = FALSE;
@@ -413,8 +539,6 @@ load_debug_file ()
 
 	if (gtk_dialog_run (GTK_DIALOG (dialog)) == GTK_RESPONSE_ACCEPT) {
 
-		clear_message_list ();
-
 		filename = gtk_file_chooser_get_filename (GTK_FILE_CHOOSER (dialog));
 
 		/* sanity check of filename will be performed 
@@ -429,96 +553,26 @@ load_debug_file ()
 }
 
 
-/** \brief Read contents of debug file. */
+/** \brief Read contents of debug file.
+ *
+ * The file is indexed in the background and shown as it is being indexed.
+ * New lines appended to the file later on will show up as well.
+ */
 static int
 read_debug_file (const gchar *filename)
 {
-	GIOChannel  *logfile = NULL;   /* the log file */
-	GError      *error = NULL;     /* error structure */
-	gint         errorcode = 0;    /* error code returned by function */
-	gchar       *line;             /* line read from file */
-	gsize        length;           /* length of line read from file */
-	gchar      **buff;
-
-
-	/* check file and read contents */
-	if (g_file_test (filename, G_FILE_TEST_EXISTS)) {
-
-		/* open file */
-		logfile = g_io_channel_new_file (filename, "r", &error);
-
-		if (logfile) {
-			/* read the file line by line */
-			while (g_io_channel_read_line (logfile,
-						       &line,
-						       &length,
-						       NULL,
-						       NULL) != G_IO_STATUS_EOF) {
-
-				/* trim line and split it */
-				line = g_strdelimit (line, "\n", '\0');
-
-				buff = g_strsplit (line,
-						   GRIG_DEBUG_SEPARATOR,
-						   MSG_LIST_COL_NUMBER);
-
-				/* buff[0] = date and time
-				   buff[1] = source
-				   buff[2] = level
-				   buff[3] = message
-				   unless it comes from Gtk+/Glib, in which case
-				   buff[0] contains the message and it is the
-				   only element
-				*/
-				switch (g_strv_length (buff)) {
-
-				case 1:
-					add_debug_message ("", _("SYS"), RIG_DEBUG_ERR, buff[0]);
-					break;
-
-				case 4:
-					add_debug_message (buff[0], buff[1],
-							   (guint) g_ascii_strtod (buff[2], NULL),
-							   buff[3]);
-					break;
-				default:
-					add_debug_message ("", _("GRIG"), RIG_DEBUG_ERR,
-							   _("Log file seems corrupt"));
-					break;
-				}
-
-				/* clean up */
-				g_free (line);
-				g_strfreev (buff);
-			}
-
-			errorcode = 0;
-
-			/* Close IO chanel; don't care about status.
-			   Shutdown will flush the stream and close the channel
-			   as soon as the reference count is dropped. Order matters!
-			*/
-			g_io_channel_shutdown (logfile, TRUE, NULL);
-			g_io_channel_unref (logfile);
-
-		}
-		else {
-			/* an error occured */
-
-			grig_debug_local (RIG_DEBUG_ERR,
-					  _("%s:%d: Error open debug log (%s)"),
-					  __FILE__, __LINE__, error->message);
+	if (!g_file_test (filename, G_FILE_TEST_IS_REGULAR)) {
 
-			g_clear_error (&error);
+		grig_debug_local (RIG_DEBUG_ERR,
+				  _("%s:%d: Error open debug log (%s)"),
+				  __FILE__, __LINE__, filename);
 
-			errorcode = 1;
-		}
-	}
-	else {
-		errorcode = 1;
+		return 1;
 	}
 
-	return errorcode;
+	set_log_model (grig_log_model_new (filename, FALSE));
+
+	return 0;
 }
 
 
@@ -526,33 +580,18 @@ read_debug_file (const gchar *filename)
  *
  * Besides clearing the message list, the function also resets
  * the counters and set the text of the corresponding widgets
- * to zero.
+ * to zero. If a log file is shown, new lines appended to it will
+ * continue to show up.
  */
 static void
 clear_message_list ()
 {
-	/* clear the meaase list */
-	gtk_list_store_clear (GTK_LIST_STORE (model));
-
-	/* reset the counters and text widgets */
-	bugs = 0;
-	errors = 0;
-	warnings = 0;
-	verboses = 0;
-	traces = 0;
-	grigs = 0;
-	hamlibs = 0;
-	others = 0;
-
-	gtk_label_set_text (GTK_LABEL (buglabel), "0");
-	gtk_label_set_text (GTK_LABEL (errlabel), "0");
-	gtk_label_set_text (GTK_LABEL (warnlabel), "0");
-	gtk_label_set_text (GTK_LABEL (verblabel), "0");
-	gtk_label_set_text (GTK_LABEL (tracelabel), "0");
-	gtk_label_set_text (GTK_LABEL (hamliblabel), "0");
-	gtk_label_set_text (GTK_LABEL (griglabel), "0");
-	gtk_label_set_text (GTK_LABEL (otherlabel), "0");
-	gtk_label_set_markup (GTK_LABEL (sumlabel), "<b>0</b>");
+	const gchar *filename = NULL;
+
+	if (model != NULL)
+		filename = grig_log_model_get_filename (model);
+
+	set_log_model (grig_log_model_new (filename, TRUE));
 }
 
 
@@ -561,9 +600,6 @@ clear_message_list ()
 static GtkWidget *
 create_message_list    ()
 {
-	/* high level treev iew widget */
-	GtkWidget *treeview;
-
 	/* scrolled window containing the tree view */
 	GtkWidget *swin;
 
@@ -579,7 +615,7 @@ create_message_list    ()
 
 	treeview = gtk_tree_view_new ();
 
-	for (i = 0; i < MSG_LIST_COL_NUMBER; i++) {
+	for (i = 0; i < GRIG_LOG_COL_NUMBER; i++) {
 
 		renderer = gtk_cell_renderer_text_new ();
 		column = gtk_tree_view_column_new_with_attributes (_(MSG_LIST_COL_TITLE[i]),
@@ -593,12 +629,19 @@ create_message_list    ()
 		/* only aligns the headers? */
 		gtk_tree_view_column_set_alignment (column, MSG_LIST_COL_TITLE_ALIGN[i]);
 
+		gtk_tree_view_column_set_sizing (column, GTK_TREE_VIEW_COLUMN_FIXED);
+		gtk_tree_view_column_set_fixed_width (column, MSG_LIST_COL_WIDTH[i]);
+		gtk_tree_view_column_set_resizable (column, TRUE);
+
 	}
 
-	/* create tree view model and finalise tree view */
-	model = create_list_model ();
-	gtk_tree_view_set_model (GTK_TREE_VIEW (treeview), model);
-	g_object_unref (model);
+	/* all rows have the same height; saves measuring every row
+	   of large log files */
+	gtk_tree_view_set_fixed_height_mode (GTK_TREE_VIEW (treeview), TRUE);
+
+	/* create empty model and finalise tree view */
+	model = grig_log_model_new (NULL, FALSE);
+	gtk_tree_view_set_model (GTK_TREE_VIEW (treeview), GTK_TREE_MODEL (model));
 
 
 	/* treeview is packed into a scroleld window */
@@ -612,27 +655,133 @@ create_message_list    ()
 }
 
 
-/* create tree view model; we actually create a GtkListStore because we are
-   only interested in a flat list. A GtkListStore can be cast to a GtkTreeModel
-   without any problems.
-*/
-static GtkTreeModel *
-create_list_model ()
+/** \brief Create filter bar.
+ *
+ * The filter bar consists of a search entry, a level and a source
+ * selector and a label showing how many messages match the filter.
+ */
+static GtkWidget *
+create_message_filter ()
+{
+	GtkWidget *hbox;
+	GtkWidget *label;
+	guint      i;
+
+	filterentry = gtk_entry_new ();
+	gtk_widget_set_tooltip_text (filterentry,
+				     _("Show only messages containing this text"));
+	g_signal_connect (G_OBJECT (filterentry), "changed",
+			  G_CALLBACK (filter_text_changed), NULL);
+
+	levelcombo = gtk_combo_box_new_text ();
+	for (i = 0; i < MSG_FILTER_LEVELS; i++)
+		gtk_combo_box_append_text (GTK_COMBO_BOX (levelcombo),
+					   _(MSG_FILTER_LEVEL_TITLE[i]));
+	gtk_combo_box_set_active (GTK_COMBO_BOX (levelcombo), 0);
+	g_signal_connect (G_OBJECT (levelcombo), "changed",
+			  G_CALLBACK (filter_combo_changed), NULL);
+
+	sourcecombo = gtk_combo_box_new_text ();
+	for (i = 0; i <= GRIG_LOG_SRC_NUMBER; i++)
+		gtk_combo_box_append_text (GTK_COMBO_BOX (sourcecombo),
+					   _(MSG_FILTER_SOURCE_TITLE[i]));
+	gtk_combo_box_set_active (GTK_COMBO_BOX (sourcecombo), 0);
+	g_signal_connect (G_OBJECT (sourcecombo), "changed",
+			  G_CALLBACK (filter_combo_changed), NULL);
+
+	matchlabel = gtk_label_new (NULL);
+	gtk_misc_set_alignment (GTK_MISC (matchlabel), 1.0, 0.5);
+
+	hbox = gtk_hbox_new (FALSE, 5);
+	label = gtk_label_new (_("Search:"));
+	gtk_box_pack_start (GTK_BOX (hbox), label, FALSE, FALSE, 0);
+	gtk_box_pack_start (GTK_BOX (hbox), filterentry, TRUE, TRUE, 0);
+	gtk_box_pack_start (GTK_BOX (hbox), levelcombo, FALSE, FALSE, 0);
+	gtk_box_pack_start (GTK_BOX (hbox), sourcecombo, FALSE, FALSE, 0);
+	gtk_box_pack_start (GTK_BOX (hbox), matchlabel, FALSE, FALSE, 5);
+
+	return hbox;
+}
+
+
+/** \brief Search text changed.
+ *
+ * The filter is applied once the user has stopped typing for
+ * MSG_WIN_FILTER_TVAL milliseconds.
+ */
+static void
+filter_text_changed (GtkWidget *widget, gpointer data)
 {
-	GtkListStore *liststore;
+	if (filtertimer != 0)
+		g_source_remove (filtertimer);
 
-	liststore = gtk_list_store_new (MSG_LIST_COL_NUMBER,
-					G_TYPE_STRING,
-					G_TYPE_STRING,
-					G_TYPE_STRING,
-					G_TYPE_STRING);
+	filtertimer = grig_latency_timeout_add (MSG_WIN_FILTER_TVAL, filter_timeout,
+						NULL, "msgwin-filter");
+}
 
-	/*** Fill existing data into the list here ***/
 
-	return GTK_TREE_MODEL (liststore);
+/** \brief Level or source selection changed. */
+static void
+filter_combo_changed (GtkWidget *widget, gpointer data)
+{
+	apply_filter ();
 }
 
 
+/** \brief Apply the filter after the search text has settled. */
+static gboolean
+filter_timeout (gpointer data)
+{
+	filtertimer = 0;
+	apply_filter ();
+
+	return FALSE;
+}
+
+
+/** \brief Read the filter widgets and apply the filter to the model.
+ *
+ * The matching rows are looked up in the log index, so this is fast even
+ * for large files. The model is detached from the view while the rows
+ * are replaced.
+ */
+static void
+apply_filter ()
+{
+	GtkTreePath *last;
+	gint         level;
+	gint         source;
+	gint         rows;
+
+	level = gtk_combo_box_get_active (GTK_COMBO_BOX (levelcombo));
+	source = gtk_combo_box_get_active (GTK_COMBO_BOX (sourcecombo));
+
+	g_free (filter.text);
+	filter.text = g_strstrip (g_strdup (gtk_entry_get_text (GTK_ENTRY (filterentry))));
+	filter.levels = (level > 0) ? MSG_FILTER_LEVEL_MASK[level] : 0;
+	filter.sources = (source > 0) ? (1 << (source - 1)) : 0;
+
+	if (model == NULL)
+		return;
+
+	g_object_ref (model);
+	gtk_tree_view_set_model (GTK_TREE_VIEW (treeview), NULL);
+	grig_log_model_set_filter (model, &filter);
+	gtk_tree_view_set_model (GTK_TREE_VIEW (treeview), GTK_TREE_MODEL (model));
+	g_object_unref (model);
+
+	/* show the most recent matches */
+	rows = gtk_tree_model_iter_n_children (GTK_TREE_MODEL (model), NULL);
+	if (rows > 0) {
+		last = gtk_tree_path_new_from_indices (rows - 1, -1);
+		gtk_tree_view_scroll_to_cell (GTK_TREE_VIEW (treeview), last,
+					      NULL, FALSE, 0.0, 0.0);
+		gtk_tree_path_free (last);
+	}
+
+	update_message_summary ();
+}
+
 
 /* create summary */
 static GtkWidget *
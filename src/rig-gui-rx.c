@@ -52,6 +52,7 @@
 #include "rig-utils.h"
 #include "rig-gui-rx.h"
 #include "grig-debug.h"
+#include "grig-latency.h"
 #include "grig-menubar.h"
 
 /* defined in main.c */
@@ -72,6 +73,21 @@ static GtkWidget *dialog;
 static gboolean visible = FALSE;
 static guint timerid = 0;
 
+/** \brief Fields displayed in this window; polled at full rate while open. */
+static const rig_data_field_t RX_FIELDS[] = {
+	RIG_DATA_FIELD_AFG,
+	RIG_DATA_FIELD_RFG,
+	RIG_DATA_FIELD_SQL,
+	RIG_DATA_FIELD_IFS,
+	RIG_DATA_FIELD_APF,
+	RIG_DATA_FIELD_NR,
+	RIG_DATA_FIELD_NOTCH,
+	RIG_DATA_FIELD_PBTIN,
+	RIG_DATA_FIELD_PBTOUT,
+	RIG_DATA_FIELD_CWPITCH,
+	RIG_DATA_FIELD_BALANCE
+};
+
 /* controls */
 static GtkWidget *afs,*rfs,*ifs,*cwp,*pbti,*pbto,*apf,*nrs,*not,*sql,*bal;
 
@@ -90,6 +106,7 @@ rig_gui_rx_create ()
 {
 	GtkWidget *hbox;
 	gchar     *title;
+	guint      i;
 
 
 	if (visible) {
@@ -126,10 +143,15 @@ rig_gui_rx_create ()
 
 	visible = TRUE;
 
+	/* tell the daemon that we need these fields */
+	for (i = 0; i < G_N_ELEMENTS (RX_FIELDS); i++) {
+		rig_data_add_interest (RX_FIELDS[i]);
+	}
+
 	gtk_widget_show_all (dialog);
 
 	/* start callback */
-	timerid = g_timeout_add (1007, rx_levels_update, NULL);
+	timerid = grig_latency_timeout_add (1007, rx_levels_update, NULL, "rx-levels");
 }
 
 
@@ -152,12 +174,16 @@ static void
 rx_window_destroy    (GtkWidget *widget,
 		      gpointer   data)
 {
+	guint i;
 
 	/* stop callback */
 	g_source_remove (timerid);
 	timerid = 0;
 
 	/* clear rx-active flag in rig-data */
+	for (i = 0; i < G_N_ELEMENTS (RX_FIELDS); i++) {
+		rig_data_remove_interest (RX_FIELDS[i]);
+	}
 
 	visible = FALSE;
 
@@ -0,0 +1,653 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+    Grig:  Gtk+ user interface for the Hamradio Control Libraries.
+
+    Copyright (C)  2001-2007  Alexandru Csete.
+
+    Authors: Alexandru Csete <oz9aec@gmail.com>
+
+    Comments, questions and bugreports should be submitted via
+    http://sourceforge.net/projects/groundstation/
+    More details can be found at the project home page:
+
+            http://groundstation.sourceforge.net/
+ 
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+  
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+  
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, visit http://www.fsf.org/
+ 
+ 
+ 
+*/
+/** \file rig-gui-scope.c
+ *  \brief Band scope window.
+ *
+ * The band scope shows the signal strength around the tuned frequency,
+ * measured by band-scope sweeps of the scan engine (see rig-scan.h), for
+ * rigs without a scope of their own. The upper part shows the last sweep
+ * and the lower part a waterfall of the previous sweeps, newest on top.
+ *
+ * A sweep is decimated to one min/max pair per pixel column. The spectrum
+ * is drawn as one vertical line per column and the waterfall is kept in
+ * a server side pixmap used as a ring buffer of rows: each new sweep only
+ * uploads one row and the two parts of the ring are copied to the window
+ * on expose, so a sweep costs O(width) no matter how many rows are kept.
+ *
+ * When the primary rig streams the data of its own scope (see
+ * rig-spectrum.h), the scope lines are shown instead of sweeps. The ring
+ * is drained at the display rate and every line becomes a waterfall row,
+ * but the spectrum is only drawn once per frame.
+ */
+#include <string.h>
+#include <gtk/gtk.h>
+#include <glib/gi18n.h>
+#include <hamlib/rig.h>
+#include "grig-debug.h"
+#include "grig-latency.h"
+#include "grig-menubar.h"
+#include "rig-ctx.h"
+#include "rig-data.h"
+#include "rig-scan.h"
+#include "rig-spectrum.h"
+#include "rig-gui-scope.h"
+
+/* defined in main.c */
+extern GtkWidget *grigapp;
+
+
+#define SCOPE_POLL_TVAL    100    /*!< Interval for checking for new sweeps [msec]. */
+#define SCOPE_FRAME_TVAL   40     /*!< Interval for draining scope lines [msec]. */
+#define SCOPE_WIDTH        500    /*!< Initial width of the scope. */
+#define SCOPE_SPEC_HEIGHT  120    /*!< Height of the spectrum. */
+#define SCOPE_WF_HEIGHT    200    /*!< Initial height of the waterfall. */
+#define SCOPE_MIN_DB       -60    /*!< Bottom of the scale [dB rel. S9]. */
+#define SCOPE_MAX_DB       40     /*!< Top of the scale [dB rel. S9]. */
+
+
+/** \brief Selectable spans [kHz]. */
+static const gint SCOPE_SPANS[] = { 10, 25, 50, 100, 250, 500, 1000 };
+
+/** \brief Selectable number of points per sweep. */
+static const gint SCOPE_POINTS[] = { 50, 100, 250, 500, 1000 };
+
+
+static GtkWidget *dialog;
+static GtkWidget *canvas;
+static GtkWidget *info;
+static GtkWidget *spancombo;
+static GtkWidget *pointscombo;
+static gboolean   visible = FALSE;
+static guint      timerid = 0;
+
+static GdkGC     *gc = NULL;         /*!< Graphics context of the canvas. */
+static GdkPixmap *spectrum = NULL;   /*!< The last sweep. */
+static GdkPixmap *waterfall = NULL;  /*!< Ring buffer of waterfall rows. */
+static gint       width = 0;         /*!< Width of the canvas. */
+static gint       rows = 0;          /*!< Height of the waterfall. */
+static gint       head = 0;          /*!< Waterfall row of the newest sweep. */
+static gint      *colmin = NULL;     /*!< Weakest level in each column. */
+static gint      *colmax = NULL;     /*!< Strongest level in each column. */
+static guchar    *rowbuf = NULL;     /*!< RGB pixels of a new waterfall row. */
+static guchar     palette[256][3];   /*!< Waterfall colours from weak to strong. */
+static rig_scan_sweep_t sweep;       /*!< The last sweep received. */
+static gboolean   streaming = FALSE; /*!< Showing the scope lines of the rig. */
+static gint       dbmin = SCOPE_MIN_DB;  /*!< Bottom of the scale [dB]. */
+static gint       dbmax = SCOPE_MAX_DB;  /*!< Top of the scale [dB]. */
+static rig_spectrum_line_t line;     /*!< Scope line taken from the ring. */
+
+
+static gint     scope_window_delete  (GtkWidget *widget, GdkEvent *event, gpointer data);
+static void     scope_window_destroy (GtkWidget *widget, gpointer data);
+static void     scope_settings_cb    (GtkComboBox *combo, gpointer data);
+static gboolean scope_configure_cb   (GtkWidget *widget, GdkEventConfigure *event, gpointer data);
+static gboolean scope_expose_cb      (GtkWidget *widget, GdkEventExpose *event, gpointer data);
+static gboolean scope_update         (gpointer data);
+static gboolean scope_update_stream  (void);
+static void     scope_take_line      (void);
+static void     scope_start          (void);
+static void     scope_init_palette   (void);
+static void     scope_decimate       (void);
+static void     scope_draw_spectrum  (void);
+static void     scope_add_row        (void);
+static gint     scope_level_to_y     (gint level);
+
+
+
+/** \brief Create the band scope window and start the sweeps.
+ *
+ * The scope lines of the rig are used instead of sweeps when they are
+ * available and the primary rig is selected.
+ */
+void
+rig_gui_scope_create ()
+{
+	GtkWidget *vbox;
+	GtkWidget *hbox;
+	gchar     *title;
+	gchar     *text;
+	guint      i;
+
+
+	if (visible) {
+		grig_debug_local (RIG_DEBUG_BUG,
+				  _("%s: Scope window already visible."),
+				  __FUNCTION__);
+
+		return;
+	}
+
+	scope_init_palette ();
+
+	/* drawing area; the pixmaps are created when its size is known */
+	canvas = gtk_drawing_area_new ();
+	gtk_widget_set_size_request (canvas, SCOPE_WIDTH,
+				     SCOPE_SPEC_HEIGHT + SCOPE_WF_HEIGHT);
+	g_signal_connect (canvas, "configure_event",
+			  G_CALLBACK (scope_configure_cb), NULL);
+	g_signal_connect (canvas, "expose_event",
+			  G_CALLBACK (scope_expose_cb), NULL);
+
+	/* settings */
+	spancombo = gtk_combo_box_new_text ();
+	for (i = 0; i < G_N_ELEMENTS (SCOPE_SPANS); i++) {
+		text = g_strdup_printf (_("%d kHz"), SCOPE_SPANS[i]);
+		gtk_combo_box_append_text (GTK_COMBO_BOX (spancombo), text);
+		g_free (text);
+	}
+	gtk_combo_box_set_active (GTK_COMBO_BOX (spancombo), 2);
+
+	pointscombo = gtk_combo_box_new_text ();
+	for (i = 0; i < G_N_ELEMENTS (SCOPE_POINTS); i++) {
+		text = g_strdup_printf (_("%d points"), SCOPE_POINTS[i]);
+		gtk_combo_box_append_text (GTK_COMBO_BOX (pointscombo), text);
+		g_free (text);
+	}
+	gtk_combo_box_set_active (GTK_COMBO_BOX (pointscombo), 1);
+
+	g_signal_connect (spancombo, "changed",
+			  G_CALLBACK (scope_settings_cb), NULL);
+	g_signal_connect (pointscombo, "changed",
+			  G_CALLBACK (scope_settings_cb), NULL);
+
+	info = gtk_label_new (NULL);
+	gtk_misc_set_alignment (GTK_MISC (info), 1.0, 0.5);
+
+	hbox = gtk_hbox_new (FALSE, 5);
+	gtk_box_pack_start (GTK_BOX (hbox), spancombo, FALSE, FALSE, 0);
+	gtk_box_pack_start (GTK_BOX (hbox), pointscombo, FALSE, FALSE, 0);
+	gtk_box_pack_start (GTK_BOX (hbox), info, TRUE, TRUE, 0);
+
+	vbox = gtk_vbox_new (FALSE, 5);
+	gtk_box_pack_start (GTK_BOX (vbox), canvas, TRUE, TRUE, 0);
+	gtk_box_pack_start (GTK_BOX (vbox), hbox, FALSE, FALSE, 0);
+
+	/* create dialog window */
+	title = g_strdup_printf (_("%s (Band Scope)"),
+				 gtk_window_get_title (GTK_WINDOW (grigapp)));
+	dialog = gtk_dialog_new_with_buttons (title,
+					      GTK_WINDOW (grigapp),
+					      GTK_DIALOG_DESTROY_WITH_PARENT,
+					      NULL);
+	g_free (title);
+
+	/* allow interaction with other windows */
+	gtk_window_set_modal (GTK_WINDOW (dialog), FALSE);
+
+	g_signal_connect (dialog, "delete_event",
+			  G_CALLBACK (scope_window_delete), NULL);
+	g_signal_connect (dialog, "destroy",
+			  G_CALLBACK (scope_window_destroy), NULL);
+
+	gtk_container_add (GTK_CONTAINER (GTK_DIALOG (dialog)->vbox), vbox);
+
+	visible = TRUE;
+
+	gtk_widget_show_all (dialog);
+
+	streaming = rig_spectrum_running () && (rig_ctx_get_selected () == 0);
+
+	if (streaming) {
+		/* the rig decides the span and the number of points */
+		gtk_widget_set_sensitive (spancombo, FALSE);
+		gtk_widget_set_sensitive (pointscombo, FALSE);
+		gtk_label_set_text (GTK_LABEL (info), _("Waiting for scope data"));
+
+		/* discard lines that are older than the window */
+		while (rig_spectrum_pop (&line));
+
+		timerid = grig_latency_timeout_add (SCOPE_FRAME_TVAL, scope_update, NULL, "scope");
+	}
+	else {
+		dbmin = SCOPE_MIN_DB;
+		dbmax = SCOPE_MAX_DB;
+
+		scope_start ();
+
+		timerid = grig_latency_timeout_add (SCOPE_POLL_TVAL, scope_update, NULL, "scope");
+	}
+}
+
+
+/** \brief Close the band scope window and stop the sweeps. */
+void
+rig_gui_scope_close ()
+{
+	if (!visible) {
+		grig_debug_local (RIG_DEBUG_BUG,
+				  _("%s: Scope window is not visible."),
+				  __FUNCTION__);
+
+		return;
+	}
+
+	gtk_widget_destroy (dialog);
+}
+
+
+static gint
+scope_window_delete  (GtkWidget *widget,
+		      GdkEvent  *event,
+		      gpointer   data)
+{
+
+	/* force menu item to unset */
+	grig_menubar_force_scope_item (FALSE);
+
+	/* return FALSE so that Gtk+ will emit the destroy signal */
+	return FALSE;
+}
+
+
+static void
+scope_window_destroy (GtkWidget *widget,
+		      gpointer   data)
+{
+	/* stop callback and sweeps */
+	g_source_remove (timerid);
+	timerid = 0;
+
+	if (!streaming) {
+		rig_scan_stop ();
+	}
+
+	if (gc != NULL) {
+		g_object_unref (gc);
+		gc = NULL;
+	}
+
+	if (spectrum != NULL) {
+		g_object_unref (spectrum);
+		spectrum = NULL;
+	}
+
+	if (waterfall != NULL) {
+		g_object_unref (waterfall);
+		waterfall = NULL;
+	}
+
+	g_free (colmin);
+	g_free (colmax);
+	g_free (rowbuf);
+	g_free (sweep.levels);
+	colmin = NULL;
+	colmax = NULL;
+	rowbuf = NULL;
+	memset (&sweep, 0, sizeof (rig_scan_sweep_t));
+	width = 0;
+
+	streaming = FALSE;
+	visible = FALSE;
+}
+
+
+/** \brief Restart the sweeps when the span or points are changed. */
+static void
+scope_settings_cb    (GtkComboBox *combo, gpointer data)
+{
+	scope_start ();
+}
+
+
+/** \brief Start sweeping with the selected span and points. */
+static void
+scope_start          ()
+{
+	gint span   = SCOPE_SPANS[gtk_combo_box_get_active (GTK_COMBO_BOX (spancombo))];
+	gint points = SCOPE_POINTS[gtk_combo_box_get_active (GTK_COMBO_BOX (pointscombo))];
+
+	if (rig_scan_sweep_start (1000.0 * span, points, RIG_SCAN_DEF_SETTLE)) {
+		gtk_label_set_text (GTK_LABEL (info), _("Waiting for the first sweep"));
+	}
+	else {
+		gtk_label_set_text (GTK_LABEL (info), _("The rig can not be swept"));
+	}
+
+	/* accept the next sweep even if it has the same number */
+	sweep.serial = 0;
+}
+
+
+/** \brief Create the pixmaps for the new size of the canvas.
+ *
+ * The waterfall history is cleared; the last sweep is drawn again.
+ */
+static gboolean
+scope_configure_cb   (GtkWidget         *widget,
+		      GdkEventConfigure *event,
+		      gpointer           data)
+{
+	if ((widget->allocation.width == width) &&
+	    (widget->allocation.height - SCOPE_SPEC_HEIGHT == rows))
+		return TRUE;
+
+	width = widget->allocation.width;
+	rows = MAX (1, widget->allocation.height - SCOPE_SPEC_HEIGHT);
+	head = 0;
+
+	if (gc == NULL)
+		gc = gdk_gc_new (GDK_DRAWABLE (widget->window));
+
+	if (spectrum != NULL)
+		g_object_unref (spectrum);
+
+	if (waterfall != NULL)
+		g_object_unref (waterfall);
+
+	spectrum = gdk_pixmap_new (GDK_DRAWABLE (widget->window), width, SCOPE_SPEC_HEIGHT, -1);
+	waterfall = gdk_pixmap_new (GDK_DRAWABLE (widget->window), width, rows, -1);
+
+	colmin = g_renew (gint, colmin, width);
+	colmax = g_renew (gint, colmax, width);
+	rowbuf = g_renew (guchar, rowbuf, 3 * width);
+
+	gdk_gc_set_rgb_fg_color (gc, &widget->style->black);
+	gdk_draw_rectangle (GDK_DRAWABLE (waterfall), gc, TRUE, 0, 0, width, rows);
+
+	scope_decimate ();
+	scope_draw_spectrum ();
+
+	return TRUE;
+}
+
+
+/** \brief Copy the spectrum and the two parts of the waterfall ring. */
+static gboolean
+scope_expose_cb      (GtkWidget      *widget,
+		      GdkEventExpose *event,
+		      gpointer        data)
+{
+	if ((gc == NULL) || (width == 0))
+		return TRUE;
+
+	gdk_gc_set_clip_rectangle (gc, &event->area);
+
+	gdk_draw_drawable (GDK_DRAWABLE (widget->window), gc,
+			   GDK_DRAWABLE (spectrum),
+			   0, 0, 0, 0, width, SCOPE_SPEC_HEIGHT);
+
+	/* newest row at the top */
+	gdk_draw_drawable (GDK_DRAWABLE (widget->window), gc,
+			   GDK_DRAWABLE (waterfall),
+			   0, head, 0, SCOPE_SPEC_HEIGHT, width, rows - head);
+
+	if (head > 0) {
+		gdk_draw_drawable (GDK_DRAWABLE (widget->window), gc,
+				   GDK_DRAWABLE (waterfall),
+				   0, 0, 0, SCOPE_SPEC_HEIGHT + rows - head, width, head);
+	}
+
+	gdk_gc_set_clip_rectangle (gc, NULL);
+
+	return TRUE;
+}
+
+
+/** \brief Check for a new sweep.
+ *  \param data Unused.
+ *  \return Always TRUE to keep the timeout running.
+ */
+static gboolean
+scope_update         (gpointer data)
+{
+	rig_scan_sweep_t  next;
+	gchar            *text;
+
+	if (streaming)
+		return scope_update_stream ();
+
+	if (!rig_scan_get_sweep (sweep.serial, &next))
+		return TRUE;
+
+	g_free (sweep.levels);
+	sweep = next;
+
+	text = g_strdup_printf (_("%.4f MHz, %.1f kHz/point"),
+				(sweep.start + (sweep.points - 1) * sweep.step / 2) / 1.0e6,
+				sweep.step / 1000.0);
+	gtk_label_set_text (GTK_LABEL (info), text);
+	g_free (text);
+
+	if (width == 0)
+		return TRUE;
+
+	scope_decimate ();
+	scope_draw_spectrum ();
+	scope_add_row ();
+
+	gdk_window_invalidate_rect (canvas->window, NULL, FALSE);
+
+	return TRUE;
+}
+
+
+/** \brief Drain the scope lines received since the last frame.
+ *  \return Always TRUE to keep the timeout running.
+ *
+ * At most RIG_SPECTRUM_SLOTS lines are taken per frame, so a rig that
+ * sends faster than they can be drawn does not starve the user
+ * interface; the rest is dropped by the daemon side of the ring.
+ */
+static gboolean
+scope_update_stream  ()
+{
+	gchar *text;
+	guint  count = 0;
+
+	while ((count < RIG_SPECTRUM_SLOTS) && rig_spectrum_pop (&line)) {
+		scope_take_line ();
+
+		if (width > 0) {
+			scope_decimate ();
+			scope_add_row ();
+		}
+
+		count++;
+	}
+
+	if (count == 0)
+		return TRUE;
+
+	text = g_strdup_printf (_("%.4f - %.4f MHz, %d points"),
+				line.low / 1.0e6, line.high / 1.0e6, line.points);
+	gtk_label_set_text (GTK_LABEL (info), text);
+	g_free (text);
+
+	if (width == 0)
+		return TRUE;
+
+	scope_draw_spectrum ();
+
+	gdk_window_invalidate_rect (canvas->window, NULL, FALSE);
+
+	return TRUE;
+}
+
+
+/** \brief Convert the scope line to dB and store it as the last sweep. */
+static void
+scope_take_line      ()
+{
+	guint i;
+
+	if (line.points != sweep.points) {
+		sweep.levels = g_renew (gint, sweep.levels, MAX (1, line.points));
+		sweep.points = line.points;
+	}
+
+	sweep.start = line.low;
+	sweep.step = (line.points > 1) ? (line.high - line.low) / (line.points - 1) : 0;
+
+	for (i = 0; i < line.points; i++) {
+		sweep.levels[i] = rig_spectrum_level (&line, i);
+	}
+
+	/* use the scale of the rig if it sends one */
+	if (line.dbmax > line.dbmin) {
+		dbmin = (gint) line.dbmin;
+		dbmax = (gint) line.dbmax;
+	}
+}
+
+
+/** \brief Reduce the last sweep to one min/max pair per column.
+ *
+ * A column shows all points that fall into it, or the nearest point to
+ * its left when there are fewer points than columns.
+ */
+static void
+scope_decimate       ()
+{
+	gint x, i, first, last;
+
+	if ((sweep.levels == NULL) || (sweep.points == 0) || (width == 0))
+		return;
+
+	for (x = 0; x < width; x++) {
+		first = x * sweep.points / width;
+		last = MAX (first, (x + 1) * sweep.points / width - 1);
+
+		colmin[x] = colmax[x] = sweep.levels[first];
+
+		for (i = first + 1; i <= last; i++) {
+			if (sweep.levels[i] < colmin[x])
+				colmin[x] = sweep.levels[i];
+			if (sweep.levels[i] > colmax[x])
+				colmax[x] = sweep.levels[i];
+		}
+	}
+}
+
+
+/** \brief Draw the last sweep with a marker at the tuned frequency.
+ *
+ * A sweep is centred on the tuned frequency; the scope of the rig may
+ * also show a fixed range that does not contain it.
+ */
+static void
+scope_draw_spectrum  ()
+{
+	GdkColor color;
+	freq_t   freq;
+	gint     x;
+
+	gdk_gc_set_rgb_fg_color (gc, &canvas->style->black);
+	gdk_draw_rectangle (GDK_DRAWABLE (spectrum), gc, TRUE,
+			    0, 0, width, SCOPE_SPEC_HEIGHT);
+
+	color.red = 257 * 0xB0;
+	color.green = 257 * 0x30;
+	color.blue = 257 * 0x20;
+	gdk_gc_set_rgb_fg_color (gc, &color);
+
+	if (!streaming) {
+		gdk_draw_line (GDK_DRAWABLE (spectrum), gc,
+			       width / 2, 0, width / 2, SCOPE_SPEC_HEIGHT - 1);
+	}
+	else if (line.high > line.low) {
+		freq = rig_data_get_freq (1);
+
+		if ((freq >= line.low) && (freq <= line.high)) {
+			x = (gint) ((freq - line.low) * (width - 1) / (line.high - line.low));
+			gdk_draw_line (GDK_DRAWABLE (spectrum), gc,
+				       x, 0, x, SCOPE_SPEC_HEIGHT - 1);
+		}
+	}
+
+	if ((sweep.levels == NULL) || (sweep.points == 0))
+		return;
+
+	color.red = 257 * 0x40;
+	color.green = 257 * 0xE0;
+	color.blue = 257 * 0x40;
+	gdk_gc_set_rgb_fg_color (gc, &color);
+
+	for (x = 0; x < width; x++) {
+		gdk_draw_line (GDK_DRAWABLE (spectrum), gc,
+			       x, scope_level_to_y (colmax[x]),
+			       x, scope_level_to_y (colmin[x]));
+	}
+}
+
+
+/** \brief Upload the last sweep as the newest waterfall row. */
+static void
+scope_add_row        ()
+{
+	gint x, idx;
+
+	for (x = 0; x < width; x++) {
+		idx = 255 * (CLAMP (colmax[x], dbmin, dbmax) - dbmin) / (dbmax - dbmin);
+
+		memcpy (&rowbuf[3 * x], palette[idx], 3);
+	}
+
+	head = (head + rows - 1) % rows;
+
+	gdk_draw_rgb_image (GDK_DRAWABLE (waterfall), gc,
+			    0, head, width, 1,
+			    GDK_RGB_DITHER_NONE, rowbuf, 3 * width);
+}
+
+
+/** \brief Convert a level to a y coordinate in the spectrum. */
+static gint
+scope_level_to_y     (gint level)
+{
+	level = CLAMP (level, dbmin, dbmax);
+
+	return (SCOPE_SPEC_HEIGHT - 1) -
+		(level - dbmin) * (SCOPE_SPEC_HEIGHT - 1) / (dbmax - dbmin);
+}
+
+
+/** \brief Fill the waterfall palette: black, blue, cyan, yellow, red. */
+static void
+scope_init_palette   ()
+{
+	static const guchar stops[5][3] = {
+		{ 0x00, 0x00, 0x00 },
+		{ 0x00, 0x00, 0xC0 },
+		{ 0x00, 0xC0, 0xC0 },
+		{ 0xF0, 0xF0, 0x00 },
+		{ 0xFF, 0x00, 0x00 }
+	};
+	gint i, s, f, c;
+
+	for (i = 0; i < 256; i++) {
+		s = MIN (3, i / 64);
+		f = i - 64 * s;
+
+		for (c = 0; c < 3; c++) {
+			palette[i][c] = stops[s][c] + (stops[s + 1][c] - stops[s][c]) * f / 64;
+		}
+	}
+}
@@ -41,41 +41,37 @@
  * function to adjust the needle angle for various corrections (faalback
  * delay, etc.)
  *
+ * Both conversions are done using lookup tables, which are built once by
+ * convert_init(). The dB to angle table has 1 dB resolution and is
+ * interpolated from a hamlib calibration table the same way hamlib's
+ * rig_raw2val() does it; the angle to coordinate table has 0.1 degree
+ * resolution.
+ *
  * \bug  The conversion functions depend on the physical size of the smeter
  *       pixmap. The corresponding constant must therefore be updated if
  *       the pixmap size changes.
  */
 #include <gtk/gtk.h>
+#include <hamlib/rig.h>
 #include <math.h>
 #include "rig-gui-smeter-conv.h"
 
 
 
-/** \brief Coefficient for converting dB to deg (linear). */
-#define RIG_DB_TO_DEG_A  1.0966
-
-/** \brief Offset for converting dB to deg (linear). */
-#define RIG_DB_TO_DEG_B  100.934
-
-
-/** \brief 3. order coefficient for converting dB to deg (polynomial). */
-#define RIG_DB_TO_DEG_POLY_A   -0.000103582
+/** \brief Lowest signal strength in the dB lookup table (S0). */
+#define DB_LUT_MIN  -54
 
-/** \brief 2. order coefficient for converting dB to deg (polynomial). */
-#define RIG_DB_TO_DEG_POLY_B   -0.00289134
+/** \brief Highest signal strength in the dB lookup table (S9+30). */
+#define DB_LUT_MAX   30
 
-/** \brief 1. order coefficient for converting dB to deg (polynomial). */
-#define RIG_DB_TO_DEG_POLY_C    1.2021
+/** \brief Number of entries in the dB lookup table (1 dB resolution). */
+#define DB_LUT_SIZE (DB_LUT_MAX - DB_LUT_MIN + 1)
 
-/** \brief Offset for converting dB to deg (polynomial). */
-#define RIG_DB_TO_DEG_POLY_D  102.033
+/** \brief Number of entries in the val.f lookup table (0.001 resolution). */
+#define VALF_LUT_SIZE 1001
 
-
-/** \brief Coefficient for converting [0.0;1.0] to deg (linear). */
-#define RIG_VALF_TO_DEG_A  88.7818 
-
-/** \brief Offset for converting [0.0;1.0] to deg (linear). */
-#define RIG_VALF_TO_DEG_B  44.8182
+/** \brief Number of entries in the angle lookup table (0.1 deg resolution). */
+#define ANGLE_LUT_SIZE 1800
 
 
 
@@ -95,16 +91,12 @@
 #define PI 3.141592653
 #endif
 
-/** \brief Convert signal strength in dB to needle angle.
- *  \param db   The signalstrength as received from hamlib.
- *  \param mode The mode specifying whether data from linear
- *               or polynomial fit should be used.
- *  \return The needle angle in dgrees.
+
+/** \brief Calibration of the meter face for signal strength.
  *
- * This function convertsthe signal strength in dB, as received from hamlib,
- * to the needle angle. The valid range in -54..30, with -54dB corresponding to
- * S0 and 30dB coresponding to S9+30. Values outside range will be truncated to
- * the corresponding limit.
+ * The raw values are the signal strength in dB as received from hamlib;
+ * the values are the needle angles in 1/100 degrees measured on the
+ * s-meter pixmap.
  * \verbatim
          S    dB   deg
          S0  -54   45.00
@@ -121,66 +113,130 @@
         +20   20  122.31
         +30   30  133.48
      \endverbatim
- * The linear fit to this data results in:
- * \verbatim
-       a   = 1.0966           +/- 0.02087      (1.903%)
-       b   = 100.934          +/- 0.625        (0.6192%)
+ */
+static const cal_table_t FACE_DB_CAL = {
+	13, {
+		{ -54,  4500 },
+		{ -48,  4885 },
+		{ -42,  5464 },
+		{ -36,  6021 },
+		{ -30,  6596 },
+		{ -24,  7203 },
+		{ -18,  8036 },
+		{ -12,  8636 },
+		{  -6,  9500 },
+		{   0, 10395 },
+		{  10, 11371 },
+		{  20, 12231 },
+		{  30, 13348 }
+	}
+};
 
-correlation matrix of the fit parameters:
 
-                a      b      
-       a      1.000 
-       b      0.539  1.000 
-   \endverbatim
- * while 3. order polynomial fit gives:
- * \verbatim
-     f(x) = a*x**3 + b*x**2 + c*x + d
+/** \brief Calibration of the meter face for val.f type [0.0;1.0] levels.
+ *
+ * The raw values are the level in 1/1000 and the values are the needle
+ * angles in 1/100 degrees.
+ */
+static const cal_table_t FACE_VALF_CAL = {
+	11, {
+		{    0,  4500 },
+		{  100,  5400 },
+		{  200,  6200 },
+		{  300,  7140 },
+		{  400,  8030 },
+		{  500,  8900 },
+		{  600,  9840 },
+		{  700, 10700 },
+		{  800, 11590 },
+		{  900, 12490 },
+		{ 1000, 13340 }
+	}
+};
+
+
+/** \brief dB to angle lookup table; index 0 corresponds to DB_LUT_MIN. */
+static gfloat db_lut[DB_LUT_SIZE];
+
+/** \brief val.f to angle lookup table; index is val.f in 1/1000. */
+static gfloat valf_lut[VALF_LUT_SIZE];
+
+/** \brief Angle to needle coordinates; index is angle in 1/10 degree. */
+static coordinate_t angle_lut[ANGLE_LUT_SIZE];
 
-       a   = -0.000103582     +/- 2.175e-05    (21%)
-       b   = -0.00289134      +/- 0.0009361    (32.38%)
-       c   = 1.2021           +/- 0.02398      (1.995%)
-       d   = 102.033          +/- 0.5287       (0.5181%)
+/** \brief Flag indicating whether the lookup tables have been built. */
+static gboolean initialised = FALSE;
 
-   correlation matrix of the fit parameters:
 
-                      a      b      c      d      
-       a               1.000 
-       b               0.861  1.000 
-       c              -0.710 -0.351  1.000 
-       d              -0.617 -0.752  0.388  1.000 
+static gfloat calc_cal_value     (gint raw, const cal_table_t *cal);
+static void   calc_angle_to_rect (gfloat angle, coordinate_t *coor);
 
-   \endverbatim
+
+
+/** \brief Build the lookup tables.
+ *  \param cal Calibration table converting dB to needle angle in 1/100
+ *             degrees, or NULL to use the calibration of the meter face.
+ *
+ * This function builds the lookup tables used by the conversion functions.
+ * It is called automatically the first time a conversion function is used,
+ * but the s-meter should call it explicitly during initialisation so that
+ * the first frame does not pay for it. It can be called again with a rig
+ * specific calibration table, e.g. for a radio whose S-units are not 6 dB.
+ *
+ * Values outside the calibrated range are truncated to the corresponding
+ * limit.
  */
-gfloat
-convert_db_to_angle    (gint db, db_to_angle_mode_t mode)
+void
+convert_init           (const cal_table_t *cal)
 {
-	gfloat fdb;
+	gint i;
 
-	/* ensure that input is within range */
-	if (db < -54) {
-		db = -54;
+	if (cal == NULL || cal->size < 2) {
+		cal = &FACE_DB_CAL;
 	}
-	else if (db > 30) {
-		db = 30;
+
+	for (i = 0; i < DB_LUT_SIZE; i++) {
+		db_lut[i] = 0.01 * calc_cal_value (i + DB_LUT_MIN, cal);
 	}
 
-	fdb = (gfloat) db;
+	for (i = 0; i < VALF_LUT_SIZE; i++) {
+		valf_lut[i] = 0.01 * calc_cal_value (i, &FACE_VALF_CAL);
+	}
 
-	/* calculate angle according to selected mode */
-	if (mode == DB_TO_ANGLE_MODE_LINEAR) {
-		return (gfloat) (RIG_DB_TO_DEG_A*fdb + RIG_DB_TO_DEG_B);
+	for (i = 0; i < ANGLE_LUT_SIZE; i++) {
+		calc_angle_to_rect (0.1 * i, &angle_lut[i]);
 	}
 
-	else if (mode == DB_TO_ANGLE_MODE_POLY) {
-		return (gfloat) (RIG_DB_TO_DEG_POLY_A*fdb*fdb*fdb +
-				 RIG_DB_TO_DEG_POLY_B*fdb*fdb   +
-				 RIG_DB_TO_DEG_POLY_C*fdb     +
-				 RIG_DB_TO_DEG_POLY_D);
+	initialised = TRUE;
+}
+
+
+
+/** \brief Convert signal strength in dB to needle angle.
+ *  \param db   The signalstrength as received from hamlib.
+ *  \return The needle angle in dgrees.
+ *
+ * This function convertsthe signal strength in dB, as received from hamlib,
+ * to the needle angle. The valid range in -54..30, with -54dB corresponding to
+ * S0 and 30dB coresponding to S9+30. Values outside range will be truncated to
+ * the corresponding limit.
+ */
+gfloat
+convert_db_to_angle    (gint db)
+{
+	if (!initialised) {
+		convert_init (NULL);
 	}
 
-	else {
-		return 0.0;
+	/* ensure that input is within range */
+	if (db < DB_LUT_MIN) {
+		db = DB_LUT_MIN;
 	}
+	else if (db > DB_LUT_MAX) {
+		db = DB_LUT_MAX;
+	}
+
+	return db_lut[db - DB_LUT_MIN];
 }
 
 
@@ -188,68 +244,99 @@ convert_db_to_angle    (gint db, db_to_angle_mode_t mode)
 
 /** \brief Convert val.f type [0.0;1.0] to needle angle.
  *  \param valf  The floating point value as received from hamlib.
- *  \param mode The mode specifying whether data from linear
- *               or polynomial fit should be used (not used!).
  *  \return The needle angle in dgrees.
  *
  * This function converts a floating point number within the range [0.0;1.0],
  * as received from hamlib,
  * to the needle angle. Values outside the valid range will be truncated to
  * the corresponding limit.
- * \verbatim
-         fp     deg
-         0.0    45.0
-         0.1    54.0
-	 0.2    62.0
-	 0.3    71.4
-         0.4    80.3
-	 0.5    89.0
-	 0.6    98.4
-	 0.7   107.0
-	 0.8   115.9
-	 0.9   124.9
-         1.0   133.4
-     \endverbatim
- * The linear fit to this data results in:
- * \verbatim
+ */
+gfloat
+convert_valf_to_angle    (gfloat valf)
+{
+	if (!initialised) {
+		convert_init (NULL);
+	}
 
-         a  = 88.7818   +/- 0.2615       (0.2945%)
-         b  = 44.8182   +/- 0.1547       (0.3451%)
+	/* ensure that input is within range; also catches NaN */
+	if (!(valf > 0.0)) {
+		valf = 0.0;
+	}
+	else if (valf > 1.0) {
+		valf = 1.0;
+	}
+
+	return valf_lut[(gint) (valf * (VALF_LUT_SIZE - 1) + 0.5)];
+}
 
-    correlation matrix of the fit parameters:
 
-               a      b      
-         a   1.000 
-         b  -0.845  1.000 
 
 
-   \endverbatim
 
-   \note Since this scale is linear, it makes no sense to use the
-         3. order polynomial fit.
+/** \brief Convert needle angle to canvas coordinates.
+ *  \param angle The needle angle.
+ *  \param coor  Coordinate structurewhere the result is stored.
+ *
+ *  This function looks up the two (x,y) cordinates necessary to draw the
+ *  needle on the canvas. The angle is rounded to the nearest 0.1 degree.
  */
-gfloat
-convert_valf_to_angle    (gfloat valf)
+void
+convert_angle_to_rect  (gfloat angle, coordinate_t *coor)
 {
+	gint index;
 
-	/* ensure that input is within range */
-	if (valf < 0.0) {
-		valf = 0.0;
+	if (!initialised) {
+		convert_init (NULL);
 	}
-	else if (valf > 1.0) {
-		valf = 1.0;
+
+	/* numerical protection: 0.0 < angle < 180.0 */
+	if (!(0.0 < angle) || !(angle < 180.0)) {
+		angle = 90.0;
 	}
 
+	index = (gint) (10.0 * angle + 0.5);
+	if (index >= ANGLE_LUT_SIZE) {
+		index = ANGLE_LUT_SIZE - 1;
+	}
 
-	/* calculate angle according to selected mode */
-	return (gfloat) (RIG_VALF_TO_DEG_A*valf + RIG_VALF_TO_DEG_B);
+	*coor = angle_lut[index];
 }
 
 
 
+/** \brief Interpolate a value in a calibration table.
+ *  \param raw The raw value.
+ *  \param cal The calibration table; raw values must be increasing.
+ *  \return The calibrated value.
+ *
+ * This function does the same linear interpolation as rig_raw2val(),
+ * which is not part of the public hamlib API. Raw values outside the
+ * table are truncated to the first or last entry.
+ */
+static gfloat
+calc_cal_value  (gint raw, const cal_table_t *cal)
+{
+	gint i;
+
+	if (raw <= cal->table[0].raw) {
+		return (gfloat) cal->table[0].val;
+	}
 
+	for (i = 1; i < cal->size; i++) {
+		if (raw < cal->table[i].raw) {
+			return cal->table[i-1].val +
+				(gfloat) (raw - cal->table[i-1].raw) *
+				(cal->table[i].val - cal->table[i-1].val) /
+				(cal->table[i].raw - cal->table[i-1].raw);
+		}
+	}
 
-/** \brief Convert needle angle to canvas coordinates.
+	return (gfloat) cal->table[cal->size - 1].val;
+}
+
+
+
+/** \brief Calculate canvas coordinates of the needle.
  *  \param angle The needle angle.
  *  \param coor  Coordinate structurewhere the result is stored.
  *
@@ -259,8 +346,8 @@ convert_valf_to_angle    (gfloat valf)
  *  These are given byconstants in this file and must be adjustedin case
  *  of a new pixmap.
  */
-void
-convert_angle_to_rect  (gfloat angle, coordinate_t *coor)
+static void
+calc_angle_to_rect  (gfloat angle, coordinate_t *coor)
 {
 	gfloat rad;
 	gfloat s,c;
@@ -36,6 +36,8 @@
 #ifndef RIG_GUI_SMETER_CONV_H
 #define RIG_GUI_SMETER_CONV_H 1
 
+#include <hamlib/rig.h>
+
 /** \brief Structure used to obtained coordinates in one pass. */
 typedef struct {
 	gfloat x1;   /*!< X1 coordinate; upper left  */
@@ -45,18 +47,11 @@ typedef struct {
 } coordinate_t;
 
 
-/** \brief Enumeration for specifying the conversion mode (linear or polynomial
- *         fit) when converting from dB to angle.
- */
-typedef enum {
-	DB_TO_ANGLE_MODE_LINEAR = 0,   /*!< Use data from linear fit */
-	DB_TO_ANGLE_MODE_POLY   = 1    /*!< Use data from 3. degree polynomial fit */
-} db_to_angle_mode_t;
-
-
+/* build lookup tables from calibration table (NULL = meter face) */
+void    convert_init           (const cal_table_t *cal);
 
 /* conversions for signal strength */
-gfloat  convert_db_to_angle    (gint db, db_to_angle_mode_t mode);
+gfloat  convert_db_to_angle    (gint db);
 
 /* conversion of 0.0 ... 1.0 float to angle */
 gfloat  convert_valf_to_angle  (gfloat valf);
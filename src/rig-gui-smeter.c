@@ -51,6 +51,8 @@
 #endif
 #include "compat.h"
 #include "rig-data.h"
+#include "rig-meter.h"
+#include "grig-trace.h"
 #include "grig-gtk-workarounds.h"
 #include "rig-gui-smeter-conv.h"
 #include "rig-gui-smeter.h"
@@ -65,9 +67,21 @@ static smeter_t smeter;
 /** \brief Needle coordinates - can be made local */
 static coordinate_t coor;
 
+/** \brief Second needle coordinates */
+static coordinate_t statcoor;
+
 /** \brief Off-screen drawable */
 static GdkPixmap *buffer;
 
+/** \brief Flag indicating that the canvas is fully obscured by other windows */
+static gboolean obscured = FALSE;
+
+/** \brief Flag indicating that grig is in the background (see rig_gui_smeter_set_background) */
+static gboolean background = FALSE;
+
+/** \brief Extra pixels around the needle bounding box (line width + round caps). */
+#define SMETER_DIRTY_MARGIN 3
+
 
 /** \brief TX mode strings used for optionmenu */
 static const gchar *TX_MODE_S[] = {
@@ -78,6 +92,15 @@ static const gchar *TX_MODE_S[] = {
 };
 
 
+/** \brief Second needle strings used for optionmenu */
+static const gchar *STAT_S[] = {
+    N_("No hold"),
+    N_("Peak"),
+    N_("Average"),
+    N_("RMS")
+};
+
+
 /** \brief TX scale strings used for optionmenu */
 static const gchar *TX_SCALE_S[] = {
     N_("0..5"),
@@ -99,16 +122,24 @@ static gfloat scale_to_power[SMETER_SCALE_LAST] = { 5.0, 10.0, 50.0, 100.0, 500.
 static void       rig_gui_smeter_create_canvas  (void);
 static GtkWidget *rig_gui_mode_selector_create  (void);
 static GtkWidget *rig_gui_scale_selector_create (void);
+static GtkWidget *rig_gui_stat_selector_create  (void);
 
+static void rig_gui_smeter_timeout_start (void);
 static gint rig_gui_smeter_timeout_exec  (gpointer);
-static gint rig_gui_smeter_timeout_stop  (gpointer);
+static void rig_gui_smeter_timeout_stop  (GtkWidget *, gpointer);
+
+static void rig_gui_smeter_redraw         (const coordinate_t *, const coordinate_t *);
+static void rig_gui_smeter_update_visible (void);
 
 static void rig_gui_smeter_mode_cb     (GtkWidget *, gpointer);
 static void rig_gui_smeter_scale_cb    (GtkWidget *, gpointer);
+static void rig_gui_smeter_stat_cb     (GtkWidget *, gpointer);
 
-static gboolean rig_gui_smeter_expose_cb   (GtkWidget *, GdkEventExpose *, gpointer);
+static gboolean rig_gui_smeter_expose_cb     (GtkWidget *, GdkEventExpose *, gpointer);
+static gboolean rig_gui_smeter_visibility_cb (GtkWidget *, GdkEventVisibility *, gpointer);
 
 static gboolean rig_gui_smeter_has_tx_mode (guint);
+static gboolean rig_gui_smeter_get_stat_angle (gfloat *);
 
 
 /** \brief Create signal strength meter widget.
@@ -124,22 +155,31 @@ rig_gui_smeter_create ()
 {
     GtkWidget *vbox;
     GtkWidget *hbox;
-    guint      timerid;
 
 
+    /* build needle lookup tables */
+    convert_init (NULL);
+
     /* initialize some data */
-    smeter.value     = convert_db_to_angle (-54, DB_TO_ANGLE_MODE_POLY);
+    smeter.value     = convert_db_to_angle (-54);
     smeter.lastvalue = smeter.value;
     smeter.tval      = RIG_GUI_SMETER_DEF_TVAL;
+    smeter.timerid   = 0;
+    smeter.timer     = g_timer_new ();
     smeter.falloff   = RIG_GUI_SMETER_DEF_FALLOFF;
     smeter.txmode    = SMETER_TX_MODE_NONE;
     smeter.scale     = SMETER_SCALE_100;
     smeter.exposed   = FALSE;
+    smeter.visible   = TRUE;
+    smeter.stat      = SMETER_STAT_NONE;
+    smeter.statshown = FALSE;
+    smeter.statvalue = smeter.value;
 
     /* create horizontal box containing selectors */
     hbox = gtk_hbox_new (TRUE, 0);
     gtk_box_pack_start (GTK_BOX (hbox), rig_gui_scale_selector_create (), TRUE, TRUE, 0);
     gtk_box_pack_start (GTK_BOX (hbox), rig_gui_mode_selector_create (), TRUE, TRUE, 0);
+    gtk_box_pack_start (GTK_BOX (hbox), rig_gui_stat_selector_create (), TRUE, TRUE, 0);
 
 
     /* create cnvas */
@@ -154,15 +194,13 @@ rig_gui_smeter_create ()
 
     /* start readback timer but only if service is available */
     if (rig_data_has_get_strength ()) {
-        timerid = g_timeout_add (RIG_GUI_SMETER_DEF_TVAL,
-                     rig_gui_smeter_timeout_exec,
-                     NULL);
-
-        /* register timer_stop function at exit */
-        gtk_quit_add (gtk_main_level (), rig_gui_smeter_timeout_stop,
-                  GUINT_TO_POINTER (timerid));
+        rig_gui_smeter_timeout_start ();
     }
 
+    /* stop the timer with the widget; it is also restarted elsewhere */
+    g_signal_connect (G_OBJECT (vbox), "destroy",
+                      G_CALLBACK (rig_gui_smeter_timeout_stop), NULL);
+
     gtk_widget_show_all (vbox);
     
     return vbox;
@@ -201,6 +239,7 @@ rig_gui_smeter_create_canvas ()
 
     /* create canvas */
     smeter.canvas = gtk_drawing_area_new ();
+    gtk_widget_set_name (smeter.canvas, "grig-smeter");
     gtk_widget_set_size_request (smeter.canvas, 160, 80);
 
     /* connect expose handler which will take care of adding
@@ -209,6 +248,13 @@ rig_gui_smeter_create_canvas ()
     g_signal_connect (G_OBJECT (smeter.canvas), "expose_event",  
               G_CALLBACK (rig_gui_smeter_expose_cb), NULL);    
 
+    /* we want to know when the meter can not be seen so that
+       the update timer can be stopped.
+    */
+    gtk_widget_add_events (smeter.canvas, GDK_VISIBILITY_NOTIFY_MASK);
+    g_signal_connect (G_OBJECT (smeter.canvas), "visibility_notify_event",
+              G_CALLBACK (rig_gui_smeter_visibility_cb), NULL);
+
     /* create background pixmap and add it to canvas */
     //fname = g_strconcat (PACKAGE_PIXMAPS_DIR, G_DIR_SEPARATOR_S,
     //             "smeter.png", NULL);
@@ -222,17 +268,38 @@ rig_gui_smeter_create_canvas ()
 }
 
 
+/** \brief Start the update timer.
+ *
+ * This function starts the update timer unless it is already running.
+ * The elapsed time reference is reset so that the first tick does not
+ * see the time the timer has been stopped.
+ */
+static void
+rig_gui_smeter_timeout_start ()
+{
+    if (smeter.timerid == 0) {
+        g_timer_start (smeter.timer);
+        smeter.timerid = grig_trace_timeout_add (smeter.tval,
+                        rig_gui_smeter_timeout_exec,
+                        NULL, GRIG_TRACE_GUI_SMETER);
+    }
+}
+
+
 /** \brief Execute timeout function.
  *  \param data User data; currently NULL.
- *  \return Always TRUE to keep the timer running.
+ *  \return TRUE to keep the timer running, FALSE to stop it.
  *
  * This function is in charge for updating the signal strength meter. It acquires
  * the signal strength from the rig-data object, converts it to needle endpoint
- * coordinates and repaints the s-meter.
+ * coordinates and repaints the part of the s-meter covered by the old and the
+ * new needle.
  *
- * The function is called peridically by the Gtk+ scheduler.
- *
- * \note Optimize?
+ * The function is called peridically by the Gtk+ scheduler. The falloff is
+ * calculated using the time actually elapsed since the previous call, since
+ * the scheduler does not guarantee the requested period. When the needle is
+ * at rest and the meter can not be seen, or grig is in the background, the
+ * timer is stopped; it will be restarted when the meter becomes visible again.
  */
 static gint 
 rig_gui_smeter_timeout_exec  (gpointer data)
@@ -242,7 +309,29 @@ rig_gui_smeter_timeout_exec  (gpointer data)
     gfloat             valf = 0.0;     /* RF power, SWR or ALC from hamlib */
     gfloat             maxdelta;
     gfloat             delta;
+    gdouble            elapsed;        /* seconds since previous update */
+    coordinate_t       old;            /* previous needle coordinates */
+    coordinate_t       oldstat;        /* previous second needle coordinates */
+    gboolean           oldshown;       /* whether second needle was shown */
+    gfloat             statang;        /* second needle angle */
+    gboolean           statshown;
+    gboolean           moved = FALSE;  /* whether any of the needles moved */
+
+
+    /* no rendering at all in background mode */
+    if (background) {
+        smeter.timerid = 0;
 
+        return FALSE;
+    }
+
+    elapsed = g_timer_elapsed (smeter.timer, NULL);
+    g_timer_start (smeter.timer);
+
+    /* a stalled main loop should not make the needle jump */
+    if (elapsed > 0.001 * RIG_GUI_SMETER_MAX_TVAL) {
+        elapsed = 0.001 * RIG_GUI_SMETER_MAX_TVAL;
+    }
 
 
     /* are we in RX or TX mode? */
@@ -256,7 +345,7 @@ rig_gui_smeter_timeout_exec  (gpointer data)
         db = rig_data_get_strength ();
 #endif
 
-        rdang = convert_db_to_angle (db, DB_TO_ANGLE_MODE_POLY);
+        rdang = convert_db_to_angle (db);
 
         delta = fabs (rdang - smeter.value);
     }
@@ -321,11 +410,15 @@ rig_gui_smeter_timeout_exec  (gpointer data)
         delta = fabs (rdang - smeter.value);
     }
 
+    old      = coor;
+    oldstat  = statcoor;
+    oldshown = smeter.statshown;
+
     /* is there a significant change? */
     if (delta > 0.1) {
 
         /* calculate max delta = deg/sec * sec  */
-        maxdelta = smeter.falloff * (smeter.tval * 0.001);
+        maxdelta = smeter.falloff * elapsed;
         
         smeter.lastvalue = smeter.value;
             
@@ -344,52 +437,143 @@ rig_gui_smeter_timeout_exec  (gpointer data)
             }
         }
 
-        /* update widget */
         convert_angle_to_rect (smeter.value, &coor);
- 
-        /* checkwhether s-meter is visible */
-        if (smeter.exposed) {
+        moved = TRUE;
+    }
+
+    /* the second needle follows the statistics without falloff;
+       the statistics are smooth enough on their own */
+    statshown = rig_gui_smeter_get_stat_angle (&statang);
 
-            /* raw background pixmap */
-            gdk_draw_pixbuf (GDK_DRAWABLE (buffer), NULL, smeter.pixbuf,
-                     0, 0, 0, 0, -1, -1, GDK_RGB_DITHER_NONE, 0, 0);
+    if ((statshown != smeter.statshown) ||
+        (statshown && (fabs (statang - smeter.statvalue) > 0.1))) {
 
-            /* draw needle */
-            gdk_draw_line (GDK_DRAWABLE (buffer), smeter.gc,
-                       coor.x1, coor.y1, coor.x2, coor.y2);
+        smeter.statshown = statshown;
 
-            /* draw border around the meter */
-            gdk_draw_rectangle (GDK_DRAWABLE (buffer), smeter.gc,
-                        FALSE, 0, 0, 160, 80);
+        if (statshown) {
+            smeter.statvalue = statang;
+            convert_angle_to_rect (statang, &statcoor);
+        }
+
+        moved = TRUE;
+    }
 
-            /* copy offscreen buffer to visible widget */
-            gdk_draw_drawable (GDK_DRAWABLE (smeter.canvas->window), smeter.gc,
-                       GDK_DRAWABLE (buffer),
-                       0, 0, 0, 0, -1, -1);
+    if (moved) {
+        /* check whether s-meter is visible; if not, the
+           expose handler will repaint everything later */
+        if (smeter.exposed && smeter.visible) {
+            rig_gui_smeter_redraw (&old, oldshown ? &oldstat : NULL);
         }
     }
 
+    /* needles are at rest and nobody is looking */
+    else if (!smeter.visible) {
+        smeter.timerid = 0;
+
+        return FALSE;
+    }
+
 
     return TRUE;
 }
 
 
+/** \brief Repaint the s-meter.
+ *  \param old The previous needle coordinates or NULL to repaint everything.
+ *  \param oldstat The previous second needle coordinates or NULL if it was not shown.
+ *
+ * This function restores the background under the bounding box of the old
+ * and the new needles from the cached background, draws the needles and copies
+ * the dirty area to the screen. The rest of the off-screen buffer is left
+ * untouched.
+ */
+static void
+rig_gui_smeter_redraw (const coordinate_t *old, const coordinate_t *oldstat)
+{
+    GdkRectangle full = { 0, 0, 160, 80 };
+    GdkRectangle area;
+    gfloat       xmin, xmax, ymin, ymax;
+
+
+    if (old == NULL) {
+        area = full;
+    }
+    else {
+        xmin = MIN (MIN (old->x1, old->x2), MIN (coor.x1, coor.x2));
+        xmax = MAX (MAX (old->x1, old->x2), MAX (coor.x1, coor.x2));
+        ymin = MIN (MIN (old->y1, old->y2), MIN (coor.y1, coor.y2));
+        ymax = MAX (MAX (old->y1, old->y2), MAX (coor.y1, coor.y2));
+
+        if (oldstat != NULL) {
+            xmin = MIN (xmin, MIN (oldstat->x1, oldstat->x2));
+            xmax = MAX (xmax, MAX (oldstat->x1, oldstat->x2));
+            ymin = MIN (ymin, MIN (oldstat->y1, oldstat->y2));
+            ymax = MAX (ymax, MAX (oldstat->y1, oldstat->y2));
+        }
+
+        if (smeter.statshown) {
+            xmin = MIN (xmin, MIN (statcoor.x1, statcoor.x2));
+            xmax = MAX (xmax, MAX (statcoor.x1, statcoor.x2));
+            ymin = MIN (ymin, MIN (statcoor.y1, statcoor.y2));
+            ymax = MAX (ymax, MAX (statcoor.y1, statcoor.y2));
+        }
+
+        area.x      = (gint) floor (xmin) - SMETER_DIRTY_MARGIN;
+        area.y      = (gint) floor (ymin) - SMETER_DIRTY_MARGIN;
+        area.width  = (gint) ceil (xmax) + SMETER_DIRTY_MARGIN - area.x;
+        area.height = (gint) ceil (ymax) + SMETER_DIRTY_MARGIN - area.y;
+
+        if (!gdk_rectangle_intersect (&full, &area, &area)) {
+            return;
+        }
+    }
+
+    /* restore background; the border is part of it */
+    gdk_draw_drawable (GDK_DRAWABLE (buffer), smeter.gc,
+               GDK_DRAWABLE (smeter.background),
+               area.x, area.y, area.x, area.y, area.width, area.height);
+
+    /* draw needles and border; clipping keeps us inside the dirty area */
+    if (smeter.statshown) {
+        gdk_gc_set_clip_rectangle (smeter.statgc, &area);
+        gdk_draw_line (GDK_DRAWABLE (buffer), smeter.statgc,
+                   statcoor.x1, statcoor.y1, statcoor.x2, statcoor.y2);
+        gdk_gc_set_clip_rectangle (smeter.statgc, NULL);
+    }
+
+    gdk_gc_set_clip_rectangle (smeter.gc, &area);
+
+    gdk_draw_line (GDK_DRAWABLE (buffer), smeter.gc,
+               coor.x1, coor.y1, coor.x2, coor.y2);
+
+    gdk_draw_rectangle (GDK_DRAWABLE (buffer), smeter.gc,
+                FALSE, 0, 0, 160, 80);
+
+    gdk_gc_set_clip_rectangle (smeter.gc, NULL);
+
+    /* copy dirty area to visible widget */
+    gdk_draw_drawable (GDK_DRAWABLE (smeter.canvas->window), smeter.gc,
+               GDK_DRAWABLE (buffer),
+               area.x, area.y, area.x, area.y, area.width, area.height);
+}
+
+
 
 /** \brief Stop timeout function.
- *  \param timer The ID of the timer to stop.
- *  \return Always TRUE.
+ *  \param widget The widget being destroyed.
+ *  \param data User data; currently NULL.
  *
- * This function is used to stop the readback timer just before the
- * program is quit. It should be called automatically by Gtk+ when
- * the gtk_main_loop is exited.
+ * This function is used to stop the readback timer when the meter
+ * is destroyed.
  */
-static gint 
-rig_gui_smeter_timeout_stop  (gpointer timer)
+static void
+rig_gui_smeter_timeout_stop  (GtkWidget *widget, gpointer data)
 {
 
-    g_source_remove (GPOINTER_TO_UINT (timer));
-
-    return TRUE;
+    if (smeter.timerid != 0) {
+        g_source_remove (smeter.timerid);
+        smeter.timerid = 0;
+    }
 }
 
 
@@ -482,6 +666,37 @@ rig_gui_scale_selector_create ()
 }
 
 
+/** \brief Create second needle selector widget.
+ *  \return The selector widget.
+ *
+ * This function is used to create the combo box which can be used to select
+ * the statistics shown by the second needle of the s-meter.
+ */
+static GtkWidget *
+rig_gui_stat_selector_create ()
+{
+    GtkWidget *combo;
+    guint i;
+
+    combo = gtk_combo_box_new_text ();
+
+    /* Add entries to combo box */
+    for (i = SMETER_STAT_NONE; i < SMETER_STAT_LAST; i++) {
+        gtk_combo_box_append_text (GTK_COMBO_BOX (combo), _(STAT_S[i]));
+    }
+
+    gtk_combo_box_set_active (GTK_COMBO_BOX (combo), SMETER_STAT_NONE);
+    gtk_widget_set_tooltip_text (combo, _("Select what the second needle should show"));
+
+    /* connect changed signal */
+    g_signal_connect (G_OBJECT (combo), "changed",
+              G_CALLBACK (rig_gui_smeter_stat_cb),
+              NULL);
+
+    return combo;
+}
+
+
 /** \brief Select s-meter mode.
  *  \param widget The widget which received the signal.
  *  \param data   User data, always NULL.
@@ -501,6 +716,7 @@ rig_gui_smeter_mode_cb   (GtkWidget *widget, gpointer data)
     /* store the mode if value is self-consistent */
     if ((index > -1) && (index < SMETER_TX_MODE_LAST)) {
         smeter.txmode = index;
+        rig_data_set_tx_meter (index);
     }
 
 }
@@ -531,59 +747,152 @@ rig_gui_smeter_scale_cb   (GtkWidget *widget, gpointer data)
 
 
 
+/** \brief Select second needle statistics.
+ *  \param widget The widget which received the signal.
+ *  \param data   User data, always NULL.
+ *
+ * This function is called when the user selects what the second needle
+ * of the s-meter should show.
+ */
+static void
+rig_gui_smeter_stat_cb   (GtkWidget *widget, gpointer data)
+{
+    gint index;
+
+    /* get selected item */
+    index = gtk_combo_box_get_active (GTK_COMBO_BOX (widget));
+
+    /* store the mode if value is self-consistent */
+    if ((index > -1) && (index < SMETER_STAT_LAST)) {
+        smeter.stat = index;
+    }
+
+}
+
+
+
 /** \brief Handle expose events for the drawing area.
  *  \param widget The drawing area widget.
  *  \param event  The event.
  *  \param data   User data; always NULL.
  * 
  * This function is called when the rawing area widget is finalized
- * and exposed. Itis used to finish the initialization of those
- * parameters, which need attributes rom visible widgets.
+ * and exposed. The first time it is used to finish the initialization
+ * of those parameters, which need attributes rom visible widgets: the
+ * graphics context, the off-screen buffer and the cached background.
+ * Subsequent calls simply repaint the meter.
  */ 
 static gboolean
 rig_gui_smeter_expose_cb   (GtkWidget      *widget,
                 GdkEventExpose *event,
                 gpointer        data)
 {
-    GdkColor color;
-
-    /* draw background pixmap */
-    gdk_draw_pixbuf (GDK_DRAWABLE (widget->window), NULL, smeter.pixbuf,
-             0, 0, 0, 0, -1, -1, GDK_RGB_DITHER_NONE, 0, 0);
-
-    /* 0x3b3428 scaled to 3x16 bits */
-    color.red = 257*0x5B;
-    color.green = 257*0x54;
-    color.blue = 257*0x48;
-
-    /* finalize the graphics context */
-    smeter.gc = gdk_gc_new (GDK_DRAWABLE (widget->window));
-    gdk_gc_set_rgb_fg_color (smeter.gc, &color);
-    gdk_gc_set_rgb_bg_color (smeter.gc, &color);
-    gdk_gc_set_line_attributes (smeter.gc, 2,
-                    GDK_LINE_SOLID,
-                    GDK_CAP_ROUND,
-                    GDK_JOIN_ROUND);
-                    
-    /* draw needle */
-    gdk_draw_line (GDK_DRAWABLE (widget->window), smeter.gc,
-               coor.x1, coor.y1, coor.x2, coor.y2);
+    GdkColor   color;
+
+    if (!smeter.exposed) {
+
+        /* 0x3b3428 scaled to 3x16 bits */
+        color.red = 257*0x5B;
+        color.green = 257*0x54;
+        color.blue = 257*0x48;
+
+        /* finalize the graphics context */
+        smeter.gc = gdk_gc_new (GDK_DRAWABLE (widget->window));
+        gdk_gc_set_rgb_fg_color (smeter.gc, &color);
+        gdk_gc_set_rgb_bg_color (smeter.gc, &color);
+        gdk_gc_set_line_attributes (smeter.gc, 2,
+                        GDK_LINE_SOLID,
+                        GDK_CAP_ROUND,
+                        GDK_JOIN_ROUND);
+
+        /* thin red needle for peak/avg/rms */
+        color.red = 257*0xB0;
+        color.green = 257*0x30;
+        color.blue = 257*0x20;
+
+        smeter.statgc = gdk_gc_new (GDK_DRAWABLE (widget->window));
+        gdk_gc_set_rgb_fg_color (smeter.statgc, &color);
+        gdk_gc_set_rgb_bg_color (smeter.statgc, &color);
+        gdk_gc_set_line_attributes (smeter.statgc, 1,
+                        GDK_LINE_SOLID,
+                        GDK_CAP_ROUND,
+                        GDK_JOIN_ROUND);
+
+        /* cache background pixmap with border */
+        smeter.background = gdk_pixmap_new (GDK_DRAWABLE (widget->window),
+                            160, 80, -1);
+        gdk_draw_pixbuf (GDK_DRAWABLE (smeter.background), NULL, smeter.pixbuf,
+                 0, 0, 0, 0, -1, -1, GDK_RGB_DITHER_NONE, 0, 0);
+        gdk_draw_rectangle (GDK_DRAWABLE (smeter.background), smeter.gc,
+                    FALSE, 0, 0, 160, 80);
+
+        /* initialize offscreen buffer */
+        buffer = gdk_pixmap_new (GDK_DRAWABLE (widget->window),
+                     160, 80, -1);
+
+        /* indicate that widget is ready to 
+           be used
+        */
+        smeter.exposed = TRUE;
+    }
 
-    /* draw border around the meter */
-    gdk_draw_rectangle (GDK_DRAWABLE (widget->window), smeter.gc,
-                FALSE, 0, 0, 160, 80);
+    /* the buffer is not updated while the meter is hidden */
+    rig_gui_smeter_redraw (NULL, NULL);
 
-    /* initialize offscreen buffer */
-    buffer = gdk_pixmap_new (GDK_DRAWABLE (smeter.canvas->window),
-                 160, 80, -1);
 
-    /* indicate that widget is ready to 
-       be used
-    */
-    smeter.exposed = TRUE;
+    return TRUE;
+}
 
 
-    return TRUE;
+/** \brief Handle visibility changes of the drawing area.
+ *  \param widget The drawing area widget.
+ *  \param event  The visibility event.
+ *  \param data   User data; always NULL.
+ *  \return Always FALSE to let other handlers see the event.
+ */
+static gboolean
+rig_gui_smeter_visibility_cb (GtkWidget          *widget,
+                  GdkEventVisibility *event,
+                  gpointer            data)
+{
+    obscured = (event->state == GDK_VISIBILITY_FULLY_OBSCURED);
+    rig_gui_smeter_update_visible ();
+
+    return FALSE;
+}
+
+
+/** \brief Enable or disable background mode.
+ *  \param bg Flag indicating whether grig is in the background.
+ *
+ * This function is called by the main window when it is iconified or can
+ * not be seen. In background mode the update timer is stopped immediately;
+ * it is restarted and the needle catches up when the background mode is
+ * disabled again.
+ */
+void
+rig_gui_smeter_set_background (gboolean bg)
+{
+    background = bg;
+    rig_gui_smeter_update_visible ();
+}
+
+
+/** \brief Update the visibility flag of the s-meter.
+ *
+ * This function is called when the visibility or the window state has
+ * changed. The update timer is restarted if the meter has become visible;
+ * stopping the timer is left to the timeout function itself so that the
+ * needle can come to rest first.
+ */
+static void
+rig_gui_smeter_update_visible ()
+{
+    smeter.visible = !(obscured || background);
+
+    if (smeter.visible && rig_data_has_get_strength ()) {
+        rig_gui_smeter_timeout_start ();
+    }
 }
 
 
@@ -628,3 +937,85 @@ rig_gui_smeter_has_tx_mode (guint mode)
 }
 
 
+/** \brief Get the angle of the second needle.
+ *  \param angle Location where the angle is stored.
+ *  \return TRUE if the second needle should be shown, FALSE otherwise.
+ *
+ * This function acquires the statistics selected for the second needle
+ * from the meter sample buffers and converts it to an angle. The meter
+ * is chosen the same way as for the main needle. The peak is calculated
+ * over the hold time, while average and RMS use the averaging window.
+ */
+static gboolean
+rig_gui_smeter_get_stat_angle (gfloat *angle)
+{
+    rig_meter_stats_t stats;
+    rig_meter_t       meter;
+    gdouble           window;
+    gfloat            value;
+
+
+    if (smeter.stat == SMETER_STAT_NONE) {
+        return FALSE;
+    }
+
+    /* select meter */
+    if (rig_data_get_ptt () == RIG_PTT_OFF) {
+        meter = RIG_METER_STRENGTH;
+    }
+    else {
+        switch (smeter.txmode) {
+
+        case SMETER_TX_MODE_POWER:
+            meter = RIG_METER_POWER;
+            break;
+
+        case SMETER_TX_MODE_SWR:
+            meter = RIG_METER_SWR;
+            break;
+
+        case SMETER_TX_MODE_ALC:
+            meter = RIG_METER_ALC;
+            break;
+
+        default:
+            return FALSE;
+            break;
+        }
+    }
+
+    window = (smeter.stat == SMETER_STAT_PEAK) ? RIG_METER_DEF_HOLD : RIG_METER_DEF_WINDOW;
+
+    if (!rig_meter_get_stats (meter, window, &stats)) {
+        return FALSE;
+    }
+
+    switch (smeter.stat) {
+
+    case SMETER_STAT_PEAK:
+        value = stats.peak;
+        break;
+
+    case SMETER_STAT_AVG:
+        value = stats.avg;
+        break;
+
+    default:
+        value = stats.rms;
+        break;
+    }
+
+    if (meter == RIG_METER_STRENGTH) {
+        *angle = convert_db_to_angle ((gint) rint (value));
+    }
+    else {
+        /* same scaling as for the main needle */
+        if (meter == RIG_METER_POWER) {
+            value *= rig_data_get_max_rfpwr () / scale_to_power[smeter.scale];
+        }
+
+        *angle = convert_valf_to_angle (value);
+    }
+
+    return TRUE;
+}
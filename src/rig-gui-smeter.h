@@ -39,6 +39,8 @@
 #ifndef RIG_GUI_SMETER_H
 #define RIG_GUI_SMETER_H 1
 
+#include "rig-data.h"
+
 
 
 /* These constants are kept public to allow their usage in e.g. adjustment ranges */
@@ -82,18 +84,20 @@ typedef enum {
 
 
 
-/** \brief TX mode setting.
+
+/** \brief Statistics shown by the second needle.
  *
- * These valuesare used to select the meter isplay mode when the rig is
- * in TX mode.
+ * The s-meter can show a second, thin needle displaying the peak, average
+ * or RMS value of the meter readings acquired by the rig daemon within a
+ * short time window.
  */
 typedef enum {
-	SMETER_TX_MODE_NONE = 0,       /*!< No display in TX mode. */
-	SMETER_TX_MODE_POWER,          /*!< Show TX power.         */
-	SMETER_TX_MODE_SWR,            /*!< Show SWR.              */
-	SMETER_TX_MODE_ALC,            /*!< Show ALC level.        */
-	SMETER_TX_MODE_LAST            /*!< Dummy...               */
-} smeter_tx_mode_t;
+	SMETER_STAT_NONE = 0,          /*!< No second needle.      */
+	SMETER_STAT_PEAK,              /*!< Show peak hold.        */
+	SMETER_STAT_AVG,               /*!< Show average.          */
+	SMETER_STAT_RMS,               /*!< Show RMS value.        */
+	SMETER_STAT_LAST               /*!< Dummy...               */
+} smeter_stat_t;
 
 
 /** \brief Data type for signal strength meter.
@@ -102,23 +106,35 @@ typedef enum {
  * meter. The signal strength meter is a GnomeCanvas having a background
  * pixmap and a needle. The data structure also hols some numerical values
  * needed to calculate the dynamic behaviour of the needle.
+ *
+ * The update timer is only running while the needle is moving or the meter
+ * is visible; timerid is 0 when the timer has been stopped.
  */
 typedef struct {
 	GtkWidget              *canvas;      /*!< The drawing area widget. */
 	GdkPixbuf              *pixbuf;      /*!< The background pixmap.   */
+	GdkPixmap              *background;  /*!< Cached background incl. border. */
 	GdkGC                  *gc;          /*!< Graphics context for drawing. */
 	gboolean                exposed;     /*!< Flag to indicate whether canvas is ready. */
+	gboolean                visible;     /*!< Flag to indicate whether canvas can be seen. */
 	gfloat                  value;       /*!< Current value (angle).   */
 	gfloat                  lastvalue;   /*!< Previous value (angle).  */
 	guint                   tval;        /*!< Current update delay.    */
+	guint                   timerid;     /*!< ID of the update timer (0 when stopped). */
+	GTimer                 *timer;       /*!< Time elapsed since last update. */
 	gfloat                  falloff;     /*!< Current falloff delay.   */
 	smeter_scale_t          scale;       /*!< Current scale.           */
 	smeter_tx_mode_t        txmode;      /*!< Display mode in TX.      */
+	smeter_stat_t           stat;        /*!< Statistics shown by second needle. */
+	gboolean                statshown;   /*!< Flag indicating whether second needle is shown. */
+	gfloat                  statvalue;   /*!< Second needle value (angle). */
+	GdkGC                  *statgc;      /*!< Graphics context for second needle. */
 } smeter_t;
 
 
 GtkWidget        *rig_gui_smeter_create (void);
 smeter_tx_mode_t  rig_gui_smeter_get_tx_mode (void);
+void              rig_gui_smeter_set_background (gboolean);
 
 
 #endif
@@ -51,6 +51,7 @@
 #include "rig-utils.h"
 #include "rig-gui-tx.h"
 #include "grig-debug.h"
+#include "grig-latency.h"
 #include "grig-menubar.h"
 
 /* defined in main.c */
@@ -72,6 +73,19 @@ static GtkWidget *dialog;
 static gboolean visible = FALSE;
 static guint timerid = 0;
 
+/** \brief Fields displayed in this window; polled at full rate while open. */
+static const rig_data_field_t TX_FIELDS[] = {
+	RIG_DATA_FIELD_KEYSPD,
+	RIG_DATA_FIELD_BKINDEL,
+	RIG_DATA_FIELD_POWER,
+	RIG_DATA_FIELD_ALC,
+	RIG_DATA_FIELD_MICG,
+	RIG_DATA_FIELD_COMP,
+	RIG_DATA_FIELD_VOXG,
+	RIG_DATA_FIELD_VOXDEL,
+	RIG_DATA_FIELD_ANTIVOX
+};
+
 
 /* controls */
 static GtkWidget *kss,*bks,*rfs,*als,*mgs,*cps,*vgs,*vds,*avs;
@@ -91,6 +105,7 @@ rig_gui_tx_create ()
 {
 	GtkWidget *hbox;
 	gchar     *title;
+	guint      i;
 
 
 	if (visible) {
@@ -130,10 +145,15 @@ rig_gui_tx_create ()
 
 	visible = TRUE;
 
+	/* tell the daemon that we need these fields */
+	for (i = 0; i < G_N_ELEMENTS (TX_FIELDS); i++) {
+		rig_data_add_interest (TX_FIELDS[i]);
+	}
+
 	gtk_widget_show_all (dialog);
 
 	/* start callback */
-	timerid = g_timeout_add (1073, tx_levels_update, NULL);
+	timerid = grig_latency_timeout_add (1073, tx_levels_update, NULL, "tx-levels");
 }
 
 
@@ -156,12 +176,16 @@ static void
 tx_window_destroy    (GtkWidget *widget,
 		      gpointer   data)
 {
+	guint i;
 
 	/* stop callback */
 	g_source_remove (timerid);
 	timerid = 0;
 
 	/* clear tx-active flag in rig-data */
+	for (i = 0; i < G_N_ELEMENTS (TX_FIELDS); i++) {
+		rig_data_remove_interest (TX_FIELDS[i]);
+	}
 
 	visible = FALSE;
 
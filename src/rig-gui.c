@@ -36,6 +36,11 @@
  * This file encapsulates the various GUI parts into one big composite widget.
  */
 #include <gtk/gtk.h>
+#include <glib/gi18n.h>
+#include "rig-ctx.h"
+#include "rig-daemon.h"
+#include "rig-data.h"
+#include "rig-meter.h"
 #include "rig-gui.h"
 #include "rig-gui-buttons.h"
 #include "rig-gui-ctrl2.h"
@@ -47,9 +52,21 @@
 #include "grig-menubar.h"
 
 
+extern GtkWidget *grigapp;    /* defined in main.c */
+
 /* we keep this global so that we can enable and disable it at runtime */
 static GtkWidget *keypadbox = NULL;
 
+/* containers of the controls that are built for the capabilities
+   of the selected rig; they are rebuilt when another rig is selected */
+static GtkWidget *buttonsbox = NULL;
+static GtkWidget *ctrl2box = NULL;
+static GtkWidget *vfobox = NULL;
+
+
+static GtkWidget *rig_gui_holder  (GtkWidget *(*create) (void));
+static void       rig_gui_rebuild (GtkWidget *holder, GtkWidget *(*create) (void));
+
 
 
 static void
@@ -116,7 +133,8 @@ rig_gui_create ()
 
 	gtk_box_pack_start (GTK_BOX (keypadbox), keypad,
 			    TRUE, TRUE, 0);
-	gtk_box_pack_start (GTK_BOX (keypadbox), rig_gui_vfo_create (),
+	vfobox = rig_gui_holder (rig_gui_vfo_create);
+	gtk_box_pack_start (GTK_BOX (keypadbox), vfobox,
 			    FALSE, FALSE, 0);
     gtk_widget_show (keypadbox);
 
@@ -135,13 +153,15 @@ rig_gui_create ()
 
 	hbox = gtk_hbox_new (FALSE, 5);
 
-	gtk_box_pack_start (GTK_BOX (hbox), rig_gui_buttons_create (),
+	buttonsbox = rig_gui_holder (rig_gui_buttons_create);
+	gtk_box_pack_start (GTK_BOX (hbox), buttonsbox,
 			    FALSE, FALSE, 0);
 	gtk_box_pack_start (GTK_BOX (hbox), rig_gui_smeter_create (),
 			    FALSE, FALSE, 0);
 	gtk_box_pack_start (GTK_BOX (hbox), lcdbox,
 			    FALSE, FALSE, 0);
-	gtk_box_pack_start (GTK_BOX (hbox), rig_gui_ctrl2_create (),
+	ctrl2box = rig_gui_holder (rig_gui_ctrl2_create);
+	gtk_box_pack_start (GTK_BOX (hbox), ctrl2box,
 			    FALSE, FALSE, 0);
     gtk_widget_show (hbox);
 
@@ -176,3 +196,99 @@ rig_gui_create ()
 	return vbox;
 }
 
+
+/** \brief Show another rig in the main window.
+ *  \param index The number of the rig, see rig-ctx.h.
+ *
+ * The main window reads the shared data of the selected rig, so it shows
+ * the new rig with its next readback. The mode, filter, AGC, antenna,
+ * attenuator, preamp and VFO controls are rebuilt for the capabilities of
+ * the new rig; their readback timers go with the old widgets. The level
+ * and function windows are closed first so that the fields they have
+ * asked for are released on the old rig. The TX meter selection is kept and the meter buffers are cleared
+ * so that the s-meter does not mix the readings of both rigs.
+ */
+void
+rig_gui_select_rig (gint index)
+{
+	smeter_tx_mode_t  txmeter;
+	gchar            *brand;
+	gchar            *model;
+	gchar            *title;
+	gint              i;
+
+
+	if ((rig_ctx_get (index) == NULL) || (index == rig_ctx_get_selected ())) {
+		return;
+	}
+
+	grig_menubar_force_rx_item (FALSE);
+	grig_menubar_force_tx_item (FALSE);
+	grig_menubar_force_func_item (FALSE);
+	grig_menubar_force_scope_item (FALSE);
+
+	txmeter = rig_data_get_tx_meter ();
+	rig_ctx_select (index);
+	rig_data_set_tx_meter (txmeter);
+
+	for (i = 0; i < RIG_METER_NUMBER; i++) {
+		rig_meter_clear (i);
+	}
+
+	rig_gui_rebuild (buttonsbox, rig_gui_buttons_create);
+	rig_gui_rebuild (ctrl2box, rig_gui_ctrl2_create);
+	rig_gui_rebuild (vfobox, rig_gui_vfo_create);
+
+	brand = rig_daemon_get_brand ();
+	model = rig_daemon_get_model ();
+	title = g_strdup_printf (_("GRIG: %s %s"), brand, model);
+
+	gtk_window_set_title (GTK_WINDOW (grigapp), title);
+
+	g_free (title);
+	g_free (brand);
+	g_free (model);
+}
+
+
+/** \brief Create a container for controls depending on the rig.
+ *  \param create The function creating the controls.
+ *  \return The container holding the controls.
+ */
+static GtkWidget *
+rig_gui_holder       (GtkWidget *(*create) (void))
+{
+	GtkWidget *holder;
+
+	holder = gtk_vbox_new (FALSE, 0);
+	gtk_box_pack_start (GTK_BOX (holder), create (), TRUE, TRUE, 0);
+
+	return holder;
+}
+
+
+/** \brief Replace the controls in a container.
+ *  \param holder The container made by rig_gui_holder().
+ *  \param create The function creating the controls.
+ *
+ * The old controls are destroyed, which also stops their readback timer.
+ */
+static void
+rig_gui_rebuild      (GtkWidget *holder, GtkWidget *(*create) (void))
+{
+	GList     *children;
+	GList     *node;
+	GtkWidget *controls;
+
+	children = gtk_container_get_children (GTK_CONTAINER (holder));
+
+	for (node = children; node != NULL; node = node->next) {
+		gtk_widget_destroy (GTK_WIDGET (node->data));
+	}
+
+	g_list_free (children);
+
+	controls = create ();
+	gtk_box_pack_start (GTK_BOX (holder), controls, TRUE, TRUE, 0);
+	gtk_widget_show_all (controls);
+}
@@ -34,5 +34,6 @@
 
 GtkWidget *rig_gui_create (void);
 void rig_gui_show_keypad (gboolean *show);
+void rig_gui_select_rig (gint index);
 
 #endif
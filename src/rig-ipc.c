@@ -0,0 +1,1211 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+    Grig:  Gtk+ user interface for the Hamradio Control Libraries.
+
+    Copyright (C)  2001-2007  Alexandru Csete.
+
+    Authors: Alexandru Csete <oz9aec@gmail.com>
+
+    Comments, questions and bugreports should be submitted via
+    http://sourceforge.net/projects/groundstation/
+    More details can be found at the project home page:
+
+            http://groundstation.sourceforge.net/
+ 
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+  
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+  
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, visit http://www.fsf.org/
+ 
+ 
+ 
+*/
+/** \file rig-ipc.c
+ *  \ingroup shdata
+ *  \brief Server and client side of the grigd protocol.
+ *
+ * Both sides run in the main loop using GIOChannel watches on non-blocking
+ * sockets. The server compares the shared data with the state last sent to
+ * the clients every RIG_IPC_INTERVAL msec and streams the changes; the
+ * client applies them to its own copy of the shared data, from where the
+ * user interface reads them as usual. Settings changed by the user are
+ * collected from the 'new' flags and forwarded to the server, which hands
+ * them to its rig daemon.
+ *
+ * An address is either the path of a UNIX domain socket (it must contain a
+ * '/') or a TCP port on the loopback interface.
+ */
+#include <glib.h>
+#include <glib/gi18n.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <hamlib/rig.h>
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+#ifdef G_OS_WIN32
+#  include <winsock2.h>
+#else
+#  include <unistd.h>
+#  include <fcntl.h>
+#  include <sys/types.h>
+#  include <sys/socket.h>
+#  include <sys/stat.h>
+#  include <sys/time.h>
+#  include <sys/un.h>
+#  include <netinet/in.h>
+#  include <arpa/inet.h>
+#endif
+#include "compat.h"
+#include "grig-debug.h"
+#include "grig-latency.h"
+#include "rig-ctx.h"
+#include "rig-daemon.h"
+#include "rig-data.h"
+#include "rig-record.h"
+#include "rig-ipc.h"
+
+
+#define IPC_MAX_CLIENTS  16      /*!< Max number of simultaneous clients. */
+#define IPC_MAX_MSG      65536   /*!< Max size of a received message. */
+#define IPC_MAX_BACKLOG  16384   /*!< Pending output above which a client is resynchronised. */
+#define IPC_TIMEOUT      5       /*!< Timeout for the initial messages [sec]. */
+
+
+/** \brief The state streamed to the clients. */
+typedef struct {
+	grig_settings_t  get;       /*!< Settings read from the rig. */
+	grig_cmd_avail_t has_get;   /*!< Reading capabilities. */
+	grig_cmd_avail_t has_set;   /*!< Writing capabilities. */
+} ipc_state_t;
+
+
+typedef struct ipc_conn_s ipc_conn_t;
+
+/** \brief Message handler.
+ *  \return FALSE if the connection should be closed.
+ */
+typedef gboolean (*ipc_handler_t) (ipc_conn_t *conn, guint type,
+				   const guchar *data, guint size);
+
+
+/** \brief Connection to a client or to the server. */
+struct ipc_conn_s {
+	gint           fd;          /*!< The socket. */
+	GIOChannel    *chan;        /*!< Channel wrapping the socket. */
+	guint          readwatch;   /*!< Read watch. */
+	guint          writewatch;  /*!< Write watch while output is pending. */
+	GString       *in;          /*!< Received data not yet processed. */
+	GString       *out;         /*!< Output not yet sent. */
+	ipc_handler_t  handler;     /*!< Handler for received messages. */
+	void         (*lost) (ipc_conn_t *);  /*!< Called when the connection fails. */
+	gboolean       resync;      /*!< Send complete state when output has been sent. */
+	guint32        interest;    /*!< Fields registered on behalf of the client. */
+};
+
+
+/** \brief Field which can be set by a client. */
+typedef struct {
+	gsize      offset;   /*!< Offset in grig_settings_t. */
+	gsize      size;     /*!< Size of the field. */
+	gsize      flag;     /*!< Offset of the 'new' flag in grig_cmd_avail_t. */
+	gboolean   mirror;   /*!< Whether the rig_data setter also updates 'get'. */
+} ipc_field_t;
+
+#define IPC_FIELD(f,m) { G_STRUCT_OFFSET (grig_settings_t, f),		\
+			 sizeof (((grig_settings_t *) 0)->f),		\
+			 G_STRUCT_OFFSET (grig_cmd_avail_t, f), m }
+
+/** \brief Fields executed on behalf of the clients; funcs are handled separately. */
+static const ipc_field_t IPC_FIELDS[] = {
+	IPC_FIELD (pstat,         TRUE),
+	IPC_FIELD (ptt,           TRUE),
+	IPC_FIELD (lock,          FALSE),
+	IPC_FIELD (vfo,           TRUE),
+	IPC_FIELD (mode,          TRUE),
+	IPC_FIELD (pbw,           TRUE),
+	IPC_FIELD (freq1,         TRUE),
+	IPC_FIELD (freq2,         TRUE),
+	IPC_FIELD (rit,           TRUE),
+	IPC_FIELD (xit,           TRUE),
+	IPC_FIELD (agc,           TRUE),
+	IPC_FIELD (att,           TRUE),
+	IPC_FIELD (preamp,        TRUE),
+	IPC_FIELD (split,         FALSE),
+	IPC_FIELD (antenna,       TRUE),
+	IPC_FIELD (afg,           TRUE),
+	IPC_FIELD (rfg,           TRUE),
+	IPC_FIELD (sql,           TRUE),
+	IPC_FIELD (ifs,           TRUE),
+	IPC_FIELD (apf,           TRUE),
+	IPC_FIELD (nr,            TRUE),
+	IPC_FIELD (notch,         TRUE),
+	IPC_FIELD (pbtin,         TRUE),
+	IPC_FIELD (pbtout,        TRUE),
+	IPC_FIELD (cwpitch,       TRUE),
+	IPC_FIELD (keyspd,        TRUE),
+	IPC_FIELD (bkindel,       TRUE),
+	IPC_FIELD (balance,       TRUE),
+	IPC_FIELD (voxdel,        TRUE),
+	IPC_FIELD (voxg,          TRUE),
+	IPC_FIELD (antivox,       TRUE),
+	IPC_FIELD (micg,          TRUE),
+	IPC_FIELD (comp,          TRUE),
+	IPC_FIELD (power,         TRUE),
+	IPC_FIELD (alc,           FALSE),
+	IPC_FIELD (vfo_op_toggle, FALSE),
+	IPC_FIELD (vfo_op_copy,   FALSE),
+	IPC_FIELD (vfo_op_xchg,   FALSE)
+};
+
+
+#ifdef G_OS_WIN32
+#  define ipc_close_socket(fd) closesocket (fd)
+#  define ipc_channel_new(fd)  g_io_channel_win32_new_socket (fd)
+#  define ipc_try_again()      ((WSAGetLastError () == WSAEWOULDBLOCK) || \
+				(WSAGetLastError () == WSAEINTR))
+#else
+#  define ipc_close_socket(fd) close (fd)
+#  define ipc_channel_new(fd)  g_io_channel_unix_new (fd)
+#  define ipc_try_again()      ((errno == EAGAIN) || (errno == EINTR))
+#endif
+
+#ifdef MSG_NOSIGNAL
+#  define IPC_SEND_FLAGS MSG_NOSIGNAL
+#else
+#  define IPC_SEND_FLAGS 0
+#endif
+
+
+/* server */
+static gint         listenfd    = -1;    /*!< Listening socket. */
+static GIOChannel  *listenchan  = NULL;  /*!< Channel wrapping the listening socket. */
+static guint        listenwatch = 0;     /*!< Accept watch. */
+static gchar       *listenpath  = NULL;  /*!< Socket file removed when stopping. */
+static guint        tickid      = 0;     /*!< Delta timeout. */
+static GSList      *clients     = NULL;  /*!< Connected clients. */
+static ipc_state_t  sent;                /*!< State last sent to the clients. */
+
+/* client */
+static ipc_conn_t       *server  = NULL; /*!< Connection to grigd. */
+static guint             flushid = 0;    /*!< Timeout forwarding the settings. */
+static ipc_state_t       mirror;         /*!< State received from grigd. */
+static rig_ipc_control_t control;        /*!< Control message last sent. */
+
+
+static gint       ipc_socket_open     (const gchar *addr, gboolean listening);
+static gboolean   ipc_set_nonblock    (gint fd);
+static gboolean   ipc_recv_msg        (gint fd, guint type, gpointer data, guint size);
+static void       ipc_state_read      (ipc_state_t *state);
+static void       ipc_state_write     (const ipc_state_t *state, gsize off, gsize len);
+static ipc_conn_t *ipc_conn_new       (gint fd, ipc_handler_t handler,
+				       void (*lost) (ipc_conn_t *));
+static void       ipc_conn_free       (ipc_conn_t *conn);
+static void       ipc_conn_send       (ipc_conn_t *conn, guint type,
+				       gconstpointer data, guint size);
+static gboolean   ipc_conn_flush      (ipc_conn_t *conn);
+static gboolean   ipc_conn_read       (GIOChannel *chan, GIOCondition cond, gpointer data);
+static gboolean   ipc_conn_write      (GIOChannel *chan, GIOCondition cond, gpointer data);
+static gboolean   ipc_server_accept   (GIOChannel *chan, GIOCondition cond, gpointer data);
+static gboolean   ipc_server_tick     (gpointer data);
+static gboolean   ipc_server_handle   (ipc_conn_t *, guint, const guchar *, guint);
+static void       ipc_server_close    (ipc_conn_t *conn);
+static void       ipc_server_interest (ipc_conn_t *conn, guint32 interest);
+static gboolean   ipc_client_flush    (gpointer data);
+static gboolean   ipc_client_handle   (ipc_conn_t *, guint, const guchar *, guint);
+static void       ipc_client_close    (ipc_conn_t *conn);
+
+
+
+/** \brief Get the default address.
+ *  \return A newly allocated string; ~/.grig/grigd.sock or the default
+ *          TCP port where UNIX domain sockets are not available.
+ */
+gchar *
+rig_ipc_default_addr ()
+{
+#ifdef G_OS_WIN32
+	return g_strdup_printf ("%d", RIG_IPC_DEF_PORT);
+#else
+	return get_conf_dir ("grigd.sock");
+#endif
+}
+
+
+/** \brief Start serving the rig to grig clients.
+ *  \param addr Socket path or TCP port.
+ *  \return TRUE if the server has been started.
+ *
+ * The rig daemon must have been started before the server. A UNIX domain
+ * socket is only accessible by the user running grigd.
+ */
+gboolean
+rig_ipc_server_start (const gchar *addr)
+{
+	if (listenfd != -1)
+		return FALSE;
+
+	listenfd = ipc_socket_open (addr, TRUE);
+	if (listenfd < 0) {
+		listenfd = -1;
+		return FALSE;
+	}
+
+	if (strchr (addr, '/') != NULL) {
+		listenpath = g_strdup (addr);
+	}
+
+	ipc_state_read (&sent);
+
+	listenchan = ipc_channel_new (listenfd);
+	listenwatch = g_io_add_watch (listenchan, G_IO_IN, ipc_server_accept, NULL);
+	tickid = grig_latency_timeout_add (RIG_IPC_INTERVAL, ipc_server_tick,
+					   NULL, "ipc-server");
+
+	grig_debug_local (RIG_DEBUG_VERBOSE,
+			  _("%s: Serving grig clients at %s"),
+			  __FUNCTION__, addr);
+
+	return TRUE;
+}
+
+
+/** \brief Stop the server and close all client connections. */
+void
+rig_ipc_server_stop  ()
+{
+	while (clients != NULL) {
+		ipc_server_close ((ipc_conn_t *) clients->data);
+	}
+
+	if (tickid != 0) {
+		g_source_remove (tickid);
+		tickid = 0;
+	}
+
+	if (listenwatch != 0) {
+		g_source_remove (listenwatch);
+		listenwatch = 0;
+	}
+
+	if (listenchan != NULL) {
+		g_io_channel_unref (listenchan);
+		listenchan = NULL;
+	}
+
+	if (listenfd != -1) {
+		ipc_close_socket (listenfd);
+		listenfd = -1;
+	}
+
+#ifndef G_OS_WIN32
+	if (listenpath != NULL) {
+		unlink (listenpath);
+	}
+#endif
+	g_free (listenpath);
+	listenpath = NULL;
+}
+
+
+/** \brief Attach to a running grigd.
+ *  \param addr Socket path or TCP port.
+ *  \param rigid Location to store the hamlib model of the radio.
+ *  \return TRUE if the connection has been established.
+ *
+ * The shared data are initialised with the state received from grigd and
+ * kept up to date from then on. Settings changed by the user interface are
+ * forwarded to grigd instead of being executed by a local daemon.
+ */
+gboolean
+rig_ipc_connect      (const gchar *addr, gint *rigid)
+{
+	rig_ipc_hello_t  hello;
+	gint             fd;
+	guint            i;
+
+
+	if (server != NULL)
+		return FALSE;
+
+	fd = ipc_socket_open (addr, FALSE);
+	if (fd < 0)
+		return FALSE;
+
+	if (!ipc_recv_msg (fd, RIG_IPC_MSG_HELLO, &hello, sizeof (hello))) {
+		grig_debug_local (RIG_DEBUG_ERR,
+				  _("%s: No answer from grigd at %s"),
+				  __FUNCTION__, addr);
+		ipc_close_socket (fd);
+		return FALSE;
+	}
+
+	if ((hello.magic != RIG_IPC_MAGIC) ||
+	    (hello.version != RIG_IPC_VERSION) ||
+	    (hello.settings_size != sizeof (grig_settings_t)) ||
+	    (hello.avail_size != sizeof (grig_cmd_avail_t))) {
+		grig_debug_local (RIG_DEBUG_ERR,
+				  _("%s: %s is not a compatible grigd"),
+				  __FUNCTION__, addr);
+		ipc_close_socket (fd);
+		return FALSE;
+	}
+
+	memset (&mirror, 0, sizeof (mirror));
+	if (!ipc_recv_msg (fd, RIG_IPC_MSG_STATE, &mirror, sizeof (mirror)) ||
+	    !ipc_set_nonblock (fd)) {
+		grig_debug_local (RIG_DEBUG_ERR,
+				  _("%s: Could not get rig state from %s"),
+				  __FUNCTION__, addr);
+		ipc_close_socket (fd);
+		return FALSE;
+	}
+
+	/* rig data which are usually set up by the daemon */
+	rig_data_set_vfos (hello.vfos);
+	rig_data_set_max_rfpwr (hello.maxpwr);
+	for (i = 0; i < HAMLIB_MAXDBLSTSIZ; i++) {
+		rig_data_set_att_data (i, hello.att[i]);
+		rig_data_set_preamp_data (i, hello.preamp[i]);
+	}
+
+	ipc_state_write (&mirror, 0, sizeof (mirror));
+
+	/* start with the current settings */
+	memcpy (rig_data_get_set_addr (), &mirror.get, sizeof (grig_settings_t));
+	memset (rig_data_get_new_addr (), 0, sizeof (grig_cmd_avail_t));
+
+	/* make sure that the first control message is sent */
+	control.interest = 0;
+	control.txmeter = SMETER_TX_MODE_LAST;
+
+	server = ipc_conn_new (fd, ipc_client_handle, ipc_client_close);
+	flushid = grig_latency_timeout_add (RIG_IPC_INTERVAL, ipc_client_flush,
+					    NULL, "ipc-client");
+
+	*rigid = hello.rigid;
+
+	return TRUE;
+}
+
+
+/** \brief Detach from grigd. */
+void
+rig_ipc_disconnect   ()
+{
+	if (flushid != 0) {
+		g_source_remove (flushid);
+		flushid = 0;
+	}
+
+	/* send pending settings; the socket is non-blocking */
+	if (server != NULL) {
+		ipc_client_flush (NULL);
+	}
+
+	if (server != NULL) {
+		ipc_conn_free (server);
+		server = NULL;
+	}
+}
+
+
+/** \brief Open a listening or connected socket.
+ *  \param addr Socket path or TCP port.
+ *  \param listening Whether to listen on or connect to the address.
+ *  \return The socket or -1 on error.
+ */
+static gint
+ipc_socket_open      (const gchar *addr, gboolean listening)
+{
+	struct sockaddr_in  inaddr;
+#ifndef G_OS_WIN32
+	struct sockaddr_un  unaddr;
+#else
+	WSADATA             wsadata;
+#endif
+	struct sockaddr    *sa;
+	gsize               salen;
+	gint                fd;
+	gint                port;
+	gint                on = 1;
+	gchar              *end;
+
+
+	if (addr == NULL)
+		return -1;
+
+#ifdef G_OS_WIN32
+	if (WSAStartup (MAKEWORD (2, 2), &wsadata) != 0) {
+		grig_debug_local (RIG_DEBUG_ERR,
+				  _("%s: Could not initialise Winsock"),
+				  __FUNCTION__);
+		return -1;
+	}
+#endif
+
+	if (strchr (addr, '/') != NULL) {
+#ifdef G_OS_WIN32
+		grig_debug_local (RIG_DEBUG_ERR,
+				  _("%s: UNIX domain sockets are not supported on this platform"),
+				  __FUNCTION__);
+		return -1;
+#else
+		if (strlen (addr) >= sizeof (unaddr.sun_path)) {
+			grig_debug_local (RIG_DEBUG_ERR,
+					  _("%s: Socket path too long: %s"),
+					  __FUNCTION__, addr);
+			return -1;
+		}
+
+		memset (&unaddr, 0, sizeof (unaddr));
+		unaddr.sun_family = AF_UNIX;
+		strcpy (unaddr.sun_path, addr);
+		sa = (struct sockaddr *) &unaddr;
+		salen = sizeof (unaddr);
+
+		fd = socket (AF_UNIX, SOCK_STREAM, 0);
+#endif
+	}
+	else {
+		port = strtol (addr, &end, 10);
+
+		if ((*end != '\0') || (port <= 0) || (port > 65535)) {
+			grig_debug_local (RIG_DEBUG_ERR,
+					  _("%s: Invalid address: %s"),
+					  __FUNCTION__, addr);
+			return -1;
+		}
+
+		memset (&inaddr, 0, sizeof (inaddr));
+		inaddr.sin_family = AF_INET;
+		inaddr.sin_port = htons ((guint16) port);
+		inaddr.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+		sa = (struct sockaddr *) &inaddr;
+		salen = sizeof (inaddr);
+
+		fd = socket (AF_INET, SOCK_STREAM, 0);
+	}
+
+	if (fd < 0) {
+		grig_debug_local (RIG_DEBUG_ERR,
+				  _("%s: Could not create socket (%s)"),
+				  __FUNCTION__, g_strerror (errno));
+		return -1;
+	}
+
+	if (!listening) {
+		if (connect (fd, sa, salen) < 0) {
+			grig_debug_local (RIG_DEBUG_ERR,
+					  _("%s: Could not connect to %s (%s)"),
+					  __FUNCTION__, addr, g_strerror (errno));
+			ipc_close_socket (fd);
+			return -1;
+		}
+
+		return fd;
+	}
+
+#ifndef G_OS_WIN32
+	/* remove the socket of a previous run unless grigd is still there */
+	if (sa->sa_family == AF_UNIX) {
+		if (connect (fd, sa, salen) == 0) {
+			grig_debug_local (RIG_DEBUG_ERR,
+					  _("%s: %s is already in use"),
+					  __FUNCTION__, addr);
+			ipc_close_socket (fd);
+			return -1;
+		}
+
+		ipc_close_socket (fd);
+		unlink (addr);
+		fd = socket (AF_UNIX, SOCK_STREAM, 0);
+	}
+	else
+#endif
+	{
+		setsockopt (fd, SOL_SOCKET, SO_REUSEADDR, (const void *) &on, sizeof (on));
+	}
+
+	if ((fd < 0) || (bind (fd, sa, salen) < 0)) {
+		grig_debug_local (RIG_DEBUG_ERR,
+				  _("%s: Could not bind to %s (%s)"),
+				  __FUNCTION__, addr, g_strerror (errno));
+		if (fd >= 0)
+			ipc_close_socket (fd);
+		return -1;
+	}
+
+#ifndef G_OS_WIN32
+	if (sa->sa_family == AF_UNIX) {
+		chmod (addr, S_IRUSR | S_IWUSR);
+	}
+#endif
+
+	if ((listen (fd, 5) < 0) || !ipc_set_nonblock (fd)) {
+		grig_debug_local (RIG_DEBUG_ERR,
+				  _("%s: Could not listen on %s (%s)"),
+				  __FUNCTION__, addr, g_strerror (errno));
+		ipc_close_socket (fd);
+		return -1;
+	}
+
+	return fd;
+}
+
+
+/** \brief Make socket non-blocking. */
+static gboolean
+ipc_set_nonblock     (gint fd)
+{
+#ifdef G_OS_WIN32
+	u_long on = 1;
+
+	return (ioctlsocket (fd, FIONBIO, &on) == 0);
+#else
+	gint flags;
+
+	flags = fcntl (fd, F_GETFL, 0);
+
+	return ((flags >= 0) && (fcntl (fd, F_SETFL, flags | O_NONBLOCK) == 0));
+#endif
+}
+
+
+/** \brief Receive a message on a blocking socket.
+ *  \param fd The socket.
+ *  \param type The expected message type.
+ *  \param data Buffer for the payload.
+ *  \param size The expected size of the payload.
+ *  \return TRUE if the expected message has been received.
+ *
+ * Used while connecting; gives up after IPC_TIMEOUT seconds without data.
+ */
+static gboolean
+ipc_recv_msg         (gint fd, guint type, gpointer data, guint size)
+{
+	rig_ipc_msg_t  msg;
+	guchar        *buf;
+	guint          n;
+	gint           len;
+#ifdef G_OS_WIN32
+	DWORD          tmo = 1000 * IPC_TIMEOUT;
+#else
+	struct timeval tmo = { IPC_TIMEOUT, 0 };
+#endif
+
+
+	setsockopt (fd, SOL_SOCKET, SO_RCVTIMEO, (const void *) &tmo, sizeof (tmo));
+
+	for (n = 0; n < sizeof (msg) + size; n += len) {
+
+		if (n < sizeof (msg)) {
+			buf = (guchar *) &msg + n;
+			len = sizeof (msg) - n;
+		}
+		else {
+			buf = (guchar *) data + n - sizeof (msg);
+			len = sizeof (msg) + size - n;
+		}
+
+		len = recv (fd, buf, len, 0);
+		if (len <= 0)
+			return FALSE;
+
+		if ((n + len == sizeof (msg)) &&
+		    ((msg.type != type) || (msg.size != size)))
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+
+/** \brief Copy the shared data to a state structure. */
+static void
+ipc_state_read       (ipc_state_t *state)
+{
+	/* clear padding so that it never shows up as a change */
+	memset (state, 0, sizeof (ipc_state_t));
+
+	memcpy (&state->get, rig_data_get_get_addr (), sizeof (grig_settings_t));
+	memcpy (&state->has_get, rig_data_get_has_get_addr (), sizeof (grig_cmd_avail_t));
+	memcpy (&state->has_set, rig_data_get_has_set_addr (), sizeof (grig_cmd_avail_t));
+}
+
+
+/** \brief Copy part of a state structure to the shared data.
+ *  \param state The state.
+ *  \param off Offset of the part to copy.
+ *  \param len Length of the part to copy.
+ */
+static void
+ipc_state_write      (const ipc_state_t *state, gsize off, gsize len)
+{
+	guchar *dst[3];
+	gsize   start[3];
+	gsize   size[3];
+	gsize   lo, hi;
+	guint   i;
+
+
+	dst[0]   = (guchar *) rig_data_get_get_addr ();
+	start[0] = G_STRUCT_OFFSET (ipc_state_t, get);
+	size[0]  = sizeof (grig_settings_t);
+	dst[1]   = (guchar *) rig_data_get_has_get_addr ();
+	start[1] = G_STRUCT_OFFSET (ipc_state_t, has_get);
+	size[1]  = sizeof (grig_cmd_avail_t);
+	dst[2]   = (guchar *) rig_data_get_has_set_addr ();
+	start[2] = G_STRUCT_OFFSET (ipc_state_t, has_set);
+	size[2]  = sizeof (grig_cmd_avail_t);
+
+	for (i = 0; i < 3; i++) {
+		lo = MAX (off, start[i]);
+		hi = MIN (off + len, start[i] + size[i]);
+
+		if (lo < hi)
+			memcpy (dst[i] + lo - start[i], (const guchar *) state + lo, hi - lo);
+	}
+}
+
+
+/** \brief Create a connection on a non-blocking socket. */
+static ipc_conn_t *
+ipc_conn_new         (gint fd, ipc_handler_t handler, void (*lost) (ipc_conn_t *))
+{
+	ipc_conn_t *conn;
+
+
+	conn = g_new0 (ipc_conn_t, 1);
+	conn->fd = fd;
+	conn->chan = ipc_channel_new (fd);
+	conn->in = g_string_new (NULL);
+	conn->out = g_string_new (NULL);
+	conn->handler = handler;
+	conn->lost = lost;
+	conn->readwatch = g_io_add_watch (conn->chan, G_IO_IN | G_IO_HUP | G_IO_ERR,
+					  ipc_conn_read, conn);
+
+	return conn;
+}
+
+
+/** \brief Close the socket and free the connection. */
+static void
+ipc_conn_free        (ipc_conn_t *conn)
+{
+	if (conn->readwatch != 0)
+		g_source_remove (conn->readwatch);
+
+	if (conn->writewatch != 0)
+		g_source_remove (conn->writewatch);
+
+	g_io_channel_unref (conn->chan);
+	ipc_close_socket (conn->fd);
+	g_string_free (conn->in, TRUE);
+	g_string_free (conn->out, TRUE);
+	g_free (conn);
+}
+
+
+/** \brief Queue a message; it is sent by the next flush. */
+static void
+ipc_conn_send        (ipc_conn_t *conn, guint type, gconstpointer data, guint size)
+{
+	rig_ipc_msg_t msg;
+
+
+	msg.type = type;
+	msg.reserved = 0;
+	msg.size = size;
+
+	g_string_append_len (conn->out, (const gchar *) &msg, sizeof (msg));
+	g_string_append_len (conn->out, (const gchar *) data, size);
+}
+
+
+/** \brief Send as much pending output as possible.
+ *  \return FALSE if the connection has failed.
+ *
+ * A write watch is installed while output is pending.
+ */
+static gboolean
+ipc_conn_flush       (ipc_conn_t *conn)
+{
+	gint len;
+
+
+	if (conn->out->len == 0)
+		return TRUE;
+
+	len = send (conn->fd, conn->out->str, conn->out->len, IPC_SEND_FLAGS);
+
+	if (len > 0) {
+		g_string_erase (conn->out, 0, len);
+	}
+	else if ((len < 0) && !ipc_try_again ()) {
+		return FALSE;
+	}
+
+	if ((conn->out->len > 0) && (conn->writewatch == 0)) {
+		conn->writewatch = g_io_add_watch (conn->chan,
+						   G_IO_OUT | G_IO_HUP | G_IO_ERR,
+						   ipc_conn_write, conn);
+	}
+
+	return TRUE;
+}
+
+
+/** \brief Read and dispatch complete messages. */
+static gboolean
+ipc_conn_read        (GIOChannel *chan, GIOCondition cond, gpointer data)
+{
+	ipc_conn_t    *conn = (ipc_conn_t *) data;
+	rig_ipc_msg_t  msg;
+	gchar          buf[4096];
+	gint           len;
+	gsize          pos = 0;
+
+
+	len = recv (conn->fd, buf, sizeof (buf), 0);
+
+	if (len <= 0) {
+		if ((len < 0) && !(cond & (G_IO_HUP | G_IO_ERR)) &&
+		    ipc_try_again ()) {
+			return TRUE;
+		}
+
+		conn->readwatch = 0;
+		conn->lost (conn);
+		return FALSE;
+	}
+
+	g_string_append_len (conn->in, buf, len);
+
+	while (conn->in->len - pos >= sizeof (msg)) {
+
+		memcpy (&msg, conn->in->str + pos, sizeof (msg));
+
+		if (msg.size > IPC_MAX_MSG) {
+			conn->readwatch = 0;
+			conn->lost (conn);
+			return FALSE;
+		}
+
+		if (conn->in->len - pos < sizeof (msg) + msg.size)
+			break;
+
+		if (!conn->handler (conn, msg.type,
+				    (const guchar *) conn->in->str + pos + sizeof (msg),
+				    msg.size)) {
+			conn->readwatch = 0;
+			conn->lost (conn);
+			return FALSE;
+		}
+
+		pos += sizeof (msg) + msg.size;
+	}
+
+	g_string_erase (conn->in, 0, pos);
+
+	if (!ipc_conn_flush (conn)) {
+		conn->readwatch = 0;
+		conn->lost (conn);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+
+/** \brief Send pending output when the peer is ready for it. */
+static gboolean
+ipc_conn_write       (GIOChannel *chan, GIOCondition cond, gpointer data)
+{
+	ipc_conn_t *conn = (ipc_conn_t *) data;
+
+
+	if ((cond & (G_IO_HUP | G_IO_ERR)) || !ipc_conn_flush (conn)) {
+		conn->writewatch = 0;
+		conn->lost (conn);
+		return FALSE;
+	}
+
+	if (conn->out->len > 0)
+		return TRUE;
+
+	conn->writewatch = 0;
+
+	return FALSE;
+}
+
+
+/** \brief Accept a new client and send it the current state. */
+static gboolean
+ipc_server_accept    (GIOChannel *chan, GIOCondition cond, gpointer data)
+{
+	ipc_conn_t      *conn;
+	rig_ipc_hello_t  hello;
+	rig_ctx_t       *prev;
+	gint             fd;
+	guint            i;
+
+
+	fd = accept (listenfd, NULL, NULL);
+
+	if (fd < 0)
+		return TRUE;
+
+	if ((g_slist_length (clients) >= IPC_MAX_CLIENTS) ||
+	    !ipc_set_nonblock (fd)) {
+		grig_debug_local (RIG_DEBUG_WARN,
+				  _("%s: Connection refused (%d clients)"),
+				  __FUNCTION__, g_slist_length (clients));
+		ipc_close_socket (fd);
+		return TRUE;
+	}
+
+	/* clients always see the primary rig */
+	prev = rig_ctx_bind (rig_ctx_get (0));
+
+	memset (&hello, 0, sizeof (hello));
+	hello.magic = RIG_IPC_MAGIC;
+	hello.version = RIG_IPC_VERSION;
+	hello.rigid = rig_daemon_get_rig_id ();
+	hello.settings_size = sizeof (grig_settings_t);
+	hello.avail_size = sizeof (grig_cmd_avail_t);
+	hello.vfos = rig_data_get_vfos ();
+	hello.maxpwr = rig_data_get_max_rfpwr ();
+	for (i = 0; i < HAMLIB_MAXDBLSTSIZ; i++) {
+		hello.att[i] = rig_data_get_att_data (i);
+		hello.preamp[i] = rig_data_get_preamp_data (i);
+	}
+
+	rig_ctx_bind (prev);
+
+	conn = ipc_conn_new (fd, ipc_server_handle, ipc_server_close);
+	clients = g_slist_prepend (clients, conn);
+
+	/* attached clients keep the rig at the full poll rate */
+	rig_daemon_add_consumer ();
+
+	ipc_conn_send (conn, RIG_IPC_MSG_HELLO, &hello, sizeof (hello));
+	ipc_conn_send (conn, RIG_IPC_MSG_STATE, &sent, sizeof (sent));
+
+	grig_debug_local (RIG_DEBUG_VERBOSE,
+			  _("%s: Client connected (%d clients)"),
+			  __FUNCTION__, g_slist_length (clients));
+
+	if (!ipc_conn_flush (conn))
+		ipc_server_close (conn);
+
+	return TRUE;
+}
+
+
+/** \brief Send the changes of the shared data to the clients.
+ *
+ * The changes are encoded once and queued for every client. Clients with
+ * too much pending output skip the changes and receive the complete state
+ * when they have caught up.
+ */
+static gboolean
+ipc_server_tick      (gpointer data)
+{
+	ipc_state_t  state;
+	ipc_conn_t  *conn;
+	rig_ctx_t   *prev;
+	GSList      *node;
+	GSList      *next;
+	guchar       diff[3 * sizeof (ipc_state_t)];
+	guint16      len;
+
+
+	prev = rig_ctx_bind (rig_ctx_get (0));
+	ipc_state_read (&state);
+	rig_ctx_bind (prev);
+
+	len = rig_record_diff ((const guchar *) &sent, (const guchar *) &state,
+			       sizeof (ipc_state_t), diff);
+
+	if (len > 0) {
+		memcpy (&sent, &state, sizeof (ipc_state_t));
+	}
+
+	for (node = clients; node != NULL; node = next) {
+		next = node->next;
+		conn = (ipc_conn_t *) node->data;
+
+		if (conn->resync) {
+			if (conn->out->len > 0)
+				continue;
+
+			ipc_conn_send (conn, RIG_IPC_MSG_STATE, &sent, sizeof (sent));
+			conn->resync = FALSE;
+		}
+		else if (len == 0) {
+			continue;
+		}
+		else if (conn->out->len > IPC_MAX_BACKLOG) {
+			conn->resync = TRUE;
+			continue;
+		}
+		else {
+			ipc_conn_send (conn, RIG_IPC_MSG_DELTA, diff, len);
+		}
+
+		if (!ipc_conn_flush (conn))
+			ipc_server_close (conn);
+	}
+
+	return TRUE;
+}
+
+
+/** \brief Handle a message from a client. */
+static gboolean
+ipc_server_handle    (ipc_conn_t *conn, guint type, const guchar *data, guint size)
+{
+	grig_settings_t    cset;
+	grig_cmd_avail_t   cnew;
+	rig_ipc_control_t  ctl;
+	grig_settings_t   *set;
+	grig_settings_t   *get;
+	grig_cmd_avail_t  *new;
+	const ipc_field_t *field;
+	rig_ctx_t         *prev;
+	guint              i;
+
+
+	switch (type) {
+
+	case RIG_IPC_MSG_SET:
+		if (size != sizeof (cset) + sizeof (cnew))
+			return FALSE;
+
+		memcpy (&cset, data, sizeof (cset));
+		memcpy (&cnew, data + sizeof (cset), sizeof (cnew));
+
+		prev = rig_ctx_bind (rig_ctx_get (0));
+
+		set = rig_data_get_set_addr ();
+		get = rig_data_get_get_addr ();
+		new = rig_data_get_new_addr ();
+
+		/* same as the rig_data setters: value first, then the flag */
+		for (i = 0; i < G_N_ELEMENTS (IPC_FIELDS); i++) {
+			field = &IPC_FIELDS[i];
+
+			if (!G_STRUCT_MEMBER (int, &cnew, field->flag))
+				continue;
+
+			memcpy ((guchar *) set + field->offset,
+				(guchar *) &cset + field->offset, field->size);
+
+			if (field->mirror)
+				memcpy ((guchar *) get + field->offset,
+					(guchar *) &cset + field->offset, field->size);
+
+			G_STRUCT_MEMBER (int, new, field->flag) = 1;
+		}
+
+		for (i = 0; i < RIG_SETTING_MAX; i++) {
+			if (cnew.funcs[i]) {
+				set->funcs[i] = cset.funcs[i];
+				new->funcs[i] = 1;
+			}
+		}
+
+		rig_ctx_bind (prev);
+		break;
+
+	case RIG_IPC_MSG_CONTROL:
+		if (size != sizeof (ctl))
+			return FALSE;
+
+		memcpy (&ctl, data, sizeof (ctl));
+
+		prev = rig_ctx_bind (rig_ctx_get (0));
+
+		ipc_server_interest (conn, ctl.interest);
+
+		if (ctl.txmeter < SMETER_TX_MODE_LAST)
+			rig_data_set_tx_meter (ctl.txmeter);
+
+		rig_ctx_bind (prev);
+		break;
+
+	default:
+		/* ignore unknown messages from newer clients */
+		break;
+	}
+
+	return TRUE;
+}
+
+
+/** \brief Close a client connection and release its fields. */
+static void
+ipc_server_close     (ipc_conn_t *conn)
+{
+	rig_ctx_t *prev;
+
+
+	clients = g_slist_remove (clients, conn);
+	rig_daemon_remove_consumer ();
+
+	prev = rig_ctx_bind (rig_ctx_get (0));
+	ipc_server_interest (conn, 0);
+	rig_ctx_bind (prev);
+
+	ipc_conn_free (conn);
+
+	grig_debug_local (RIG_DEBUG_VERBOSE,
+			  _("%s: Client disconnected (%d clients)"),
+			  __FUNCTION__, g_slist_length (clients));
+}
+
+
+/** \brief Register the on-demand fields a client is interested in.
+ *  \param conn The client.
+ *  \param interest Bit field of rig_data_field_t.
+ */
+static void
+ipc_server_interest  (ipc_conn_t *conn, guint32 interest)
+{
+	guint i;
+
+
+	for (i = 0; i < RIG_DATA_FIELD_NUMBER; i++) {
+		if ((interest & ~conn->interest) & (1 << i))
+			rig_data_add_interest (i);
+		else if ((~interest & conn->interest) & (1 << i))
+			rig_data_remove_interest (i);
+	}
+
+	conn->interest = interest;
+}
+
+
+/** \brief Forward the settings changed by the user interface to grigd.
+ *
+ * Also sends the on-demand fields and TX meter the user interface needs
+ * whenever they change.
+ */
+static gboolean
+ipc_client_flush     (gpointer data)
+{
+	static const grig_cmd_avail_t none;
+	grig_cmd_avail_t  *new;
+	rig_ipc_control_t  ctl;
+	guchar             buf[sizeof (grig_settings_t) + sizeof (grig_cmd_avail_t)];
+	guint              i;
+
+
+	if (server == NULL)
+		return FALSE;
+
+	new = rig_data_get_new_addr ();
+
+	if (memcmp (new, &none, sizeof (grig_cmd_avail_t))) {
+		memcpy (buf, rig_data_get_set_addr (), sizeof (grig_settings_t));
+		memcpy (buf + sizeof (grig_settings_t), new, sizeof (grig_cmd_avail_t));
+		memset (new, 0, sizeof (grig_cmd_avail_t));
+
+		ipc_conn_send (server, RIG_IPC_MSG_SET, buf, sizeof (buf));
+	}
+
+	ctl.interest = 0;
+	for (i = 0; i < RIG_DATA_FIELD_NUMBER; i++) {
+		if (rig_data_has_interest (i))
+			ctl.interest |= 1 << i;
+	}
+	ctl.txmeter = rig_data_get_tx_meter ();
+
+	if ((ctl.interest != control.interest) || (ctl.txmeter != control.txmeter)) {
+		ipc_conn_send (server, RIG_IPC_MSG_CONTROL, &ctl, sizeof (ctl));
+		control = ctl;
+	}
+
+	if (!ipc_conn_flush (server)) {
+		flushid = 0;
+		ipc_client_close (server);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+
+/** \brief Handle a message from grigd. */
+static gboolean
+ipc_client_handle    (ipc_conn_t *conn, guint type, const guchar *data, guint size)
+{
+	guint16 off, len;
+	guint   i = 0;
+
+
+	switch (type) {
+
+	case RIG_IPC_MSG_STATE:
+		if (size != sizeof (ipc_state_t))
+			return FALSE;
+
+		memcpy (&mirror, data, sizeof (ipc_state_t));
+		ipc_state_write (&mirror, 0, sizeof (ipc_state_t));
+		break;
+
+	case RIG_IPC_MSG_DELTA:
+		/* only the changed parts are copied so that settings which
+		   have just been changed by the user are not overwritten */
+		while (i + 2 * sizeof (guint16) <= size) {
+			memcpy (&off, data + i, sizeof (guint16));
+			memcpy (&len, data + i + sizeof (guint16), sizeof (guint16));
+			i += 2 * sizeof (guint16);
+
+			if ((i + len > size) || (off + len > sizeof (ipc_state_t)))
+				return FALSE;
+
+			memcpy ((guchar *) &mirror + off, data + i, len);
+			ipc_state_write (&mirror, off, len);
+			i += len;
+		}
+		break;
+
+	default:
+		break;
+	}
+
+	return TRUE;
+}
+
+
+/** \brief Handle the loss of the connection to grigd.
+ *
+ * The user interface keeps running with the last received state.
+ */
+static void
+ipc_client_close     (ipc_conn_t *conn)
+{
+	grig_debug_local (RIG_DEBUG_ERR,
+			  _("%s: Lost connection to grigd"),
+			  __FUNCTION__);
+
+	if (flushid != 0) {
+		g_source_remove (flushid);
+		flushid = 0;
+	}
+
+	ipc_conn_free (conn);
+	server = NULL;
+}
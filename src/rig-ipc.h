@@ -0,0 +1,120 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+    Grig:  Gtk+ user interface for the Hamradio Control Libraries.
+
+    Copyright (C)  2001-2007  Alexandru Csete.
+
+    Authors: Alexandru Csete <oz9aec@gmail.com>
+
+    Comments, questions and bugreports should be submitted via
+    http://sourceforge.net/projects/groundstation/
+    More details can be found at the project home page:
+
+            http://groundstation.sourceforge.net/
+ 
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+  
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+  
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, visit http://www.fsf.org/
+ 
+ 
+ 
+*/
+/** \file rig-ipc.h
+ *  \ingroup shdata
+ *  \brief Protocol between the grigd daemon and its clients.
+ *
+ * grigd owns the radio and runs the rig daemon; any number of grig user
+ * interfaces can attach to it through a UNIX domain socket or a TCP port
+ * on the loopback interface, e.g. forwarded over ssh from another host.
+ *
+ * Every message starts with a rig_ipc_msg_t header followed by 'size'
+ * bytes of payload. All values are in host byte order; server and client
+ * must use the same build of grig, which is checked in the HELLO message.
+ *
+ * Server to client:
+ *
+ *   HELLO    rig_ipc_hello_t; sent once after connecting
+ *   STATE    complete state: 'get', 'has_get' and 'has_set' settings
+ *   DELTA    changes to the state encoded as (guint16 offset,
+ *            guint16 length, data) runs, see rig_record_diff()
+ *
+ * Client to server:
+ *
+ *   SET      grig_settings_t 'set' followed by grig_cmd_avail_t 'new';
+ *            the fields flagged in 'new' are executed by the daemon
+ *   CONTROL  rig_ipc_control_t; fields the client polls on demand and
+ *            the TX meter it displays
+ *
+ * A client which does not keep up with the deltas is sent a new STATE
+ * once its pending output has been sent.
+ */
+#ifndef RIG_IPC_H
+#define RIG_IPC_H 1
+
+#include <glib.h>
+#include "rig-data.h"
+
+
+#define RIG_IPC_MAGIC     0x47524944  /*!< "GRID" */
+#define RIG_IPC_VERSION   1           /*!< Protocol version. */
+#define RIG_IPC_DEF_PORT  4534        /*!< Default TCP port. */
+#define RIG_IPC_INTERVAL  20          /*!< Interval between state deltas [msec]. */
+
+
+/** \brief Message types. */
+typedef enum {
+	RIG_IPC_MSG_HELLO = 1,   /*!< Server identification and rig data. */
+	RIG_IPC_MSG_STATE,       /*!< Complete state. */
+	RIG_IPC_MSG_DELTA,       /*!< Changes to the state. */
+	RIG_IPC_MSG_SET,         /*!< Settings to execute. */
+	RIG_IPC_MSG_CONTROL      /*!< Polling preferences of the client. */
+} rig_ipc_msg_type_t;
+
+
+/** \brief Message header. */
+typedef struct {
+	guint16  type;           /*!< rig_ipc_msg_type_t */
+	guint16  reserved;       /*!< Unused, always 0. */
+	guint32  size;           /*!< Size of the payload [bytes]. */
+} rig_ipc_msg_t;
+
+
+/** \brief Payload of the HELLO message. */
+typedef struct {
+	guint32  magic;          /*!< RIG_IPC_MAGIC */
+	guint32  version;        /*!< RIG_IPC_VERSION */
+	gint32   rigid;          /*!< Hamlib model of the radio. */
+	guint32  settings_size;  /*!< sizeof (grig_settings_t) */
+	guint32  avail_size;     /*!< sizeof (grig_cmd_avail_t) */
+	gint32   vfos;           /*!< Available VFOs. */
+	gfloat   maxpwr;         /*!< Max RF power [W]. */
+	gint32   att[HAMLIB_MAXDBLSTSIZ];     /*!< Attenuator values. */
+	gint32   preamp[HAMLIB_MAXDBLSTSIZ];  /*!< Preamp values. */
+} rig_ipc_hello_t;
+
+
+/** \brief Payload of the CONTROL message. */
+typedef struct {
+	guint32  interest;       /*!< Bit field of rig_data_field_t. */
+	guint32  txmeter;        /*!< smeter_tx_mode_t */
+} rig_ipc_control_t;
+
+
+gchar   *rig_ipc_default_addr (void);
+
+gboolean rig_ipc_server_start (const gchar *addr);
+void     rig_ipc_server_stop  (void);
+
+gboolean rig_ipc_connect      (const gchar *addr, gint *rigid);
+void     rig_ipc_disconnect   (void);
+
+#endif
@@ -0,0 +1,295 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+    Grig:  Gtk+ user interface for the Hamradio Control Libraries.
+
+    Copyright (C)  2001-2007  Alexandru Csete.
+
+    Authors: Alexandru Csete <oz9aec@gmail.com>
+
+    Comments, questions and bugreports should be submitted via
+    http://sourceforge.net/projects/groundstation/
+    More details can be found at the project home page:
+
+            http://groundstation.sourceforge.net/
+ 
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+  
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+  
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, visit http://www.fsf.org/
+ 
+ 
+ 
+*/
+/** \file rig-link.c
+ *  \ingroup shdata
+ *  \brief Linked rig tracking.
+ *
+ * The daemon of rig 0 passes the frequency and mode on to rig 1 right
+ * after it has read or set them; see rig-link.h. The values are put into
+ * the shared data of rig 1 like any other setting, so a value that has
+ * not been sent yet is simply replaced by the next one. The pending flag
+ * lets the daemon of rig 1 send the frequency in the next GET_FREQ_1 or
+ * empty slot instead of waiting for the next SET_FREQ_1 in its cycle.
+ */
+#include <glib.h>
+#include <glib/gi18n.h>
+#include <hamlib/rig.h>
+#include "grig-debug.h"
+#include "grig-metrics.h"
+#include "rig-ctx.h"
+#include "rig-data.h"
+#include "rig-link.h"
+
+
+static rig_link_type_t linktype = RIG_LINK_NONE;  /*!< Frequency tracking. */
+static freq_t          linkoffs = 0;              /*!< Offset or sum of the frequencies [Hz]. */
+static gboolean        linkmode = FALSE;          /*!< Whether rig 1 uses the mode of rig 0. */
+static freq_t          lastfreq = 0;              /*!< Last frequency of rig 0 passed on. */
+static rmode_t         lastmode = RIG_MODE_NONE;  /*!< Last mode of rig 0 passed on. */
+static gboolean        pending  = FALSE;          /*!< Rig 1 has not been set to the last frequency yet. */
+static gint64          since    = 0;              /*!< Metrics time stamp of the last frequency. */
+
+#if GLIB_CHECK_VERSION(2,32,0)
+static GMutex        mutex;
+#  define LINK_LOCK()   g_mutex_lock (&mutex)
+#  define LINK_UNLOCK() g_mutex_unlock (&mutex)
+#else
+static GStaticMutex  mutex = G_STATIC_MUTEX_INIT;
+#  define LINK_LOCK()   g_static_mutex_lock (&mutex)
+#  define LINK_UNLOCK() g_static_mutex_unlock (&mutex)
+#endif
+
+
+static gboolean link_parse_freq (const gchar *str, freq_t *freq);
+static void     link_set_freq   (rig_ctx_t *target, freq_t freq);
+static void     link_set_mode   (rig_ctx_t *target, rmode_t mode);
+
+
+
+/** \brief Configure the link between rig 0 and rig 1.
+ *  \param spec Comma separated list of offset=HZ, inverse=HZ and mode.
+ *  \return TRUE if the specification is valid.
+ *
+ * The link is only used if an additional rig is running.
+ */
+gboolean
+rig_link_parse   (const gchar *spec)
+{
+	gchar  **items;
+	gboolean ok = TRUE;
+	gint     i;
+
+	if (spec == NULL)
+		return FALSE;
+
+	items = g_strsplit (spec, ",", 0);
+
+	for (i = 0; ok && (items[i] != NULL); i++) {
+
+		g_strstrip (items[i]);
+
+		if (!g_ascii_strcasecmp (items[i], "mode")) {
+			linkmode = TRUE;
+		}
+		else if (!g_ascii_strncasecmp (items[i], "offset=", 7)) {
+			linktype = RIG_LINK_OFFSET;
+			ok = link_parse_freq (items[i] + 7, &linkoffs);
+		}
+		else if (!g_ascii_strncasecmp (items[i], "inverse=", 8)) {
+			linktype = RIG_LINK_INVERSE;
+			ok = link_parse_freq (items[i] + 8, &linkoffs);
+		}
+		else {
+			ok = FALSE;
+		}
+	}
+
+	g_strfreev (items);
+
+	if (!ok) {
+		linktype = RIG_LINK_NONE;
+		linkmode = FALSE;
+	}
+
+	return ok;
+}
+
+
+/** \brief Check whether the current rig should set the linked frequency.
+ *  \return TRUE if the daemon should execute SET_FREQ_1 next.
+ */
+gboolean
+rig_link_pending ()
+{
+	gboolean result;
+
+	if (rig_ctx_current ()->index != 1)
+		return FALSE;
+
+	LINK_LOCK ();
+	result = pending;
+	LINK_UNLOCK ();
+
+	return result;
+}
+
+
+/** \brief Pass the result of a command on to the linked rig.
+ *  \param cmd The command which has been executed.
+ *  \param status Whether the command has been sent to the rig.
+ *  \param retcode The hamlib return code.
+ *  \param get Pointer to the 'get' buffer of the current rig.
+ *
+ * This function is called by the daemon of each rig after each command.
+ * For rig 0 the new frequency and mode are passed on to rig 1, for rig 1
+ * the time it took to set the frequency is reported.
+ */
+void
+rig_link_cmd     (rig_cmd_t cmd, gint status, gint retcode,
+		  const grig_settings_t *get)
+{
+	rig_ctx_t *ctx;
+	rig_ctx_t *target;
+	gint64     start;
+
+
+	if ((linktype == RIG_LINK_NONE) && !linkmode)
+		return;
+
+	ctx = rig_ctx_current ();
+
+	/* rig 1 has set the frequency or could not set it */
+	if (ctx->index == 1) {
+		if (cmd != RIG_CMD_SET_FREQ_1)
+			return;
+
+		LINK_LOCK ();
+		start = since;
+		pending = FALSE;
+		since = 0;
+		LINK_UNLOCK ();
+
+		if (status && (retcode == RIG_OK))
+			grig_metrics_link (start);
+
+		return;
+	}
+
+	if ((ctx->index != 0) || !status || (retcode != RIG_OK))
+		return;
+
+	target = rig_ctx_get (1);
+
+	if ((target == NULL) || (target->rig == NULL))
+		return;
+
+	switch (cmd) {
+
+	case RIG_CMD_GET_FREQ_1:
+	case RIG_CMD_SET_FREQ_1:
+		if ((linktype != RIG_LINK_NONE) && (get->freq1 != lastfreq)) {
+			lastfreq = get->freq1;
+			link_set_freq (target, get->freq1);
+		}
+		break;
+
+	case RIG_CMD_GET_MODE:
+	case RIG_CMD_SET_MODE:
+		if (linkmode && (get->mode != lastmode)) {
+			lastmode = get->mode;
+			link_set_mode (target, get->mode);
+		}
+		break;
+
+	default:
+		break;
+	}
+}
+
+
+/** \brief Parse a frequency in Hz. */
+static gboolean
+link_parse_freq (const gchar *str, freq_t *freq)
+{
+	gchar *end;
+
+	*freq = g_ascii_strtod (str, &end);
+
+	return ((end != str) && (*end == '\0'));
+}
+
+
+/** \brief Set the tracked frequency on rig 1.
+ *  \param target The context of rig 1.
+ *  \param freq The frequency of rig 0.
+ */
+static void
+link_set_freq   (rig_ctx_t *target, freq_t freq)
+{
+	rig_ctx_t *prev;
+
+	if (linktype == RIG_LINK_OFFSET)
+		freq = freq + linkoffs;
+	else
+		freq = linkoffs - freq;
+
+	if (freq <= 0) {
+		grig_debug_local (RIG_DEBUG_WARN,
+				  _("%s: Linked frequency %.0f Hz out of range"),
+				  __FUNCTION__, freq);
+		return;
+	}
+
+	prev = rig_ctx_bind (target);
+	rig_data_set_freq (1, freq);
+	rig_ctx_bind (prev);
+
+	LINK_LOCK ();
+	pending = TRUE;
+	since = grig_metrics_time ();
+	LINK_UNLOCK ();
+}
+
+
+/** \brief Set the mode of rig 0 on rig 1.
+ *  \param target The context of rig 1.
+ *  \param mode The mode of rig 0.
+ *
+ * An inverting transponder also inverts the sideband.
+ */
+static void
+link_set_mode   (rig_ctx_t *target, rmode_t mode)
+{
+	rig_ctx_t *prev;
+
+	if (linktype == RIG_LINK_INVERSE) {
+		switch (mode) {
+		case RIG_MODE_USB:
+			mode = RIG_MODE_LSB;
+			break;
+		case RIG_MODE_LSB:
+			mode = RIG_MODE_USB;
+			break;
+		case RIG_MODE_CW:
+			mode = RIG_MODE_CWR;
+			break;
+		case RIG_MODE_CWR:
+			mode = RIG_MODE_CW;
+			break;
+		default:
+			break;
+		}
+	}
+
+	prev = rig_ctx_bind (target);
+	rig_data_set_mode (mode);
+	rig_ctx_bind (prev);
+}
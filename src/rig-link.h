@@ -0,0 +1,71 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+    Grig:  Gtk+ user interface for the Hamradio Control Libraries.
+
+    Copyright (C)  2001-2007  Alexandru Csete.
+
+    Authors: Alexandru Csete <oz9aec@gmail.com>
+
+    Comments, questions and bugreports should be submitted via
+    http://sourceforge.net/projects/groundstation/
+    More details can be found at the project home page:
+
+            http://groundstation.sourceforge.net/
+ 
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+  
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+  
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, visit http://www.fsf.org/
+ 
+ 
+ 
+*/
+/** \file rig-link.h
+ *  \ingroup shdata
+ *  \brief Linked rig tracking (interface).
+ *
+ * The first additional rig (context 1) can follow the frequency of the
+ * primary rig (context 0):
+ *
+ *   offset=HZ    rig 1 = rig 0 + HZ, e.g. the IF rig of a transverter
+ *   inverse=HZ   rig 1 = HZ - rig 0, for inverting satellite transponders
+ *   mode         rig 1 also uses the mode of rig 0; USB/LSB and CW/CWR
+ *                are swapped when tracking inversely
+ *
+ * Each frequency read from or set on rig 0 is passed on to rig 1 as soon
+ * as the daemon of rig 0 has it. The daemon of rig 1 sets it in the next
+ * slot of its cycle that would only read the frequency or is empty; a
+ * newer frequency replaces one that has not been sent yet. The time from
+ * reading rig 0 to setting rig 1 is reported as the grig_link_lag_seconds
+ * metric.
+ */
+#ifndef RIG_LINK_H
+#define RIG_LINK_H 1
+
+#include <glib.h>
+#include "rig-daemon.h"
+#include "rig-data.h"
+
+
+/** \brief Frequency tracking. */
+typedef enum {
+	RIG_LINK_NONE = 0,   /*!< Frequency is not tracked. */
+	RIG_LINK_OFFSET,     /*!< Rig 1 = rig 0 + offset. */
+	RIG_LINK_INVERSE     /*!< Rig 1 = offset - rig 0. */
+} rig_link_type_t;
+
+
+gboolean rig_link_parse   (const gchar *spec);
+gboolean rig_link_pending (void);
+void     rig_link_cmd     (rig_cmd_t cmd, gint status, gint retcode,
+			   const grig_settings_t *get);
+
+#endif
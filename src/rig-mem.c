@@ -0,0 +1,1541 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+    Grig:  Gtk+ user interface for the Hamradio Control Libraries.
+
+    Copyright (C)  2001-2007  Alexandru Csete.
+
+    Authors: Alexandru Csete <oz9aec@gmail.com>
+
+    Comments, questions and bugreports should be submitted via
+    http://sourceforge.net/projects/groundstation/
+    More details can be found at the project home page:
+
+            http://groundstation.sourceforge.net/
+ 
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+  
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+  
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, visit http://www.fsf.org/
+ 
+ 
+ 
+*/
+/** \file rig-mem.c
+ *  \ingroup shdata
+ *  \brief Software memory.
+ *
+ * The channels are kept in one array sorted by frequency, which is also
+ * the order of the records in the .mem file (see rig-mem.h). Adding a
+ * channel inserts it at its place; importing a file appends all channels
+ * and sorts once. The lists of channels per tag are rebuilt on the first
+ * lookup after a change.
+ *
+ * The store is shared by the user interface and the daemon thread doing
+ * a transfer, so all functions take the lock. The generation goes up
+ * whenever channels are added, removed or reordered; the functions taking
+ * indices also take the generation the indices belong to and refuse them
+ * if the store has changed since. Only one transfer runs at
+ * a time; it belongs to the rig that was current when it was started.
+ */
+#include <glib.h>
+#include <glib/gi18n.h>
+#include <glib/gstdio.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <hamlib/rig.h>
+#include "grig-config.h"
+#include "grig-debug.h"
+#include "rig-ctx.h"
+#include "rig-mem.h"
+
+
+#define RIG_MEM_MAGIC   "GRIGMEM"     /*!< Start of a .mem file, with the NUL. */
+#define RIG_MEM_NONE    0xFFFFFFFF    /*!< String offset of a channel without name. */
+
+
+/** \brief Bulk transfer between the store and a rig. */
+typedef struct {
+	gboolean  running;   /*!< The transfer is in progress. */
+	gboolean  upload;    /*!< Writing to the rig rather than reading. */
+	gint      rig;       /*!< Index of the rig. */
+	GArray   *chans;     /*!< Upload: rig_mem_chan_t to write; download: gint numbers to read. */
+	GArray   *read;      /*!< Download: rig_mem_chan_t read so far. */
+	guint     pos;       /*!< Channel to be transferred next. */
+	guint     failed;    /*!< Number of channels that failed. */
+	guint     failures;  /*!< Number of consecutive failures. */
+	GTimer   *timer;     /*!< Time since the transfer has been started. */
+} transfer_t;
+
+
+static GArray     *chans = NULL;                /*!< rig_mem_chan_t sorted by frequency. */
+static gchar      *tagnames[RIG_MEM_MAX_TAGS];  /*!< Names of the tags. */
+static guint       ntags = 0;                   /*!< Number of tags. */
+static GArray     *bytag[RIG_MEM_MAX_TAGS];     /*!< Indices of the channels with each tag. */
+static gboolean    indexed = FALSE;             /*!< The lists in 'bytag' are up to date. */
+static gchar      *filename = NULL;             /*!< The .mem file or NULL. */
+static gboolean    modified = FALSE;            /*!< The store differs from the file. */
+static guint       generation = 0;              /*!< Changes of the indices of the channels. */
+static transfer_t  transfer;                    /*!< The current or last transfer. */
+
+/** \brief Terminator for the extension levels of a channel. */
+static struct ext_list noext[1];
+
+#if GLIB_CHECK_VERSION(2,32,0)
+static GMutex        mutex;
+#  define MEM_LOCK()   g_mutex_lock (&mutex)
+#  define MEM_UNLOCK() g_mutex_unlock (&mutex)
+#else
+static GStaticMutex  mutex = G_STATIC_MUTEX_INIT;
+#  define MEM_LOCK()   g_static_mutex_lock (&mutex)
+#  define MEM_UNLOCK() g_static_mutex_unlock (&mutex)
+#endif
+
+
+static void     mem_init        (void);
+static void     mem_clear       (void);
+static gboolean mem_parse       (const guchar *data, gsize len);
+static gboolean mem_parse_line  (gchar *line, rig_mem_chan_t *chan);
+static guint    mem_lower_bound (freq_t freq, gboolean above);
+static void     mem_insert      (const rig_mem_chan_t *chan);
+static void     mem_index       (void);
+static gint     mem_tag_id      (const gchar *name, gboolean create);
+static guint64  mem_tags        (const gchar *tags);
+static gint     mem_compare     (gconstpointer a, gconstpointer b);
+static gint     mem_compare_number (gconstpointer a, gconstpointer b);
+static gint     mem_compare_desc   (gconstpointer a, gconstpointer b);
+static gboolean mem_check_generation (guint gen, const gchar *func);
+static gboolean mem_transfer_install (gboolean upload, GArray *list);
+static void     mem_transfer_finish  (const gchar *reason);
+static void     mem_merge       (void);
+static void     mem_put32       (guchar *p, guint32 val);
+static void     mem_put64       (guchar *p, guint64 val);
+static guint32  mem_get32       (const guchar *p);
+static guint64  mem_get64       (const guchar *p);
+
+
+
+/** \brief Load the software memory.
+ *  \param fname The .mem file or NULL to use ~/.grig/grig.mem.
+ *  \return TRUE if the file has been loaded or does not exist yet.
+ *
+ * A file which can not be read is never overwritten by rig_mem_save().
+ */
+gboolean
+rig_mem_load         (const gchar *fname)
+{
+	gchar   *path;
+	gchar   *data;
+	gsize    len;
+	GError  *err = NULL;
+	gboolean ok;
+	guint    count;
+
+
+	if (fname != NULL)
+		path = g_strdup (fname);
+	else
+		path = g_build_filename (g_get_home_dir (), ".grig", "grig.mem", NULL);
+
+	MEM_LOCK ();
+
+	mem_clear ();
+
+	if (!g_file_test (path, G_FILE_TEST_EXISTS)) {
+		filename = path;
+		MEM_UNLOCK ();
+
+		grig_debug_local (RIG_DEBUG_VERBOSE,
+				  _("%s: %s does not exist; starting with an empty memory"),
+				  __FUNCTION__, path);
+
+		return TRUE;
+	}
+
+	if (!g_file_get_contents (path, &data, &len, &err)) {
+		MEM_UNLOCK ();
+
+		grig_debug_local (RIG_DEBUG_ERR,
+				  _("%s: Can not read %s: %s"),
+				  __FUNCTION__, path, err->message);
+		g_clear_error (&err);
+		g_free (path);
+
+		return FALSE;
+	}
+
+	ok = mem_parse ((const guchar *) data, len);
+	g_free (data);
+
+	if (ok) {
+		filename = path;
+	}
+	else {
+		mem_clear ();
+	}
+
+	count = chans->len;
+
+	MEM_UNLOCK ();
+
+	if (ok) {
+		grig_debug_local (RIG_DEBUG_VERBOSE,
+				  _("%s: %u channels loaded from %s"),
+				  __FUNCTION__, count, path);
+	}
+	else {
+		grig_debug_local (RIG_DEBUG_ERR,
+				  _("%s: %s is not a valid memory file; it will not be saved"),
+				  __FUNCTION__, path);
+		g_free (path);
+	}
+
+	return ok;
+}
+
+
+/** \brief Save the software memory if it has been modified.
+ *  \return TRUE if the memory has been saved or there was nothing to save.
+ */
+gboolean
+rig_mem_save         ()
+{
+	GString  *strings;
+	guchar   *data;
+	guchar   *p;
+	gsize     len;
+	guint32  *tagoffs;
+	guint32  *nameoffs;
+	rig_mem_chan_t *chan;
+	GError   *err = NULL;
+	gboolean  ok;
+	guint     i;
+
+
+	MEM_LOCK ();
+
+	mem_init ();
+
+	if (!modified) {
+		MEM_UNLOCK ();
+		return TRUE;
+	}
+
+	if (filename == NULL) {
+		MEM_UNLOCK ();
+
+		grig_debug_local (RIG_DEBUG_ERR,
+				  _("%s: There is no memory file to save to"),
+				  __FUNCTION__);
+
+		return FALSE;
+	}
+
+	/* string table; the offsets are known before the records are written */
+	strings = g_string_new (NULL);
+	tagoffs = g_new (guint32, MAX (1, ntags));
+	nameoffs = g_new (guint32, MAX (1, chans->len));
+
+	for (i = 0; i < ntags; i++) {
+		tagoffs[i] = strings->len;
+		g_string_append_len (strings, tagnames[i], strlen (tagnames[i]) + 1);
+	}
+
+	for (i = 0; i < chans->len; i++) {
+		chan = &g_array_index (chans, rig_mem_chan_t, i);
+
+		if (chan->name[0] == '\0') {
+			nameoffs[i] = RIG_MEM_NONE;
+		}
+		else {
+			nameoffs[i] = strings->len;
+			g_string_append_len (strings, chan->name, strlen (chan->name) + 1);
+		}
+	}
+
+	len = RIG_MEM_HEADER_SIZE + 4 * ntags + RIG_MEM_RECORD_SIZE * chans->len + strings->len;
+	data = g_malloc0 (len);
+
+	memcpy (data, RIG_MEM_MAGIC, sizeof (RIG_MEM_MAGIC));
+	mem_put32 (data + 8, GRIG_MEM_CFG_VER);
+	mem_put32 (data + 12, chans->len);
+	mem_put32 (data + 16, ntags);
+	mem_put32 (data + 20, strings->len);
+
+	p = data + RIG_MEM_HEADER_SIZE;
+
+	for (i = 0; i < ntags; i++, p += 4) {
+		mem_put32 (p, tagoffs[i]);
+	}
+
+	for (i = 0; i < chans->len; i++, p += RIG_MEM_RECORD_SIZE) {
+		chan = &g_array_index (chans, rig_mem_chan_t, i);
+
+		mem_put64 (p, (guint64) (chan->freq + 0.5));
+		mem_put64 (p + 8, chan->mode);
+		mem_put64 (p + 16, chan->tags);
+		mem_put32 (p + 24, (guint32) chan->number);
+		mem_put32 (p + 28, (guint32) chan->width);
+		mem_put32 (p + 32, chan->ctcss);
+		mem_put32 (p + 36, chan->ctcss_sql);
+		mem_put32 (p + 40, chan->dcs);
+		mem_put32 (p + 44, nameoffs[i]);
+	}
+
+	memcpy (p, strings->str, strings->len);
+
+	ok = g_file_set_contents (filename, (const gchar *) data, len, &err);
+
+	if (ok) {
+		modified = FALSE;
+		grig_debug_local (RIG_DEBUG_VERBOSE,
+				  _("%s: %u channels saved to %s"),
+				  __FUNCTION__, chans->len, filename);
+	}
+	else {
+		grig_debug_local (RIG_DEBUG_ERR,
+				  _("%s: Can not save %s: %s"),
+				  __FUNCTION__, filename, err->message);
+		g_clear_error (&err);
+	}
+
+	MEM_UNLOCK ();
+
+	g_free (data);
+	g_free (tagoffs);
+	g_free (nameoffs);
+	g_string_free (strings, TRUE);
+
+	return ok;
+}
+
+
+/** \brief Add the channels of a text file to the software memory.
+ *  \param fname The file to import.
+ *  \return TRUE if the file could be read.
+ *
+ * Each line is FREQ;MODE;NAME;TAGS;CTCSS;CHANNEL with the frequency in Hz,
+ * the mode as in hamlib, tags separated by commas, the CTCSS tone in Hz
+ * and the memory channel number in the rig. Only the frequency is
+ * required; empty lines and lines starting with # are skipped.
+ */
+gboolean
+rig_mem_import       (const gchar *fname)
+{
+	rig_mem_chan_t chan;
+	gchar   *data;
+	gchar  **lines;
+	GError  *err = NULL;
+	guint    added = 0;
+	guint    i;
+
+
+	if (!g_file_get_contents (fname, &data, NULL, &err)) {
+		grig_debug_local (RIG_DEBUG_ERR,
+				  _("%s: Can not read %s: %s"),
+				  __FUNCTION__, fname, err->message);
+		g_clear_error (&err);
+
+		return FALSE;
+	}
+
+	lines = g_strsplit (data, "\n", -1);
+	g_free (data);
+
+	MEM_LOCK ();
+
+	mem_init ();
+
+	for (i = 0; lines[i] != NULL; i++) {
+		g_strstrip (lines[i]);
+
+		if ((lines[i][0] == '\0') || (lines[i][0] == '#'))
+			continue;
+
+		if (chans->len >= RIG_MEM_MAX_CHANNELS) {
+			grig_debug_local (RIG_DEBUG_ERR,
+					  _("%s: The memory is full"),
+					  __FUNCTION__);
+			break;
+		}
+
+		if (!mem_parse_line (lines[i], &chan)) {
+			grig_debug_local (RIG_DEBUG_WARN,
+					  _("%s: Skipping invalid line %u of %s"),
+					  __FUNCTION__, i + 1, fname);
+			continue;
+		}
+
+		g_array_append_val (chans, chan);
+		added++;
+	}
+
+	if (added > 0) {
+		g_array_sort (chans, mem_compare);
+		indexed = FALSE;
+		modified = TRUE;
+		generation++;
+	}
+
+	MEM_UNLOCK ();
+
+	g_strfreev (lines);
+
+	grig_debug_local (RIG_DEBUG_VERBOSE,
+			  _("%s: %u channels imported from %s"),
+			  __FUNCTION__, added, fname);
+
+	return TRUE;
+}
+
+
+/** \brief Get the format version of a .mem file.
+ *  \param fname The file.
+ *  \return The version or -1 if the file is not a memory file.
+ */
+gint
+rig_mem_file_version (const gchar *fname)
+{
+	guchar  header[RIG_MEM_HEADER_SIZE];
+	FILE   *file;
+	gint    version = -1;
+
+	file = g_fopen (fname, "rb");
+
+	if (file == NULL)
+		return -1;
+
+	if ((fread (header, 1, RIG_MEM_HEADER_SIZE, file) == RIG_MEM_HEADER_SIZE) &&
+	    (memcmp (header, RIG_MEM_MAGIC, sizeof (RIG_MEM_MAGIC)) == 0)) {
+		version = (gint) mem_get32 (header + 8);
+	}
+
+	fclose (file);
+
+	return version;
+}
+
+
+/** \brief Check whether the software memory has unsaved changes. */
+gboolean
+rig_mem_modified     ()
+{
+	gboolean mod;
+
+	MEM_LOCK ();
+	mod = modified;
+	MEM_UNLOCK ();
+
+	return mod;
+}
+
+
+/** \brief Get the number of channels in the software memory. */
+guint
+rig_mem_count        ()
+{
+	guint count;
+
+	MEM_LOCK ();
+	mem_init ();
+	count = chans->len;
+	MEM_UNLOCK ();
+
+	return count;
+}
+
+
+/** \brief Get the generation of the software memory.
+ *
+ * The generation changes whenever the indices of the channels change.
+ */
+guint
+rig_mem_generation   ()
+{
+	guint gen;
+
+	MEM_LOCK ();
+	gen = generation;
+	MEM_UNLOCK ();
+
+	return gen;
+}
+
+
+/** \brief Get a channel of the software memory.
+ *  \param index The index of the channel in frequency order.
+ *  \param gen The generation the index belongs to.
+ *  \param chan Location to store the channel.
+ *  \return FALSE if there is no such channel or the store has changed.
+ */
+gboolean
+rig_mem_get          (guint index, guint gen, rig_mem_chan_t *chan)
+{
+	gboolean ok;
+
+	MEM_LOCK ();
+
+	mem_init ();
+
+	ok = (gen == generation) && (index < chans->len);
+
+	if (ok)
+		*chan = g_array_index (chans, rig_mem_chan_t, index);
+
+	MEM_UNLOCK ();
+
+	return ok;
+}
+
+
+/** \brief Add a channel to the software memory.
+ *  \param chan The channel.
+ *  \return FALSE if the memory is full.
+ */
+gboolean
+rig_mem_add          (const rig_mem_chan_t *chan)
+{
+	gboolean ok;
+
+	MEM_LOCK ();
+
+	mem_init ();
+
+	ok = (chans->len < RIG_MEM_MAX_CHANNELS);
+
+	if (ok)
+		mem_insert (chan);
+
+	MEM_UNLOCK ();
+
+	return ok;
+}
+
+
+/** \brief Remove channels from the software memory.
+ *  \param indices The indices of the channels in frequency order.
+ *  \param count The number of indices.
+ *  \param gen The generation the indices belong to.
+ *  \return FALSE if the store has changed; nothing is removed then.
+ *
+ * Indices of channels that do not exist are ignored.
+ */
+gboolean
+rig_mem_remove       (const guint *indices, guint count, guint gen)
+{
+	guint   *sorted;
+	guint    i;
+	gboolean ok;
+
+	/* from the back, since the following indices go down */
+	sorted = g_new (guint, count);
+	memcpy (sorted, indices, count * sizeof (guint));
+	qsort (sorted, count, sizeof (guint), mem_compare_desc);
+
+	MEM_LOCK ();
+
+	mem_init ();
+
+	ok = mem_check_generation (gen, __FUNCTION__);
+
+	for (i = 0; ok && (i < count); i++) {
+		if ((sorted[i] >= chans->len) || ((i > 0) && (sorted[i] == sorted[i - 1])))
+			continue;
+
+		g_array_remove_index (chans, sorted[i]);
+		indexed = FALSE;
+		modified = TRUE;
+	}
+
+	if (ok && (count > 0))
+		generation++;
+
+	MEM_UNLOCK ();
+
+	g_free (sorted);
+
+	return ok;
+}
+
+
+/** \brief Convert tag names to a tag mask.
+ *  \param tags Tag names separated by commas.
+ *  \return The mask; new tags are added to the store.
+ */
+guint64
+rig_mem_parse_tags   (const gchar *tags)
+{
+	guint64 mask;
+
+	MEM_LOCK ();
+	mask = mem_tags (tags);
+	MEM_UNLOCK ();
+
+	return mask;
+}
+
+
+/** \brief Convert a tag mask to tag names.
+ *  \param tags The mask.
+ *  \return Newly allocated string with the names separated by commas.
+ */
+gchar *
+rig_mem_tags_to_string (guint64 tags)
+{
+	GString *str;
+	guint    i;
+
+	str = g_string_new (NULL);
+
+	MEM_LOCK ();
+
+	for (i = 0; i < ntags; i++) {
+		if (tags & (G_GUINT64_CONSTANT (1) << i)) {
+			if (str->len > 0)
+				g_string_append_c (str, ',');
+			g_string_append (str, tagnames[i]);
+		}
+	}
+
+	MEM_UNLOCK ();
+
+	return g_string_free (str, FALSE);
+}
+
+
+/** \brief Find the channels in a frequency range and with a tag.
+ *  \param low The lowest frequency [Hz].
+ *  \param high The highest frequency [Hz].
+ *  \param tag The tag or NULL or an empty string for all channels.
+ *  \param found Location to store the newly allocated indices in
+ *               frequency order; free with g_free().
+ *  \param gen Location to store the generation the indices belong to.
+ *  \return The number of channels found.
+ *
+ * The range is found by binary search. With a tag, the shorter of the
+ * range and the list of channels with the tag is walked.
+ */
+guint
+rig_mem_find         (freq_t low, freq_t high, const gchar *tag,
+		      guint **found, guint *gen)
+{
+	GArray *result;
+	GArray *list;
+	guint   first, last, i, idx;
+	guint   lo, hi, mid;
+	gint    id = -1;
+	guint64 bit;
+
+
+	result = g_array_new (FALSE, FALSE, sizeof (guint));
+
+	MEM_LOCK ();
+
+	mem_init ();
+
+	first = mem_lower_bound (low, FALSE);
+	last = mem_lower_bound (high, TRUE);
+
+	if ((tag != NULL) && (tag[0] != '\0')) {
+		id = mem_tag_id (tag, FALSE);
+
+		/* an unknown tag finds nothing */
+		if (id < 0)
+			last = first;
+	}
+
+	if ((id < 0) || (first >= last)) {
+		for (i = first; i < last; i++)
+			g_array_append_val (result, i);
+	}
+	else {
+		mem_index ();
+		list = bytag[id];
+		bit = G_GUINT64_CONSTANT (1) << id;
+
+		if (list->len < last - first) {
+			/* first channel with the tag in the range */
+			lo = 0;
+			hi = list->len;
+
+			while (lo < hi) {
+				mid = (lo + hi) / 2;
+				if (g_array_index (list, guint, mid) < first)
+					lo = mid + 1;
+				else
+					hi = mid;
+			}
+
+			for (i = lo; i < list->len; i++) {
+				idx = g_array_index (list, guint, i);
+				if (idx >= last)
+					break;
+				g_array_append_val (result, idx);
+			}
+		}
+		else {
+			for (i = first; i < last; i++) {
+				if (g_array_index (chans, rig_mem_chan_t, i).tags & bit)
+					g_array_append_val (result, i);
+			}
+		}
+	}
+
+	*gen = generation;
+
+	MEM_UNLOCK ();
+
+	i = result->len;
+	*found = (guint *) g_array_free (result, FALSE);
+
+	return i;
+}
+
+
+/** \brief Read all memory channels of the current rig into the store.
+ *  \return TRUE if the transfer has been started.
+ *
+ * The channels read replace the ones with the same number, keeping their
+ * tags. Channels that are empty in the rig are skipped.
+ */
+gboolean
+rig_mem_download     ()
+{
+	rig_ctx_t *ctx = rig_ctx_current ();
+	GArray    *numbers;
+	const chan_t *list;
+	gint       i, n;
+
+
+	if (ctx->rig == NULL) {
+		grig_debug_local (RIG_DEBUG_ERR,
+				  _("%s: The rig is not running"),
+				  __FUNCTION__);
+		return FALSE;
+	}
+
+	numbers = g_array_new (FALSE, FALSE, sizeof (gint));
+	list = ctx->rig->state.chan_list;
+
+	for (i = 0; (i < HAMLIB_CHANLSTSIZ) && !RIG_IS_CHAN_END (list[i]); i++) {
+		if (list[i].type != RIG_MTYPE_MEM)
+			continue;
+
+		for (n = list[i].startc;
+		     (n <= list[i].endc) && (numbers->len < RIG_MEM_MAX_CHANNELS); n++) {
+			g_array_append_val (numbers, n);
+		}
+	}
+
+	if (numbers->len == 0) {
+		grig_debug_local (RIG_DEBUG_ERR,
+				  _("%s: The rig has no memory channels"),
+				  __FUNCTION__);
+		g_array_free (numbers, TRUE);
+		return FALSE;
+	}
+
+	return mem_transfer_install (FALSE, numbers);
+}
+
+
+/** \brief Write channels of the store to the memory of the current rig.
+ *  \param indices The indices of the channels.
+ *  \param count The number of indices.
+ *  \param gen The generation the indices belong to.
+ *  \return TRUE if the transfer has been started.
+ *
+ * Channels without a channel number are skipped. The channels are copied
+ * when the transfer is started.
+ */
+gboolean
+rig_mem_upload       (const guint *indices, guint count, guint gen)
+{
+	GArray         *list;
+	rig_mem_chan_t *chan;
+	guint           i;
+
+
+	if (rig_ctx_current ()->rig == NULL) {
+		grig_debug_local (RIG_DEBUG_ERR,
+				  _("%s: The rig is not running"),
+				  __FUNCTION__);
+		return FALSE;
+	}
+
+	list = g_array_new (FALSE, FALSE, sizeof (rig_mem_chan_t));
+
+	MEM_LOCK ();
+
+	mem_init ();
+
+	if (!mem_check_generation (gen, __FUNCTION__)) {
+		MEM_UNLOCK ();
+		g_array_free (list, TRUE);
+		return FALSE;
+	}
+
+	for (i = 0; i < count; i++) {
+		if (indices[i] >= chans->len)
+			continue;
+
+		chan = &g_array_index (chans, rig_mem_chan_t, indices[i]);
+
+		if (chan->number >= 0)
+			g_array_append_vals (list, chan, 1);
+	}
+
+	MEM_UNLOCK ();
+
+	if (list->len == 0) {
+		grig_debug_local (RIG_DEBUG_ERR,
+				  _("%s: None of the channels has a channel number"),
+				  __FUNCTION__);
+		g_array_free (list, TRUE);
+		return FALSE;
+	}
+
+	return mem_transfer_install (TRUE, list);
+}
+
+
+/** \brief Stop the transfer.
+ *
+ * The channels downloaded so far are merged into the store.
+ */
+void
+rig_mem_transfer_stop ()
+{
+	MEM_LOCK ();
+
+	if (transfer.running)
+		mem_transfer_finish (_("Transfer stopped"));
+
+	MEM_UNLOCK ();
+}
+
+
+/** \brief Get the progress of the current or last transfer.
+ *  \param done Location to store the number of channels transferred or NULL.
+ *  \param total Location to store the number of channels or NULL.
+ *  \param failed Location to store the number of failed channels or NULL.
+ *  \return TRUE if the transfer is in progress.
+ */
+gboolean
+rig_mem_transfer_running (guint *done, guint *total, guint *failed)
+{
+	gboolean running;
+
+	MEM_LOCK ();
+
+	running = transfer.running;
+
+	if (done != NULL)
+		*done = transfer.pos;
+	if (total != NULL)
+		*total = (transfer.chans != NULL) ? transfer.chans->len : transfer.pos;
+	if (failed != NULL)
+		*failed = transfer.failed;
+
+	MEM_UNLOCK ();
+
+	return running;
+}
+
+
+/** \brief Get the next channel of the transfer of the current rig.
+ *  \param chan Location to store the channel; only the number and the VFO
+ *              are set.
+ *  \param upload Location to store whether the channel is to be written.
+ *  \return FALSE if there is nothing to transfer.
+ *
+ * A channel to be written is first read from the rig and then passed to
+ * rig_mem_transfer_fill(), so that the settings the store does not hold
+ * are kept.
+ */
+gboolean
+rig_mem_transfer_next   (channel_t *chan, gboolean *upload)
+{
+	rig_mem_chan_t *mem;
+	gboolean        ok;
+
+	MEM_LOCK ();
+
+	ok = transfer.running && (transfer.rig == rig_ctx_current ()->index);
+
+	if (ok) {
+		memset (chan, 0, sizeof (channel_t));
+		chan->vfo = RIG_VFO_MEM;
+		chan->ext_levels = noext;
+
+		if (transfer.upload) {
+			mem = &g_array_index (transfer.chans, rig_mem_chan_t, transfer.pos);
+			chan->channel_num = mem->number;
+		}
+		else {
+			chan->channel_num = g_array_index (transfer.chans, gint, transfer.pos);
+		}
+
+		*upload = transfer.upload;
+	}
+
+	MEM_UNLOCK ();
+
+	return ok;
+}
+
+
+/** \brief Put the stored settings into a channel to be written.
+ *  \param chan The channel from rig_mem_transfer_next().
+ *  \param valid Whether chan has been read from the rig successfully. If
+ *               not, the settings the store does not hold are cleared.
+ *
+ * The frequency, mode, passband width, tones and, if the stored channel
+ * has one, the name replace the values read from the rig; everything else,
+ * e.g. the split, offset or tuning step settings of the channel, is kept.
+ */
+void
+rig_mem_transfer_fill   (channel_t *chan, gboolean valid)
+{
+	rig_mem_chan_t *mem;
+	gint            number = chan->channel_num;
+
+	if (!valid) {
+		memset (chan, 0, sizeof (channel_t));
+		chan->channel_num = number;
+	}
+
+	/* hamlib may have changed these while reading */
+	chan->vfo = RIG_VFO_MEM;
+	chan->ext_levels = noext;
+
+	MEM_LOCK ();
+
+	if (transfer.running && transfer.upload &&
+	    (transfer.rig == rig_ctx_current ()->index)) {
+
+		mem = &g_array_index (transfer.chans, rig_mem_chan_t, transfer.pos);
+
+		chan->channel_num = mem->number;
+		chan->freq = mem->freq;
+		chan->mode = mem->mode;
+		chan->width = mem->width;
+		chan->ctcss_tone = mem->ctcss;
+		chan->ctcss_sql = mem->ctcss_sql;
+		chan->dcs_code = mem->dcs;
+
+		if (mem->name[0] != '\0')
+			g_strlcpy (chan->channel_desc, mem->name, sizeof (chan->channel_desc));
+	}
+
+	MEM_UNLOCK ();
+}
+
+
+/** \brief Report the channel from rig_mem_transfer_next().
+ *  \param retcode The hamlib return code.
+ *  \param chan The channel; for a download as read from the rig.
+ */
+void
+rig_mem_transfer_result (gint retcode, const channel_t *chan)
+{
+	rig_mem_chan_t mem;
+
+	MEM_LOCK ();
+
+	if (!transfer.running || (transfer.rig != rig_ctx_current ()->index)) {
+		MEM_UNLOCK ();
+		return;
+	}
+
+	if (retcode != RIG_OK) {
+		transfer.failed++;
+
+		if ((retcode == -RIG_ENIMPL) ||
+		    (++transfer.failures >= RIG_MEM_MAX_FAILURES)) {
+			mem_transfer_finish (_("Transfer given up after failures"));
+			MEM_UNLOCK ();
+			return;
+		}
+	}
+	else {
+		transfer.failures = 0;
+
+		if (!transfer.upload && (chan->freq > 0)) {
+			memset (&mem, 0, sizeof (rig_mem_chan_t));
+			mem.number = chan->channel_num;
+			mem.freq = chan->freq;
+			mem.mode = chan->mode;
+			mem.width = chan->width;
+			mem.ctcss = chan->ctcss_tone;
+			mem.ctcss_sql = chan->ctcss_sql;
+			mem.dcs = chan->dcs_code;
+			g_strlcpy (mem.name, chan->channel_desc, RIG_MEM_NAME_LEN);
+			g_array_append_val (transfer.read, mem);
+		}
+	}
+
+	if (++transfer.pos >= transfer.chans->len)
+		mem_transfer_finish (_("Transfer finished"));
+
+	MEM_UNLOCK ();
+}
+
+
+/** \brief Create the store if it does not exist yet.
+ *
+ * Must be called with the lock held.
+ */
+static void
+mem_init             ()
+{
+	if (chans == NULL)
+		chans = g_array_new (FALSE, TRUE, sizeof (rig_mem_chan_t));
+}
+
+
+/** \brief Remove all channels and tags.
+ *
+ * Must be called with the lock held.
+ */
+static void
+mem_clear            ()
+{
+	guint i;
+
+	mem_init ();
+	g_array_set_size (chans, 0);
+
+	for (i = 0; i < ntags; i++) {
+		g_free (tagnames[i]);
+		tagnames[i] = NULL;
+	}
+
+	ntags = 0;
+	indexed = FALSE;
+	modified = FALSE;
+	generation++;
+
+	g_free (filename);
+	filename = NULL;
+}
+
+
+/** \brief Read the contents of a .mem file into the empty store.
+ *  \param data The contents.
+ *  \param len The size of the contents.
+ *  \return TRUE if the contents are valid.
+ *
+ * Must be called with the lock held.
+ */
+static gboolean
+mem_parse            (const guchar *data, gsize len)
+{
+	const guchar   *p;
+	const gchar    *strings;
+	rig_mem_chan_t  chan;
+	guint32         count, tags, strsize, off, version;
+	gboolean        sorted = TRUE;
+	guint           i;
+
+
+	if ((len < RIG_MEM_HEADER_SIZE) ||
+	    (memcmp (data, RIG_MEM_MAGIC, sizeof (RIG_MEM_MAGIC)) != 0))
+		return FALSE;
+
+	version = mem_get32 (data + 8);
+	count = mem_get32 (data + 12);
+	tags = mem_get32 (data + 16);
+	strsize = mem_get32 (data + 20);
+
+	if (version != GRIG_MEM_CFG_VER) {
+		grig_debug_local (RIG_DEBUG_ERR,
+				  _("%s: Memory file version %u is not supported"),
+				  __FUNCTION__, version);
+		return FALSE;
+	}
+
+	/* the sizes are checked one by one so that they can not overflow */
+	if ((count > RIG_MEM_MAX_CHANNELS) || (tags > RIG_MEM_MAX_TAGS) ||
+	    (strsize > len) ||
+	    (len != RIG_MEM_HEADER_SIZE + 4 * tags + RIG_MEM_RECORD_SIZE * count + strsize))
+		return FALSE;
+
+	strings = (const gchar *) data + len - strsize;
+
+	if ((strsize > 0) && (strings[strsize - 1] != '\0'))
+		return FALSE;
+
+	p = data + RIG_MEM_HEADER_SIZE;
+
+	for (i = 0; i < tags; i++, p += 4) {
+		off = mem_get32 (p);
+		if (off >= strsize)
+			return FALSE;
+
+		tagnames[ntags++] = g_strdup (strings + off);
+	}
+
+	g_array_set_size (chans, count);
+
+	for (i = 0; i < count; i++, p += RIG_MEM_RECORD_SIZE) {
+		memset (&chan, 0, sizeof (rig_mem_chan_t));
+
+		chan.freq = (freq_t) mem_get64 (p);
+		chan.mode = (rmode_t) mem_get64 (p + 8);
+		chan.tags = mem_get64 (p + 16);
+		chan.number = (gint32) mem_get32 (p + 24);
+		chan.width = (gint32) mem_get32 (p + 28);
+		chan.ctcss = mem_get32 (p + 32);
+		chan.ctcss_sql = mem_get32 (p + 36);
+		chan.dcs = mem_get32 (p + 40);
+		off = mem_get32 (p + 44);
+
+		if (off != RIG_MEM_NONE) {
+			if (off >= strsize)
+				return FALSE;
+
+			g_strlcpy (chan.name, strings + off, RIG_MEM_NAME_LEN);
+		}
+
+		/* tags that are not in the tag table are dropped */
+		if (tags < RIG_MEM_MAX_TAGS)
+			chan.tags &= (G_GUINT64_CONSTANT (1) << tags) - 1;
+
+		if ((i > 0) && (chan.freq < g_array_index (chans, rig_mem_chan_t, i - 1).freq))
+			sorted = FALSE;
+
+		g_array_index (chans, rig_mem_chan_t, i) = chan;
+	}
+
+	/* a file written by another program may be out of order */
+	if (!sorted)
+		g_array_sort (chans, mem_compare);
+
+	return TRUE;
+}
+
+
+/** \brief Parse a line of an imported file.
+ *  \param line The line; it is modified.
+ *  \param chan Location to store the channel.
+ *  \return FALSE if the line is invalid.
+ *
+ * Must be called with the lock held, since new tags are added.
+ */
+static gboolean
+mem_parse_line       (gchar *line, rig_mem_chan_t *chan)
+{
+	gchar  **fields;
+	gchar   *end;
+	guint    n, i;
+	gboolean ok = TRUE;
+
+
+	memset (chan, 0, sizeof (rig_mem_chan_t));
+	chan->number = -1;
+
+	fields = g_strsplit (line, ";", 6);
+	n = g_strv_length (fields);
+
+	for (i = 0; i < n; i++)
+		g_strstrip (fields[i]);
+
+	chan->freq = g_ascii_strtod (fields[0], &end);
+	ok = (end != fields[0]) && (*end == '\0') && (chan->freq > 0.0);
+
+	if (ok && (n > 1) && (fields[1][0] != '\0')) {
+		chan->mode = rig_parse_mode (fields[1]);
+		ok = (chan->mode != RIG_MODE_NONE);
+	}
+
+	if (ok && (n > 2))
+		g_strlcpy (chan->name, fields[2], RIG_MEM_NAME_LEN);
+
+	if (ok && (n > 3))
+		chan->tags = mem_tags (fields[3]);
+
+	if (ok && (n > 4) && (fields[4][0] != '\0')) {
+		chan->ctcss = (tone_t) (10.0 * g_ascii_strtod (fields[4], &end) + 0.5);
+		ok = (*end == '\0');
+	}
+
+	if (ok && (n > 5) && (fields[5][0] != '\0')) {
+		chan->number = (gint) strtol (fields[5], &end, 10);
+		ok = (*end == '\0') && (chan->number >= 0);
+	}
+
+	g_strfreev (fields);
+
+	return ok;
+}
+
+
+/** \brief Find the first channel at or above a frequency.
+ *  \param freq The frequency [Hz].
+ *  \param above Find the first channel above the frequency instead.
+ *  \return The index of the channel or the number of channels.
+ *
+ * Must be called with the lock held.
+ */
+static guint
+mem_lower_bound      (freq_t freq, gboolean above)
+{
+	guint  lo = 0;
+	guint  hi = chans->len;
+	guint  mid;
+	freq_t f;
+
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		f = g_array_index (chans, rig_mem_chan_t, mid).freq;
+
+		if ((f < freq) || (above && (f == freq)))
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo;
+}
+
+
+/** \brief Insert a channel at its place.
+ *
+ * Must be called with the lock held.
+ */
+static void
+mem_insert           (const rig_mem_chan_t *chan)
+{
+	g_array_insert_vals (chans, mem_lower_bound (chan->freq, TRUE), chan, 1);
+	indexed = FALSE;
+	modified = TRUE;
+	generation++;
+}
+
+
+/** \brief Rebuild the lists of channels per tag if necessary.
+ *
+ * Must be called with the lock held.
+ */
+static void
+mem_index            ()
+{
+	rig_mem_chan_t *chan;
+	guint           i, t;
+
+	if (indexed)
+		return;
+
+	for (t = 0; t < ntags; t++) {
+		if (bytag[t] == NULL)
+			bytag[t] = g_array_new (FALSE, FALSE, sizeof (guint));
+		else
+			g_array_set_size (bytag[t], 0);
+	}
+
+	for (i = 0; i < chans->len; i++) {
+		chan = &g_array_index (chans, rig_mem_chan_t, i);
+
+		for (t = 0; (t < ntags) && (chan->tags >> t); t++) {
+			if (chan->tags & (G_GUINT64_CONSTANT (1) << t))
+				g_array_append_val (bytag[t], i);
+		}
+	}
+
+	indexed = TRUE;
+}
+
+
+/** \brief Look up a tag.
+ *  \param name The name of the tag; case is ignored.
+ *  \param create Add the tag if it does not exist yet.
+ *  \return The number of the tag or -1.
+ *
+ * Must be called with the lock held.
+ */
+static gint
+mem_tag_id           (const gchar *name, gboolean create)
+{
+	guint i;
+
+	for (i = 0; i < ntags; i++) {
+		if (g_ascii_strcasecmp (tagnames[i], name) == 0)
+			return i;
+	}
+
+	if (!create)
+		return -1;
+
+	if (ntags >= RIG_MEM_MAX_TAGS) {
+		grig_debug_local (RIG_DEBUG_WARN,
+				  _("%s: Too many tags; %s is ignored"),
+				  __FUNCTION__, name);
+		return -1;
+	}
+
+	tagnames[ntags] = g_strdup (name);
+	indexed = FALSE;
+	modified = TRUE;
+
+	return ntags++;
+}
+
+
+/** \brief Convert tag names separated by commas to a mask.
+ *
+ * Must be called with the lock held.
+ */
+static guint64
+mem_tags             (const gchar *tags)
+{
+	gchar  **names;
+	guint64  mask = 0;
+	gint     id;
+	guint    i;
+
+	if (tags == NULL)
+		return 0;
+
+	names = g_strsplit (tags, ",", -1);
+
+	for (i = 0; names[i] != NULL; i++) {
+		g_strstrip (names[i]);
+
+		if (names[i][0] == '\0')
+			continue;
+
+		id = mem_tag_id (names[i], TRUE);
+
+		if (id >= 0)
+			mask |= G_GUINT64_CONSTANT (1) << id;
+	}
+
+	g_strfreev (names);
+
+	return mask;
+}
+
+
+/** \brief Order channels by frequency and channel number. */
+static gint
+mem_compare          (gconstpointer a, gconstpointer b)
+{
+	const rig_mem_chan_t *ca = a;
+	const rig_mem_chan_t *cb = b;
+
+	if (ca->freq != cb->freq)
+		return (ca->freq < cb->freq) ? -1 : 1;
+
+	return ca->number - cb->number;
+}
+
+
+/** \brief Order channels by channel number. */
+static gint
+mem_compare_number   (gconstpointer a, gconstpointer b)
+{
+	return ((const rig_mem_chan_t *) a)->number - ((const rig_mem_chan_t *) b)->number;
+}
+
+
+/** \brief Order indices from the highest to the lowest. */
+static gint
+mem_compare_desc     (gconstpointer a, gconstpointer b)
+{
+	return (*(const guint *) b > *(const guint *) a) ? 1 :
+		(*(const guint *) b < *(const guint *) a) ? -1 : 0;
+}
+
+
+/** \brief Check that indices still belong to the store.
+ *  \param gen The generation the indices belong to.
+ *  \param func The calling function, for the message.
+ *  \return FALSE if the store has changed since.
+ *
+ * Must be called with the lock held.
+ */
+static gboolean
+mem_check_generation (guint gen, const gchar *func)
+{
+	if (gen == generation)
+		return TRUE;
+
+	grig_debug_local (RIG_DEBUG_WARN,
+			  _("%s: The memory has changed; the channels are not valid any more"),
+			  func);
+
+	return FALSE;
+}
+
+
+/** \brief Start a transfer with the current rig.
+ *  \param upload Write to the rig rather than read.
+ *  \param list The channels to write or the numbers to read; it is
+ *              freed if the transfer can not be started.
+ *  \return TRUE if the transfer has been started.
+ */
+static gboolean
+mem_transfer_install (gboolean upload, GArray *list)
+{
+	gint rig = rig_ctx_current ()->index;
+
+	MEM_LOCK ();
+
+	if (transfer.running) {
+		MEM_UNLOCK ();
+
+		grig_debug_local (RIG_DEBUG_ERR,
+				  _("%s: A transfer is already running"),
+				  __FUNCTION__);
+		g_array_free (list, TRUE);
+
+		return FALSE;
+	}
+
+	if (transfer.chans != NULL)
+		g_array_free (transfer.chans, TRUE);
+	if (transfer.timer != NULL)
+		g_timer_destroy (transfer.timer);
+
+	memset (&transfer, 0, sizeof (transfer_t));
+	transfer.running = TRUE;
+	transfer.upload = upload;
+	transfer.rig = rig;
+	transfer.chans = list;
+	transfer.timer = g_timer_new ();
+
+	if (!upload)
+		transfer.read = g_array_new (FALSE, FALSE, sizeof (rig_mem_chan_t));
+
+	MEM_UNLOCK ();
+
+	grig_debug_local (RIG_DEBUG_VERBOSE,
+			  upload ? _("%s: Writing %u channels to rig %d") :
+			  _("%s: Reading %u channels from rig %d"),
+			  __FUNCTION__, list->len, rig + 1);
+
+	return TRUE;
+}
+
+
+/** \brief End the transfer.
+ *  \param reason Message to log with the summary.
+ *
+ * Must be called with the lock held.
+ */
+static void
+mem_transfer_finish  (const gchar *reason)
+{
+	transfer.running = FALSE;
+	g_timer_stop (transfer.timer);
+
+	grig_debug_local (RIG_DEBUG_VERBOSE,
+			  _("%s: %s; %u of %u channels in %.1f sec, %u failed"),
+			  __FUNCTION__, reason, transfer.pos, transfer.chans->len,
+			  g_timer_elapsed (transfer.timer, NULL), transfer.failed);
+
+	if (!transfer.upload) {
+		mem_merge ();
+		g_array_free (transfer.read, TRUE);
+		transfer.read = NULL;
+	}
+}
+
+
+/** \brief Merge the downloaded channels into the store.
+ *
+ * A channel read from the rig replaces the one with the same number and
+ * takes over its tags. Must be called with the lock held.
+ */
+static void
+mem_merge            ()
+{
+	GArray         *read = transfer.read;
+	rig_mem_chan_t *chan;
+	rig_mem_chan_t *match;
+	guint           i, j;
+
+	if (read->len == 0)
+		return;
+
+	mem_init ();
+
+	g_array_sort (read, mem_compare_number);
+
+	for (i = 0, j = 0; i < chans->len; i++) {
+		chan = &g_array_index (chans, rig_mem_chan_t, i);
+		match = NULL;
+
+		if (chan->number >= 0)
+			match = bsearch (chan, read->data, read->len,
+					 sizeof (rig_mem_chan_t), mem_compare_number);
+
+		if (match != NULL) {
+			match->tags |= chan->tags;
+			continue;
+		}
+
+		if (j != i)
+			g_array_index (chans, rig_mem_chan_t, j) = *chan;
+		j++;
+	}
+
+	g_array_set_size (chans, j);
+
+	if (chans->len + read->len > RIG_MEM_MAX_CHANNELS)
+		g_array_set_size (read, RIG_MEM_MAX_CHANNELS - chans->len);
+
+	g_array_append_vals (chans, read->data, read->len);
+	g_array_sort (chans, mem_compare);
+
+	indexed = FALSE;
+	modified = TRUE;
+	generation++;
+}
+
+
+static void
+mem_put32            (guchar *p, guint32 val)
+{
+	val = GUINT32_TO_LE (val);
+	memcpy (p, &val, 4);
+}
+
+
+static void
+mem_put64            (guchar *p, guint64 val)
+{
+	val = GUINT64_TO_LE (val);
+	memcpy (p, &val, 8);
+}
+
+
+static guint32
+mem_get32            (const guchar *p)
+{
+	guint32 val;
+
+	memcpy (&val, p, 4);
+
+	return GUINT32_FROM_LE (val);
+}
+
+
+static guint64
+mem_get64            (const guchar *p)
+{
+	guint64 val;
+
+	memcpy (&val, p, 8);
+
+	return GUINT64_FROM_LE (val);
+}
@@ -0,0 +1,126 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+    Grig:  Gtk+ user interface for the Hamradio Control Libraries.
+
+    Copyright (C)  2001-2007  Alexandru Csete.
+
+    Authors: Alexandru Csete <oz9aec@gmail.com>
+
+    Comments, questions and bugreports should be submitted via
+    http://sourceforge.net/projects/groundstation/
+    More details can be found at the project home page:
+
+            http://groundstation.sourceforge.net/
+ 
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+  
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+  
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, visit http://www.fsf.org/
+ 
+ 
+ 
+*/
+/** \file rig-mem.h
+ *  \ingroup shdata
+ *  \brief Software memory (interface).
+ *
+ * The software memory is a store of channels kept on disk in a .mem file
+ * in the configuration directory, ~/.grig/grig.mem unless another file
+ * is given. The whole store is held in memory while grig is running.
+ *
+ * The .mem file is little endian and consists of
+ *
+ *   - a header of RIG_MEM_HEADER_SIZE bytes: the magic string "GRIGMEM",
+ *     the format version (GRIG_MEM_CFG_VER) and the number of channels,
+ *     tags and bytes of strings, each as a 32 bit integer;
+ *   - the tag table, one 32 bit string offset per tag;
+ *   - the channel records of RIG_MEM_RECORD_SIZE bytes, sorted by
+ *     frequency: frequency [Hz], mode and tag mask as 64 bit integers,
+ *     then channel number, passband width, CTCSS tone, CTCSS squelch, DCS
+ *     code and name offset as 32 bit integers;
+ *   - the string table with the names of the tags and channels.
+ *
+ * The order of the records is the frequency index: a frequency range is
+ * found by binary search. Each channel has a mask of up to RIG_MEM_MAX_TAGS
+ * tags, from which a list of channels per tag is built on the first lookup
+ * after a change, so that looking up a tag does not go through all
+ * channels.
+ *
+ * Channels are addressed by their index in frequency order. Since the
+ * indices change when channels are added, removed or merged, even by the
+ * daemon at the end of a transfer, every index comes with the generation
+ * of the store it was taken from (see rig_mem_generation()); it is refused
+ * once the store has changed.
+ *
+ * The channels can be transferred to and from the memory channels of a
+ * rig. Like a scan (see rig-scan.h), a transfer only keeps the state; the
+ * daemon of the rig takes the channels with rig_mem_transfer_next(),
+ * makes the hamlib calls and reports them with rig_mem_transfer_result().
+ * A channel is uploaded by reading it from the rig, putting the stored
+ * settings into it with rig_mem_transfer_fill() and writing it back, so
+ * that settings the store does not hold are not lost. Downloaded channels
+ * are merged into the store when the transfer ends.
+ */
+#ifndef RIG_MEM_H
+#define RIG_MEM_H 1
+
+#include <glib.h>
+#include <hamlib/rig.h>
+
+
+#define RIG_MEM_HEADER_SIZE   32       /*!< Size of the file header [bytes]. */
+#define RIG_MEM_RECORD_SIZE   48       /*!< Size of a channel record [bytes]. */
+#define RIG_MEM_MAX_TAGS      64       /*!< Max number of different tags. */
+#define RIG_MEM_MAX_CHANNELS  100000   /*!< Max number of channels. */
+#define RIG_MEM_NAME_LEN      32       /*!< Max length of a name, including the NUL. */
+#define RIG_MEM_MAX_FAILURES  5        /*!< Consecutive failures after which a transfer is given up. */
+
+
+/** \brief Channel of the software memory. */
+typedef struct {
+	freq_t     freq;       /*!< Frequency [Hz]. */
+	rmode_t    mode;       /*!< Mode or RIG_MODE_NONE. */
+	pbwidth_t  width;      /*!< Passband width [Hz] or 0. */
+	gint       number;     /*!< Memory channel number in the rig or -1. */
+	tone_t     ctcss;      /*!< CTCSS tone [0.1 Hz] or 0. */
+	tone_t     ctcss_sql;  /*!< CTCSS squelch tone [0.1 Hz] or 0. */
+	tone_t     dcs;        /*!< DCS code or 0. */
+	guint64    tags;       /*!< Bit i is set if the channel has tag i. */
+	gchar      name[RIG_MEM_NAME_LEN];  /*!< Name of the channel. */
+} rig_mem_chan_t;
+
+
+gboolean  rig_mem_load       (const gchar *filename);
+gboolean  rig_mem_save       (void);
+gboolean  rig_mem_import     (const gchar *filename);
+gint      rig_mem_file_version (const gchar *filename);
+gboolean  rig_mem_modified   (void);
+guint     rig_mem_count      (void);
+guint     rig_mem_generation (void);
+gboolean  rig_mem_get        (guint index, guint gen, rig_mem_chan_t *chan);
+gboolean  rig_mem_add        (const rig_mem_chan_t *chan);
+gboolean  rig_mem_remove     (const guint *indices, guint count, guint gen);
+guint64   rig_mem_parse_tags (const gchar *tags);
+gchar    *rig_mem_tags_to_string (guint64 tags);
+guint     rig_mem_find       (freq_t low, freq_t high, const gchar *tag,
+			      guint **found, guint *gen);
+
+gboolean  rig_mem_download   (void);
+gboolean  rig_mem_upload     (const guint *indices, guint count, guint gen);
+void      rig_mem_transfer_stop (void);
+gboolean  rig_mem_transfer_running (guint *done, guint *total, guint *failed);
+
+/* used by the daemon */
+gboolean  rig_mem_transfer_next   (channel_t *chan, gboolean *upload);
+void      rig_mem_transfer_fill   (channel_t *chan, gboolean valid);
+void      rig_mem_transfer_result (gint retcode, const channel_t *chan);
+
+#endif
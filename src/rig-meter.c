@@ -0,0 +1,272 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+    Grig:  Gtk+ user interface for the Hamradio Control Libraries.
+
+    Copyright (C)  2001-2007  Alexandru Csete.
+
+    Authors: Alexandru Csete <oz9aec@gmail.com>
+
+    Comments, questions and bugreports should be submitted via
+    http://sourceforge.net/projects/groundstation/
+    More details can be found at the project home page:
+
+            http://groundstation.sourceforge.net/
+ 
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+  
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+  
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, visit http://www.fsf.org/
+ 
+ 
+ 
+ 
+*/
+/** \file    rig-meter.c
+ *  \ingroup shdata
+ *  \brief   Meter sample buffers.
+ *
+ * This object keeps the most recent readings of the signal strength, RF
+ * power, SWR and ALC meters in ring buffers together with the time they
+ * were acquired. The rig daemon adds a sample every time a meter has been
+ * read successfully, while the GUI asks for statistics (peak, average and
+ * RMS) over a time window. This way fast peaks, which would otherwise fall
+ * between two s-meter updates, can be displayed.
+ *
+ * The buffers are written by the daemon thread and read by the GUI, so
+ * all access is protected by a mutex.
+ */
+#include <glib.h>
+#include <math.h>
+#include "rig-meter.h"
+
+
+/** \brief One meter sample. */
+typedef struct {
+	gdouble  time;     /*!< Time in seconds since rig_meter_init(). */
+	gfloat   value;    /*!< The sample value. */
+} meter_sample_t;
+
+
+/** \brief Ring buffer holding the samples of one meter. */
+typedef struct {
+	meter_sample_t  samples[RIG_METER_BUFFER_SIZE];  /*!< The samples. */
+	guint           head;                            /*!< Index of next sample. */
+	guint           count;                           /*!< Number of valid samples. */
+} meter_buffer_t;
+
+
+/** \brief Flags indicating which meters use a logarithmic (dB) scale. */
+static const gboolean METER_IS_DB[RIG_METER_NUMBER] = {
+	TRUE,     /* RIG_METER_STRENGTH */
+	FALSE,    /* RIG_METER_POWER    */
+	FALSE,    /* RIG_METER_SWR      */
+	FALSE     /* RIG_METER_ALC      */
+};
+
+
+static meter_buffer_t buffers[RIG_METER_NUMBER];   /*!< The sample buffers. */
+static GTimer        *timer = NULL;                /*!< Time reference. */
+
+#if GLIB_CHECK_VERSION(2,32,0)
+static GMutex        mutex;
+#  define METER_LOCK()   g_mutex_lock (&mutex)
+#  define METER_UNLOCK() g_mutex_unlock (&mutex)
+#else
+static GStaticMutex  mutex = G_STATIC_MUTEX_INIT;
+#  define METER_LOCK()   g_static_mutex_lock (&mutex)
+#  define METER_UNLOCK() g_static_mutex_unlock (&mutex)
+#endif
+
+
+
+/** \brief Initialise the meter buffers.
+ *
+ * This function clears all buffers and starts the time reference. It
+ * should be called by the daemon before it starts polling the rig.
+ */
+void
+rig_meter_init ()
+{
+	guint i;
+
+	METER_LOCK ();
+
+	if (timer == NULL) {
+		timer = g_timer_new ();
+	}
+	else {
+		g_timer_start (timer);
+	}
+
+	for (i = 0; i < RIG_METER_NUMBER; i++) {
+		buffers[i].head = 0;
+		buffers[i].count = 0;
+	}
+
+	METER_UNLOCK ();
+}
+
+
+/** \brief Free resources used by the meter buffers. */
+void
+rig_meter_free ()
+{
+	METER_LOCK ();
+
+	if (timer != NULL) {
+		g_timer_destroy (timer);
+		timer = NULL;
+	}
+
+	METER_UNLOCK ();
+}
+
+
+/** \brief Discard all samples of a meter.
+ *  \param meter The meter to clear.
+ *
+ * This can be used when the samples become meaningless, e.g. when
+ * switching between RX and TX.
+ */
+void
+rig_meter_clear (rig_meter_t meter)
+{
+	if (meter >= RIG_METER_NUMBER)
+		return;
+
+	METER_LOCK ();
+	buffers[meter].head = 0;
+	buffers[meter].count = 0;
+	METER_UNLOCK ();
+}
+
+
+/** \brief Add a new sample.
+ *  \param meter The meter which has been read.
+ *  \param value The value read from the rig.
+ *
+ * The oldest sample is overwritten when the buffer is full.
+ */
+void
+rig_meter_add_sample (rig_meter_t meter, gfloat value)
+{
+	meter_buffer_t *buf;
+
+	if (meter >= RIG_METER_NUMBER)
+		return;
+
+	METER_LOCK ();
+
+	if (timer != NULL) {
+		buf = &buffers[meter];
+
+		buf->samples[buf->head].time  = g_timer_elapsed (timer, NULL);
+		buf->samples[buf->head].value = value;
+
+		buf->head = (buf->head + 1) % RIG_METER_BUFFER_SIZE;
+		if (buf->count < RIG_METER_BUFFER_SIZE) {
+			buf->count++;
+		}
+	}
+
+	METER_UNLOCK ();
+}
+
+
+/** \brief Get meter statistics.
+ *  \param meter  The meter.
+ *  \param window The length of the time window in seconds.
+ *  \param stats  Structure where the result is stored.
+ *  \return TRUE if there was at least one sample within the window.
+ *
+ * This function calculates the peak, average and RMS value of the samples
+ * acquired within the last window seconds. For the signal strength, which
+ * is in dB, the RMS value is the average power converted back to dB.
+ * The most recent sample is returned even if it is older than the window.
+ */
+gboolean
+rig_meter_get_stats  (rig_meter_t meter,
+		      gdouble window,
+		      rig_meter_stats_t *stats)
+{
+	meter_buffer_t *buf;
+	gdouble         now;
+	gdouble         sum = 0.0;
+	gdouble         sumsq = 0.0;
+	gfloat          value;
+	guint           i, idx;
+
+
+	stats->count = 0;
+	stats->last  = 0.0;
+	stats->peak  = 0.0;
+	stats->avg   = 0.0;
+	stats->rms   = 0.0;
+
+	if (meter >= RIG_METER_NUMBER)
+		return FALSE;
+
+	METER_LOCK ();
+
+	buf = &buffers[meter];
+
+	if ((timer == NULL) || (buf->count == 0)) {
+		METER_UNLOCK ();
+		return FALSE;
+	}
+
+	now = g_timer_elapsed (timer, NULL);
+
+	/* walk backwards from the newest sample */
+	for (i = 0; i < buf->count; i++) {
+
+		idx = (buf->head + RIG_METER_BUFFER_SIZE - 1 - i) % RIG_METER_BUFFER_SIZE;
+		value = buf->samples[idx].value;
+
+		if (i == 0) {
+			stats->last = value;
+			stats->peak = value;
+		}
+
+		if (now - buf->samples[idx].time > window)
+			break;
+
+		if (value > stats->peak) {
+			stats->peak = value;
+		}
+
+		sum += value;
+		if (METER_IS_DB[meter]) {
+			sumsq += pow (10.0, value / 10.0);
+		}
+		else {
+			sumsq += value * value;
+		}
+
+		stats->count++;
+	}
+
+	METER_UNLOCK ();
+
+	if (stats->count == 0)
+		return FALSE;
+
+	stats->avg = sum / stats->count;
+
+	if (METER_IS_DB[meter]) {
+		stats->rms = 10.0 * log10 (sumsq / stats->count);
+	}
+	else {
+		stats->rms = sqrt (sumsq / stats->count);
+	}
+
+	return TRUE;
+}
@@ -0,0 +1,79 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+    Grig:  Gtk+ user interface for the Hamradio Control Libraries.
+
+    Copyright (C)  2001-2007  Alexandru Csete.
+
+    Authors: Alexandru Csete <oz9aec@gmail.com>
+
+    Comments, questions and bugreports should be submitted via
+    http://sourceforge.net/projects/groundstation/
+    More details can be found at the project home page:
+
+            http://groundstation.sourceforge.net/
+ 
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+  
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+  
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, visit http://www.fsf.org/
+ 
+ 
+ 
+ 
+*/
+/** \file    rig-meter.h
+ *  \ingroup shdata
+ *  \brief   Meter sample buffers (interface).
+ */
+#ifndef RIG_METER_H
+#define RIG_METER_H 1
+
+
+/** \brief Number of samples kept for each meter. */
+#define RIG_METER_BUFFER_SIZE 256
+
+/** \brief Default averaging window in seconds. */
+#define RIG_METER_DEF_WINDOW  1.0
+
+/** \brief Default peak hold time in seconds. */
+#define RIG_METER_DEF_HOLD    2.0
+
+
+/** \brief Available meters. */
+typedef enum {
+	RIG_METER_STRENGTH = 0,    /*!< Signal strength in dB (log scale). */
+	RIG_METER_POWER,           /*!< RF power [0.0;1.0]. */
+	RIG_METER_SWR,             /*!< SWR. */
+	RIG_METER_ALC,             /*!< ALC level. */
+	RIG_METER_NUMBER           /*!< Number of meters. */
+} rig_meter_t;
+
+
+/** \brief Meter statistics over a time window. */
+typedef struct {
+	guint    count;    /*!< Number of samples within the window. */
+	gfloat   last;     /*!< Most recent sample. */
+	gfloat   peak;     /*!< Largest sample. */
+	gfloat   avg;      /*!< Arithmetic mean. */
+	gfloat   rms;      /*!< RMS value; power average for the dB meter. */
+} rig_meter_stats_t;
+
+
+void     rig_meter_init       (void);
+void     rig_meter_free       (void);
+void     rig_meter_clear      (rig_meter_t meter);
+void     rig_meter_add_sample (rig_meter_t meter, gfloat value);
+gboolean rig_meter_get_stats  (rig_meter_t meter,
+                               gdouble window,
+                               rig_meter_stats_t *stats);
+
+
+#endif
@@ -0,0 +1,484 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+    Grig:  Gtk+ user interface for the Hamradio Control Libraries.
+
+    Copyright (C)  2001-2007  Alexandru Csete.
+
+    Authors: Alexandru Csete <oz9aec@gmail.com>
+
+    Comments, questions and bugreports should be submitted via
+    http://sourceforge.net/projects/groundstation/
+    More details can be found at the project home page:
+
+            http://groundstation.sourceforge.net/
+ 
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+  
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+  
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, visit http://www.fsf.org/
+ 
+ 
+ 
+*/
+/** \file rig-record.c
+ *  \ingroup shdata
+ *  \brief Recording and replay of rig daemon traffic.
+ *
+ * Recording happens at the boundary between the daemon and hamlib: the
+ * daemon takes a copy of the 'get' settings before each command and
+ * passes both copies to rig_record_cmd(), which stores only the 32 bit
+ * words that have changed. A typical poll that does not change anything
+ * costs 24 bytes in the file. The file is written through a stdio buffer
+ * by the daemon thread; rig_record_stop() must only be called after the
+ * daemon has stopped.
+ *
+ * A recording is loaded into memory completely before replay, so that the
+ * replay timing is not disturbed by file I/O.
+ */
+#include <glib.h>
+#include <glib/gi18n.h>
+#include <glib/gstdio.h>
+#include <stdio.h>
+#include <string.h>
+#include <hamlib/rig.h>
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+#include "grig-debug.h"
+#include "rig-data.h"
+#include "rig-daemon.h"
+#include "rig-record.h"
+
+
+#define RECORD_BUFFER_SIZE 65536  /*!< stdio buffer size for the recording. */
+
+
+static FILE    *recfile  = NULL;  /*!< The recording or NULL if not recording. */
+static gchar   *recname  = NULL;  /*!< File name of the recording. */
+static gint64   rectime  = 0;     /*!< Start time of the recording. */
+static guint    reccount = 0;     /*!< Number of recorded entries. */
+
+static gchar   *replaybuf  = NULL; /*!< The loaded recording. */
+static gsize    replaylen  = 0;    /*!< Size of the loaded recording. */
+static gsize    replaypos  = 0;    /*!< Offset of the next entry. */
+static rig_record_entry_t replayentry; /*!< The current entry. */
+static const guchar *replaydata = NULL; /*!< Changes of the current entry. */
+
+
+static gboolean rig_record_write (gconstpointer, gsize);
+
+
+
+/** \brief Get current time.
+ *  \return A monotonic time stamp in microseconds.
+ */
+gint64
+rig_record_time   ()
+{
+#if GLIB_CHECK_VERSION(2,28,0)
+	return g_get_monotonic_time ();
+#else
+	GTimeVal tval;
+
+	g_get_current_time (&tval);
+
+	return ((gint64) tval.tv_sec * G_USEC_PER_SEC) + tval.tv_usec;
+#endif
+}
+
+
+/** \brief Start recording.
+ *  \param filename The file to record to; an existing file is overwritten.
+ *  \param rigid The hamlib model of the rig.
+ *  \param get The current 'get' settings.
+ *  \param has_get The 'has_get' capabilities.
+ *  \param has_set The 'has_set' capabilities.
+ *  \return TRUE if the recording has been started.
+ */
+gboolean
+rig_record_start  (const gchar            *filename,
+		   gint                    rigid,
+		   const grig_settings_t  *get,
+		   const grig_cmd_avail_t *has_get,
+		   const grig_cmd_avail_t *has_set)
+{
+	rig_record_header_t header;
+
+
+	if (recfile != NULL) {
+		rig_record_stop ();
+	}
+
+	recfile = g_fopen (filename, "wb");
+
+	if (recfile == NULL) {
+		grig_debug_local (RIG_DEBUG_ERR,
+				  _("%s: Could not create %s"),
+				  __FUNCTION__, filename);
+		return FALSE;
+	}
+
+	setvbuf (recfile, NULL, _IOFBF, RECORD_BUFFER_SIZE);
+
+	recname = g_strdup (filename);
+	rectime = rig_record_time ();
+	reccount = 0;
+
+	memset (&header, 0, sizeof (header));
+	memcpy (header.magic, RIG_RECORD_MAGIC, sizeof (header.magic));
+	header.version = RIG_RECORD_VERSION;
+	header.rigid = rigid;
+	header.settings_size = sizeof (grig_settings_t);
+	header.avail_size = sizeof (grig_cmd_avail_t);
+
+	if (!rig_record_write (&header, sizeof (header)) ||
+	    !rig_record_write (get, sizeof (grig_settings_t)) ||
+	    !rig_record_write (has_get, sizeof (grig_cmd_avail_t)) ||
+	    !rig_record_write (has_set, sizeof (grig_cmd_avail_t))) {
+
+		return FALSE;
+	}
+
+	grig_debug_local (RIG_DEBUG_VERBOSE,
+			  _("%s: Recording rig traffic to %s"),
+			  __FUNCTION__, filename);
+
+	return TRUE;
+}
+
+
+/** \brief Record an executed command.
+ *  \param cmd The command.
+ *  \param status The status returned by the daemon.
+ *  \param retcode The hamlib return code.
+ *  \param start Time stamp taken with rig_record_time() before execution.
+ *  \param before Copy of the 'get' settings before execution.
+ *  \param after The 'get' settings after execution.
+ */
+void
+rig_record_cmd    (rig_cmd_t               cmd,
+		   gint                    status,
+		   gint                    retcode,
+		   gint64                  start,
+		   const grig_settings_t  *before,
+		   const grig_settings_t  *after)
+{
+	rig_record_entry_t entry;
+	guchar diff[3 * sizeof (grig_settings_t)];
+	gint64 now;
+
+
+	if (recfile == NULL)
+		return;
+
+	now = rig_record_time ();
+
+	memset (&entry, 0, sizeof (entry));
+	entry.time = start - rectime;
+	entry.duration = (guint32) (now - start);
+	entry.retcode = retcode;
+	entry.cmd = cmd;
+	entry.status = status;
+	entry.size = rig_record_diff ((const guchar *) before,
+				      (const guchar *) after,
+				      sizeof (grig_settings_t),
+				      diff);
+
+	if (rig_record_write (&entry, sizeof (entry)) && entry.size) {
+		rig_record_write (diff, entry.size);
+	}
+
+	reccount++;
+}
+
+
+/** \brief Record the end of a daemon cycle. */
+void
+rig_record_cycle  ()
+{
+	rig_record_entry_t entry;
+
+
+	if (recfile == NULL)
+		return;
+
+	memset (&entry, 0, sizeof (entry));
+	entry.time = rig_record_time () - rectime;
+	entry.cmd = RIG_CMD_NONE;
+
+	rig_record_write (&entry, sizeof (entry));
+
+	reccount++;
+}
+
+
+/** \brief Stop recording and close the file. */
+void
+rig_record_stop   ()
+{
+	if (recfile == NULL)
+		return;
+
+	if (fclose (recfile) != 0) {
+		grig_debug_local (RIG_DEBUG_ERR,
+				  _("%s: Error writing %s"),
+				  __FUNCTION__, recname);
+	}
+	else {
+		grig_debug_local (RIG_DEBUG_VERBOSE,
+				  _("%s: Recorded %d entries to %s"),
+				  __FUNCTION__, reccount, recname);
+	}
+
+	recfile = NULL;
+	g_free (recname);
+	recname = NULL;
+}
+
+
+/** \brief Load a recording for replay.
+ *  \param filename The recording.
+ *  \param rigid Location to store the recorded hamlib model.
+ *  \param get Location to store the initial 'get' settings.
+ *  \param has_get Location to store the 'has_get' capabilities.
+ *  \param has_set Location to store the 'has_set' capabilities.
+ *  \return TRUE if the recording has been loaded.
+ */
+gboolean
+rig_replay_load   (const gchar            *filename,
+		   gint                   *rigid,
+		   grig_settings_t        *get,
+		   grig_cmd_avail_t       *has_get,
+		   grig_cmd_avail_t       *has_set)
+{
+	rig_record_header_t header;
+	GError *err = NULL;
+	gsize   pos;
+
+
+	rig_replay_unload ();
+
+	if (!g_file_get_contents (filename, &replaybuf, &replaylen, &err)) {
+		grig_debug_local (RIG_DEBUG_ERR,
+				  _("%s: %s"),
+				  __FUNCTION__, err->message);
+		g_clear_error (&err);
+		return FALSE;
+	}
+
+	pos = sizeof (header) + sizeof (grig_settings_t) + 2 * sizeof (grig_cmd_avail_t);
+
+	if (replaylen < pos) {
+		grig_debug_local (RIG_DEBUG_ERR,
+				  _("%s: %s is not a grig recording"),
+				  __FUNCTION__, filename);
+		rig_replay_unload ();
+		return FALSE;
+	}
+
+	memcpy (&header, replaybuf, sizeof (header));
+
+	if (memcmp (header.magic, RIG_RECORD_MAGIC, sizeof (header.magic))) {
+		grig_debug_local (RIG_DEBUG_ERR,
+				  _("%s: %s is not a grig recording"),
+				  __FUNCTION__, filename);
+		rig_replay_unload ();
+		return FALSE;
+	}
+
+	if ((header.version != RIG_RECORD_VERSION) ||
+	    (header.settings_size != sizeof (grig_settings_t)) ||
+	    (header.avail_size != sizeof (grig_cmd_avail_t))) {
+		grig_debug_local (RIG_DEBUG_ERR,
+				  _("%s: %s has been recorded by an incompatible "\
+				    "version of grig"),
+				  __FUNCTION__, filename);
+		rig_replay_unload ();
+		return FALSE;
+	}
+
+	*rigid = header.rigid;
+
+	memcpy (get, replaybuf + sizeof (header), sizeof (grig_settings_t));
+	memcpy (has_get, replaybuf + sizeof (header) + sizeof (grig_settings_t),
+		sizeof (grig_cmd_avail_t));
+	memcpy (has_set, replaybuf + sizeof (header) + sizeof (grig_settings_t) +
+		sizeof (grig_cmd_avail_t), sizeof (grig_cmd_avail_t));
+
+	replaypos = pos;
+
+	grig_debug_local (RIG_DEBUG_VERBOSE,
+			  _("%s: Loaded %s (rig model %d, %d bytes)"),
+			  __FUNCTION__, filename, header.rigid, (gint) replaylen);
+
+	return TRUE;
+}
+
+
+/** \brief Advance to the next recorded entry.
+ *  \param cmd Location to store the command of the entry.
+ *  \param when Location to store the time of the entry [usec].
+ *  \return TRUE if there was another entry, FALSE at the end of the recording.
+ *
+ * The entry becomes the current entry used by rig_replay_exec().
+ */
+gboolean
+rig_replay_next   (rig_cmd_t *cmd, gint64 *when)
+{
+	if ((replaybuf == NULL) || (replaypos + sizeof (replayentry) > replaylen))
+		return FALSE;
+
+	memcpy (&replayentry, replaybuf + replaypos, sizeof (replayentry));
+	replaypos += sizeof (replayentry);
+
+	if ((replayentry.cmd >= RIG_CMD_NUMBER) ||
+	    (replaypos + replayentry.size > replaylen)) {
+		grig_debug_local (RIG_DEBUG_ERR,
+				  _("%s: Corrupt entry at offset %d"),
+				  __FUNCTION__, (gint) (replaypos - sizeof (replayentry)));
+		replaypos = replaylen;
+		return FALSE;
+	}
+
+	replaydata = (const guchar *) replaybuf + replaypos;
+	replaypos += replayentry.size;
+
+	*cmd = replayentry.cmd;
+	*when = replayentry.time;
+
+	return TRUE;
+}
+
+
+/** \brief Replay the current entry.
+ *  \param get The 'get' settings to apply the recorded changes to.
+ *  \param retcode Location to store the recorded hamlib return code.
+ *  \param speed Speed factor; the recorded duration is divided by this
+ *               value. 0 means do not wait at all.
+ *  \return The recorded daemon status.
+ */
+gint
+rig_replay_exec   (grig_settings_t *get, gint *retcode, gdouble speed)
+{
+	guint16 off, len;
+	guint   i = 0;
+
+
+	if (replaydata == NULL) {
+		*retcode = RIG_OK;
+		return 0;
+	}
+
+	if ((speed > 0.0) && replayentry.duration) {
+		g_usleep ((gulong) (replayentry.duration / speed));
+	}
+
+	while (i + 2 * sizeof (guint16) <= replayentry.size) {
+		memcpy (&off, replaydata + i, sizeof (guint16));
+		memcpy (&len, replaydata + i + sizeof (guint16), sizeof (guint16));
+		i += 2 * sizeof (guint16);
+
+		if ((i + len > replayentry.size) ||
+		    (off + len > sizeof (grig_settings_t)))
+			break;
+
+		memcpy ((guchar *) get + off, replaydata + i, len);
+		i += len;
+	}
+
+	*retcode = replayentry.retcode;
+
+	return replayentry.status;
+}
+
+
+/** \brief Free the loaded recording. */
+void
+rig_replay_unload ()
+{
+	g_free (replaybuf);
+	replaybuf = NULL;
+	replaylen = 0;
+	replaypos = 0;
+	replaydata = NULL;
+}
+
+
+/** \brief Encode the changes between two buffers.
+ *  \param a The old contents.
+ *  \param b The new contents.
+ *  \param size The size of the buffers.
+ *  \param out Output buffer; must hold at least 3 * size bytes.
+ *  \return The number of bytes written to \a out.
+ *
+ * The buffers are compared in 32 bit words and each run of changed
+ * words is written as (offset, length, new data). The same encoding is
+ * used for the state deltas sent to grigd clients.
+ */
+guint16
+rig_record_diff  (const guchar *a, const guchar *b, guint size, guchar *out)
+{
+	guint   i = 0;
+	guint   n = 0;
+	guint   run;
+	guint16 off, len;
+
+
+	while (i < size) {
+
+		if (!memcmp (a + i, b + i, MIN (4, size - i))) {
+			i += 4;
+			continue;
+		}
+
+		run = i;
+
+		while ((i < size) && memcmp (a + i, b + i, MIN (4, size - i)))
+			i += 4;
+
+		off = run;
+		len = MIN (i, size) - run;
+
+		memcpy (out + n, &off, sizeof (guint16));
+		memcpy (out + n + sizeof (guint16), &len, sizeof (guint16));
+		memcpy (out + n + 2 * sizeof (guint16), b + run, len);
+		n += 2 * sizeof (guint16) + len;
+	}
+
+	return n;
+}
+
+
+/** \brief Write to the recording.
+ *  \param data The data to write.
+ *  \param size The number of bytes to write.
+ *  \return TRUE if the data has been written.
+ *
+ * On error the recording is closed.
+ */
+static gboolean
+rig_record_write (gconstpointer data, gsize size)
+{
+	if (fwrite (data, 1, size, recfile) != size) {
+		grig_debug_local (RIG_DEBUG_ERR,
+				  _("%s: Error writing %s; recording stopped"),
+				  __FUNCTION__, recname);
+
+		fclose (recfile);
+		recfile = NULL;
+		g_free (recname);
+		recname = NULL;
+
+		return FALSE;
+	}
+
+	return TRUE;
+}
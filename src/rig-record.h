@@ -0,0 +1,122 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+    Grig:  Gtk+ user interface for the Hamradio Control Libraries.
+
+    Copyright (C)  2001-2007  Alexandru Csete.
+
+    Authors: Alexandru Csete <oz9aec@gmail.com>
+
+    Comments, questions and bugreports should be submitted via
+    http://sourceforge.net/projects/groundstation/
+    More details can be found at the project home page:
+
+            http://groundstation.sourceforge.net/
+ 
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+  
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+  
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, visit http://www.fsf.org/
+ 
+ 
+ 
+*/
+/** \file rig-record.h
+ *  \ingroup shdata
+ *  \brief Recording and replay of rig daemon traffic.
+ *
+ * The recorder captures every command executed by the rig daemon together
+ * with its time stamp, duration, hamlib return code and the changes it made
+ * to the shared 'get' settings. A recording can be replayed later without
+ * any hardware; the replayed commands go through the same daemon code path
+ * with the original timing or accelerated by a speed factor, which makes
+ * recordings usable as benchmarks and regression tests.
+ *
+ * File layout (host byte order):
+ *
+ *   rig_record_header_t   magic, version, rig model and structure sizes
+ *   grig_settings_t       initial 'get' settings
+ *   grig_cmd_avail_t      'has_get' capabilities
+ *   grig_cmd_avail_t      'has_set' capabilities
+ *
+ * followed by one rig_record_entry_t per command, each followed by 'size'
+ * bytes of changes to the 'get' settings encoded as a sequence of
+ * (guint16 offset, guint16 length, data) runs. Entries with the command
+ * RIG_CMD_NONE mark the end of a daemon cycle.
+ */
+#ifndef RIG_RECORD_H
+#define RIG_RECORD_H 1
+
+#include <glib.h>
+#include "rig-daemon.h"
+#include "rig-data.h"
+
+
+#define RIG_RECORD_MAGIC   "GRIGREC1"  /*!< File identifier. */
+#define RIG_RECORD_VERSION 1           /*!< File format version. */
+
+
+/** \brief Recording file header. */
+typedef struct {
+	gchar   magic[8];        /*!< RIG_RECORD_MAGIC without terminating zero. */
+	guint32 version;         /*!< RIG_RECORD_VERSION. */
+	gint32  rigid;           /*!< Hamlib model of the recorded rig. */
+	guint32 settings_size;   /*!< sizeof (grig_settings_t) when recorded. */
+	guint32 avail_size;      /*!< sizeof (grig_cmd_avail_t) when recorded. */
+} rig_record_header_t;
+
+
+/** \brief Recorded command. */
+typedef struct {
+	gint64  time;            /*!< Start time relative to start of recording [usec]. */
+	guint32 duration;        /*!< Execution time [usec]. */
+	gint32  retcode;         /*!< Hamlib return code. */
+	guint16 cmd;             /*!< The command (rig_cmd_t). */
+	guint8  status;          /*!< Status returned by the daemon. */
+	guint8  reserved;        /*!< Unused, always 0. */
+	guint16 size;            /*!< Size of the following changes [bytes]. */
+	guint16 reserved2;       /*!< Unused, always 0. */
+} rig_record_entry_t;
+
+
+gint64   rig_record_time   (void);
+
+gboolean rig_record_start  (const gchar            *filename,
+			    gint                    rigid,
+			    const grig_settings_t  *get,
+			    const grig_cmd_avail_t *has_get,
+			    const grig_cmd_avail_t *has_set);
+void     rig_record_cmd    (rig_cmd_t               cmd,
+			    gint                    status,
+			    gint                    retcode,
+			    gint64                  start,
+			    const grig_settings_t  *before,
+			    const grig_settings_t  *after);
+void     rig_record_cycle  (void);
+void     rig_record_stop   (void);
+
+gboolean rig_replay_load   (const gchar            *filename,
+			    gint                   *rigid,
+			    grig_settings_t        *get,
+			    grig_cmd_avail_t       *has_get,
+			    grig_cmd_avail_t       *has_set);
+gboolean rig_replay_next   (rig_cmd_t              *cmd,
+			    gint64                 *when);
+gint     rig_replay_exec   (grig_settings_t        *get,
+			    gint                   *retcode,
+			    gdouble                 speed);
+void     rig_replay_unload (void);
+
+guint16  rig_record_diff   (const guchar           *a,
+			    const guchar           *b,
+			    guint                   size,
+			    guchar                 *out);
+
+#endif
@@ -0,0 +1,772 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+    Grig:  Gtk+ user interface for the Hamradio Control Libraries.
+
+    Copyright (C)  2001-2007  Alexandru Csete.
+
+    Authors: Alexandru Csete <oz9aec@gmail.com>
+
+    Comments, questions and bugreports should be submitted via
+    http://sourceforge.net/projects/groundstation/
+    More details can be found at the project home page:
+
+            http://groundstation.sourceforge.net/
+ 
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+  
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+  
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, visit http://www.fsf.org/
+ 
+ 
+ 
+*/
+/** \file rig-scan.c
+ *  \ingroup shdata
+ *  \brief Software scan engine.
+ *
+ * The engine only keeps the channel list and the results and decides
+ * what to do next; the hamlib calls are made by the daemon of the rig,
+ * which asks for the next channel with rig_scan_next() and reports the
+ * measurement with rig_scan_result(). Each rig has its own scan.
+ *
+ * A band-scope sweep is a repeated scan whose channels are placed around
+ * the frequency the daemon tunes back to, taken at the start of each
+ * sweep. The levels of the last completed sweep are kept apart so that
+ * the user interface always gets a whole sweep.
+ */
+#include <glib.h>
+#include <glib/gi18n.h>
+#include <math.h>
+#include <string.h>
+#include <hamlib/rig.h>
+#include "grig-debug.h"
+#include "rig-ctx.h"
+#include "rig-data.h"
+#include "rig-scan.h"
+
+
+/** \brief Scan of one rig. */
+typedef struct {
+	GArray   *chans;     /*!< One rig_scan_result_t per channel. */
+	guint     pos;       /*!< Channel to be measured next. */
+	gulong    settle;    /*!< Settle time [msec]. */
+	gint      level;     /*!< Activity threshold [dB rel. S9]. */
+	gboolean  usedcd;    /*!< Detect activity by the squelch status. */
+	guint     dwell;     /*!< Time to listen on active channels [msec] or 0 to stop. */
+	gboolean  repeat;    /*!< Start over at the end of the list. */
+	gchar    *outfile;   /*!< File to save the results to or NULL. */
+	gboolean  running;   /*!< The scan is in progress. */
+	GTimer   *timer;     /*!< Time since the scan has been started. */
+	gdouble   resume;    /*!< Timer value at which a dwell ends [sec]. */
+	guint     failures;  /*!< Number of consecutive failures. */
+	guint     measured;  /*!< Number of channels measured. */
+	guint     active;    /*!< Number of active channels found. */
+	gboolean  sweep;     /*!< Band-scope sweep around the tuned frequency. */
+	freq_t    span;      /*!< Width of the sweep [Hz]. */
+	freq_t    first;     /*!< Frequency of the first point of the current sweep [Hz]. */
+	gint     *last;      /*!< Levels of the last completed sweep. */
+	freq_t    laststart; /*!< Frequency of the first point of the last completed sweep [Hz]. */
+	guint     serial;    /*!< Number of completed sweeps. */
+} scan_t;
+
+
+static scan_t  scans[RIG_CTX_MAX];  /*!< The scans, by rig index. */
+
+#if GLIB_CHECK_VERSION(2,32,0)
+static GMutex        mutex;
+#  define SCAN_LOCK()   g_mutex_lock (&mutex)
+#  define SCAN_UNLOCK() g_mutex_unlock (&mutex)
+#else
+static GStaticMutex  mutex = G_STATIC_MUTEX_INIT;
+#  define SCAN_LOCK()   g_static_mutex_lock (&mutex)
+#  define SCAN_UNLOCK() g_static_mutex_unlock (&mutex)
+#endif
+
+
+static gboolean scan_install   (scan_t *scan);
+static gboolean scan_parse     (const gchar *spec, scan_t *scan);
+static gboolean scan_parse_int (const gchar *str, gint min, gint max, gint *val);
+static gboolean scan_add       (GArray *chans, freq_t freq);
+static gboolean scan_add_range (GArray *chans, const gchar *range);
+static gboolean scan_add_list  (GArray *chans, const gchar *filename);
+static void     scan_free      (scan_t *scan);
+static void     scan_advance   (scan_t *scan);
+static void     scan_finish    (scan_t *scan, const gchar *reason);
+static void     scan_save      (scan_t *scan);
+static void     scan_swept     (scan_t *scan);
+
+
+
+/** \brief Start scanning with the current rig.
+ *  \param spec The channels and settings, see rig-scan.h.
+ *  \return TRUE if the scan has been started.
+ *
+ * A scan which is already running on the rig is replaced.
+ */
+gboolean
+rig_scan_start       (const gchar *spec)
+{
+	scan_t scan;
+	guint  len;
+
+
+	memset (&scan, 0, sizeof (scan_t));
+	scan.settle = RIG_SCAN_DEF_SETTLE;
+	scan.level = RIG_SCAN_DEF_LEVEL;
+	scan.chans = g_array_new (FALSE, TRUE, sizeof (rig_scan_result_t));
+
+	if (!scan_parse (spec, &scan)) {
+		scan_free (&scan);
+		return FALSE;
+	}
+
+	len = scan.chans->len;
+
+	if (!scan_install (&scan))
+		return FALSE;
+
+	grig_debug_local (RIG_DEBUG_VERBOSE,
+			  _("%s: Scanning %u channels on rig %d"),
+			  __FUNCTION__, len, rig_ctx_current ()->index + 1);
+
+	return TRUE;
+}
+
+
+/** \brief Start band-scope sweeps with the current rig.
+ *  \param span The width of the sweep [Hz].
+ *  \param points The number of points in a sweep.
+ *  \param settle The settle time [msec].
+ *  \return TRUE if the sweeps have been started.
+ *
+ * A scan which is already running on the rig is replaced.
+ */
+gboolean
+rig_scan_sweep_start (freq_t span, guint points, gulong settle)
+{
+	scan_t scan;
+
+
+	if ((span <= 0) || (points < 2) || (points > RIG_SCAN_MAX_POINTS))
+		return FALSE;
+
+	memset (&scan, 0, sizeof (scan_t));
+	scan.settle = settle;
+	scan.repeat = TRUE;
+	scan.sweep = TRUE;
+	scan.span = span;
+	scan.chans = g_array_new (FALSE, TRUE, sizeof (rig_scan_result_t));
+	g_array_set_size (scan.chans, points);
+	scan.last = g_new0 (gint, points);
+
+	if (!scan_install (&scan))
+		return FALSE;
+
+	grig_debug_local (RIG_DEBUG_VERBOSE,
+			  _("%s: Sweeping %.0f Hz in %u points on rig %d"),
+			  __FUNCTION__, span, points, rig_ctx_current ()->index + 1);
+
+	return TRUE;
+}
+
+
+/** \brief Stop the scan of the current rig.
+ *
+ * The results are kept until the next scan is started.
+ */
+void
+rig_scan_stop        ()
+{
+	scan_t *scan = &scans[rig_ctx_current ()->index];
+
+	SCAN_LOCK ();
+	if (scan->running)
+		scan_finish (scan, _("Scan stopped"));
+	SCAN_UNLOCK ();
+}
+
+
+/** \brief Check whether the current rig is scanning.
+ *  \return TRUE if a scan is in progress, including dwells.
+ */
+gboolean
+rig_scan_running     ()
+{
+	scan_t  *scan = &scans[rig_ctx_current ()->index];
+	gboolean result;
+
+	SCAN_LOCK ();
+	result = scan->running;
+	SCAN_UNLOCK ();
+
+	return result;
+}
+
+
+/** \brief Check whether the current rig runs band-scope sweeps.
+ *  \return TRUE if sweeps are in progress.
+ */
+gboolean
+rig_scan_sweeping    ()
+{
+	scan_t  *scan = &scans[rig_ctx_current ()->index];
+	gboolean result;
+
+	SCAN_LOCK ();
+	result = scan->running && scan->sweep;
+	SCAN_UNLOCK ();
+
+	return result;
+}
+
+
+/** \brief Get the last completed sweep of the current rig.
+ *  \param serial The number of the sweep the caller already has or 0.
+ *  \param sweep Location to store the sweep; the levels are newly
+ *                allocated and must be freed with g_free().
+ *  \return FALSE if there is no newer sweep.
+ */
+gboolean
+rig_scan_get_sweep   (guint serial, rig_scan_sweep_t *sweep)
+{
+	scan_t  *scan = &scans[rig_ctx_current ()->index];
+	gboolean ok;
+
+	SCAN_LOCK ();
+
+	ok = scan->sweep && (scan->serial > 0) && (scan->serial != serial);
+
+	if (ok) {
+		sweep->serial = scan->serial;
+		sweep->start = scan->laststart;
+		sweep->points = scan->chans->len;
+		sweep->step = scan->span / (sweep->points - 1);
+		sweep->levels = g_new (gint, sweep->points);
+		memcpy (sweep->levels, scan->last, sweep->points * sizeof (gint));
+	}
+
+	SCAN_UNLOCK ();
+
+	return ok;
+}
+
+
+/** \brief Get the results of the current or last scan of the current rig.
+ *  \param results Location to store a newly allocated copy of the table
+ *                 in channel order; free it with g_free().
+ *  \return The number of channels in the table.
+ *
+ * Channels which have not been measured yet have the valid flag cleared.
+ */
+guint
+rig_scan_get_results (rig_scan_result_t **results)
+{
+	scan_t *scan = &scans[rig_ctx_current ()->index];
+	guint   len = 0;
+
+	*results = NULL;
+
+	SCAN_LOCK ();
+	if (scan->chans != NULL)
+		len = scan->chans->len;
+
+	if (len > 0) {
+		*results = g_new (rig_scan_result_t, len);
+		memcpy (*results, scan->chans->data, len * sizeof (rig_scan_result_t));
+	}
+	SCAN_UNLOCK ();
+
+	return len;
+}
+
+
+/** \brief Get the channel to be measured next.
+ *  \param home The frequency the rig is tuned to by the user.
+ *  \param freq Location to store the frequency.
+ *  \param settle Location to store the settle time [msec].
+ *  \param usedcd Location to store whether the squelch status should be
+ *                read instead of the signal strength.
+ *  \return FALSE if the rig is not scanning or dwells on a channel.
+ *
+ * Each call must be followed by a call to rig_scan_result(). A sweep is
+ * centred on the home frequency given at its first point.
+ */
+gboolean
+rig_scan_next        (freq_t home, freq_t *freq, gulong *settle, gboolean *usedcd)
+{
+	scan_t            *scan = &scans[rig_ctx_current ()->index];
+	rig_scan_result_t *chan;
+	gboolean           ok;
+
+	SCAN_LOCK ();
+
+	ok = scan->running &&
+		(g_timer_elapsed (scan->timer, NULL) >= scan->resume);
+
+	if (ok) {
+		chan = &g_array_index (scan->chans, rig_scan_result_t, scan->pos);
+
+		if (scan->sweep) {
+			if (scan->pos == 0)
+				scan->first = home - scan->span / 2;
+
+			chan->freq = scan->first +
+				scan->pos * scan->span / (scan->chans->len - 1);
+		}
+
+		*freq = chan->freq;
+		*settle = scan->settle;
+		*usedcd = scan->usedcd;
+	}
+
+	SCAN_UNLOCK ();
+
+	return ok;
+}
+
+
+/** \brief Store the measurement of the channel from rig_scan_next().
+ *  \param retcode The hamlib return code of tuning and measuring.
+ *  \param strength The signal strength [dB rel. S9].
+ *  \param dcd 1 if the squelch is open, 0 if closed and -1 if the signal
+ *             strength should be used instead.
+ *  \return TRUE if the channel is active.
+ */
+gboolean
+rig_scan_result      (gint retcode, gint strength, gint dcd)
+{
+	scan_t            *scan = &scans[rig_ctx_current ()->index];
+	rig_scan_result_t *chan;
+	gboolean           active = FALSE;
+
+
+	SCAN_LOCK ();
+
+	if (!scan->running) {
+		SCAN_UNLOCK ();
+		return FALSE;
+	}
+
+	chan = &g_array_index (scan->chans, rig_scan_result_t, scan->pos);
+
+	if (retcode != RIG_OK) {
+		if (++scan->failures >= RIG_SCAN_MAX_FAILURES)
+			scan_finish (scan, _("Scan given up after repeated failures"));
+		else
+			scan_advance (scan);
+
+		SCAN_UNLOCK ();
+		return FALSE;
+	}
+
+	scan->failures = 0;
+	scan->measured++;
+
+	if (scan->sweep)
+		active = FALSE;
+	else
+		active = (dcd >= 0) ? (dcd > 0) : (strength >= scan->level);
+
+	chan->strength = strength;
+	chan->active = active;
+	chan->valid = TRUE;
+
+	if (active) {
+		scan->active++;
+		grig_debug_local (RIG_DEBUG_VERBOSE,
+				  _("%s: Activity on %.0f Hz (%d dB)"),
+				  __FUNCTION__, chan->freq, strength);
+	}
+
+	if (active && (scan->dwell == 0)) {
+		scan_finish (scan, _("Scan stopped on activity"));
+	}
+	else {
+		if (active)
+			scan->resume = g_timer_elapsed (scan->timer, NULL) + scan->dwell / 1000.0;
+
+		scan_advance (scan);
+	}
+
+	SCAN_UNLOCK ();
+
+	return active;
+}
+
+
+/** \brief Check the rig and make a scan the one of the current rig.
+ *  \param scan The new scan; it is freed if it can not be used.
+ *  \return TRUE if the scan has been started.
+ */
+static gboolean
+scan_install         (scan_t *scan)
+{
+	rig_ctx_t *ctx = rig_ctx_current ();
+
+
+	if (ctx->rig == NULL) {
+		grig_debug_local (RIG_DEBUG_ERR,
+				  _("%s: The rig is not running"),
+				  __FUNCTION__);
+		scan_free (scan);
+		return FALSE;
+	}
+
+	if (scan->usedcd && (ctx->rig->caps->get_dcd == NULL)) {
+		grig_debug_local (RIG_DEBUG_WARN,
+				  _("%s: The rig can not read the squelch status; "\
+				    "using the signal strength"),
+				  __FUNCTION__);
+		scan->usedcd = FALSE;
+	}
+
+	if (!scan->usedcd && !rig_data_has_get_strength ()) {
+		grig_debug_local (RIG_DEBUG_ERR,
+				  _("%s: The rig can not read the signal strength"),
+				  __FUNCTION__);
+		scan_free (scan);
+		return FALSE;
+	}
+
+	scan->running = TRUE;
+	scan->timer = g_timer_new ();
+
+	SCAN_LOCK ();
+	scan_free (&scans[ctx->index]);
+	scans[ctx->index] = *scan;
+	SCAN_UNLOCK ();
+
+	return TRUE;
+}
+
+
+/** \brief Parse the channels and settings of a scan.
+ *  \param spec The specification, see rig-scan.h.
+ *  \param scan The scan to set up.
+ *  \return TRUE if the specification is valid and contains channels.
+ */
+static gboolean
+scan_parse           (const gchar *spec, scan_t *scan)
+{
+	gchar  **items;
+	gboolean ok = TRUE;
+	gint     val = 0;
+	gint     i;
+
+	if (spec == NULL)
+		return FALSE;
+
+	items = g_strsplit (spec, ",", 0);
+
+	for (i = 0; ok && (items[i] != NULL); i++) {
+
+		g_strstrip (items[i]);
+
+		if (!g_ascii_strncasecmp (items[i], "range=", 6)) {
+			ok = scan_add_range (scan->chans, items[i] + 6);
+		}
+		else if (!g_ascii_strncasecmp (items[i], "list=", 5)) {
+			ok = scan_add_list (scan->chans, items[i] + 5);
+		}
+		else if (!g_ascii_strncasecmp (items[i], "settle=", 7)) {
+			ok = scan_parse_int (items[i] + 7, 0, 10000, &val);
+			scan->settle = val;
+		}
+		else if (!g_ascii_strncasecmp (items[i], "level=", 6)) {
+			ok = scan_parse_int (items[i] + 6, -100, 100, &scan->level);
+		}
+		else if (!g_ascii_strcasecmp (items[i], "dcd")) {
+			scan->usedcd = TRUE;
+		}
+		else if (!g_ascii_strncasecmp (items[i], "dwell=", 6)) {
+			ok = scan_parse_int (items[i] + 6, 0, 3600000, &val);
+			scan->dwell = val;
+		}
+		else if (!g_ascii_strcasecmp (items[i], "repeat")) {
+			scan->repeat = TRUE;
+		}
+		else if (!g_ascii_strncasecmp (items[i], "out=", 4) && (items[i][4] != '\0')) {
+			g_free (scan->outfile);
+			scan->outfile = g_strdup (items[i] + 4);
+		}
+		else {
+			ok = FALSE;
+		}
+	}
+
+	g_strfreev (items);
+
+	if (ok && (scan->chans->len == 0)) {
+		grig_debug_local (RIG_DEBUG_ERR,
+				  _("%s: No channels to scan"),
+				  __FUNCTION__);
+		ok = FALSE;
+	}
+
+	return ok;
+}
+
+
+/** \brief Parse an integer setting.
+ *  \param str The string to parse.
+ *  \param min The smallest valid value.
+ *  \param max The largest valid value.
+ *  \param val Location to store the value.
+ *  \return TRUE if the string is a valid number within the limits.
+ */
+static gboolean
+scan_parse_int       (const gchar *str, gint min, gint max, gint *val)
+{
+	gchar  *end;
+	gint64  num;
+
+	num = g_ascii_strtoll (str, &end, 10);
+
+	if ((end == str) || (*end != '\0') || (num < min) || (num > max))
+		return FALSE;
+
+	*val = (gint) num;
+
+	return TRUE;
+}
+
+
+/** \brief Add a channel.
+ *  \param chans The channel list.
+ *  \param freq The frequency of the channel.
+ *  \return FALSE if there are too many channels.
+ */
+static gboolean
+scan_add             (GArray *chans, freq_t freq)
+{
+	rig_scan_result_t chan;
+
+	if (chans->len >= RIG_SCAN_MAX_CHANNELS) {
+		grig_debug_local (RIG_DEBUG_ERR,
+				  _("%s: More than %d channels"),
+				  __FUNCTION__, RIG_SCAN_MAX_CHANNELS);
+		return FALSE;
+	}
+
+	memset (&chan, 0, sizeof (rig_scan_result_t));
+	chan.freq = freq;
+	g_array_append_val (chans, chan);
+
+	return TRUE;
+}
+
+
+/** \brief Add the channels of a frequency range.
+ *  \param chans The channel list.
+ *  \param range START:STOP:STEP in Hz.
+ *  \return TRUE if the range is valid.
+ */
+static gboolean
+scan_add_range       (GArray *chans, const gchar *range)
+{
+	gchar  **vec;
+	gchar   *end;
+	gdouble  val[3];
+	gdouble  num;
+	gboolean ok;
+	gint     i;
+
+	vec = g_strsplit (range, ":", 3);
+	ok = (g_strv_length (vec) == 3);
+
+	for (i = 0; ok && (i < 3); i++) {
+		val[i] = g_ascii_strtod (vec[i], &end);
+		ok = (end != vec[i]) && (*end == '\0') && (val[i] > 0);
+	}
+
+	g_strfreev (vec);
+
+	if (!ok || (val[1] < val[0])) {
+		grig_debug_local (RIG_DEBUG_ERR,
+				  _("%s: Invalid range %s"),
+				  __FUNCTION__, range);
+		return FALSE;
+	}
+
+	num = floor ((val[1] - val[0]) / val[2]);
+
+	for (i = 0; ok && (i <= num); i++) {
+		ok = scan_add (chans, val[0] + i * val[2]);
+	}
+
+	return ok;
+}
+
+
+/** \brief Add the channels listed in a file.
+ *  \param chans The channel list.
+ *  \param filename The file with one frequency per line.
+ *  \return TRUE if the file is valid.
+ */
+static gboolean
+scan_add_list        (GArray *chans, const gchar *filename)
+{
+	GError  *err = NULL;
+	gchar   *contents;
+	gchar  **lines;
+	gchar   *end;
+	freq_t   freq;
+	gboolean ok = TRUE;
+	gint     i;
+
+
+	if (!g_file_get_contents (filename, &contents, NULL, &err)) {
+		grig_debug_local (RIG_DEBUG_ERR,
+				  _("%s: Can not read %s: %s"),
+				  __FUNCTION__, filename, err->message);
+		g_clear_error (&err);
+		return FALSE;
+	}
+
+	lines = g_strsplit (contents, "\n", 0);
+	g_free (contents);
+
+	for (i = 0; ok && (lines[i] != NULL); i++) {
+
+		g_strstrip (lines[i]);
+
+		if ((lines[i][0] == '\0') || (lines[i][0] == '#'))
+			continue;
+
+		freq = g_ascii_strtod (lines[i], &end);
+
+		if ((end == lines[i]) || (freq <= 0)) {
+			grig_debug_local (RIG_DEBUG_ERR,
+					  _("%s: Invalid frequency in line %d of %s"),
+					  __FUNCTION__, i + 1, filename);
+			ok = FALSE;
+		}
+		else {
+			ok = scan_add (chans, freq);
+		}
+	}
+
+	g_strfreev (lines);
+
+	return ok;
+}
+
+
+/** \brief Free the channels and settings of a scan. */
+static void
+scan_free            (scan_t *scan)
+{
+	if (scan->chans != NULL)
+		g_array_free (scan->chans, TRUE);
+
+	if (scan->timer != NULL)
+		g_timer_destroy (scan->timer);
+
+	g_free (scan->outfile);
+	g_free (scan->last);
+
+	memset (scan, 0, sizeof (scan_t));
+}
+
+
+/** \brief Go on with the next channel.
+ *
+ * The scan ends after the last channel unless it is repeated.
+ * Must be called with the lock held.
+ */
+static void
+scan_advance         (scan_t *scan)
+{
+	if (++scan->pos < scan->chans->len)
+		return;
+
+	if (scan->sweep)
+		scan_swept (scan);
+
+	if (scan->repeat)
+		scan->pos = 0;
+	else
+		scan_finish (scan, _("Scan finished"));
+}
+
+
+/** \brief End the scan.
+ *  \param reason Message to log with the summary.
+ *
+ * Must be called with the lock held.
+ */
+static void
+scan_finish          (scan_t *scan, const gchar *reason)
+{
+	scan->running = FALSE;
+	g_timer_stop (scan->timer);
+
+	grig_debug_local (RIG_DEBUG_VERBOSE,
+			  _("%s: %s; %u channels measured in %.1f sec, %u active"),
+			  __FUNCTION__, reason, scan->measured,
+			  g_timer_elapsed (scan->timer, NULL), scan->active);
+
+	if (scan->outfile != NULL)
+		scan_save (scan);
+}
+
+
+/** \brief Save the results of a scan.
+ *
+ * Each measured channel is written as FREQ STRENGTH ACTIVE.
+ * Must be called with the lock held.
+ */
+static void
+scan_save            (scan_t *scan)
+{
+	rig_scan_result_t *chan;
+	GString           *text;
+	GError            *err = NULL;
+	guint              i;
+
+	text = g_string_new ("# frequency [Hz], strength [dB rel. S9], active\n");
+
+	for (i = 0; i < scan->chans->len; i++) {
+		chan = &g_array_index (scan->chans, rig_scan_result_t, i);
+
+		if (chan->valid)
+			g_string_append_printf (text, "%.0f %d %d\n",
+						chan->freq, chan->strength, chan->active);
+	}
+
+	if (!g_file_set_contents (scan->outfile, text->str, text->len, &err)) {
+		grig_debug_local (RIG_DEBUG_ERR,
+				  _("%s: Can not save %s: %s"),
+				  __FUNCTION__, scan->outfile, err->message);
+		g_clear_error (&err);
+	}
+
+	g_string_free (text, TRUE);
+}
+
+
+/** \brief Keep the levels of a completed sweep.
+ *
+ * Points which could not be measured keep the level of the previous
+ * sweep. Must be called with the lock held.
+ */
+static void
+scan_swept           (scan_t *scan)
+{
+	guint i;
+
+	for (i = 0; i < scan->chans->len; i++) {
+		scan->last[i] = g_array_index (scan->chans, rig_scan_result_t, i).strength;
+	}
+
+	scan->laststart = scan->first;
+	scan->serial++;
+}
@@ -0,0 +1,113 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+    Grig:  Gtk+ user interface for the Hamradio Control Libraries.
+
+    Copyright (C)  2001-2007  Alexandru Csete.
+
+    Authors: Alexandru Csete <oz9aec@gmail.com>
+
+    Comments, questions and bugreports should be submitted via
+    http://sourceforge.net/projects/groundstation/
+    More details can be found at the project home page:
+
+            http://groundstation.sourceforge.net/
+ 
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+  
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+  
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, visit http://www.fsf.org/
+ 
+ 
+ 
+*/
+/** \file rig-scan.h
+ *  \ingroup shdata
+ *  \brief Software scan engine (interface).
+ *
+ * The scan engine tunes a rig over a list of channels and measures the
+ * signal strength, or the squelch (DCD) status, on each of them. The
+ * channels are given as a comma separated list of:
+ *
+ *   range=START:STOP:STEP  the frequencies from START to STOP in Hz
+ *   list=FILE              the frequencies in FILE, one per line in Hz;
+ *                          lines starting with # are ignored
+ *
+ * which may be repeated, together with the scan settings:
+ *
+ *   settle=MSEC  time to wait after tuning before measuring (default 20)
+ *   level=DB     activity threshold in dB relative to S9 (default -24)
+ *   dcd          detect activity by the squelch status instead
+ *   dwell=MSEC   listen for MSEC on active channels and then go on;
+ *                without dwell the scan stops on the first active channel
+ *   repeat       start over at the end of the list
+ *   out=FILE     save the results to FILE when the scan has finished
+ *
+ * The settings belong to the rig the scan is started on, so each rig can
+ * have its own settle time.
+ *
+ * The daemon runs the scan in a tight loop of its own instead of the
+ * normal cycle and does not record these commands. Tuning the rig from
+ * the user interface stops the scan. The strength of each channel is kept
+ * in a table, which can be read with rig_scan_get_results().
+ *
+ * A band-scope sweep, started with rig_scan_sweep_start(), measures a
+ * span around the tuned frequency over and over again. The daemon tunes
+ * the rig back after each of its time slices, so the normal cycle keeps
+ * running between them and the user can still tune the rig, which moves
+ * the next sweep. Completed sweeps are read with rig_scan_get_sweep().
+ */
+#ifndef RIG_SCAN_H
+#define RIG_SCAN_H 1
+
+#include <glib.h>
+#include <hamlib/rig.h>
+
+
+#define RIG_SCAN_DEF_SETTLE   20      /*!< Default settle time [msec]. */
+#define RIG_SCAN_DEF_LEVEL    -24     /*!< Default activity threshold [dB rel. S9], approx. S5. */
+#define RIG_SCAN_MAX_CHANNELS 100000  /*!< Max number of channels in one scan. */
+#define RIG_SCAN_MAX_FAILURES 5       /*!< Consecutive failures after which the scan is given up. */
+#define RIG_SCAN_MAX_POINTS   1000    /*!< Max number of points in a band-scope sweep. */
+
+
+/** \brief Scan result of one channel. */
+typedef struct {
+	freq_t    freq;      /*!< Frequency [Hz]. */
+	gint      strength;  /*!< Signal strength [dB rel. S9]. */
+	gboolean  active;    /*!< Activity has been detected. */
+	gboolean  valid;     /*!< The channel has been measured. */
+} rig_scan_result_t;
+
+
+/** \brief Completed band-scope sweep. */
+typedef struct {
+	guint     serial;    /*!< Number of the sweep, counting from 1. */
+	freq_t    start;     /*!< Frequency of the first point [Hz]. */
+	freq_t    step;      /*!< Distance between two points [Hz]. */
+	guint     points;    /*!< Number of points. */
+	gint     *levels;    /*!< Signal strength of each point [dB rel. S9]. */
+} rig_scan_sweep_t;
+
+
+gboolean rig_scan_start       (const gchar *spec);
+void     rig_scan_stop        (void);
+gboolean rig_scan_running     (void);
+guint    rig_scan_get_results (rig_scan_result_t **results);
+gboolean rig_scan_sweep_start (freq_t span, guint points, gulong settle);
+gboolean rig_scan_sweeping    (void);
+gboolean rig_scan_get_sweep   (guint serial, rig_scan_sweep_t *sweep);
+
+/* used by the daemon */
+gboolean rig_scan_next        (freq_t home, freq_t *freq, gulong *settle,
+			       gboolean *usedcd);
+gboolean rig_scan_result      (gint retcode, gint strength, gint dcd);
+
+#endif
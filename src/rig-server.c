@@ -0,0 +1,1280 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+    Grig:  Gtk+ user interface for the Hamradio Control Libraries.
+
+    Copyright (C)  2001-2007  Alexandru Csete.
+
+    Authors: Alexandru Csete <oz9aec@gmail.com>
+
+    Comments, questions and bugreports should be submitted via
+    http://sourceforge.net/projects/groundstation/
+    More details can be found at the project home page:
+
+            http://groundstation.sourceforge.net/
+ 
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+  
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+  
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, visit http://www.fsf.org/
+ 
+ 
+ 
+*/
+/** \file rig-server.c
+ *  \ingroup shdata
+ *  \brief rigctld compatible network server.
+ *
+ * The server runs in the Gtk+ main loop using GIOChannel watches on
+ * non-blocking sockets, so it accesses the shared data from the same thread
+ * as the user interface. Each client sends one command per line, either
+ * as a single character with arguments (e.g. "F 14074000") or as a long
+ * command preceded by a backslash (e.g. "\set_freq 14074000"). Queries
+ * answer with one value per line; commands that change something answer
+ * with "RPRT 0" or "RPRT -error".
+ *
+ * Supported commands:
+ *
+ *   F f  set/get frequency         M m  set/get mode and passband
+ *   V v  set/get VFO               T t  set/get PTT
+ *   S s  set/get split             I i  set/get split frequency
+ *   J j  set/get RIT               Z z  set/get XIT
+ *   L l  set/get level             U u  set/get func
+ *   G    VFO operation             _    rig info
+ *   q Q  close connection
+ *   \set_powerstat \get_powerstat \dump_state \chk_vfo
+ *
+ * The extended response format is not supported.
+ *
+ * Levels and func's which are only polled on demand are registered as
+ * interesting on behalf of a client once it has read them, so that the
+ * daemon polls them at full rate until the client disconnects. A value
+ * set by a client is answered from the shared data until the daemon has
+ * sent it to the rig; otherwise a read right after a set could return the
+ * value the daemon read from the rig before.
+ */
+#include <glib.h>
+#include <glib/gi18n.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <hamlib/rig.h>
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+#ifdef G_OS_WIN32
+#  include <winsock2.h>
+#else
+#  include <unistd.h>
+#  include <fcntl.h>
+#  include <sys/types.h>
+#  include <sys/socket.h>
+#  include <netinet/in.h>
+#  include <arpa/inet.h>
+#endif
+#include "grig-debug.h"
+#include "rig-ctx.h"
+#include "rig-daemon.h"
+#include "rig-data.h"
+#include "rig-server.h"
+
+
+#define SERVER_MAX_CLIENTS  16      /*!< Max number of simultaneous clients. */
+#define SERVER_MAX_LINE     1024    /*!< Max length of a command line. */
+#define SERVER_MAX_OUTPUT   65536   /*!< Max unsent output before a client is dropped. */
+
+
+/** \brief Client connection. */
+typedef struct {
+	gint         fd;          /*!< The socket. */
+	GIOChannel  *chan;        /*!< Channel wrapping the socket. */
+	guint        readwatch;   /*!< Read watch. */
+	guint        writewatch;  /*!< Write watch while output is pending. */
+	GString     *in;          /*!< Received data not yet processed. */
+	GString     *out;         /*!< Output not yet sent. */
+	gboolean     quit;        /*!< Close connection when output has been sent. */
+	guint32      interest;    /*!< Fields registered on behalf of the client. */
+} server_client_t;
+
+
+/** \brief Command handler.
+ *  \param out Buffer to append the answer to.
+ *  \param argv The arguments of the command.
+ *  \return RIG_OK or a negative hamlib error code.
+ */
+typedef gint (*server_func_t) (GString *out, gchar **argv);
+
+
+/** \brief Command table entry. */
+typedef struct {
+	gchar          cmd;     /*!< Short command or 0 if only the long form exists. */
+	const gchar   *name;    /*!< Long command. */
+	guint          argc;    /*!< Number of arguments. */
+	gboolean       set;     /*!< Whether the command reports "RPRT 0" on success. */
+	server_func_t  func;    /*!< Handler. */
+} server_cmd_t;
+
+
+/** \brief Level table entry; either the float or the int functions are set. */
+typedef struct {
+	setting_t      level;
+	int          (*has_get) (void);
+	int          (*has_set) (void);
+	float        (*getf)    (void);
+	void         (*setf)    (float);
+	int          (*geti)    (void);
+	void         (*seti)    (int);
+	rig_data_field_t field;  /*!< On-demand field or RIG_DATA_FIELD_NUMBER. */
+} server_level_t;
+
+
+static RIG *myrig = NULL;   /*!< The primary rig while a command is executed. */
+static server_client_t *myclient = NULL;  /*!< The client whose command is executed. */
+
+
+static gint server_set_freq       (GString *, gchar **);
+static gint server_get_freq       (GString *, gchar **);
+static gint server_set_mode       (GString *, gchar **);
+static gint server_get_mode       (GString *, gchar **);
+static gint server_set_vfo        (GString *, gchar **);
+static gint server_get_vfo        (GString *, gchar **);
+static gint server_set_ptt        (GString *, gchar **);
+static gint server_get_ptt        (GString *, gchar **);
+static gint server_set_split      (GString *, gchar **);
+static gint server_get_split      (GString *, gchar **);
+static gint server_set_split_freq (GString *, gchar **);
+static gint server_get_split_freq (GString *, gchar **);
+static gint server_set_rit        (GString *, gchar **);
+static gint server_get_rit        (GString *, gchar **);
+static gint server_set_xit        (GString *, gchar **);
+static gint server_get_xit        (GString *, gchar **);
+static gint server_set_level      (GString *, gchar **);
+static gint server_get_level      (GString *, gchar **);
+static gint server_set_func       (GString *, gchar **);
+static gint server_get_func       (GString *, gchar **);
+static gint server_vfo_op         (GString *, gchar **);
+static gint server_set_pstat      (GString *, gchar **);
+static gint server_get_pstat      (GString *, gchar **);
+static gint server_get_info       (GString *, gchar **);
+static gint server_dump_state     (GString *, gchar **);
+static gint server_chk_vfo        (GString *, gchar **);
+
+
+/** \brief Supported commands. */
+static const server_cmd_t SERVER_CMDS[] = {
+	{ 'F', "set_freq",       1, TRUE,  server_set_freq },
+	{ 'f', "get_freq",       0, FALSE, server_get_freq },
+	{ 'M', "set_mode",       2, TRUE,  server_set_mode },
+	{ 'm', "get_mode",       0, FALSE, server_get_mode },
+	{ 'V', "set_vfo",        1, TRUE,  server_set_vfo },
+	{ 'v', "get_vfo",        0, FALSE, server_get_vfo },
+	{ 'T', "set_ptt",        1, TRUE,  server_set_ptt },
+	{ 't', "get_ptt",        0, FALSE, server_get_ptt },
+	{ 'S', "set_split_vfo",  2, TRUE,  server_set_split },
+	{ 's', "get_split_vfo",  0, FALSE, server_get_split },
+	{ 'I', "set_split_freq", 1, TRUE,  server_set_split_freq },
+	{ 'i', "get_split_freq", 0, FALSE, server_get_split_freq },
+	{ 'J', "set_rit",        1, TRUE,  server_set_rit },
+	{ 'j', "get_rit",        0, FALSE, server_get_rit },
+	{ 'Z', "set_xit",        1, TRUE,  server_set_xit },
+	{ 'z', "get_xit",        0, FALSE, server_get_xit },
+	{ 'L', "set_level",      2, TRUE,  server_set_level },
+	{ 'l', "get_level",      1, FALSE, server_get_level },
+	{ 'U', "set_func",       2, TRUE,  server_set_func },
+	{ 'u', "get_func",       1, FALSE, server_get_func },
+	{ 'G', "vfo_op",         1, TRUE,  server_vfo_op },
+	{ '_', "get_info",       0, FALSE, server_get_info },
+	{ 0,   "set_powerstat",  1, TRUE,  server_set_pstat },
+	{ 0,   "get_powerstat",  0, FALSE, server_get_pstat },
+	{ 0,   "dump_state",     0, FALSE, server_dump_state },
+	{ 0,   "chk_vfo",        0, FALSE, server_chk_vfo },
+	{ 0,   NULL,             0, FALSE, NULL }
+};
+
+
+/** \brief Supported levels. */
+static const server_level_t SERVER_LEVELS[] = {
+	{ RIG_LEVEL_AF,       rig_data_has_get_afg,      rig_data_has_set_afg,
+	  rig_data_get_afg,      rig_data_set_afg,      NULL, NULL,
+	  RIG_DATA_FIELD_AFG },
+	{ RIG_LEVEL_RF,       rig_data_has_get_rfg,      rig_data_has_set_rfg,
+	  rig_data_get_rfg,      rig_data_set_rfg,      NULL, NULL,
+	  RIG_DATA_FIELD_RFG },
+	{ RIG_LEVEL_SQL,      rig_data_has_get_sql,      rig_data_has_set_sql,
+	  rig_data_get_sql,      rig_data_set_sql,      NULL, NULL,
+	  RIG_DATA_FIELD_SQL },
+	{ RIG_LEVEL_APF,      rig_data_has_get_apf,      rig_data_has_set_apf,
+	  rig_data_get_apf,      rig_data_set_apf,      NULL, NULL,
+	  RIG_DATA_FIELD_APF },
+	{ RIG_LEVEL_NR,       rig_data_has_get_nr,       rig_data_has_set_nr,
+	  rig_data_get_nr,       rig_data_set_nr,       NULL, NULL,
+	  RIG_DATA_FIELD_NR },
+	{ RIG_LEVEL_PBT_IN,   rig_data_has_get_pbtin,    rig_data_has_set_pbtin,
+	  rig_data_get_pbtin,    rig_data_set_pbtin,    NULL, NULL,
+	  RIG_DATA_FIELD_PBTIN },
+	{ RIG_LEVEL_PBT_OUT,  rig_data_has_get_pbtout,   rig_data_has_set_pbtout,
+	  rig_data_get_pbtout,   rig_data_set_pbtout,   NULL, NULL,
+	  RIG_DATA_FIELD_PBTOUT },
+	{ RIG_LEVEL_BALANCE,  rig_data_has_get_balance,  rig_data_has_set_balance,
+	  rig_data_get_balance,  rig_data_set_balance,  NULL, NULL,
+	  RIG_DATA_FIELD_BALANCE },
+	{ RIG_LEVEL_VOXGAIN,  rig_data_has_get_voxg,     rig_data_has_set_voxg,
+	  rig_data_get_voxg,     rig_data_set_voxg,     NULL, NULL,
+	  RIG_DATA_FIELD_VOXG },
+	{ RIG_LEVEL_ANTIVOX,  rig_data_has_get_antivox,  rig_data_has_set_antivox,
+	  rig_data_get_antivox,  rig_data_set_antivox,  NULL, NULL,
+	  RIG_DATA_FIELD_ANTIVOX },
+	{ RIG_LEVEL_MICGAIN,  rig_data_has_get_micg,     rig_data_has_set_micg,
+	  rig_data_get_micg,     rig_data_set_micg,     NULL, NULL,
+	  RIG_DATA_FIELD_MICG },
+	{ RIG_LEVEL_COMP,     rig_data_has_get_comp,     rig_data_has_set_comp,
+	  rig_data_get_comp,     rig_data_set_comp,     NULL, NULL,
+	  RIG_DATA_FIELD_COMP },
+	{ RIG_LEVEL_RFPOWER,  rig_data_has_get_power,    rig_data_has_set_power,
+	  rig_data_get_power,    rig_data_set_power,    NULL, NULL,
+	  RIG_DATA_FIELD_POWER },
+	{ RIG_LEVEL_ALC,      rig_data_has_get_alc,      rig_data_has_set_alc,
+	  rig_data_get_alc,      rig_data_set_alc,      NULL, NULL,
+	  RIG_DATA_FIELD_ALC },
+	{ RIG_LEVEL_SWR,      rig_data_has_get_swr,      NULL,
+	  rig_data_get_swr,      NULL,                  NULL, NULL,
+	  RIG_DATA_FIELD_NUMBER },
+	{ RIG_LEVEL_STRENGTH, rig_data_has_get_strength, NULL,
+	  NULL, NULL, rig_data_get_strength, NULL,
+	  RIG_DATA_FIELD_NUMBER },
+	{ RIG_LEVEL_AGC,      rig_data_has_get_agc,      rig_data_has_set_agc,
+	  NULL, NULL, rig_data_get_agc,      rig_data_set_agc,
+	  RIG_DATA_FIELD_NUMBER },
+	{ RIG_LEVEL_ATT,      rig_data_has_get_att,      rig_data_has_set_att,
+	  NULL, NULL, rig_data_get_att,      rig_data_set_att,
+	  RIG_DATA_FIELD_NUMBER },
+	{ RIG_LEVEL_PREAMP,   rig_data_has_get_preamp,   rig_data_has_set_preamp,
+	  NULL, NULL, rig_data_get_preamp,   rig_data_set_preamp,
+	  RIG_DATA_FIELD_NUMBER },
+	{ RIG_LEVEL_IF,       rig_data_has_get_ifs,      rig_data_has_set_ifs,
+	  NULL, NULL, rig_data_get_ifs,      rig_data_set_ifs,
+	  RIG_DATA_FIELD_IFS },
+	{ RIG_LEVEL_NOTCHF,   rig_data_has_get_notch,    rig_data_has_set_notch,
+	  NULL, NULL, rig_data_get_notch,    rig_data_set_notch,
+	  RIG_DATA_FIELD_NOTCH },
+	{ RIG_LEVEL_CWPITCH,  rig_data_has_get_cwpitch,  rig_data_has_set_cwpitch,
+	  NULL, NULL, rig_data_get_cwpitch,  rig_data_set_cwpitch,
+	  RIG_DATA_FIELD_CWPITCH },
+	{ RIG_LEVEL_KEYSPD,   rig_data_has_get_keyspd,   rig_data_has_set_keyspd,
+	  NULL, NULL, rig_data_get_keyspd,   rig_data_set_keyspd,
+	  RIG_DATA_FIELD_KEYSPD },
+	{ RIG_LEVEL_BKINDL,   rig_data_has_get_bkindel,  rig_data_has_set_bkindel,
+	  NULL, NULL, rig_data_get_bkindel,  rig_data_set_bkindel,
+	  RIG_DATA_FIELD_BKINDEL },
+	{ RIG_LEVEL_VOXDELAY, rig_data_has_get_voxdel,   rig_data_has_set_voxdel,
+	  NULL, NULL, rig_data_get_voxdel,   rig_data_set_voxdel,
+	  RIG_DATA_FIELD_VOXDEL },
+	{ RIG_LEVEL_NONE,     NULL, NULL, NULL, NULL, NULL, NULL, RIG_DATA_FIELD_NUMBER }
+};
+
+
+static gint        listenfd    = -1;     /*!< Listening socket. */
+static GIOChannel *listenchan  = NULL;   /*!< Channel wrapping the listening socket. */
+static guint       listenwatch = 0;      /*!< Accept watch. */
+static GSList     *clients     = NULL;   /*!< Open client connections. */
+
+#ifdef G_OS_WIN32
+#  define server_close_socket(fd) closesocket (fd)
+#  define server_channel_new(fd)  g_io_channel_win32_new_socket (fd)
+#  define server_try_again()      ((WSAGetLastError () == WSAEWOULDBLOCK) || \
+				   (WSAGetLastError () == WSAEINTR))
+#else
+#  define server_close_socket(fd) close (fd)
+#  define server_channel_new(fd)  g_io_channel_unix_new (fd)
+#  define server_try_again()      ((errno == EAGAIN) || (errno == EINTR))
+#endif
+
+#ifdef MSG_NOSIGNAL
+#  define SERVER_SEND_FLAGS MSG_NOSIGNAL
+#else
+#  define SERVER_SEND_FLAGS 0
+#endif
+
+
+static gboolean server_set_nonblock  (gint fd);
+static gboolean server_accept        (GIOChannel *chan, GIOCondition cond, gpointer data);
+static gboolean server_client_read   (GIOChannel *chan, GIOCondition cond, gpointer data);
+static gboolean server_client_write  (GIOChannel *chan, GIOCondition cond, gpointer data);
+static gboolean server_client_flush  (server_client_t *client);
+static void     server_client_close  (server_client_t *client);
+static void     server_execute       (server_client_t *client, gchar *line);
+static gchar  **server_split         (const gchar *str);
+static const server_level_t *server_find_level (const gchar *name);
+static pbwidth_t server_passband     (rmode_t mode, rig_data_pbw_t pbw);
+static void     server_append_float  (GString *out, gdouble value);
+static void     server_interest      (rig_data_field_t field);
+
+
+
+/** \brief Start the server.
+ *  \param port TCP port on the loopback interface.
+ *  \return TRUE if the server has been started, FALSE otherwise.
+ *
+ * The rig daemon must have been started before the server.
+ */
+gboolean
+rig_server_start (gint port)
+{
+	struct sockaddr_in  addr;
+#ifdef G_OS_WIN32
+	WSADATA             wsadata;
+#endif
+	gint                on = 1;
+
+
+	if (listenfd != -1)
+		return FALSE;
+
+	if ((port <= 0) || (port > 65535)) {
+		grig_debug_local (RIG_DEBUG_ERR,
+				  _("%s: Invalid port: %d"),
+				  __FUNCTION__, port);
+		return FALSE;
+	}
+
+#ifdef G_OS_WIN32
+	if (WSAStartup (MAKEWORD (2, 2), &wsadata) != 0) {
+		grig_debug_local (RIG_DEBUG_ERR,
+				  _("%s: Could not initialise Winsock"),
+				  __FUNCTION__);
+		return FALSE;
+	}
+#endif
+
+	listenfd = socket (AF_INET, SOCK_STREAM, 0);
+	if (listenfd < 0) {
+		grig_debug_local (RIG_DEBUG_ERR,
+				  _("%s: Could not create socket (%s)"),
+				  __FUNCTION__, g_strerror (errno));
+		listenfd = -1;
+		return FALSE;
+	}
+
+	setsockopt (listenfd, SOL_SOCKET, SO_REUSEADDR, (const void *) &on, sizeof (on));
+
+	memset (&addr, 0, sizeof (addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons ((guint16) port);
+	addr.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+
+	if (bind (listenfd, (struct sockaddr *) &addr, sizeof (addr)) < 0) {
+		grig_debug_local (RIG_DEBUG_ERR,
+				  _("%s: Could not bind to port %d (%s)"),
+				  __FUNCTION__, port, g_strerror (errno));
+		server_close_socket (listenfd);
+		listenfd = -1;
+		return FALSE;
+	}
+
+	if ((listen (listenfd, 5) < 0) || !server_set_nonblock (listenfd)) {
+		grig_debug_local (RIG_DEBUG_ERR,
+				  _("%s: Could not listen on port %d (%s)"),
+				  __FUNCTION__, port, g_strerror (errno));
+		rig_server_stop ();
+		return FALSE;
+	}
+
+	listenchan = server_channel_new (listenfd);
+	listenwatch = g_io_add_watch (listenchan, G_IO_IN, server_accept, NULL);
+
+	grig_debug_local (RIG_DEBUG_VERBOSE,
+			  _("%s: Serving rigctld protocol on port %d"),
+			  __FUNCTION__, port);
+
+	return TRUE;
+}
+
+
+/** \brief Stop the server and close all client connections. */
+void
+rig_server_stop  ()
+{
+	while (clients != NULL) {
+		server_client_close ((server_client_t *) clients->data);
+	}
+
+	if (listenwatch != 0) {
+		g_source_remove (listenwatch);
+		listenwatch = 0;
+	}
+
+	if (listenchan != NULL) {
+		g_io_channel_unref (listenchan);
+		listenchan = NULL;
+	}
+
+	if (listenfd != -1) {
+		server_close_socket (listenfd);
+		listenfd = -1;
+	}
+}
+
+
+/** \brief Make socket non-blocking. */
+static gboolean
+server_set_nonblock  (gint fd)
+{
+#ifdef G_OS_WIN32
+	u_long on = 1;
+
+	return (ioctlsocket (fd, FIONBIO, &on) == 0);
+#else
+	gint flags;
+
+	flags = fcntl (fd, F_GETFL, 0);
+
+	return ((flags >= 0) && (fcntl (fd, F_SETFL, flags | O_NONBLOCK) == 0));
+#endif
+}
+
+
+/** \brief Accept a new client connection. */
+static gboolean
+server_accept        (GIOChannel *chan, GIOCondition cond, gpointer data)
+{
+	server_client_t *client;
+	gint             fd;
+
+	fd = accept (listenfd, NULL, NULL);
+	if (fd < 0)
+		return TRUE;
+
+	if ((g_slist_length (clients) >= SERVER_MAX_CLIENTS) ||
+	    !server_set_nonblock (fd)) {
+
+		grig_debug_local (RIG_DEBUG_WARN,
+				  _("%s: Connection refused (%d clients)"),
+				  __FUNCTION__, g_slist_length (clients));
+		server_close_socket (fd);
+		return TRUE;
+	}
+
+	client = g_new0 (server_client_t, 1);
+	client->fd = fd;
+	client->chan = server_channel_new (fd);
+	client->in = g_string_new (NULL);
+	client->out = g_string_new (NULL);
+	client->readwatch = g_io_add_watch (client->chan, G_IO_IN | G_IO_HUP | G_IO_ERR,
+					    server_client_read, client);
+
+	clients = g_slist_prepend (clients, client);
+
+	/* the client gets fresh values while grig is minimized */
+	rig_daemon_add_consumer ();
+
+	grig_debug_local (RIG_DEBUG_VERBOSE,
+			  _("%s: Client connected (%d clients)"),
+			  __FUNCTION__, g_slist_length (clients));
+
+	return TRUE;
+}
+
+
+/** \brief Read commands from client.
+ *
+ * Every complete line is executed and the answers are sent when all
+ * lines received so far have been processed.
+ */
+static gboolean
+server_client_read   (GIOChannel *chan, GIOCondition cond, gpointer data)
+{
+	server_client_t *client = (server_client_t *) data;
+	gchar            buf[1024];
+	gchar           *eol;
+	gint             len;
+
+	len = recv (client->fd, buf, sizeof (buf), 0);
+
+	if (len <= 0) {
+		if ((len < 0) && !(cond & (G_IO_HUP | G_IO_ERR)) &&
+		    server_try_again ()) {
+			return TRUE;
+		}
+
+		client->readwatch = 0;
+		server_client_close (client);
+
+		return FALSE;
+	}
+
+	g_string_append_len (client->in, buf, len);
+
+	while (!client->quit &&
+	       ((eol = memchr (client->in->str, '\n', client->in->len)) != NULL)) {
+
+		len = eol - client->in->str;
+		*eol = '\0';
+
+		if ((len > 0) && (client->in->str[len - 1] == '\r'))
+			client->in->str[len - 1] = '\0';
+
+		server_execute (client, client->in->str);
+		g_string_erase (client->in, 0, len + 1);
+	}
+
+	if ((client->in->len > SERVER_MAX_LINE) || !server_client_flush (client)) {
+		client->readwatch = 0;
+		server_client_close (client);
+
+		return FALSE;
+	}
+
+	/* stop reading when client asked to quit; it is closed once
+	   the answers have been sent */
+	if (client->quit) {
+		client->readwatch = 0;
+
+		if (client->writewatch == 0)
+			server_client_close (client);
+
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+
+/** \brief Send pending output when the client is ready for it. */
+static gboolean
+server_client_write  (GIOChannel *chan, GIOCondition cond, gpointer data)
+{
+	server_client_t *client = (server_client_t *) data;
+
+	if ((cond & (G_IO_HUP | G_IO_ERR)) || !server_client_flush (client)) {
+		client->writewatch = 0;
+		server_client_close (client);
+
+		return FALSE;
+	}
+
+	if (client->out->len > 0)
+		return TRUE;
+
+	client->writewatch = 0;
+
+	if (client->quit)
+		server_client_close (client);
+
+	return FALSE;
+}
+
+
+/** \brief Send as much pending output as possible.
+ *  \return FALSE if the connection has failed.
+ *
+ * A write watch is installed while output is pending.
+ */
+static gboolean
+server_client_flush  (server_client_t *client)
+{
+	gint len;
+
+	if (client->out->len == 0)
+		return TRUE;
+
+	len = send (client->fd, client->out->str, client->out->len, SERVER_SEND_FLAGS);
+
+	if (len > 0) {
+		g_string_erase (client->out, 0, len);
+	}
+	else if ((len < 0) && !server_try_again ()) {
+		return FALSE;
+	}
+
+	/* client does not read its answers */
+	if (client->out->len > SERVER_MAX_OUTPUT)
+		return FALSE;
+
+	if ((client->out->len > 0) && (client->writewatch == 0)) {
+		client->writewatch = g_io_add_watch (client->chan,
+						     G_IO_OUT | G_IO_HUP | G_IO_ERR,
+						     server_client_write, client);
+	}
+
+	return TRUE;
+}
+
+
+/** \brief Close client connection and free its resources. */
+static void
+server_client_close  (server_client_t *client)
+{
+	rig_ctx_t *prev;
+	guint      i;
+
+	clients = g_slist_remove (clients, client);
+	rig_daemon_remove_consumer ();
+
+	/* release the fields registered on behalf of the client */
+	prev = rig_ctx_bind (rig_ctx_get (0));
+	for (i = 0; i < RIG_DATA_FIELD_NUMBER; i++) {
+		if (client->interest & (1 << i))
+			rig_data_remove_interest (i);
+	}
+	rig_ctx_bind (prev);
+
+	if (client->readwatch != 0)
+		g_source_remove (client->readwatch);
+
+	if (client->writewatch != 0)
+		g_source_remove (client->writewatch);
+
+	g_io_channel_unref (client->chan);
+	server_close_socket (client->fd);
+
+	g_string_free (client->in, TRUE);
+	g_string_free (client->out, TRUE);
+
+	g_free (client);
+
+	grig_debug_local (RIG_DEBUG_VERBOSE,
+			  _("%s: Client disconnected (%d clients)"),
+			  __FUNCTION__, g_slist_length (clients));
+}
+
+
+/** \brief Execute a command line and append the answer to the client output. */
+static void
+server_execute       (server_client_t *client, gchar *line)
+{
+	const server_cmd_t *cmd = NULL;
+	rig_ctx_t *prev;
+	gchar  **argv;
+	gchar   *args;
+	guint    i;
+	gint     retcode;
+
+
+	while ((*line == ' ') || (*line == '\t'))
+		line++;
+
+	if (*line == '\0')
+		return;
+
+	if (*line == '\\') {
+		line++;
+		args = line + strcspn (line, " \t");
+
+		for (i = 0; SERVER_CMDS[i].name != NULL; i++) {
+			if ((strlen (SERVER_CMDS[i].name) == (gsize) (args - line)) &&
+			    !strncmp (SERVER_CMDS[i].name, line, args - line)) {
+				cmd = &SERVER_CMDS[i];
+				break;
+			}
+		}
+	}
+	else {
+		args = line + 1;
+
+		if ((*args != '\0') && (*args != ' ') && (*args != '\t')) {
+			/* not a short command */
+		}
+		else if ((*line == 'q') || (*line == 'Q')) {
+			client->quit = TRUE;
+			return;
+		}
+		else {
+			for (i = 0; SERVER_CMDS[i].name != NULL; i++) {
+				if (SERVER_CMDS[i].cmd == *line) {
+					cmd = &SERVER_CMDS[i];
+					break;
+				}
+			}
+		}
+	}
+
+	if (cmd == NULL) {
+		g_string_append_printf (client->out, "RPRT %d\n", -RIG_EINVAL);
+		return;
+	}
+
+	argv = server_split (args);
+
+	/* clients always talk to the primary rig */
+	prev = rig_ctx_bind (rig_ctx_get (0));
+	myrig = rig_ctx_current ()->rig;
+	myclient = client;
+
+	if (myrig == NULL) {
+		retcode = -RIG_EINTERNAL;
+	}
+	else if (g_strv_length (argv) < cmd->argc) {
+		retcode = -RIG_EINVAL;
+	}
+	else {
+		retcode = cmd->func (client->out, argv);
+	}
+
+	myclient = NULL;
+	rig_ctx_bind (prev);
+
+	if ((retcode != RIG_OK) || cmd->set) {
+		g_string_append_printf (client->out, "RPRT %d\n", retcode);
+	}
+
+	g_strfreev (argv);
+}
+
+
+/** \brief Split arguments separated by any number of blanks. */
+static gchar **
+server_split         (const gchar *str)
+{
+	gchar **argv;
+	guint   i, j;
+
+	argv = g_strsplit_set (str, " \t", 0);
+
+	for (i = 0, j = 0; argv[i] != NULL; i++) {
+		if (*argv[i] == '\0')
+			g_free (argv[i]);
+		else
+			argv[j++] = argv[i];
+	}
+	argv[j] = NULL;
+
+	return argv;
+}
+
+
+/** \brief Find level by name. */
+static const server_level_t *
+server_find_level    (const gchar *name)
+{
+	setting_t level;
+	guint     i;
+
+	level = rig_parse_level (name);
+
+	for (i = 0; (level != RIG_LEVEL_NONE) && (SERVER_LEVELS[i].level != RIG_LEVEL_NONE); i++) {
+		if (SERVER_LEVELS[i].level == level)
+			return &SERVER_LEVELS[i];
+	}
+
+	return NULL;
+}
+
+
+/** \brief Convert passband width index to Hz. */
+static pbwidth_t
+server_passband      (rmode_t mode, rig_data_pbw_t pbw)
+{
+	switch (pbw) {
+	case RIG_DATA_PB_WIDE:
+		return rig_passband_wide (myrig, mode);
+	case RIG_DATA_PB_NARROW:
+		return rig_passband_narrow (myrig, mode);
+	default:
+		return rig_passband_normal (myrig, mode);
+	}
+}
+
+
+/** \brief Append floating point value independent of the locale. */
+static void
+server_append_float  (GString *out, gdouble value)
+{
+	gchar buf[G_ASCII_DTOSTR_BUF_SIZE];
+
+	g_string_append_printf (out, "%s\n",
+				g_ascii_formatd (buf, sizeof (buf), "%f", value));
+}
+
+
+static gint
+server_set_freq       (GString *out, gchar **argv)
+{
+	freq_t freq = g_ascii_strtod (argv[0], NULL);
+
+	if (freq <= 0)
+		return -RIG_EINVAL;
+
+	if (!rig_data_has_set_freq1 ())
+		return -RIG_ENAVAIL;
+
+	rig_data_set_freq (1, freq);
+
+	return RIG_OK;
+}
+
+
+static gint
+server_get_freq       (GString *out, gchar **argv)
+{
+	if (!rig_data_has_get_freq1 ())
+		return -RIG_ENAVAIL;
+
+	g_string_append_printf (out, "%.0f\n",
+				rig_data_get_new_addr ()->freq1 ?
+				rig_data_get_set_addr ()->freq1 :
+				rig_data_get_freq (1));
+
+	return RIG_OK;
+}
+
+
+/* The passband width is mapped to the nearest of grig's narrow, normal
+   and wide settings; 0 selects normal and -1 leaves it unchanged. */
+static gint
+server_set_mode       (GString *out, gchar **argv)
+{
+	rmode_t   mode;
+	pbwidth_t pbw;
+
+	mode = rig_parse_mode (argv[0]);
+	pbw = atol (argv[1]);
+
+	if (mode == RIG_MODE_NONE)
+		return -RIG_EINVAL;
+
+	if (!rig_data_get_has_set_addr ()->mode)
+		return -RIG_ENAVAIL;
+
+	if (pbw == 0) {
+		rig_data_set_pbwidth (RIG_DATA_PB_NORMAL);
+	}
+	else if (pbw > 0) {
+		if (pbw <= rig_passband_narrow (myrig, mode))
+			rig_data_set_pbwidth (RIG_DATA_PB_NARROW);
+		else if (pbw >= rig_passband_wide (myrig, mode))
+			rig_data_set_pbwidth (RIG_DATA_PB_WIDE);
+		else
+			rig_data_set_pbwidth (RIG_DATA_PB_NORMAL);
+	}
+
+	rig_data_set_mode (mode);
+
+	return RIG_OK;
+}
+
+
+static gint
+server_get_mode       (GString *out, gchar **argv)
+{
+	rmode_t mode;
+
+	if (rig_data_get_new_addr ()->mode)
+		mode = rig_data_get_set_addr ()->mode;
+	else
+		mode = rig_data_get_mode ();
+
+	g_string_append_printf (out, "%s\n%ld\n", rig_strrmode (mode),
+				(long) server_passband (mode, rig_data_get_pbwidth ()));
+
+	return RIG_OK;
+}
+
+
+static gint
+server_set_vfo        (GString *out, gchar **argv)
+{
+	vfo_t vfo = rig_parse_vfo (argv[0]);
+
+	if (vfo == RIG_VFO_NONE)
+		return -RIG_EINVAL;
+
+	if (!rig_data_has_set_vfo ())
+		return -RIG_ENAVAIL;
+
+	rig_data_set_vfo (vfo);
+
+	return RIG_OK;
+}
+
+
+static gint
+server_get_vfo        (GString *out, gchar **argv)
+{
+	g_string_append_printf (out, "%s\n", rig_strvfo (rig_data_get_vfo ()));
+
+	return RIG_OK;
+}
+
+
+static gint
+server_set_ptt        (GString *out, gchar **argv)
+{
+	if (!rig_data_has_set_ptt ())
+		return -RIG_ENAVAIL;
+
+	rig_data_set_ptt (atoi (argv[0]) ? RIG_PTT_ON : RIG_PTT_OFF);
+
+	return RIG_OK;
+}
+
+
+static gint
+server_get_ptt        (GString *out, gchar **argv)
+{
+	g_string_append_printf (out, "%d\n",
+				rig_data_get_new_addr ()->ptt ?
+				rig_data_get_set_addr ()->ptt :
+				rig_data_get_ptt ());
+
+	return RIG_OK;
+}
+
+
+/* grig transmits on the secondary frequency in split mode; the TX VFO
+   argument is ignored. */
+static gint
+server_set_split      (GString *out, gchar **argv)
+{
+	if (!rig_data_has_set_split ())
+		return -RIG_ENAVAIL;
+
+	rig_data_set_split (atoi (argv[0]) ? RIG_SPLIT_ON : RIG_SPLIT_OFF);
+
+	return RIG_OK;
+}
+
+
+static gint
+server_get_split      (GString *out, gchar **argv)
+{
+	g_string_append_printf (out, "%d\n%s\n",
+				rig_data_get_new_addr ()->split ?
+				rig_data_get_set_addr ()->split :
+				rig_data_get_split (),
+				rig_strvfo (RIG_VFO_B));
+
+	return RIG_OK;
+}
+
+
+static gint
+server_set_split_freq (GString *out, gchar **argv)
+{
+	freq_t freq = g_ascii_strtod (argv[0], NULL);
+
+	if (freq <= 0)
+		return -RIG_EINVAL;
+
+	if (!rig_data_has_set_freq2 ())
+		return -RIG_ENAVAIL;
+
+	rig_data_set_freq (2, freq);
+
+	return RIG_OK;
+}
+
+
+static gint
+server_get_split_freq (GString *out, gchar **argv)
+{
+	if (!rig_data_has_get_freq2 ())
+		return -RIG_ENAVAIL;
+
+	g_string_append_printf (out, "%.0f\n",
+				rig_data_get_new_addr ()->freq2 ?
+				rig_data_get_set_addr ()->freq2 :
+				rig_data_get_freq (2));
+
+	return RIG_OK;
+}
+
+
+static gint
+server_set_rit        (GString *out, gchar **argv)
+{
+	if (!rig_data_has_set_rit ())
+		return -RIG_ENAVAIL;
+
+	rig_data_set_rit (atol (argv[0]));
+
+	return RIG_OK;
+}
+
+
+static gint
+server_get_rit        (GString *out, gchar **argv)
+{
+	if (!rig_data_has_get_rit ())
+		return -RIG_ENAVAIL;
+
+	g_string_append_printf (out, "%ld\n", (long) rig_data_get_rit ());
+
+	return RIG_OK;
+}
+
+
+static gint
+server_set_xit        (GString *out, gchar **argv)
+{
+	if (!rig_data_has_set_xit ())
+		return -RIG_ENAVAIL;
+
+	rig_data_set_xit (atol (argv[0]));
+
+	return RIG_OK;
+}
+
+
+static gint
+server_get_xit        (GString *out, gchar **argv)
+{
+	if (!rig_data_has_get_xit ())
+		return -RIG_ENAVAIL;
+
+	g_string_append_printf (out, "%ld\n", (long) rig_data_get_xit ());
+
+	return RIG_OK;
+}
+
+
+static gint
+server_set_level      (GString *out, gchar **argv)
+{
+	const server_level_t *level = server_find_level (argv[0]);
+	gdouble value = g_ascii_strtod (argv[1], NULL);
+
+	if (level == NULL)
+		return -RIG_EINVAL;
+
+	if ((level->has_set == NULL) || !level->has_set ())
+		return -RIG_ENAVAIL;
+
+	if (level->setf != NULL)
+		level->setf ((float) value);
+	else
+		level->seti ((int) value);
+
+	return RIG_OK;
+}
+
+
+static gint
+server_get_level      (GString *out, gchar **argv)
+{
+	const server_level_t *level = server_find_level (argv[0]);
+
+	if (level == NULL)
+		return -RIG_EINVAL;
+
+	if (!level->has_get ())
+		return -RIG_ENAVAIL;
+
+	server_interest (level->field);
+
+	if (level->getf != NULL)
+		server_append_float (out, level->getf ());
+	else
+		g_string_append_printf (out, "%d\n", level->geti ());
+
+	return RIG_OK;
+}
+
+
+static gint
+server_set_func       (GString *out, gchar **argv)
+{
+	setting_t func = rig_parse_func (argv[0]);
+
+	if (func == RIG_FUNC_NONE)
+		return -RIG_EINVAL;
+
+	if (!rig_data_has_set_func (func))
+		return -RIG_ENAVAIL;
+
+	rig_data_set_func (func, atoi (argv[1]) ? 1 : 0);
+
+	return RIG_OK;
+}
+
+
+static gint
+server_get_func       (GString *out, gchar **argv)
+{
+	setting_t func = rig_parse_func (argv[0]);
+
+	if (func == RIG_FUNC_NONE)
+		return -RIG_EINVAL;
+
+	if (!rig_data_has_get_func (func))
+		return -RIG_ENAVAIL;
+
+	server_interest (RIG_DATA_FIELD_FUNC);
+
+	g_string_append_printf (out, "%d\n", rig_data_get_func (func));
+
+	return RIG_OK;
+}
+
+
+static gint
+server_vfo_op         (GString *out, gchar **argv)
+{
+	switch (rig_parse_vfo_op (argv[0])) {
+
+	case RIG_OP_TOGGLE:
+		if (!rig_data_has_vfo_op_toggle ())
+			return -RIG_ENAVAIL;
+		rig_data_vfo_op_toggle ();
+		break;
+
+	case RIG_OP_CPY:
+		if (!rig_data_has_vfo_op_copy ())
+			return -RIG_ENAVAIL;
+		rig_data_vfo_op_copy ();
+		break;
+
+	case RIG_OP_XCHG:
+		if (!rig_data_has_vfo_op_xchg ())
+			return -RIG_ENAVAIL;
+		rig_data_vfo_op_xchg ();
+		break;
+
+	case RIG_OP_NONE:
+		return -RIG_EINVAL;
+
+	default:
+		return -RIG_ENAVAIL;
+	}
+
+	return RIG_OK;
+}
+
+
+static gint
+server_set_pstat      (GString *out, gchar **argv)
+{
+	if (!rig_data_has_set_pstat ())
+		return -RIG_ENAVAIL;
+
+	rig_data_set_pstat ((powerstat_t) atoi (argv[0]));
+
+	return RIG_OK;
+}
+
+
+static gint
+server_get_pstat      (GString *out, gchar **argv)
+{
+	g_string_append_printf (out, "%d\n", rig_data_get_pstat ());
+
+	return RIG_OK;
+}
+
+
+static gint
+server_get_info       (GString *out, gchar **argv)
+{
+	g_string_append_printf (out, "%s %s\n",
+				myrig->caps->mfg_name, myrig->caps->model_name);
+
+	return RIG_OK;
+}
+
+
+/* Rig description used by the NET rigctl backend when it opens the
+   connection; protocol version 0. */
+static gint
+server_dump_state     (GString *out, gchar **argv)
+{
+	struct rig_state *rs = &myrig->state;
+	gint i;
+
+	g_string_append_printf (out, "0\n%d\n%d\n",
+				myrig->caps->rig_model, rs->itu_region);
+
+	for (i = 0; (i < HAMLIB_FRQRANGESIZ) && !RIG_IS_FRNG_END (rs->rx_range_list[i]); i++) {
+		g_string_append_printf (out, "%.0f %.0f 0x%" G_GINT64_MODIFIER "x %d %d 0x%x 0x%x\n",
+					rs->rx_range_list[i].startf,
+					rs->rx_range_list[i].endf,
+					(guint64) rs->rx_range_list[i].modes,
+					rs->rx_range_list[i].low_power,
+					rs->rx_range_list[i].high_power,
+					(guint) rs->rx_range_list[i].vfo,
+					(guint) rs->rx_range_list[i].ant);
+	}
+	g_string_append (out, "0 0 0 0 0 0 0\n");
+
+	for (i = 0; (i < HAMLIB_FRQRANGESIZ) && !RIG_IS_FRNG_END (rs->tx_range_list[i]); i++) {
+		g_string_append_printf (out, "%.0f %.0f 0x%" G_GINT64_MODIFIER "x %d %d 0x%x 0x%x\n",
+					rs->tx_range_list[i].startf,
+					rs->tx_range_list[i].endf,
+					(guint64) rs->tx_range_list[i].modes,
+					rs->tx_range_list[i].low_power,
+					rs->tx_range_list[i].high_power,
+					(guint) rs->tx_range_list[i].vfo,
+					(guint) rs->tx_range_list[i].ant);
+	}
+	g_string_append (out, "0 0 0 0 0 0 0\n");
+
+	/* see rig-gui-info.c about RIG_IS_TS_END */
+	for (i = 0; (i < HAMLIB_TSLSTSIZ) && (rs->tuning_steps[i].ts != 0); i++) {
+		g_string_append_printf (out, "0x%" G_GINT64_MODIFIER "x %ld\n",
+					(guint64) rs->tuning_steps[i].modes,
+					(long) rs->tuning_steps[i].ts);
+	}
+	g_string_append (out, "0 0\n");
+
+	for (i = 0; (i < HAMLIB_FLTLSTSIZ) && (rs->filters[i].modes != RIG_MODE_NONE); i++) {
+		g_string_append_printf (out, "0x%" G_GINT64_MODIFIER "x %ld\n",
+					(guint64) rs->filters[i].modes,
+					(long) rs->filters[i].width);
+	}
+	g_string_append (out, "0 0\n");
+
+	g_string_append_printf (out, "%ld\n%ld\n%ld\n%d\n",
+				(long) rs->max_rit, (long) rs->max_xit,
+				(long) rs->max_ifshift, (gint) rs->announces);
+
+	for (i = 0; (i < HAMLIB_MAXDBLSTSIZ) && (rs->preamp[i] != 0); i++)
+		g_string_append_printf (out, "%d ", rs->preamp[i]);
+	g_string_append (out, "\n");
+
+	for (i = 0; (i < HAMLIB_MAXDBLSTSIZ) && (rs->attenuator[i] != 0); i++)
+		g_string_append_printf (out, "%d ", rs->attenuator[i]);
+	g_string_append (out, "\n");
+
+	/* only what grig can actually serve */
+	g_string_append_printf (out, "0x%" G_GINT64_MODIFIER "x\n0x%" G_GINT64_MODIFIER "x\n"
+				"0x%" G_GINT64_MODIFIER "x\n0x%" G_GINT64_MODIFIER "x\n0x0\n0x0\n",
+				(guint64) (rs->has_get_func & GRIG_FUNC_RD),
+				(guint64) (rs->has_set_func & GRIG_FUNC_WR),
+				(guint64) (rs->has_get_level & GRIG_LEVEL_RD),
+				(guint64) (rs->has_set_level & GRIG_LEVEL_WR));
+
+	return RIG_OK;
+}
+
+
+static gint
+server_chk_vfo        (GString *out, gchar **argv)
+{
+	g_string_append (out, "CHKVFO 0\n");
+
+	return RIG_OK;
+}
+
+
+/** \brief Register interest in an on-demand field for the current client.
+ *  \param field The field; RIG_DATA_FIELD_NUMBER is ignored.
+ *
+ * The first value is the one polled at the keep-alive rate, subsequent
+ * reads get values polled at full rate.
+ */
+static void
+server_interest      (rig_data_field_t field)
+{
+	if ((field >= RIG_DATA_FIELD_NUMBER) || (myclient == NULL))
+		return;
+
+	if (!(myclient->interest & (1 << field))) {
+		rig_data_add_interest (field);
+		myclient->interest |= 1 << field;
+	}
+}
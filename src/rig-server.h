@@ -0,0 +1,56 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+    Grig:  Gtk+ user interface for the Hamradio Control Libraries.
+
+    Copyright (C)  2001-2007  Alexandru Csete.
+
+    Authors: Alexandru Csete <oz9aec@gmail.com>
+
+    Comments, questions and bugreports should be submitted via
+    http://sourceforge.net/projects/groundstation/
+    More details can be found at the project home page:
+
+            http://groundstation.sourceforge.net/
+ 
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+  
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+  
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, visit http://www.fsf.org/
+ 
+ 
+ 
+*/
+/** \file rig-server.h
+ *  \ingroup shdata
+ *  \brief rigctld compatible network server.
+ *
+ * The server lets other programs (loggers, digital mode software, rigctl)
+ * share the radio with grig. It speaks the rigctld line protocol on a TCP
+ * port of the loopback interface, so clients can use the hamlib "NET rigctl"
+ * backend (model 2), e.g.
+ *
+ *   rigctl -m 2 -r localhost:4532 f
+ *
+ * Queries are answered from the settings last read by the rig daemon and
+ * never touch the radio port. Changes are stored in the shared data like
+ * changes made in the user interface, and the daemon sends them to the radio
+ * in its next cycle.
+ */
+#ifndef RIG_SERVER_H
+#define RIG_SERVER_H 1
+
+#include <glib.h>
+
+
+gboolean rig_server_start (gint port);
+void     rig_server_stop  (void);
+
+#endif
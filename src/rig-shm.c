@@ -0,0 +1,246 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+    Grig:  Gtk+ user interface for the Hamradio Control Libraries.
+
+    Copyright (C)  2001-2007  Alexandru Csete.
+
+    Authors: Alexandru Csete <oz9aec@gmail.com>
+
+    Comments, questions and bugreports should be submitted via
+    http://sourceforge.net/projects/groundstation/
+    More details can be found at the project home page:
+
+            http://groundstation.sourceforge.net/
+ 
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+  
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+  
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, visit http://www.fsf.org/
+ 
+ 
+ 
+*/
+/** \file rig-shm.c
+ *  \ingroup shdata
+ *  \brief Publication of the rig state in shared memory.
+ *
+ * The rig daemon calls rig_shm_publish() after each executed command. The
+ * segment has a single writer: rig_shm_start() fills in the initial state
+ * before the segment is made visible to the daemon, and rig_shm_stop() is
+ * called after the daemon has stopped.
+ */
+#include <glib.h>
+#include <glib/gi18n.h>
+#include <string.h>
+#include <errno.h>
+#include <hamlib/rig.h>
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+#ifdef HAVE_SYS_MMAN_H
+#  include <unistd.h>
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#endif
+#include "grig-debug.h"
+#include "grig-shm.h"
+#include "rig-daemon.h"
+#include "rig-data.h"
+#include "rig-shm.h"
+
+
+static grig_shm_t *shm     = NULL;   /*!< The mapped segment or NULL. */
+static gchar      *shmname = NULL;   /*!< Name of the segment. */
+
+
+static gint64 rig_shm_time (void);
+static void   rig_shm_write (grig_shm_t *seg, const grig_settings_t *get);
+
+
+
+/** \brief Start publishing.
+ *  \param name Name of the segment, e.g. GRIG_SHM_NAME.
+ *  \param rigid The hamlib model of the radio.
+ *  \return TRUE if the segment has been created.
+ *
+ * The segment is created, or reused if it exists, and is readable by all
+ * users. The current settings are published immediately.
+ */
+gboolean
+rig_shm_start   (const gchar *name, gint rigid)
+{
+#ifdef HAVE_SYS_MMAN_H
+	grig_shm_t *seg;
+	void       *addr;
+	gint        fd;
+
+
+	if ((name == NULL) || (shm != NULL))
+		return FALSE;
+
+	fd = shm_open (name, O_CREAT | O_RDWR, 0644);
+	if (fd < 0) {
+		grig_debug_local (RIG_DEBUG_ERR,
+				  _("%s: Could not create shared memory %s (%s)"),
+				  __FUNCTION__, name, g_strerror (errno));
+		return FALSE;
+	}
+
+	if (ftruncate (fd, sizeof (grig_shm_t)) < 0) {
+		grig_debug_local (RIG_DEBUG_ERR,
+				  _("%s: Could not resize shared memory %s (%s)"),
+				  __FUNCTION__, name, g_strerror (errno));
+		close (fd);
+		return FALSE;
+	}
+
+	addr = mmap (NULL, sizeof (grig_shm_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close (fd);
+
+	if (addr == MAP_FAILED) {
+		grig_debug_local (RIG_DEBUG_ERR,
+				  _("%s: Could not map shared memory %s (%s)"),
+				  __FUNCTION__, name, g_strerror (errno));
+		return FALSE;
+	}
+
+	seg = (grig_shm_t *) addr;
+
+	/* invalidate while the header is written; a reader could
+	   still have the segment of a previous run mapped */
+	seg->magic = 0;
+	GRIG_SHM_BARRIER ();
+
+	seg->version = GRIG_SHM_VERSION;
+	seg->size = sizeof (grig_shm_t);
+	seg->seq = 0;
+	seg->pid = getpid ();
+	seg->rig_model = rigid;
+	seg->start_time = rig_shm_time ();
+	memset (&seg->state, 0, sizeof (grig_shm_state_t));
+
+	rig_shm_write (seg, rig_data_get_get_addr ());
+
+	GRIG_SHM_BARRIER ();
+	seg->magic = GRIG_SHM_MAGIC;
+
+	shmname = g_strdup (name);
+	shm = seg;
+
+	/* readers expect fresh values while grig is minimized */
+	rig_daemon_add_consumer ();
+
+	grig_debug_local (RIG_DEBUG_VERBOSE,
+			  _("%s: Publishing rig state in shared memory %s"),
+			  __FUNCTION__, name);
+
+	return TRUE;
+#else
+	grig_debug_local (RIG_DEBUG_ERR,
+			  _("%s: Shared memory is not supported on this platform"),
+			  __FUNCTION__);
+
+	return FALSE;
+#endif
+}
+
+
+/** \brief Publish the current settings.
+ *  \param get The 'get' settings.
+ */
+void
+rig_shm_publish (const grig_settings_t *get)
+{
+	if (shm != NULL)
+		rig_shm_write (shm, get);
+}
+
+
+/** \brief Stop publishing and remove the segment.
+ *
+ * Readers which still have the segment mapped see pid 0.
+ */
+void
+rig_shm_stop    ()
+{
+#ifdef HAVE_SYS_MMAN_H
+	if (shm == NULL)
+		return;
+
+	shm->pid = 0;
+
+	munmap (shm, sizeof (grig_shm_t));
+	shm_unlink (shmname);
+
+	shm = NULL;
+	g_free (shmname);
+	shmname = NULL;
+
+	rig_daemon_remove_consumer ();
+#endif
+}
+
+
+/** \brief Get wall clock time in microseconds. */
+static gint64
+rig_shm_time    ()
+{
+#if GLIB_CHECK_VERSION(2,28,0)
+	return g_get_real_time ();
+#else
+	GTimeVal tval;
+
+	g_get_current_time (&tval);
+
+	return ((gint64) tval.tv_sec * G_USEC_PER_SEC) + tval.tv_usec;
+#endif
+}
+
+
+/** \brief Write a new snapshot under the sequence lock. */
+static void
+rig_shm_write   (grig_shm_t *seg, const grig_settings_t *get)
+{
+	grig_shm_state_t *state = &seg->state;
+
+
+	seg->seq++;
+	GRIG_SHM_BARRIER ();
+
+	state->time     = rig_shm_time ();
+	state->count++;
+	state->freq1    = get->freq1;
+	state->freq2    = get->freq2;
+	state->mode     = get->mode;
+	state->pbw      = get->pbw;
+	state->vfo      = get->vfo;
+	state->pstat    = get->pstat;
+	state->ptt      = get->ptt;
+	state->split    = get->split;
+	state->lock     = get->lock;
+	state->rit      = get->rit;
+	state->xit      = get->xit;
+	state->agc      = get->agc;
+	state->att      = get->att;
+	state->preamp   = get->preamp;
+	state->antenna  = get->antenna;
+	state->strength = get->strength;
+	state->power    = get->power;
+	state->swr      = get->swr;
+	state->alc      = get->alc;
+	state->afg      = get->afg;
+	state->rfg      = get->rfg;
+	state->sql      = get->sql;
+
+	GRIG_SHM_BARRIER ();
+	seg->seq++;
+}
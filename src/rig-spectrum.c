@@ -0,0 +1,271 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+    Grig:  Gtk+ user interface for the Hamradio Control Libraries.
+
+    Copyright (C)  2001-2007  Alexandru Csete.
+
+    Authors: Alexandru Csete <oz9aec@gmail.com>
+
+    Comments, questions and bugreports should be submitted via
+    http://sourceforge.net/projects/groundstation/
+    More details can be found at the project home page:
+
+            http://groundstation.sourceforge.net/
+ 
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+  
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+  
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, visit http://www.fsf.org/
+ 
+ 
+ 
+*/
+/** \file rig-spectrum.c
+ *  \ingroup shdata
+ *  \brief Spectrum scope data streamed by the rig.
+ *
+ * The ring has a single producer, the hamlib callback, and a single
+ * consumer, the user interface. The producer only writes the slot at
+ * 'head' and the consumer only reads the slot at 'tail'; each side
+ * publishes its progress with an atomic store after it is done with the
+ * slot, so no lock is needed. One slot is always left empty to tell a
+ * full ring from an empty one.
+ */
+#include <glib.h>
+#include <glib/gi18n.h>
+#include <string.h>
+#include <hamlib/rig.h>
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+#include "grig-debug.h"
+#include "rig-spectrum.h"
+
+
+static gboolean             enabled  = FALSE;  /*!< Streaming has been requested. */
+static gboolean             running  = FALSE;  /*!< Scope lines are being received. */
+static rig_spectrum_line_t  ring[RIG_SPECTRUM_SLOTS];  /*!< The scope lines. */
+static volatile gint        head     = 0;      /*!< Slot written next by hamlib. */
+static volatile gint        tail     = 0;      /*!< Slot read next by the user interface. */
+static volatile gint        received = 0;      /*!< Number of lines put into the ring. */
+static volatile gint        dropped  = 0;      /*!< Number of lines dropped. */
+
+
+#ifdef HAVE_RIG_SET_SPECTRUM_CALLBACK
+static int spectrum_cb (RIG *rig, struct rig_spectrum_line *line, rig_ptr_t data);
+#endif
+
+
+
+/** \brief Request the scope data of the primary rig.
+ *  \param enable Whether the scope data should be streamed.
+ *
+ * This function must be called before rig_daemon_start().
+ */
+void
+rig_spectrum_enable  (gboolean enable)
+{
+	enabled = enable;
+}
+
+
+/** \brief Check whether the primary rig streams scope data.
+ *  \return TRUE if the scope lines are passed on.
+ */
+gboolean
+rig_spectrum_running ()
+{
+	return running;
+}
+
+
+/** \brief Take the oldest scope line out of the ring.
+ *  \param line Location to store the line.
+ *  \return FALSE if the ring is empty.
+ *
+ * Only the user interface may call this function.
+ */
+gboolean
+rig_spectrum_pop     (rig_spectrum_line_t *line)
+{
+	gint t = g_atomic_int_get (&tail);
+
+	if (t == g_atomic_int_get (&head))
+		return FALSE;
+
+	memcpy (line, &ring[t],
+		G_STRUCT_OFFSET (rig_spectrum_line_t, data) + ring[t].points);
+
+	g_atomic_int_set (&tail, (t + 1) % RIG_SPECTRUM_SLOTS);
+
+	return TRUE;
+}
+
+
+/** \brief Get the level of a point in dB.
+ *  \param line The scope line.
+ *  \param i The index of the point.
+ *  \return The level rounded to whole dB.
+ */
+gint
+rig_spectrum_level   (const rig_spectrum_line_t *line, guint i)
+{
+	if (line->datamax <= line->datamin)
+		return (gint) line->dbmin;
+
+	return (gint) (line->dbmin + (line->data[i] - line->datamin) *
+		       (line->dbmax - line->dbmin) / (line->datamax - line->datamin));
+}
+
+
+/** \brief Enable asynchronous data before the rig is opened.
+ *  \param rig The primary rig.
+ */
+void
+rig_spectrum_prepare (RIG *rig)
+{
+	gint retcode;
+
+	if (!enabled)
+		return;
+
+	retcode = rig_set_conf (rig, rig_token_lookup (rig, "async"), "1");
+
+	if (retcode != RIG_OK) {
+		grig_debug_local (RIG_DEBUG_WARN,
+				  _("%s: Could not enable asynchronous data (%d)"),
+				  __FUNCTION__, retcode);
+	}
+}
+
+
+/** \brief Start receiving scope lines after the rig has been opened.
+ *  \param rig The primary rig.
+ */
+void
+rig_spectrum_start   (RIG *rig)
+{
+#ifdef HAVE_RIG_SET_SPECTRUM_CALLBACK
+	gint retcode;
+#endif
+
+	if (!enabled || running)
+		return;
+
+#ifdef HAVE_RIG_SET_SPECTRUM_CALLBACK
+	g_atomic_int_set (&head, 0);
+	g_atomic_int_set (&tail, 0);
+	g_atomic_int_set (&received, 0);
+	g_atomic_int_set (&dropped, 0);
+
+	retcode = rig_set_spectrum_callback (rig, spectrum_cb, NULL);
+
+	if (retcode != RIG_OK) {
+		grig_debug_local (RIG_DEBUG_ERR,
+				  _("%s: Could not install the spectrum callback (%d)"),
+				  __FUNCTION__, retcode);
+		return;
+	}
+
+	/* the scope output may also have been switched on at the rig */
+	retcode = rig_set_func (rig, RIG_VFO_CURR, RIG_FUNC_SPECTRUM, 1);
+
+	if (retcode != RIG_OK) {
+		grig_debug_local (RIG_DEBUG_WARN,
+				  _("%s: Could not switch on the scope output (%d)"),
+				  __FUNCTION__, retcode);
+	}
+
+	running = TRUE;
+
+	grig_debug_local (RIG_DEBUG_VERBOSE,
+			  _("%s: Waiting for scope data"),
+			  __FUNCTION__);
+#else
+	grig_debug_local (RIG_DEBUG_WARN,
+			  _("%s: This version of hamlib does not deliver scope data"),
+			  __FUNCTION__);
+#endif
+}
+
+
+/** \brief Stop receiving scope lines before the rig is closed.
+ *  \param rig The primary rig.
+ */
+void
+rig_spectrum_stop    (RIG *rig)
+{
+	if (!running)
+		return;
+
+#ifdef HAVE_RIG_SET_SPECTRUM_CALLBACK
+	rig_set_func (rig, RIG_VFO_CURR, RIG_FUNC_SPECTRUM, 0);
+	rig_set_spectrum_callback (rig, NULL, NULL);
+#endif
+
+	running = FALSE;
+
+	grig_debug_local (RIG_DEBUG_VERBOSE,
+			  _("%s: %d scope lines received, %d dropped"),
+			  __FUNCTION__,
+			  g_atomic_int_get (&received), g_atomic_int_get (&dropped));
+}
+
+
+#ifdef HAVE_RIG_SET_SPECTRUM_CALLBACK
+/** \brief Put a scope line into the ring.
+ *  \param rig The rig.
+ *  \param line The scope line from hamlib.
+ *  \param data Unused.
+ *  \return Always RIG_OK.
+ *
+ * This function is called by hamlib in its own thread and must not wait
+ * for the user interface.
+ */
+static int
+spectrum_cb          (RIG *rig, struct rig_spectrum_line *line, rig_ptr_t data)
+{
+	rig_spectrum_line_t *slot;
+	gint                 h, next;
+
+	h = g_atomic_int_get (&head);
+	next = (h + 1) % RIG_SPECTRUM_SLOTS;
+
+	/* the user interface has not caught up */
+	if (next == g_atomic_int_get (&tail)) {
+		g_atomic_int_inc (&dropped);
+		return RIG_OK;
+	}
+
+	slot = &ring[h];
+
+	slot->low = line->low_edge_freq;
+	slot->high = line->high_edge_freq;
+
+	/* center mode lines may only carry the center and span */
+	if (slot->high <= slot->low) {
+		slot->low = line->center_freq - line->span_freq / 2;
+		slot->high = line->center_freq + line->span_freq / 2;
+	}
+
+	slot->points = MIN (line->spectrum_data_length, RIG_SPECTRUM_MAX_POINTS);
+	slot->datamin = line->data_level_min;
+	slot->datamax = line->data_level_max;
+	slot->dbmin = line->signal_strength_min;
+	slot->dbmax = line->signal_strength_max;
+	memcpy (slot->data, line->spectrum_data, slot->points);
+
+	g_atomic_int_set (&head, next);
+	g_atomic_int_inc (&received);
+
+	return RIG_OK;
+}
+#endif
@@ -0,0 +1,79 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+    Grig:  Gtk+ user interface for the Hamradio Control Libraries.
+
+    Copyright (C)  2001-2007  Alexandru Csete.
+
+    Authors: Alexandru Csete <oz9aec@gmail.com>
+
+    Comments, questions and bugreports should be submitted via
+    http://sourceforge.net/projects/groundstation/
+    More details can be found at the project home page:
+
+            http://groundstation.sourceforge.net/
+ 
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+  
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+  
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, visit http://www.fsf.org/
+ 
+ 
+ 
+*/
+/** \file rig-spectrum.h
+ *  \ingroup shdata
+ *  \brief Spectrum scope data streamed by the rig (interface).
+ *
+ * Some rigs, e.g. recent Icom and Yaesu models, send the data of their
+ * spectrum scope to the computer. Hamlib delivers these scope lines to a
+ * callback in its own thread when asynchronous data is enabled. The scope
+ * lines of the primary rig are passed on to the user interface through a
+ * lock-free ring of RIG_SPECTRUM_SLOTS lines: the hamlib thread never
+ * waits for the user interface, and when the ring is full because the
+ * user interface is too slow, the new line is dropped.
+ *
+ * The hamlib dummy rig (model 1) sends a simulated spectrum.
+ */
+#ifndef RIG_SPECTRUM_H
+#define RIG_SPECTRUM_H 1
+
+#include <glib.h>
+#include <hamlib/rig.h>
+
+
+#define RIG_SPECTRUM_SLOTS       16     /*!< Number of lines in the ring. */
+#define RIG_SPECTRUM_MAX_POINTS  2048   /*!< Max number of points in a line. */
+
+
+/** \brief Scope line. */
+typedef struct {
+	freq_t   low;       /*!< Frequency of the first point [Hz]. */
+	freq_t   high;      /*!< Frequency of the last point [Hz]. */
+	guint    points;    /*!< Number of points. */
+	gint     datamin;   /*!< Raw value of the weakest level. */
+	gint     datamax;   /*!< Raw value of the strongest level. */
+	gdouble  dbmin;     /*!< Weakest level [dB]. */
+	gdouble  dbmax;     /*!< Strongest level [dB]. */
+	guchar   data[RIG_SPECTRUM_MAX_POINTS];  /*!< Raw levels. */
+} rig_spectrum_line_t;
+
+
+void     rig_spectrum_enable  (gboolean enable);
+gboolean rig_spectrum_running (void);
+gboolean rig_spectrum_pop     (rig_spectrum_line_t *line);
+gint     rig_spectrum_level   (const rig_spectrum_line_t *line, guint i);
+
+/* used by the daemon */
+void     rig_spectrum_prepare (RIG *rig);
+void     rig_spectrum_start   (RIG *rig);
+void     rig_spectrum_stop    (RIG *rig);
+
+#endif